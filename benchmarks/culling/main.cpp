@@ -0,0 +1,80 @@
+#include <ituGL/scene/CullingBatch.h>
+#include <ituGL/camera/Camera.h>
+#include <glm/gtc/constants.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Measures frustum culling of N random AABBs, one object at a time through Bounds and batched through CullingBatch
+int main()
+{
+    Camera camera;
+    camera.SetViewMatrix(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    camera.SetPerspectiveProjectionMatrix(glm::half_pi<float>(), 16.0f / 9.0f, 0.1f, 500.0f);
+    FrustumBounds frustum(camera.GetViewProjectionMatrix());
+
+    std::printf("SIMD path: %s\n", CullingBatch::IsSimdEnabled() ? "AVX2" : "disabled");
+    std::printf("%10s %10s %14s %14s %14s\n", "objects", "visible", "per-object ms", "scalar ms", "batch ms");
+
+    const int iterations = 10;
+    for (unsigned int count : { 10000u, 100000u, 1000000u })
+    {
+        // Objects spread in a cube around the camera, so around a fifth of them are visible
+        std::mt19937 random(count);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> extent(0.1f, 4.0f);
+
+        std::vector<AabbBounds> bounds;
+        bounds.reserve(count);
+        CullingBatch batch;
+        batch.Reserve(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            glm::vec3 center(position(random), position(random), position(random));
+            glm::vec3 size(extent(random), extent(random), extent(random));
+            bounds.emplace_back(center, size);
+            batch.Add(bounds.back());
+        }
+
+        std::vector<unsigned int> visibleIndices;
+        visibleIndices.reserve(count);
+
+        using Clock = std::chrono::high_resolution_clock;
+        auto Measure = [&](auto&& cull)
+        {
+            auto start = Clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                visibleIndices.clear();
+                cull();
+            }
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+        };
+
+        double perObjectTime = Measure([&]()
+            {
+                for (unsigned int i = 0; i < count; ++i)
+                {
+                    if (Bounds::Intersects(frustum, bounds[i]))
+                    {
+                        visibleIndices.push_back(i);
+                    }
+                }
+            });
+        size_t perObjectVisible = visibleIndices.size();
+
+        double scalarTime = Measure([&]() { batch.CullScalar(frustum, visibleIndices); });
+        double batchTime = Measure([&]() { batch.Cull(frustum, visibleIndices); });
+
+        // The batch also rejects with the bounding sphere, so it can only cull more
+        std::printf("%10u %10zu %14.3f %14.3f %14.3f\n", count, visibleIndices.size(), perObjectTime, scalarTime, batchTime);
+        if (visibleIndices.size() > perObjectVisible)
+        {
+            std::printf("Mismatch: batch returned more objects than per-object culling (%zu)\n", perObjectVisible);
+            return 1;
+        }
+    }
+
+    return 0;
+}
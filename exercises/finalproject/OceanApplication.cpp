@@ -22,16 +22,31 @@
 #include <iostream>
 #include <imgui.h>
 #include <chrono>
-#include <ituGL/asset/Texture2DLoader.h>
-#include <ituGL/asset/TextureCubemapLoader.h>
-
-OceanApplication::OceanApplication()
+#include <array>
+#include <ituGL/asset/TextureLoader.h>
+#include <ituGL/asset/AsyncTextureLoader.h>
+#include <ituGL/asset/TextureCache.h>
+#include <ituGL/asset/AssetPack.h>
+#include <ituGL/texture/BlockCompressor.h>
+#include <ituGL/texture/MipmapGenerator.h>
+#include <ituGL/core/ThreadPool.h>
+#include <algorithm>
+#include <future>
+#include <cassert>
+#include <string>
+
+// Vertices per side of the terrain occluder. Far less than the terrain grid, the occluder only needs the rough shape
+static const unsigned int s_occluderResolution = 48;
+
+// Memory for the resident skyboxes. The one that is shown always stays, even if it doesn't fit
+static const std::size_t s_skyboxMemoryBudget = 32 << 20;
+
+OceanApplication::OceanApplication(bool buildAssetPack, bool asyncStartup)
 	: Application(1024, 1024, "Ocean demo")
 	, m_gridX(128), m_gridY(128)
 	, m_startTime(std::chrono::steady_clock::now())
-	// Shader loaders
-	, m_vertexShaderLoader(Shader::Type::VertexShader)
-	, m_fragmentShaderLoader(Shader::Type::FragmentShader)
+	, m_buildAssetPack(buildAssetPack)
+	, m_asyncStartup(asyncStartup)
 	// Camera
 	, m_cameraPosition(10, 15, 20)
 	, m_cameraTranslationSpeed(5.0f)
@@ -39,6 +54,19 @@ OceanApplication::OceanApplication()
 	, m_cameraEnabled(false)
 	, m_cameraEnablePressed(false)
 	, m_mousePosition(GetMainWindow().GetMousePosition(true))
+	// Shader programs, from binaries saved by previous runs when possible
+	, m_shaderProgramCache("shadercache")
+	// Textures
+	, m_textureResidency(ThreadPool::GetDefault(), s_skyboxMemoryBudget)
+	, m_skyboxId(-1)
+	, m_requestedSkyboxId(0)
+	// Occlusion culling
+	, m_presetId(0)
+	, m_occlusionMode(OcclusionMode::CPU)
+	, m_occlusionBuffer(256, 128)
+	, m_previousViewProjMatrix(1.0f)
+	, m_hasPreviousDepth(false)
+	, m_readGpuCullingStats(false)
 	// Adjustable values
 	// Terrain
 	, m_terrainBounds(glm::vec4(-10.0f, -10.0f, 10.0f, 10.0f))
@@ -81,10 +109,53 @@ void OceanApplication::Initialize()
 	// Initialize DearImGUI
 	m_imGui.Initialize(GetMainWindow());
 
+	// The assets come from the pack when there is one, instead of the loose files.
+	// When building it, the loose files are loaded and the processed textures are added to it
+	AssetPackWriter assetPackWriter;
+	if (m_buildAssetPack)
+	{
+		TextureCache::GetDefault().SetPackWriter(&assetPackWriter);
+	}
+	else if (AssetPack::GetDefault().Open("assets.pack"))
+	{
+		std::cout << "Asset pack: " << AssetPack::GetDefault().GetEntryCount() << " entries" << std::endl;
+	}
+
 	// Initialize scene content
+	// (the shaders compile in the driver while the textures load, and the first frames use a fallback program)
+	InitializeShaderPrograms();
 	InitializeTextures();
 	InitializeMaterials();
 	InitializeMeshes();
+	if (!m_asyncStartup)
+	{
+		// The programs are ready before the first frame, the fallback is never shown
+		m_shaderProgramCache.Finish();
+		ReportShaderPrograms();
+	}
+
+	if (m_buildAssetPack)
+	{
+		// The skyboxes are only loaded when they are shown, load them all now so they go in the pack too
+		for (TextureResidencyManager::Id skyboxTexture : m_skyboxTexture)
+		{
+			m_textureResidency.RequestNow(skyboxTexture);
+		}
+		TextureCache::GetDefault().SetPackWriter(nullptr);
+
+		// The shaders and the heightmaps go as they are. The heightmaps are also decoded on the CPU
+		assetPackWriter.AddDirectory("shaders");
+		for (int i = 0; i < 3; ++i)
+		{
+			assetPackWriter.AddFile(("textures/heightmap" + std::to_string(i) + ".png").c_str());
+		}
+		bool written = assetPackWriter.Write("assets.pack");
+		std::cout << "Asset pack: " << (written ? "wrote " : "couldn't write ") << assetPackWriter.GetEntryCount() << " entries" << std::endl;
+	}
+
+	// With the async startup, this should be bound by the slowest texture, instead of the sum of all the assets
+	auto startupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime);
+	std::cout << "Startup: " << startupTime.count() << " ms until the first frame (" << (m_asyncStartup ? "async" : "serial") << ")" << std::endl;
 
 	// Initialize camera
 	InitializeCamera();
@@ -101,8 +172,19 @@ void OceanApplication::Update()
 {
 	Application::Update();
 
+	// The materials and the culling objects switch to their programs as they are completed
+	if (m_shaderProgramCache.GetPendingCount() > 0 && m_shaderProgramCache.Update() > 0 && m_shaderProgramCache.GetPendingCount() == 0)
+	{
+		ReportShaderPrograms();
+	}
+
 	UpdateCamera();
 
+	UpdateOcclusion();
+
+	UpdateSkybox();
+	m_textureResidency.Update();
+
 	UpdateUniforms();
 }
 
@@ -112,11 +194,27 @@ void OceanApplication::Render()
 	
 	// Before water pass
 	m_fbBeforeWater->Bind();
+	// the depth of the previous frame is still there, build the depth pyramid from it before clearing
+	bool gpuCulling = m_occlusionMode == OcclusionMode::GPU;
+	bool queryCulling = m_occlusionMode == OcclusionMode::Queries;
+	if (queryCulling)
+		m_queryCuller->BeginFrame();
+	if (gpuCulling && m_hasPreviousDepth)
+	{
+		int width, height;
+		GetMainWindow().GetDimensions(width, height);
+		m_depthPyramid->Build(*m_fbBeforeWaterDepth, width, height, m_previousViewProjMatrix);
+	}
 	// clear color and depth
 	GetDevice().Clear(true, Color(0.0f, 0.0f, 0.0f, 1.0f), true, 1.0f);
 	// draw terrain and skybox
-	DrawTerrain();
+	if (gpuCulling)
+		CullAndDrawTerrain();
+	else
+		DrawTerrain();
 	DrawSkybox();
+	m_previousViewProjMatrix = m_camera.GetViewProjectionMatrix();
+	m_hasPreviousDepth = true;
 
 	// Main pass
 	FramebufferObject::Unbind();
@@ -124,9 +222,14 @@ void OceanApplication::Render()
 	GetDevice().Clear(true, Color(0.0f, 0.0f, 0.0f, 1.0f), true, 1.0f);
 	// draw terrain and skybox ( again :( )
 	DrawTerrain();
+	// the ocean is drawn with the queries of the previous frame, so these can test against the terrain only
+	if (queryCulling)
+		DrawOcclusionProxies();
 	DrawSkybox();
 	// draw ocean
 	DrawOcean();
+	if (queryCulling)
+		m_queryCuller->EndFrame();
 
 	// Render the debug user interface
 	RenderGUI();
@@ -142,23 +245,80 @@ void OceanApplication::Cleanup()
 
 void OceanApplication::InitializeTextures()
 {
-	// Skyboxes
-	m_skyboxTexture[0] = TextureCubemapLoader::LoadTextureShared("textures/skybox0.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB);
-	m_skyboxTexture[1] = TextureCubemapLoader::LoadTextureShared("textures/skybox1.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB);
-	m_skyboxTexture[2] = TextureCubemapLoader::LoadTextureShared("textures/skybox2.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB);
-	m_skyboxTexture[3] = TextureCubemapLoader::LoadTextureShared("textures/skybox3.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB);
+	auto startTime = std::chrono::steady_clock::now();
+
+	// The images are decoded in parallel, and uploaded here as they finish.
+	// Without the async startup, a single worker decodes them one after the other, to compare the startup times
+	ThreadPool serialThreadPool(1);
+	ThreadPool& threadPool = m_asyncStartup ? ThreadPool::GetDefault() : serialThreadPool;
+	AsyncTextureLoader loader(threadPool);
+
+	// Block compressed formats for the textures that are only sampled in fragment shaders.
+	// The first run builds their mipmaps and encodes them, the next ones load them from the texture cache
+	TextureObject::InternalFormat colorFormat = BlockCompressor::SelectInternalFormat(BlockCompressor::Usage::Color);
+	TextureObject::InternalFormat normalFormat = BlockCompressor::SelectInternalFormat(BlockCompressor::Usage::Normal);
+	TextureObject::InternalFormat maskFormat = BlockCompressor::SelectInternalFormat(BlockCompressor::Usage::Mask);
+
+	// The color textures are sRGB, their mipmaps are filtered in linear space
+	MipmapGenerator::Settings colorMipmapSettings;
+	colorMipmapSettings.srgb = true;
+	loader.SetMipmapSettings(colorMipmapSettings);
+
+	// Skyboxes, loaded when they are shown. The first one starts loading with the other textures
+	for (int i = 0; i < 4; ++i)
+	{
+		m_skyboxTexture[i] = m_textureResidency.AddCubemap(("textures/skybox" + std::to_string(i) + ".png").c_str(),
+			TextureObject::FormatRGB, colorFormat, true, colorMipmapSettings);
+	}
+	m_textureResidency.Request(m_skyboxTexture[0]);
 
 	// Terrain
-    m_terrainTexture = Load2DTexture("textures/dirt.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
+	m_terrainTexture = loader.Load2D("textures/dirt.png", TextureObject::FormatRGB, colorFormat);
 
 	// Heightmaps
-	m_heightmapTexture[0] = Load2DTexture("textures/heightmap0.png", TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA, GL_CLAMP_TO_EDGE, GL_LINEAR); // heightmaps only really need R, but the texture files are RGBA, so we just have to roll with it
-	m_heightmapTexture[1] = Load2DTexture("textures/heightmap1.png", TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA, GL_CLAMP_TO_EDGE, GL_LINEAR); // no terrain (for debugging)
-	m_heightmapTexture[2] = Load2DTexture("textures/heightmap2.png", TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA, GL_CLAMP_TO_EDGE, GL_LINEAR);
+	// (not compressed: they displace the vertices, and the block errors would show up as steps in the terrain)
+	// (no mipmaps either, they are sampled without them)
+	// (only R, at 16 bits: the files are 16-bit, and 8 bits would show up as terraces in the terrain)
+	m_heightmapTexture[0] = loader.Load2D("textures/heightmap0.png", TextureObject::FormatR, TextureObject::InternalFormatR16, false);
+	m_heightmapTexture[1] = loader.Load2D("textures/heightmap1.png", TextureObject::FormatR, TextureObject::InternalFormatR16, false); // no terrain (for debugging)
+	m_heightmapTexture[2] = loader.Load2D("textures/heightmap2.png", TextureObject::FormatR, TextureObject::InternalFormatR16, false);
+	// The occlusion culling and the camera also need them on the CPU. Each one only writes its own preset, so they can load in parallel too
+	std::array<std::future<void>, 3> heightmapDataLoads;
+	for (int i = 0; i < 3; ++i)
+	{
+		heightmapDataLoads[i] = threadPool.Submit([this, i]() { LoadHeightmapData(i, ("textures/heightmap" + std::to_string(i) + ".png").c_str()); });
+	}
 
 	// Ocean
-	m_oceanTexture = Load2DTexture("textures/water_n.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR); // too much detail disappears when using mip maps
-	m_foamTexture = Load2DTexture("textures/foam.png", TextureObject::FormatRGB, TextureObject::InternalFormatRGB, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
+	// (the normal map only keeps X and Y, the shader reconstructs Z)
+	MipmapGenerator::Settings normalMipmapSettings;
+	normalMipmapSettings.normalMap = true;
+	loader.SetMipmapSettings(normalMipmapSettings);
+	m_oceanTexture = loader.Load2D("textures/water_n.png", TextureObject::FormatRG, normalFormat);
+	loader.SetMipmapSettings(MipmapGenerator::Settings());
+	m_foamTexture = loader.Load2D("textures/foam.png", TextureObject::FormatR, maskFormat);
+
+	loader.Finish();
+	for (std::future<void>& heightmapDataLoad : heightmapDataLoads)
+	{
+		heightmapDataLoad.wait();
+	}
+
+	// The time to load them all, compared to the decode times of the loader
+	TextureCache& textureCache = TextureCache::GetDefault();
+	auto loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+	std::cout << "Textures: " << textureCache.GetPackCount() << " from pack, " << textureCache.GetHitCount() << " from cache, "
+		<< textureCache.GetMissCount() << " processed, " << loadTime.count() << " ms (decoding: "
+		<< loader.GetDecodeTime() << " ms in total, " << loader.GetSlowestDecodeTime() << " ms the slowest)" << std::endl;
+
+	// The loader only sets the filters, the rest is set once the images are there
+	SetTextureSampling(*m_terrainTexture, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
+	for (int i = 0; i < 3; ++i)
+	{
+		SetTextureSampling(*m_heightmapTexture[i], GL_CLAMP_TO_EDGE, GL_LINEAR);
+	}
+	SetTextureSampling(*m_oceanTexture, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR); // too much detail disappears when using mip maps
+	SetTextureSampling(*m_foamTexture, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
 
 	// Framebuffers (this re-implements what happens in GBufferRenderPass from ituGL)
 	Window& window = GetMainWindow();
@@ -189,50 +349,130 @@ void OceanApplication::InitializeTextures()
 	FramebufferObject::Unbind();
 }
 
-void OceanApplication::InitializeMaterials()
+void OceanApplication::InitializeShaderPrograms()
 {
+	// Fallback shader, drawing flat patches of the material color until the other programs are completed
+	// (it is tiny, and the only program that the startup waits for)
+	m_fallbackShaderProgram = LoadShaderProgram("shaders/fallback.vert", "shaders/fallback.frag");
+	m_shaderProgramCache.Wait(*m_fallbackShaderProgram);
+
 	// Skybox shader
 	// (the shader used here comes from exercise 8)
-	Shader skyboxVS = m_vertexShaderLoader.Load("shaders/skybox.vert");
-	Shader skyboxFS = m_fragmentShaderLoader.Load("shaders/skybox.frag");
-	std::shared_ptr<ShaderProgram> skyboxShaderProgram = std::make_shared<ShaderProgram>();
-	skyboxShaderProgram->Build(skyboxVS, skyboxFS);
-
-	// Skybox material
-	m_skyboxMaterial = std::make_shared<Material>(skyboxShaderProgram);
-	// (SkyboxTexture is set in ApplySkybox)
-
+	m_skyboxShaderProgram = LoadShaderProgram("shaders/skybox.vert", "shaders/skybox.frag", GetMaterialCompletedFunction(m_skyboxMaterial));
 
 	// Terrain shader program
 	// (the fragment shader is heavily based on the one from exercise 5, but the
 	// vertex shader is different since I need to calculate normals)
-	Shader terrainVS = m_vertexShaderLoader.Load("shaders/blinn-phong-terrain.vert");
-	Shader terrainFS = m_fragmentShaderLoader.Load("shaders/blinn-phong-terrain.frag");
-	std::shared_ptr<ShaderProgram> terrainShaderProgram = std::make_shared<ShaderProgram>();
-	terrainShaderProgram->Build(terrainVS, terrainFS);
+	m_terrainShaderProgram = LoadShaderProgram("shaders/blinn-phong-terrain.vert", "shaders/blinn-phong-terrain.frag", GetMaterialCompletedFunction(m_terrainMaterial));
+
+	// Ocean shader
+	m_oceanShaderProgram = LoadShaderProgram("shaders/ocean.vert", "shaders/ocean.frag", GetMaterialCompletedFunction(m_oceanMaterial));
+
+	// Occlusion culling shaders
+	// (each culling mode can be selected once its objects are created)
+	m_proxyShaderProgram = LoadShaderProgram("shaders/occlusion-proxy.vert", "shaders/occlusion-proxy.frag",
+		[this](std::shared_ptr<ShaderProgram> shaderProgram, bool linked)
+		{
+			if (!linked)
+				return;
+			// Occlusion queries and conditional rendering are available everywhere
+			m_queryCuller = std::make_unique<OcclusionQueryCuller>(shaderProgram);
+			m_queryCuller->SetObjectCount(2 * static_cast<unsigned int>(m_patchMatrices.size()));
+		});
+	if (DepthPyramid::IsSupported() && HiZOcclusionCuller::IsSupported())
+	{
+		m_pyramidShaderProgram = LoadShaderProgram("shaders/hiz-pyramid.comp",
+			[this](std::shared_ptr<ShaderProgram> shaderProgram, bool linked)
+			{
+				if (linked)
+					m_depthPyramid = std::make_unique<DepthPyramid>(shaderProgram);
+			});
+		m_cullShaderProgram = LoadShaderProgram("shaders/hiz-cull.comp",
+			[this](std::shared_ptr<ShaderProgram> shaderProgram, bool linked)
+			{
+				if (!linked)
+					return;
+				// terrain and ocean have their own objects, but share the shader
+				m_terrainCuller = std::make_unique<HiZOcclusionCuller>(shaderProgram);
+				m_oceanCuller = std::make_unique<HiZOcclusionCuller>(shaderProgram);
+			});
+	}
+}
+
+void OceanApplication::ReportShaderPrograms() const
+{
+	// The first run compiles everything, the next ones should only load the binaries
+	auto readyTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime);
+	std::cout << "Shader programs: " << m_shaderProgramCache.GetHitCount() << " from cache, "
+		<< m_shaderProgramCache.GetMissCount() << " compiled, " << m_shaderProgramCache.GetSharedCount() << " shared, "
+		<< m_shaderProgramCache.GetBuildTime() << " ms (" << (m_shaderProgramCache.GetMissCount() == 0 ? "warm" : "cold") << " start), "
+		<< "all ready " << readyTime.count() << " ms after the start" << std::endl;
+}
+
+ShaderProgramCache::CompletedFunction OceanApplication::GetMaterialCompletedFunction(std::shared_ptr<Material>& material)
+{
+	// The material is created later, in InitializeMaterials, but the program is only completed in Update
+	return [this, &material](std::shared_ptr<ShaderProgram> shaderProgram, bool linked)
+	{
+		// if it didn't link, keep drawing with the fallback
+		if (linked)
+		{
+			material->ChangeShader(shaderProgram);
+			InitializeMaterialUniforms();
+		}
+	};
+}
+
+void OceanApplication::InitializeMaterials()
+{
+	// The materials start with the fallback program, and change to their own when it is completed (see GetMaterialCompletedFunction)
+
+	// Skybox material
+	m_skyboxMaterial = std::make_shared<Material>(m_fallbackShaderProgram);
+	// only draw where nothing else has been drawn (depth == 1)
+	m_skyboxMaterial->SetDepthTestFunction(Material::TestFunction::Equal);
 
 	// Terrain material
-	m_terrainMaterial = std::make_shared<Material>(terrainShaderProgram);
-	// (Heightmap is set in ApplyPreset)
+	m_terrainMaterial = std::make_shared<Material>(m_fallbackShaderProgram);
+
+	// Ocean material
+	m_oceanMaterial = std::make_shared<Material>(m_fallbackShaderProgram);
+
+	// Initial call to ApplyPreset, ApplySkybox and InitializeMaterialUniforms to initialize the uniform values
+	ApplyPreset(0);
+	ApplySkybox(0);
+	InitializeMaterialUniforms();
+}
+
+void OceanApplication::InitializeMaterialUniforms()
+{
+	// Uniforms that are not updated every frame. The uniforms missing in the current program are skipped,
+	// so this is called again when a material changes its program
+
+	// Skybox material
+	// (the skybox that is shown, UpdateSkybox changes it)
+	std::shared_ptr<TextureObject> skyboxTexture = m_skyboxId >= 0 ? m_textureResidency.Request(m_skyboxTexture[m_skyboxId]) : nullptr;
+	if (skyboxTexture)
+	{
+		m_skyboxMaterial->SetUniformValue("SkyboxTexture", skyboxTexture);
+		m_oceanMaterial->SetUniformValue("SkyboxTexture", skyboxTexture);
+	}
+
+
+	// Terrain material
+	// (the heightmap of the current preset, ApplyPreset changes it)
+	m_terrainMaterial->SetUniformValue("Heightmap", m_heightmapTexture[m_presetId]);
 	m_terrainMaterial->SetUniformValue("ColorTexture", m_terrainTexture);
 	m_terrainMaterial->SetUniformValue("AmbientReflection", 1.0f);
 	m_terrainMaterial->SetUniformValue("DiffuseReflection", 1.0f);
 	
 
-	// Ocean shader
-	Shader oceanVS = m_vertexShaderLoader.Load("shaders/ocean.vert");
-	Shader oceanFS = m_fragmentShaderLoader.Load("shaders/ocean.frag");
-	std::shared_ptr<ShaderProgram> oceanShaderProgram = std::make_shared<ShaderProgram>();
-	oceanShaderProgram->Build(oceanVS, oceanFS);
-	
 	// Ocean material
-	m_oceanMaterial = std::make_shared<Material>(oceanShaderProgram);
-	// (Heightmap is set in ApplyPreset)
+	m_oceanMaterial->SetUniformValue("Heightmap", m_heightmapTexture[m_presetId]);
 	m_oceanMaterial->SetUniformValue("NormalMap", m_oceanTexture);
 	m_oceanMaterial->SetUniformValue("FoamTexture", m_foamTexture);
 	m_oceanMaterial->SetUniformValue("AmbientReflection", 1.0f);
 	m_oceanMaterial->SetUniformValue("DiffuseReflection", 1.0f);
-	// (SkyboxTexture is set in ApplySkybox)
 
 
 	// Renderbuffer stuff for water
@@ -245,9 +485,6 @@ void OceanApplication::InitializeMaterials()
 
 	m_oceanMaterial->SetUniformValue("Resolution", glm::vec2(width, height));
 
-	// Initial call to ApplyPreset, ApplySkybox and UpdateUniforms to initialize the uniform values
-	ApplyPreset(0);
-	ApplySkybox(0);
 	UpdateUniforms();
 }
 
@@ -255,6 +492,19 @@ void OceanApplication::InitializeMeshes()
 {
 	CreateTerrainMesh(m_terrainPatch, m_gridX, m_gridY);
 	CreateFullscreenMesh(m_fullscreenMesh);
+
+	// The terrain and the ocean are made of 4 patches around the origin
+	m_patchMatrices =
+	{
+		glm::scale(glm::vec3(10.0f)),
+		glm::translate(glm::vec3(-10.f, 0.0f, 0.0f)) * glm::scale(glm::vec3(10.0f)),
+		glm::translate(glm::vec3(0.f, 0.0f, -10.0f)) * glm::scale(glm::vec3(10.0f)),
+		glm::translate(glm::vec3(-10.f, 0.0f, -10.0f)) * glm::scale(glm::vec3(10.0f)),
+	};
+	m_patchInstances.SetWorldMatrices(m_patchMatrices);
+	// All of them until the first occlusion update
+	m_terrainInstances.SetWorldMatrices(m_patchMatrices);
+	m_oceanInstances.SetWorldMatrices(m_patchMatrices);
 }
 
 void OceanApplication::InitializeCamera()
@@ -415,8 +665,126 @@ void OceanApplication::UpdateUniforms()
 	m_oceanMaterial->SetUniformValue("FarPlane", 1000.0f);
 }
 
+void OceanApplication::UpdateOcclusion()
+{
+	if (m_occlusionMode == OcclusionMode::Queries)
+		return;
+
+	if (m_occlusionMode == OcclusionMode::GPU)
+	{
+		// The culling happens while rendering, here only the objects are updated. One per patch, each
+		// drawing the whole patch mesh, with baseInstance selecting its matrix in m_patchInstances
+		GLsizei indexCount = m_terrainPatch.GetSubmeshDrawcall(0).GetCount();
+		std::vector<HiZOcclusionCuller::Object> objects(m_patchMatrices.size(), HiZOcclusionCuller::Object{});
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			bool ocean = pass == 1;
+			for (unsigned int i = 0; i < objects.size(); ++i)
+			{
+				glm::vec3 patchMin, patchMax;
+				GetPatchBounds(m_patchMatrices[i], ocean, patchMin, patchMax);
+				objects[i].boundsMin = glm::vec4(patchMin, 1.0f);
+				objects[i].boundsMax = glm::vec4(patchMax, 1.0f);
+				objects[i].command = { static_cast<GLuint>(indexCount), 1, 0, 0, i };
+			}
+
+			// the bounds only change with the preset and the terrain and wave settings, don't upload them every frame
+			std::vector<HiZOcclusionCuller::Object>& uploadedObjects = m_cullerObjects[pass];
+			std::span<const std::byte> objectBytes = Data::GetBytes(std::span<const HiZOcclusionCuller::Object>(objects));
+			std::span<const std::byte> uploadedBytes = Data::GetBytes(std::span<const HiZOcclusionCuller::Object>(uploadedObjects));
+			if (!std::equal(objectBytes.begin(), objectBytes.end(), uploadedBytes.begin(), uploadedBytes.end()))
+			{
+				(ocean ? m_oceanCuller : m_terrainCuller)->SetObjects(objects);
+				uploadedObjects = objects;
+			}
+		}
+		return;
+	}
+
+	// Seen from below, the terrain faces are culled and hide nothing, so the occluder can't be used either
+	// (a negative height scale also flips it, and it would not stay under the terrain anymore)
+	glm::vec3 cameraPosition = m_camera.ExtractTranslation();
+	bool useOccluder = m_occlusionMode == OcclusionMode::CPU && !m_occluderVertices.empty() && m_terrainHeightScale > 0.0f
+		&& cameraPosition.y > GetTerrainHeight(glm::vec2(cameraPosition.x, cameraPosition.z));
+
+	if (useOccluder)
+	{
+		// The occluder is in [0, 1], place it over the heightmap bounds like the shaders do
+		glm::vec2 boundsMin(m_terrainBounds.x, m_terrainBounds.y);
+		glm::vec2 boundsMax(m_terrainBounds.z, m_terrainBounds.w);
+		glm::mat4 occluderMatrix = glm::translate(glm::vec3(boundsMin.x, m_terrainHeightOffset, boundsMin.y))
+			* glm::scale(glm::vec3(boundsMax.x - boundsMin.x, m_terrainHeightScale, boundsMax.y - boundsMin.y));
+
+		m_occlusionBuffer.Begin(m_camera.GetViewProjectionMatrix());
+		m_occlusionBuffer.AddOccluder(m_occluderVertices, m_occluderIndices, occluderMatrix);
+		m_occlusionBuffer.Rasterize(&ThreadPool::GetDefault());
+	}
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		bool ocean = pass == 1;
+		m_visiblePatchMatrices.clear();
+		for (const glm::mat4& patchMatrix : m_patchMatrices)
+		{
+			glm::vec3 patchMin, patchMax;
+			GetPatchBounds(patchMatrix, ocean, patchMin, patchMax);
+			if (!useOccluder || m_occlusionBuffer.IsVisible(patchMin, patchMax))
+			{
+				m_visiblePatchMatrices.push_back(patchMatrix);
+			}
+		}
+		(ocean ? m_oceanInstances : m_terrainInstances).SetWorldMatrices(m_visiblePatchMatrices);
+	}
+}
+
+void OceanApplication::GetPatchBounds(const glm::mat4& patchMatrix, bool ocean, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	// The patch mesh covers [0, 1] in XZ
+	glm::vec3 corner0 = patchMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	glm::vec3 corner1 = patchMatrix * glm::vec4(1.0f, 0.0f, 1.0f, 1.0f);
+	boundsMin = glm::min(corner0, corner1);
+	boundsMax = glm::max(corner0, corner1);
+
+	// Height range of the terrain, from the lowest and highest samples of the heightmap
+	// (the bilinear filter never goes outside of them)
+	const HeightmapSampler& heightmap = m_heightmapSampler[m_presetId];
+	float terrainMinY = std::min(heightmap.GetMinValue() * m_terrainHeightScale, heightmap.GetMaxValue() * m_terrainHeightScale) + m_terrainHeightOffset;
+	float terrainMaxY = std::max(heightmap.GetMinValue() * m_terrainHeightScale, heightmap.GetMaxValue() * m_terrainHeightScale) + m_terrainHeightOffset;
+
+	if (ocean)
+	{
+		// The ocean waves grow with the depth, up to the lowest point of the terrain (see getPosition in ocean.vert)
+		float waveScale = std::max(0.0f, -terrainMinY + m_oceanCoastOffset) * std::abs(m_oceanWaveScale);
+		glm::vec4 waveHeight = glm::abs(m_oceanWaveHeight);
+		glm::vec4 waveWidth = glm::abs(m_oceanWaveWidth);
+		float waveOffsetY = (waveHeight.x + waveHeight.y + waveHeight.z + waveHeight.w) * waveScale;
+		float waveOffsetXZ = (waveWidth.x + waveWidth.y + waveWidth.z + waveWidth.w) * waveScale;
+		boundsMin += glm::vec3(-waveOffsetXZ, -waveOffsetY, -waveOffsetXZ);
+		boundsMax += glm::vec3(waveOffsetXZ, waveOffsetY, waveOffsetXZ);
+	}
+	else
+	{
+		boundsMin.y = terrainMinY;
+		boundsMax.y = terrainMaxY;
+	}
+}
+
 void OceanApplication::ApplyPreset(int presetId)
 {
+	m_presetId = presetId;
+	// rebuild the terrain occluder from the new heightmap
+	const HeightmapSampler& heightmap = m_heightmapSampler[presetId];
+	if (!heightmap.IsEmpty())
+	{
+		OcclusionBuffer::CreateHeightfieldOccluder(heightmap.GetSamples(), heightmap.GetWidth(), heightmap.GetHeight(),
+			s_occluderResolution, m_occluderVertices, m_occluderIndices);
+	}
+	else
+	{
+		m_occluderVertices.clear();
+		m_occluderIndices.clear();
+	}
+
 	// change the heightmap texture
 	m_terrainMaterial->SetUniformValue("Heightmap", m_heightmapTexture[presetId]);
 	m_oceanMaterial->SetUniformValue("Heightmap", m_heightmapTexture[presetId]);
@@ -446,26 +814,102 @@ void OceanApplication::ApplyPreset(int presetId)
 
 void OceanApplication::ApplySkybox(int skyboxId)
 {
-	m_skyboxMaterial->SetUniformValue("SkyboxTexture", m_skyboxTexture[skyboxId]);
-	m_oceanMaterial->SetUniformValue("SkyboxTexture", m_skyboxTexture[skyboxId]);
+	// The current skybox stays until the new one is loaded. There is nothing to show before the first one, so wait for it
+	m_requestedSkyboxId = skyboxId;
+	if (m_skyboxId < 0)
+	{
+		m_textureResidency.RequestNow(m_skyboxTexture[skyboxId]);
+	}
+	UpdateSkybox();
 }
 
-std::shared_ptr<Texture2DObject> OceanApplication::Load2DTexture(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat, GLenum wrapMode, GLenum filter)
+void OceanApplication::UpdateSkybox()
 {
-	// I want to set some extra properties appart from what Texture2DLoader does which is why this function exists.
-	std::shared_ptr<Texture2DObject> texture = Texture2DLoader::LoadTextureShared(path, format, internalFormat);
-	
-	texture->Bind();
+	// The materials hold the skybox that is shown, so it is not evicted. The previous one can be, once it is replaced
+	std::shared_ptr<TextureObject> skyboxTexture = m_textureResidency.Request(m_skyboxTexture[m_requestedSkyboxId]);
+	if (skyboxTexture && m_skyboxId != m_requestedSkyboxId)
+	{
+		m_skyboxMaterial->SetUniformValue("SkyboxTexture", skyboxTexture);
+		m_oceanMaterial->SetUniformValue("SkyboxTexture", skyboxTexture);
+		m_skyboxId = m_requestedSkyboxId;
+	}
+	else if (m_skyboxId >= 0 && m_textureResidency.IsFailed(m_skyboxTexture[m_requestedSkyboxId]))
+	{
+		// Keep the skybox that is shown, instead of waiting for one that won't load
+		m_requestedSkyboxId = m_skyboxId;
+	}
+}
+
+void OceanApplication::LoadHeightmapData(int presetId, const char* path)
+{
+	int width = 0, height = 0;
+	Data::Type dataType;
+	std::span<const std::byte> data = TextureLoaderUtils::LoadTexture2DData(path, width, height, dataType,
+		TextureObject::FormatR, TextureObject::InternalFormatR16, false);
+
+	// Same format as the texture, so the heights match the ones in the shaders
+	HeightmapSampler& heightmap = m_heightmapSampler[presetId];
+	heightmap.Clear();
+	if (data.empty())
+	{
+		return;
+	}
+	heightmap.SetData(data, width, height, 1, dataType);
+
+	TextureLoaderUtils::FreeTexture2DData(data);
+}
+
+float OceanApplication::GetTerrainHeight(const glm::vec2& position) const
+{
+	const HeightmapSampler& heightmap = m_heightmapSampler[m_presetId];
+	if (heightmap.IsEmpty())
+	{
+		return m_terrainHeightOffset;
+	}
+
+	// Same mapping as worldToTextureCoord in the shaders, and the same filtering as the heightmap texture
+	glm::vec2 texCoord = (position - glm::vec2(m_terrainBounds.x, m_terrainBounds.y)) / (glm::vec2(m_terrainBounds.z, m_terrainBounds.w) - glm::vec2(m_terrainBounds.x, m_terrainBounds.y));
+	return heightmap.Sample(texCoord) * m_terrainHeightScale + m_terrainHeightOffset;
+}
+
+std::shared_ptr<ShaderProgram> OceanApplication::LoadShaderProgram(const char* vertexPath, const char* fragmentPath,
+	const ShaderProgramCache::CompletedFunction& completedFunction, std::span<const ShaderPreprocessor::Define> defines)
+{
+	std::shared_ptr<const std::string> vertexSource = m_shaderPreprocessor.Process(vertexPath, defines);
+	std::shared_ptr<const std::string> fragmentSource = m_shaderPreprocessor.Process(fragmentPath, defines);
+	assert(vertexSource && fragmentSource);
+	ShaderProgramCache::Source sources[] =
+	{
+		{ Shader::VertexShader, *vertexSource },
+		{ Shader::FragmentShader, *fragmentSource },
+	};
+	return m_shaderProgramCache.Submit(sources, completedFunction);
+}
+
+std::shared_ptr<ShaderProgram> OceanApplication::LoadShaderProgram(const char* computePath,
+	const ShaderProgramCache::CompletedFunction& completedFunction, std::span<const ShaderPreprocessor::Define> defines)
+{
+	std::shared_ptr<const std::string> computeSource = m_shaderPreprocessor.Process(computePath, defines);
+	assert(computeSource);
+	ShaderProgramCache::Source sources[] =
+	{
+		{ Shader::ComputeShader, *computeSource },
+	};
+	return m_shaderProgramCache.Submit(sources, completedFunction);
+}
+
+void OceanApplication::SetTextureSampling(Texture2DObject& texture, GLenum wrapMode, GLenum filter)
+{
+	// I want to set some extra properties appart from what the texture loader does which is why this function exists.
+	texture.Bind();
 	
-	texture->SetParameter(TextureObject::ParameterEnum::WrapS, wrapMode);
-	texture->SetParameter(TextureObject::ParameterEnum::WrapT, wrapMode);
+	texture.SetParameter(TextureObject::ParameterEnum::WrapS, wrapMode);
+	texture.SetParameter(TextureObject::ParameterEnum::WrapT, wrapMode);
 	
-	texture->SetParameter(TextureObject::ParameterEnum::MagFilter, filter);
-	texture->SetParameter(TextureObject::ParameterEnum::MinFilter, filter);
+	texture.SetParameter(TextureObject::ParameterEnum::MagFilter, filter);
+	texture.SetParameter(TextureObject::ParameterEnum::MinFilter, filter);
 	
 	Texture2DObject::Unbind();
-
-	return texture;
 }
 
 void OceanApplication::RenderGUI()
@@ -480,6 +924,64 @@ void OceanApplication::RenderGUI()
 	ImGui::Text(m_cameraEnabled
 		? "Press SPACE to disable camera movement\nUp: Q, Down: E\nLeft: A, Right: D\nForwards: W, Backwards: S\nRotate: Mouse"
 		: "Press SPACE to enable camera movement");
+	ImGui::Separator();
+	ImGui::Text("Occlusion Culling:");
+	ImGui::SameLine();
+	if (ImGui::RadioButton("None", m_occlusionMode == OcclusionMode::None)) m_occlusionMode = OcclusionMode::None;
+	ImGui::SameLine();
+	if (ImGui::RadioButton("CPU", m_occlusionMode == OcclusionMode::CPU)) m_occlusionMode = OcclusionMode::CPU;
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Skip the terrain and ocean patches hidden behind the terrain, tested against a small depth buffer rasterized on the CPU.");
+	if (m_queryCuller)
+	{
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Queries", m_occlusionMode == OcclusionMode::Queries))
+		{
+			// results of queries issued the last time this mode was used are too old
+			m_occlusionMode = OcclusionMode::Queries;
+			m_queryCuller->SetObjectCount(2 * static_cast<unsigned int>(m_patchMatrices.size()));
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Skip the patches whose bounding box was hidden in the previous frame, with occlusion queries and conditional rendering.");
+	}
+	if (m_depthPyramid && m_terrainCuller)
+	{
+		ImGui::SameLine();
+		if (ImGui::RadioButton("GPU", m_occlusionMode == OcclusionMode::GPU)) m_occlusionMode = OcclusionMode::GPU;
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Skip the patches hidden behind the terrain, tested in a compute shader against a depth pyramid of the terrain.");
+	}
+	unsigned int patchCount = static_cast<unsigned int>(m_patchMatrices.size());
+	if (m_occlusionMode == OcclusionMode::GPU)
+	{
+		ImGui::Checkbox("Read back visible patches", &m_readGpuCullingStats);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Waits for the GPU every frame.");
+		if (m_readGpuCullingStats)
+		{
+			ImGui::Text("Visible patches: terrain %u+%u/%u, ocean %u/%u",
+				m_terrainCuller->ReadDrawCount(HiZOcclusionCuller::Pass::First), m_terrainCuller->ReadDrawCount(HiZOcclusionCuller::Pass::Second), patchCount,
+				m_oceanCuller->ReadDrawCount(HiZOcclusionCuller::Pass::First), patchCount);
+		}
+	}
+	else if (m_occlusionMode == OcclusionMode::Queries)
+	{
+		const OcclusionQueryCuller::Statistics& frameStatistics = m_queryCuller->GetFrameStatistics();
+		const OcclusionQueryCuller::Statistics& totalStatistics = m_queryCuller->GetTotalStatistics();
+		ImGui::Text("Queries: %u issued, %u skipped, %u conditional draws",
+			frameStatistics.issuedQueries, frameStatistics.skippedQueries, frameStatistics.conditionalDraws);
+		ImGui::Text("Hit rate: %.1f%% (total %.1f%%), skip rate: %.1f%% (total %.1f%%)",
+			100.0f * frameStatistics.GetHitRate(), 100.0f * totalStatistics.GetHitRate(),
+			100.0f * frameStatistics.GetSkipRate(), 100.0f * totalStatistics.GetSkipRate());
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Hit rate: results that found a patch hidden.\nSkip rate: queries not needed, the patch was visible for a while.");
+		if (ImGui::Button("Reset Statistics"))
+			m_queryCuller->ResetStatistics();
+	}
+	else
+	{
+		ImGui::Text("Visible patches: terrain %u/%u, ocean %u/%u", m_terrainInstances.GetInstanceCount(), patchCount, m_oceanInstances.GetInstanceCount(), patchCount);
+	}
 	ImGui::End();
 
 	// Terrain
@@ -564,58 +1066,168 @@ void OceanApplication::RenderGUI()
 	if (ImGui::Button("Overcast")) ApplySkybox(2);
 	ImGui::SameLine();
 	if (ImGui::Button("Light")) ApplySkybox(3);
+	// skybox memory
+	const float megabyte = 1024.0f * 1024.0f;
+	ImGui::Text("Skybox memory: %.1f / %.1f MB, %u resident%s", m_textureResidency.GetMemoryUsage() / megabyte,
+		m_textureResidency.GetMemoryBudget() / megabyte, m_textureResidency.GetResidentCount(), m_skyboxId != m_requestedSkyboxId ? " (loading)" : "");
+	int memoryBudget = static_cast<int>(m_textureResidency.GetMemoryBudget() >> 20);
+	if (ImGui::SliderInt("Skybox budget (MB)", &memoryBudget, 0, 128))
+		m_textureResidency.SetMemoryBudget(static_cast<std::size_t>(memoryBudget) << 20);
 	ImGui::End();
 
 	m_imGui.EndFrame();
 }
 
-void OceanApplication::DrawObject(const Mesh& mesh, Material& material, const glm::mat4& worldMatrix)
+void OceanApplication::DrawObject(const Mesh& mesh, Material& material, const InstanceBuffer& instances)
 {
-	// This has not been changed from exercise 4
+	// This is based on exercise 4, but the world matrices come from the instance buffer instead of a uniform
+
+	material.Use();
+
+	ShaderProgram& shaderProgram = *material.GetShaderProgram();
+	ShaderProgram::Location locationViewProjMatrix = shaderProgram.GetUniformLocation("ViewProjMatrix");
+	material.GetShaderProgram()->SetUniform(locationViewProjMatrix, m_camera.GetViewProjectionMatrix());
+
+	// the shaders read the world matrix from the InstanceWorldMatrix attribute
+	mesh.GetSubmeshVertexArray(0).Bind();
+	ShaderProgram::Location locationInstanceWorldMatrix = shaderProgram.GetAttributeLocation("InstanceWorldMatrix");
+	instances.SetAttributes(locationInstanceWorldMatrix);
+
+	mesh.GetSubmeshDrawcall(0).DrawInstanced(instances.GetInstanceCount());
+
+	// the VAO is shared with draws that don't use instances
+	InstanceBuffer::ResetAttributes(locationInstanceWorldMatrix);
+}
+
+void OceanApplication::DrawObject(const Mesh& mesh, Material& material, const HiZOcclusionCuller& culler, HiZOcclusionCuller::Pass pass)
+{
+	// Same as above, but the GPU decides which instances are drawn: each drawcall selects its matrix with baseInstance
 
 	material.Use();
 
 	ShaderProgram& shaderProgram = *material.GetShaderProgram();
-	ShaderProgram::Location locationWorldMatrix = shaderProgram.GetUniformLocation("WorldMatrix");
-	material.GetShaderProgram()->SetUniform(locationWorldMatrix, worldMatrix);
 	ShaderProgram::Location locationViewProjMatrix = shaderProgram.GetUniformLocation("ViewProjMatrix");
 	material.GetShaderProgram()->SetUniform(locationViewProjMatrix, m_camera.GetViewProjectionMatrix());
 
-	mesh.DrawSubmesh(0);
+	mesh.GetSubmeshVertexArray(0).Bind();
+	ShaderProgram::Location locationInstanceWorldMatrix = shaderProgram.GetAttributeLocation("InstanceWorldMatrix");
+	m_patchInstances.SetAttributes(locationInstanceWorldMatrix);
+
+	culler.Draw(pass);
+
+	InstanceBuffer::ResetAttributes(locationInstanceWorldMatrix);
+}
+
+void OceanApplication::DrawObject(const Mesh& mesh, Material& material, OcclusionQueryCuller& culler, unsigned int firstObject)
+{
+	// Same as above, but one drawcall per patch, as each one is conditioned on a different query
+
+	material.Use();
+
+	ShaderProgram& shaderProgram = *material.GetShaderProgram();
+	ShaderProgram::Location locationViewProjMatrix = shaderProgram.GetUniformLocation("ViewProjMatrix");
+	material.GetShaderProgram()->SetUniform(locationViewProjMatrix, m_camera.GetViewProjectionMatrix());
+
+	mesh.GetSubmeshVertexArray(0).Bind();
+	ShaderProgram::Location locationInstanceWorldMatrix = shaderProgram.GetAttributeLocation("InstanceWorldMatrix");
+	const Drawcall& drawcall = mesh.GetSubmeshDrawcall(0);
+	for (unsigned int i = 0; i < m_patchMatrices.size(); ++i)
+	{
+		// point the instance attribute to the matrix of this patch
+		m_patchInstances.SetAttributes(locationInstanceWorldMatrix, i);
+		culler.BeginConditionalRender(firstObject + i);
+		drawcall.DrawInstanced(1);
+		culler.EndConditionalRender(firstObject + i);
+	}
+
+	InstanceBuffer::ResetAttributes(locationInstanceWorldMatrix);
+}
+
+void OceanApplication::DrawOcclusionProxies()
+{
+	unsigned int patchCount = static_cast<unsigned int>(m_patchMatrices.size());
+	m_queryCuller->BeginProxies(m_camera.GetViewProjectionMatrix());
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		bool ocean = pass == 1;
+		for (unsigned int i = 0; i < patchCount; ++i)
+		{
+			glm::vec3 patchMin, patchMax;
+			GetPatchBounds(m_patchMatrices[i], ocean, patchMin, patchMax);
+			m_queryCuller->DrawProxy((ocean ? patchCount : 0) + i, patchMin, patchMax);
+		}
+	}
+	m_queryCuller->EndProxies();
+}
+
+void OceanApplication::CullAndDrawTerrain()
+{
+	// first pass: the patches visible in the depth pyramid of the previous frame
+	m_terrainCuller->Cull(HiZOcclusionCuller::Pass::First, m_camera.GetViewProjectionMatrix(), *m_depthPyramid);
+	DrawObject(m_terrainPatch, *m_terrainMaterial, *m_terrainCuller, HiZOcclusionCuller::Pass::First);
+
+	// second pass: the rest, against a pyramid of what the first pass drew
+	int width, height;
+	GetMainWindow().GetDimensions(width, height);
+	m_depthPyramid->Build(*m_fbBeforeWaterDepth, width, height, m_camera.GetViewProjectionMatrix());
+	m_terrainCuller->Cull(HiZOcclusionCuller::Pass::Second, m_camera.GetViewProjectionMatrix(), *m_depthPyramid);
+	DrawObject(m_terrainPatch, *m_terrainMaterial, *m_terrainCuller, HiZOcclusionCuller::Pass::Second);
 }
 
 void OceanApplication::DrawTerrain()
 {
 	// Draw terrain meshes
-	DrawObject(m_terrainPatch, *m_terrainMaterial, glm::scale(glm::vec3(10.0f)));
-	DrawObject(m_terrainPatch, *m_terrainMaterial, glm::translate(glm::vec3(-10.f, 0.0f, 0.0f)) * glm::scale(glm::vec3(10.0f)));
-	DrawObject(m_terrainPatch, *m_terrainMaterial, glm::translate(glm::vec3(0.f, 0.0f, -10.0f)) * glm::scale(glm::vec3(10.0f)));
-	DrawObject(m_terrainPatch, *m_terrainMaterial, glm::translate(glm::vec3(-10.f, 0.0f, -10.0f)) * glm::scale(glm::vec3(10.0f)));
+	if (m_occlusionMode == OcclusionMode::GPU)
+	{
+		// the patches that passed any of the passes of CullAndDrawTerrain
+		DrawObject(m_terrainPatch, *m_terrainMaterial, *m_terrainCuller, HiZOcclusionCuller::Pass::First);
+		DrawObject(m_terrainPatch, *m_terrainMaterial, *m_terrainCuller, HiZOcclusionCuller::Pass::Second);
+	}
+	else if (m_occlusionMode == OcclusionMode::Queries)
+	{
+		DrawObject(m_terrainPatch, *m_terrainMaterial, *m_queryCuller, 0);
+	}
+	else
+	{
+		DrawObject(m_terrainPatch, *m_terrainMaterial, m_terrainInstances);
+	}
 }
 
 void OceanApplication::DrawOcean()
 {
 	// Draw ocean meshes
-	DrawObject(m_terrainPatch, *m_oceanMaterial, glm::scale(glm::vec3(10.0f)));
-	DrawObject(m_terrainPatch, *m_oceanMaterial, glm::translate(glm::vec3(-10.f, 0.0f, 0.0f)) * glm::scale(glm::vec3(10.0f)));
-	DrawObject(m_terrainPatch, *m_oceanMaterial, glm::translate(glm::vec3(0.f, 0.0f, -10.0f)) * glm::scale(glm::vec3(10.0f)));
-	DrawObject(m_terrainPatch, *m_oceanMaterial, glm::translate(glm::vec3(-10.f, 0.0f, -10.0f)) * glm::scale(glm::vec3(10.0f)));
+	if (m_occlusionMode == OcclusionMode::GPU)
+	{
+		// the pyramid already has the terrain of this frame, one pass is enough
+		m_oceanCuller->Cull(HiZOcclusionCuller::Pass::First, m_camera.GetViewProjectionMatrix(), *m_depthPyramid);
+		DrawObject(m_terrainPatch, *m_oceanMaterial, *m_oceanCuller, HiZOcclusionCuller::Pass::First);
+	}
+	else if (m_occlusionMode == OcclusionMode::Queries)
+	{
+		// the ocean patches follow the terrain patches
+		DrawObject(m_terrainPatch, *m_oceanMaterial, *m_queryCuller, static_cast<unsigned int>(m_patchMatrices.size()));
+	}
+	else
+	{
+		DrawObject(m_terrainPatch, *m_oceanMaterial, m_oceanInstances);
+	}
 }
 
 void OceanApplication::DrawSkybox()
 {
 	// This is based on the code from SkyboxRenderPass::Render from the ituGL
 
+	// the fallback program can't draw the skybox, the clear color stays until the skybox program is completed
+	if (m_skyboxMaterial->GetShaderProgram() == m_fallbackShaderProgram)
+		return;
+
 	m_skyboxMaterial->Use();
 
 	m_skyboxMaterial->SetUniformValue("CameraPosition", m_camera.ExtractTranslation());
 	m_skyboxMaterial->SetUniformValue("InvViewProjMatrix", glm::inverse(m_camera.GetViewProjectionMatrix()));
 
-	glDepthFunc(GL_EQUAL);
-
+	// (the depth test function is part of the material)
 	m_fullscreenMesh.DrawSubmesh(0);
-
-	glDepthFunc(GL_LESS);
 }
 
 void OceanApplication::CreateTerrainMesh(Mesh& mesh, unsigned int gridX, unsigned int gridY)
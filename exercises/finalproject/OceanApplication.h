@@ -2,8 +2,11 @@
 
 #include <ituGL/application/Application.h>
 
-#include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/asset/ShaderProgramCache.h>
+#include <ituGL/asset/ShaderPreprocessor.h>
+#include <ituGL/asset/TextureResidencyManager.h>
 #include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/InstanceBuffer.h>
 #include <ituGL/camera/Camera.h>
 #include <ituGL/shader/Material.h>
 #include <ituGL/utils/DearImGui.h>
@@ -12,13 +15,21 @@
 #include <chrono>
 #include <ituGL/texture/TextureCubemapObject.h>
 #include <ituGL/texture/FrameBufferObject.h>
+#include <ituGL/texture/HeightmapSampler.h>
+#include <ituGL/scene/OcclusionBuffer.h>
+#include <ituGL/renderer/DepthPyramid.h>
+#include <ituGL/renderer/HiZOcclusionCuller.h>
+#include <ituGL/renderer/OcclusionQueryCuller.h>
 
 class Texture2DObject;
 
 class OceanApplication : public Application
 {
 public:
-    OceanApplication();
+    // If buildAssetPack is set, the assets are loaded from the loose files and written to the asset pack
+    // Without the async startup, the textures are decoded one at a time and the shader programs are completed
+    // before the first frame, to compare the startup times
+    explicit OceanApplication(bool buildAssetPack = false, bool asyncStartup = true);
 
 protected:
     void Initialize() override;
@@ -27,27 +38,65 @@ protected:
     void Cleanup() override;
 
 private:
+    void InitializeShaderPrograms();
     void InitializeTextures();
     void InitializeMaterials();
+    // Set the uniforms of the materials that don't change every frame
+    void InitializeMaterialUniforms();
     void InitializeMeshes();
     void InitializeCamera();
 
     void UpdateCamera();
+    // CPU: rasterize the terrain occluder and select the terrain and ocean patches that are not hidden behind it
+    // GPU: update the bounds of the patches, they are culled while rendering
+    // Queries: nothing, the patches are culled while rendering
+    void UpdateOcclusion();
+    // World space bounds of a terrain or ocean patch, including the height of the terrain or the waves
+    void GetPatchBounds(const glm::mat4& patchMatrix, bool ocean, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
     // Update all uniform values that should update every frame (i.e. configurable in debug UI)
     void UpdateUniforms();
     // Update configurable values and change terrain
     void ApplyPreset(int presetId);
-    // Update skybox
+    // Update skybox. It changes once the new skybox is loaded
     void ApplySkybox(int skyboxId);
+    // Show the requested skybox if it is loaded, and mark it as used
+    void UpdateSkybox();
 
     void RenderGUI();
 
-    void DrawObject(const Mesh& mesh, Material& material, const glm::mat4& worldMatrix);
+    // Draw all the instances of the mesh in a single drawcall
+    void DrawObject(const Mesh& mesh, Material& material, const InstanceBuffer& instances);
+    // Draw the instances that passed a GPU culling pass, in a single drawcall
+    void DrawObject(const Mesh& mesh, Material& material, const HiZOcclusionCuller& culler, HiZOcclusionCuller::Pass pass);
+    // Draw each patch with its own drawcall, conditioned on its occlusion query. The patch objects start at firstObject
+    void DrawObject(const Mesh& mesh, Material& material, OcclusionQueryCuller& culler, unsigned int firstObject);
+    // Draw the bounds of the terrain and ocean patches with occlusion queries, after the terrain was drawn
+    void DrawOcclusionProxies();
+    // Draw the terrain with two pass GPU culling, rebuilding the depth pyramid in between
+    void CullAndDrawTerrain();
     void DrawTerrain();
     void DrawOcean();
     void DrawSkybox();
 
-    std::shared_ptr<Texture2DObject> Load2DTexture(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat, GLenum wrapMode, GLenum filter);
+    // Keep a 16-bit copy of the red channel of a heightmap in CPU memory, for the terrain occluder, the patch bounds
+    // and the height of the camera
+    void LoadHeightmapData(int presetId, const char* path);
+    // Height of the terrain, in world space, at the position. Filtered like in the shaders
+    float GetTerrainHeight(const glm::vec2& position) const;
+
+    // Shared program from the shader files, preprocessed with the defines of the variant.
+    // It is only submitted, completedFunction is called from Update once it can be used
+    std::shared_ptr<ShaderProgram> LoadShaderProgram(const char* vertexPath, const char* fragmentPath,
+        const ShaderProgramCache::CompletedFunction& completedFunction = nullptr, std::span<const ShaderPreprocessor::Define> defines = {});
+    std::shared_ptr<ShaderProgram> LoadShaderProgram(const char* computePath,
+        const ShaderProgramCache::CompletedFunction& completedFunction = nullptr, std::span<const ShaderPreprocessor::Define> defines = {});
+    // Print the shader program statistics, once they are all completed
+    void ReportShaderPrograms() const;
+    // Change the material to the completed program, and set its uniforms again
+    ShaderProgramCache::CompletedFunction GetMaterialCompletedFunction(std::shared_ptr<Material>& material);
+
+    // Wrap mode and filter of a loaded texture
+    void SetTextureSampling(Texture2DObject& texture, GLenum wrapMode, GLenum filter);
 
     void CreateTerrainMesh(Mesh& mesh, unsigned int gridX, unsigned int gridY);
     void CreateFullscreenMesh(Mesh& mesh);
@@ -56,6 +105,10 @@ private:
     unsigned int m_gridX, m_gridY;
     std::chrono::steady_clock::time_point m_startTime;
 
+    // Load the assets from the loose files and write them to the asset pack
+    bool m_buildAssetPack;
+    bool m_asyncStartup;
+
     // Camera
     Camera m_camera;
     glm::vec3 m_cameraPosition;
@@ -65,14 +118,31 @@ private:
     bool m_cameraEnablePressed;
     glm::vec2 m_mousePosition;
 
-    // Shader loaders
-    ShaderLoader m_vertexShaderLoader;
-    ShaderLoader m_fragmentShaderLoader;
+    // Shader programs
+    ShaderPreprocessor m_shaderPreprocessor;
+    ShaderProgramCache m_shaderProgramCache;
+    // Used by the materials until their programs are completed
+    std::shared_ptr<ShaderProgram> m_fallbackShaderProgram;
+    std::shared_ptr<ShaderProgram> m_skyboxShaderProgram;
+    std::shared_ptr<ShaderProgram> m_terrainShaderProgram;
+    std::shared_ptr<ShaderProgram> m_oceanShaderProgram;
+    std::shared_ptr<ShaderProgram> m_proxyShaderProgram;
+    // Only if GPU occlusion culling is supported
+    std::shared_ptr<ShaderProgram> m_pyramidShaderProgram;
+    std::shared_ptr<ShaderProgram> m_cullShaderProgram;
 
     // Meshes
     Mesh m_terrainPatch;
     Mesh m_fullscreenMesh;
 
+    // World matrices of the patches (shared by terrain and ocean)
+    std::vector<glm::mat4> m_patchMatrices;
+
+    // World matrices of all the patches, and of the patches that passed CPU occlusion culling this frame
+    InstanceBuffer m_patchInstances;
+    InstanceBuffer m_terrainInstances;
+    InstanceBuffer m_oceanInstances;
+
     // Materials
     std::shared_ptr<Material> m_terrainMaterial;
     std::shared_ptr<Material> m_oceanMaterial;
@@ -83,7 +153,39 @@ private:
     std::shared_ptr<Texture2DObject> m_oceanTexture;
     std::shared_ptr<Texture2DObject> m_foamTexture;
     std::shared_ptr<Texture2DObject> m_heightmapTexture[3];
-    std::shared_ptr<TextureCubemapObject> m_skyboxTexture[4];
+    // Skyboxes are only loaded when they are shown, within a memory budget
+    TextureResidencyManager m_textureResidency;
+    TextureResidencyManager::Id m_skyboxTexture[4];
+    // Skybox shown (-1 before the first one), and the one to show when it is loaded
+    int m_skyboxId;
+    int m_requestedSkyboxId;
+
+    // CPU copy of the heightmaps
+    HeightmapSampler m_heightmapSampler[3];
+    int m_presetId;
+
+    // Occlusion culling
+    enum class OcclusionMode { None, CPU, GPU, Queries };
+    OcclusionMode m_occlusionMode;
+    // CPU, against a depth buffer rasterized from a terrain occluder
+    OcclusionBuffer m_occlusionBuffer;
+    std::vector<glm::vec3> m_occluderVertices;
+    std::vector<unsigned int> m_occluderIndices;
+    std::vector<glm::mat4> m_visiblePatchMatrices;
+    // GPU, against a depth pyramid of the terrain depth. Only created if compute shaders are supported
+    std::unique_ptr<DepthPyramid> m_depthPyramid;
+    std::unique_ptr<HiZOcclusionCuller> m_terrainCuller;
+    std::unique_ptr<HiZOcclusionCuller> m_oceanCuller;
+    // Objects last given to each culler (terrain, ocean), so they are only uploaded again when the bounds change
+    std::vector<HiZOcclusionCuller::Object> m_cullerObjects[2];
+    // Camera that drew the depth still in m_fbBeforeWaterDepth, from the previous frame
+    glm::mat4 m_previousViewProjMatrix;
+    bool m_hasPreviousDepth;
+    // Reading the GPU draw counts back waits for the GPU
+    bool m_readGpuCullingStats;
+    // Occlusion queries on the bounds of the patches, for when compute shaders are not supported.
+    // The terrain patches are the first objects, followed by the ocean patches
+    std::unique_ptr<OcclusionQueryCuller> m_queryCuller;
 
     // Before Water Framebuffer
     std::shared_ptr<FramebufferObject> m_fbBeforeWater;
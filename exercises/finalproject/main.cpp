@@ -1,7 +1,18 @@
 #include "OceanApplication.h"
 
-int main()
+#include <cstring>
+
+int main(int argc, char* argv[])
 {
-    OceanApplication oceanApplication;
+    // Run with --build-pack to write assets.pack, with all the assets that the application loads
+    // Run with --serial-startup to load the assets one after the other, and compare the startup time printed
+    bool buildAssetPack = false;
+    bool asyncStartup = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        buildAssetPack |= std::strcmp(argv[i], "--build-pack") == 0;
+        asyncStartup &= std::strcmp(argv[i], "--serial-startup") != 0;
+    }
+    OceanApplication oceanApplication(buildAssetPack, asyncStartup);
     return oceanApplication.Run();
 }
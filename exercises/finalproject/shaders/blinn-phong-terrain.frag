@@ -7,8 +7,7 @@ in vec2 TexCoord;
 out vec4 FragColor;
 
 uniform vec4 Color;
-uniform sampler2D Heightmap;
-uniform vec4 HeightmapBounds; // xy = min coord, zw = max coord
+#include "include/heightmap.glsl"
 
 // surface
 uniform float AmbientReflection;
@@ -23,12 +22,6 @@ uniform vec3 LightColor;
 uniform vec3 LightDirection;
 uniform vec3 CameraPosition;
 
-// Convert world coordinates to texture coordinates
-vec2 worldToTextureCoord(vec2 worldSpacePosition)
-{
-	return (worldSpacePosition - HeightmapBounds.xy) / (HeightmapBounds.zw - HeightmapBounds.xy);
-}
-
 vec3 ambient(vec3 color)
 {
 	return AmbientColor * AmbientReflection * color;
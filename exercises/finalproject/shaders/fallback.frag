@@ -0,0 +1,13 @@
+#version 330 core
+
+//Outputs
+out vec4 FragColor;
+
+//Uniforms
+uniform vec4 Color;
+
+void main()
+{
+	// Only the base color of the material, until its own program is ready
+	FragColor = Color;
+}
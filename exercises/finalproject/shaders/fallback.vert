@@ -0,0 +1,17 @@
+#version 330 core
+
+//Inputs
+layout (location = 0) in vec3 VertexPosition;
+layout (location = 3) in mat4 InstanceWorldMatrix; // same locations as the terrain and ocean shaders
+
+//Uniforms
+uniform mat4 ViewProjMatrix;
+uniform float HeightOffset;
+
+void main()
+{
+	// Flat patches, at the base height of the terrain
+	vec3 worldPosition = (InstanceWorldMatrix * vec4(VertexPosition, 1.0)).xyz;
+	worldPosition.y += HeightOffset;
+	gl_Position = ViewProjMatrix * vec4(worldPosition, 1.0);
+}
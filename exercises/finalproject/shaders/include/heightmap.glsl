@@ -0,0 +1,18 @@
+// Heightmap of the terrain. The terrain and the ocean read it with the same mapping
+
+uniform sampler2D Heightmap;
+uniform vec4 HeightmapBounds; // xy = min coord, zw = max coord
+uniform float HeightScale;
+uniform float HeightOffset;
+
+// convert world coordinates to texture coordinates
+vec2 worldToTextureCoord(vec2 worldSpacePosition)
+{
+	return (worldSpacePosition - HeightmapBounds.xy) / (HeightmapBounds.zw - HeightmapBounds.xy);
+}
+
+// height of the terrain, in world space
+float getTerrainHeight(vec2 worldSpacePosition)
+{
+	return texture(Heightmap, worldToTextureCoord(worldSpacePosition)).r * HeightScale + HeightOffset;
+}
@@ -0,0 +1,20 @@
+// Normals of a displaced surface. The including shader must define the displacement first:
+// vec3 getPosition(vec3 worldPosition)
+
+// get the vectors from the position to the displaced positions at an adjacent position on each axis
+void getSurfaceTangents(vec3 worldPosition, float sampleOffset, out vec3 tangent, out vec3 biTangent)
+{
+	vec3 baseSample = getPosition(worldPosition);
+	vec3 xSample = getPosition(vec3(worldPosition.x + sampleOffset, worldPosition.yz));
+	vec3 zSample = getPosition(vec3(worldPosition.xy, worldPosition.z + sampleOffset));
+	tangent = xSample - baseSample;
+	biTangent = zSample - baseSample;
+}
+
+// approximate normal, from the cross product of the tangents
+vec3 getNormal(vec3 worldPosition, float sampleOffset)
+{
+	vec3 tangent, biTangent;
+	getSurfaceTangents(worldPosition, sampleOffset, tangent, biTangent);
+	return normalize(cross(biTangent, tangent));
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+//Inputs
+layout (location = 0) in vec3 VertexPosition;
+
+//Uniforms
+uniform vec3 BoundsMin;
+uniform vec3 BoundsMax;
+uniform mat4 ViewProjMatrix;
+
+void main()
+{
+	// The vertices are a unit cube, stretch it over the bounds
+	vec3 worldPosition = mix(BoundsMin, BoundsMax, VertexPosition);
+	gl_Position = ViewProjMatrix * vec4(worldPosition, 1.0f);
+}
@@ -42,8 +42,9 @@ uniform vec3 CameraPosition;
 // read normal from normal map and convert it to world space
 vec3 getNormalFromMap(vec2 tiling, vec2 offset)
 {
-	vec3 normal = texture(NormalMap, TexCoord * tiling + offset).rgb;
-	normal = normal * 2.0 - 1.0;
+	// only X and Y are stored, Z is always positive in tangent space
+	vec2 normalXY = texture(NormalMap, TexCoord * tiling + offset).rg * 2.0 - 1.0;
+	vec3 normal = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
 	normal = normalize(TBN * normal);
 	return normal;
 }
@@ -3,6 +3,7 @@
 layout (location = 0) in vec3 VertexPosition;
 layout (location = 1) in vec3 VertexNormal;
 layout (location = 2) in vec2 VertexTexCoord;
+layout (location = 3) in mat4 InstanceWorldMatrix; // one per patch, takes locations 3 to 6
 
 out vec3 WorldPosition;
 out vec3 WorldNormal;
@@ -11,15 +12,11 @@ out mat3 TBN;
 out vec2 TexSquish; // Basically how much the texture is squished due to wave movement
 
 // world
-uniform mat4 WorldMatrix;
 uniform mat4 ViewProjMatrix;
 uniform float Time;
 
 // terrain info
-uniform sampler2D Heightmap;
-uniform vec4 HeightmapBounds; // xy = min coord, zw = max coord
-uniform float HeightScale;
-uniform float HeightOffset;
+#include "include/heightmap.glsl"
 
 // shape
 uniform vec4 WaveFrequency;
@@ -35,18 +32,10 @@ uniform float WaveScale;
 // shading
 uniform float NormalSampleOffset;
 
-// convert world coordinates to texture coordinates
-vec2 worldToTextureCoord(vec2 worldSpacePosition)
-{
-	return (worldSpacePosition - HeightmapBounds.xy) / (HeightmapBounds.zw - HeightmapBounds.xy);
-}
-
 // get depth
 float getDepth(vec3 worldPosition)
 {
-	float height = texture(Heightmap, worldToTextureCoord(worldPosition.xz)).r
-		* HeightScale + HeightOffset;
-	return -height;
+	return -getTerrainHeight(worldPosition.xz);
 }
 
 // get vertex offset produced by a Gerstner wave
@@ -70,16 +59,14 @@ vec3 getPosition(vec3 worldPosition)
 	return worldPosition + wave * waveScale * WaveScale;
 }
 
-// approximate normal
-vec3 getNormal(vec3 worldPosition, float sampleOffset)
+#include "include/surface-normal.glsl"
+
+// approximate normal, also writing the outputs that depend on the tangents
+vec3 getOceanNormal(vec3 worldPosition, float sampleOffset)
 {
-	// to get the normal, we sample the height at the position and at an adjacent position on each axis
-	vec3 baseSample = getPosition(worldPosition);
-	vec3 xSample = getPosition(vec3(worldPosition.x + sampleOffset, worldPosition.yz));
-	vec3 zSample = getPosition(vec3(worldPosition.xy, worldPosition.z + sampleOffset));
-	// we then get the vectors from the base position to the two extra samples
-	vec3 tangent = xSample - baseSample;
-	vec3 biTangent = zSample - baseSample;
+	// to get the normal, we sample the position and an adjacent position on each axis
+	vec3 tangent, biTangent;
+	getSurfaceTangents(worldPosition, sampleOffset, tangent, biTangent);
 	// set texture squish
 	TexSquish = vec2(length(tangent), length(biTangent));
 	// normalize for next step (we can reuse TexSquish for an easy optimization)
@@ -96,15 +83,15 @@ vec3 getNormal(vec3 worldPosition, float sampleOffset)
 void main()
 {
 	// find base values
-	WorldPosition = (WorldMatrix * vec4(VertexPosition, 1.0)).xyz;
-	WorldNormal = (WorldMatrix * vec4(VertexNormal, 0.0)).xyz;
+	WorldPosition = (InstanceWorldMatrix * vec4(VertexPosition, 1.0)).xyz;
+	WorldNormal = (InstanceWorldMatrix * vec4(VertexNormal, 0.0)).xyz;
 	TexCoord = WorldPosition.xz;
 
 	// position
 	WorldPosition = getPosition(WorldPosition);
 
 	// normal
-	WorldNormal = getNormal(WorldPosition, NormalSampleOffset);
+	WorldNormal = getOceanNormal(WorldPosition, NormalSampleOffset);
 
 	gl_Position = ViewProjMatrix * vec4(WorldPosition, 1.0);
 }
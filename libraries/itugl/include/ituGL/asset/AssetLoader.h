@@ -1,6 +1,6 @@
 #pragma once
 
-#include <unordered_map>
+#include <ituGL/asset/AssetRegistry.h>
 #include <string>
 #include <memory>
 
@@ -22,6 +22,7 @@ public:
     virtual T* LoadNew(const char* path);
 
     // Load the asset from a path into a shared pointer
+    // Shared assets are kept in the default AssetRegistry, so any loader with the same parameters gets the same asset
     virtual std::shared_ptr<T> LoadShared(const char* path);
 
     // Load the asset from a path into the object passed as a parameter
@@ -30,12 +31,13 @@ public:
     inline bool GetKeepShared() const { return m_keepShared; }
     inline void SetKeepShared(bool keepShared) { m_keepShared = keepShared; }
 
+protected:
+    // Key of the asset in the registry. Loaders with parameters that change the asset must add them to the path
+    virtual std::string GetKey(const char* path) const;
+
 private:
-    // If true, keep a reference to assets loaded as shared, to avoid loading twice
+    // If true, assets loaded as shared go through the registry, to avoid loading twice
     bool m_keepShared;
-
-    // Map of loaded shared assets
-    std::unordered_map<std::string, std::shared_ptr<T>> m_sharedAssets;
 };
 
 template <typename T>
@@ -67,26 +69,25 @@ std::shared_ptr<T> AssetLoader<T>::LoadShared(const char* path)
     std::shared_ptr<T> t;
     if (IsValid(path))
     {
-        // Try to find the asset on the previously loaded
-        std::string pathString(path);
-        auto itAsset = m_sharedAssets.find(pathString);
-        if (itAsset != m_sharedAssets.end())
+        if (m_keepShared)
         {
-            t = itAsset->second;
+            // Found if it is alive or loading, created otherwise
+            t = AssetRegistry<T>::GetDefault().Load(GetKey(path), [this, path]() { return std::make_shared<T>(Load(path)); });
         }
         else
         {
-            // If not found, create a new one
             t = std::make_shared<T>(Load(path));
-            if (m_keepShared)
-            {
-                m_sharedAssets.insert(std::make_pair(pathString, t));
-            }
         }
     }
     return t;
 }
 
+template <typename T>
+std::string AssetLoader<T>::GetKey(const char* path) const
+{
+    return path;
+}
+
 template <typename T>
 bool AssetLoader<T>::LoadInto(const char* path, T& t)
 {
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Single file with many assets, mapped in memory instead of read. Each entry is a blob found by name: the loaders
+// use it directly from the mapping, without opening, reading or copying a file for each asset.
+// The file has a header, an index sorted by the hash of the names, the names, and the blobs aligned to 64 bytes.
+// Find can be called from several threads at the same time, once the pack is open
+class AssetPack
+{
+public:
+    AssetPack();
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Map the file. Returns false if it is missing or not a valid pack
+    bool Open(const char* path);
+    void Close();
+
+    inline bool IsOpen() const { return m_data != nullptr; }
+
+    // Data of the entry, from the mapping. Empty if there is no entry with that name.
+    // Names are paths, compared after normalizing them
+    std::span<const std::byte> Find(std::string_view name) const;
+
+    inline bool Contains(std::string_view name) const { return !Find(name).empty(); }
+
+    inline unsigned int GetEntryCount() const { return m_entryCount; }
+    inline std::size_t GetSize() const { return m_size; }
+
+    // Same path, written the same way
+    static std::string NormalizeName(std::string_view name);
+
+    // Shared pack, used by the loaders. Closed until something opens it
+    static AssetPack& GetDefault();
+
+private:
+    // Written by AssetPackWriter
+    struct Entry;
+    friend class AssetPackWriter;
+
+    // Check that the index and the blobs are inside the file
+    bool Validate() const;
+
+    std::string_view GetEntryName(const Entry& entry) const;
+
+private:
+    const std::byte* m_data;
+    std::size_t m_size;
+
+    const Entry* m_entries;
+    unsigned int m_entryCount;
+};
+
+// Builds an asset pack. Entries can be added from several threads at the same time
+class AssetPackWriter
+{
+public:
+    // Add an entry, or replace the one with the same name
+    void Add(std::string_view name, std::vector<std::byte> data);
+    void Add(std::string_view name, std::span<const std::byte> data);
+
+    // Add the contents of a file, named after its path
+    bool AddFile(const char* path);
+
+    // Add all the files in the directory and its subdirectories
+    bool AddDirectory(const char* path);
+
+    unsigned int GetEntryCount() const;
+
+    // Write the pack file. Written with another name first, so a pack that is being read is never half written
+    bool Write(const char* path) const;
+
+private:
+    // Entries by normalized name
+    std::map<std::string, std::vector<std::byte>> m_entries;
+    mutable std::mutex m_mutex;
+};
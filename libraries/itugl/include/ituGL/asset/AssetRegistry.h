@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide registry of the shared assets of one type, by key. The key is the path with the load parameters,
+// see AssetLoader::GetKey.
+// Assets are held by weak references, so they are freed when nothing else uses them, and loaded again if needed.
+// Lookups can run concurrently. When an asset is requested while another thread is loading it, the request waits
+// for that load instead of loading it again. A load must not request its own key, it would wait for itself.
+// If a load throws, the requests waiting for it get the same exception, and the next request loads it again
+template <typename T>
+class AssetRegistry
+{
+public:
+    using LoadFunction = std::function<std::shared_ptr<T>()>;
+
+public:
+    AssetRegistry();
+
+    AssetRegistry(const AssetRegistry&) = delete;
+    AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+    // The asset, if it is alive. Doesn't wait for assets that are loading
+    std::shared_ptr<T> Find(const std::string& key) const;
+
+    // The asset if it is alive, the result of its load if it is loading, or the result of the load function
+    std::shared_ptr<T> Load(const std::string& key, const LoadFunction& load);
+
+    // Remove the entries of the assets that were freed. Also done while loading, when the entries have doubled
+    void RemoveExpired();
+
+    // Statistics
+    inline unsigned int GetHitCount() const { return m_hitCount; }
+    inline unsigned int GetJoinCount() const { return m_joinCount; }
+    inline unsigned int GetLoadCount() const { return m_loadCount; }
+
+    static AssetRegistry& GetDefault();
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<T> asset;
+        // Valid while the asset is loading
+        std::shared_future<std::shared_ptr<T>> loading;
+    };
+
+    // RemoveExpired, with the exclusive lock already held
+    void RemoveExpiredLocked();
+
+private:
+    // Shared for the lookups, exclusive to add and update entries
+    mutable std::shared_mutex m_mutex;
+
+    std::unordered_map<std::string, Entry> m_entries;
+    // Entry count that triggers the next removal of expired entries
+    std::size_t m_pruneSize;
+
+    // Requests that found the asset alive
+    std::atomic<unsigned int> m_hitCount;
+    // Requests that waited for the load of another thread
+    std::atomic<unsigned int> m_joinCount;
+    // Requests that loaded the asset
+    std::atomic<unsigned int> m_loadCount;
+};
+
+template <typename T>
+AssetRegistry<T>::AssetRegistry() : m_pruneSize(64), m_hitCount(0), m_joinCount(0), m_loadCount(0)
+{
+}
+
+template <typename T>
+std::shared_ptr<T> AssetRegistry<T>::Find(const std::string& key) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto itEntry = m_entries.find(key);
+    return itEntry != m_entries.end() ? itEntry->second.asset.lock() : nullptr;
+}
+
+template <typename T>
+std::shared_ptr<T> AssetRegistry<T>::Load(const std::string& key, const LoadFunction& load)
+{
+    // Most requests find the asset alive, without the exclusive lock
+    if (std::shared_ptr<T> asset = Find(key))
+    {
+        ++m_hitCount;
+        return asset;
+    }
+
+    std::promise<std::shared_ptr<T>> promise;
+    std::shared_future<std::shared_ptr<T>> loading;
+    {
+        // Checked again, another thread could have added it since
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        if (m_entries.size() >= m_pruneSize)
+        {
+            RemoveExpiredLocked();
+            m_pruneSize = std::max(m_pruneSize, m_entries.size() * 2);
+        }
+
+        Entry& entry = m_entries[key];
+        if (std::shared_ptr<T> asset = entry.asset.lock())
+        {
+            ++m_hitCount;
+            return asset;
+        }
+
+        if (entry.loading.valid())
+        {
+            loading = entry.loading;
+        }
+        else
+        {
+            entry.loading = promise.get_future().share();
+        }
+    }
+
+    // Another thread is loading it, wait for its result
+    if (loading.valid())
+    {
+        ++m_joinCount;
+        return loading.get();
+    }
+
+    // Loaded without the lock, so other assets can be requested meanwhile
+    std::shared_ptr<T> asset;
+    try
+    {
+        asset = load();
+    }
+    catch (...)
+    {
+        // Not loading anymore, the next request tries again
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            m_entries[key].loading = std::shared_future<std::shared_ptr<T>>();
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        Entry& entry = m_entries[key];
+        entry.asset = asset;
+        entry.loading = std::shared_future<std::shared_ptr<T>>();
+    }
+    promise.set_value(asset);
+    ++m_loadCount;
+    return asset;
+}
+
+template <typename T>
+void AssetRegistry<T>::RemoveExpired()
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    RemoveExpiredLocked();
+}
+
+template <typename T>
+void AssetRegistry<T>::RemoveExpiredLocked()
+{
+    std::erase_if(m_entries, [](const auto& keyEntry)
+        {
+            return keyEntry.second.asset.expired() && !keyEntry.second.loading.valid();
+        });
+}
+
+template <typename T>
+AssetRegistry<T>& AssetRegistry<T>::GetDefault()
+{
+    static AssetRegistry registry;
+    return registry;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <ituGL/asset/TextureCache.h>
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/TextureCubemapObject.h>
+#include <ituGL/core/BufferObject.h>
+#include <ituGL/core/Data.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+class ThreadPool;
+
+// Loads many textures at once: the images are decoded in the workers of a thread pool, and the thread with the
+// OpenGL context uploads them as they finish, through a pixel unpack buffer.
+// The textures are returned right away, and get their images in Update or Finish. Same settings as
+// Texture2DLoader and TextureCubemapLoader, with the cubemaps in the same cross layout.
+// Textures that go through the default TextureCache, like in the loaders, are read from it or processed in the workers
+class AsyncTextureLoader
+{
+public:
+    // Called in the OpenGL thread when the image of a texture is uploaded, with the memory it takes.
+    // The memory is 0 if the image couldn't be loaded
+    using UploadCallback = std::function<void(std::size_t memorySize)>;
+
+public:
+    explicit AsyncTextureLoader(ThreadPool& threadPool);
+    // Waits for the pending textures
+    ~AsyncTextureLoader();
+
+    AsyncTextureLoader(const AsyncTextureLoader&) = delete;
+    AsyncTextureLoader& operator=(const AsyncTextureLoader&) = delete;
+
+    // Start loading a texture. It is empty until its image is uploaded
+    std::shared_ptr<Texture2DObject> Load2D(const char* path,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap = true, bool flipVertical = false, UploadCallback uploadCallback = nullptr);
+    std::shared_ptr<TextureCubemapObject> LoadCubemap(const char* path,
+        TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap = true, UploadCallback uploadCallback = nullptr);
+
+    // How the mipmaps are filtered when they are built on the CPU, for the textures loaded after this
+    inline const MipmapGenerator::Settings& GetMipmapSettings() const { return m_mipmapSettings; }
+    inline void SetMipmapSettings(const MipmapGenerator::Settings& mipmapSettings) { m_mipmapSettings = mipmapSettings; }
+
+    // Upload the images that are already decoded, without waiting. Returns how many were uploaded
+    unsigned int Update();
+
+    // Upload all the pending images, each one as soon as it is decoded
+    void Finish();
+
+    // Textures that are still waiting for their image
+    inline unsigned int GetPendingCount() const { return m_pendingCount; }
+    // Textures whose image couldn't be loaded. They stay empty
+    inline unsigned int GetFailedCount() const { return m_failedCount; }
+
+    // Time the workers spent decoding the uploaded images, added together and the slowest one, in milliseconds.
+    // When the decodes run in parallel, waiting for all of them should take close to the slowest one, not the sum
+    inline double GetDecodeTime() const { return m_decodeTime; }
+    inline double GetSlowestDecodeTime() const { return m_slowestDecodeTime; }
+
+private:
+    struct Request
+    {
+        std::string path;
+        TextureObject::Format format;
+        TextureObject::InternalFormat internalFormat;
+        bool generateMipmap;
+        bool flipVertical;
+        MipmapGenerator::Settings mipmapSettings;
+        UploadCallback uploadCallback;
+
+        // Only one of them is set
+        std::shared_ptr<Texture2DObject> texture2D;
+        std::shared_ptr<TextureCubemapObject> textureCubemap;
+
+        // Filled by the worker
+        int width;
+        int height;
+        Data::Type dataType;
+        std::span<const std::byte> data;
+
+        // Filled by the worker instead of the data, for the textures that go through the cache
+        TextureCache::Image cachedImage;
+
+        // Time the worker took, in milliseconds
+        double decodeTime;
+    };
+
+    using PixelBuffer = BufferObjectBase<BufferObject::PixelUnpackBuffer>;
+
+    // Decode the image in a worker, and queue it for upload
+    void Enqueue(Request request);
+
+    // Upload the image and return the memory it takes, or 0 if it failed
+    std::size_t Upload(Request& request);
+    void Upload2D(Request& request);
+    void UploadCubemap(Request& request);
+    void UploadCached(Request& request);
+
+    // Copy the data to the pixel buffer, left bound, so the texture calls read from it
+    void StreamPixelData(std::span<const std::byte> data);
+
+    template<typename T>
+    static void SetSampling(T& texture, bool generateMipmap, int size);
+
+    // Sampling of an image that comes with its mipmaps
+    template<typename T>
+    static void SetLevelSampling(T& texture, int levelCount);
+
+private:
+    ThreadPool& m_threadPool;
+
+    MipmapGenerator::Settings m_mipmapSettings;
+
+    // Decoded images, waiting for the upload
+    std::deque<Request> m_decodedRequests;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    // Only used in the OpenGL thread
+    unsigned int m_pendingCount;
+    unsigned int m_failedCount;
+    double m_decodeTime;
+    double m_slowestDecodeTime;
+    PixelBuffer m_pixelBuffer;
+};
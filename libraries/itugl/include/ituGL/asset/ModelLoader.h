@@ -27,6 +27,16 @@ public:
     bool GetCreateMaterials() const;
     void SetCreateMaterials(bool createMaterials);
 
+    // Keep a CPU copy of the triangles of each submesh in the mesh, see Mesh::SubmeshGeometry
+    bool GetKeepGeometry() const;
+    void SetKeepGeometry(bool keepGeometry);
+
+    // Store the triangles of the submeshes in a shared arena, when it has the same vertex format and attribute locations.
+    // Static models loaded this way are drawn together by the renderer, with one multi-draw call per material.
+    // The other submeshes, or all of them if the arena is full, get their own buffers as usual
+    std::shared_ptr<GeometryArena> GetGeometryArena() const;
+    void SetGeometryArena(std::shared_ptr<GeometryArena> geometryArena);
+
     Texture2DLoader& GetTexture2DLoader();
     const Texture2DLoader& GetTexture2DLoader() const;
 
@@ -39,10 +49,17 @@ public:
     // Maps a material property to a uniform in the shader program used by the material
     bool SetMaterialProperty(MaterialProperty materialProperty, const char* uniformName);
 
+protected:
+    // Also depends on the reference material and how the model is mapped to it
+    std::string GetKey(const char* path) const override;
+
 private:
     // Generate a submesh from the loaded mesh data
     void GenerateSubmesh(Mesh& mesh, const aiMesh& meshData);
 
+    // Grow the bounds of the mesh with the positions of the loaded mesh data
+    static void ExpandBounds(Mesh& mesh, const aiMesh& meshData);
+
     // Generate a material from the loaded material data
     std::shared_ptr<Material> GenerateMaterial(const aiMaterial& materialData);
 
@@ -53,6 +70,9 @@ private:
     // Build the vertex data from the mesh data
     static std::vector<GLubyte> CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved);
 
+    // Build 32-bit triangle indices from the mesh data. Faces that are not triangles are skipped
+    static std::vector<unsigned int> CollectTriangleIndices(const aiMesh& meshData);
+
     // Build the element data from the mesh data
     static std::vector<GLubyte> CollectElementData(const aiMesh& meshData, Data::Type& elementType,
         std::vector<Drawcall::Primitive>& primitives, std::vector<int>& elementCounts);
@@ -82,6 +102,12 @@ private:
     // Should create new materials for each submesh or use the reference material
     bool m_createMaterials;
 
+    // Should keep the geometry in CPU memory after uploading it
+    bool m_keepGeometry;
+
+    // Where the submeshes are stored, if they fit. Otherwise each one has its own buffers
+    std::shared_ptr<GeometryArena> m_geometryArena;
+
     // Texture loader to cache already loaded shared textures
     mutable Texture2DLoader m_textureLoader;
 };
@@ -3,6 +3,7 @@
 #include <ituGL/asset/AssetLoader.h>
 #include <ituGL/shader/Shader.h>
 #include <span>
+#include <string>
 
 class ShaderLoader : AssetLoader<Shader>
 {
@@ -22,8 +23,18 @@ public:
 
     static Shader Load(Shader::Type type, const char* path);
 
-private:
-    void Compile(Shader& shader);
+    // Compile a shader from source code that is already loaded
+    Shader LoadSource(const char* source);
+
+    // Start compiling a shader from source code, without waiting. Check it later with CheckCompilation
+    Shader LoadSourceAsync(const char* source);
+
+    // Check if the shader compiled, printing the errors if it didn't
+    static bool CheckCompilation(const Shader& shader);
 
+    // Read the source code of a shader file
+    static std::string ReadSource(const char* path);
+
+private:
     Shader::Type m_type;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Prepares shader files before compiling them:
+// - #include "file" is replaced by the file, looked up next to the including file and then in the include directories.
+//   Each file is included only once per shader, so files can include what they need without guards
+// - The defines of the variant are added after #version, so the same file can be compiled with different features
+// Files are read once, and the preprocessed sources are kept by variant. Variants that end up with the same code
+// share the same source, so they can be compiled once
+class ShaderPreprocessor
+{
+public:
+    // Name and value of a define. The value can be empty
+    using Define = std::pair<std::string, std::string>;
+
+public:
+    void AddIncludeDirectory(const char* directory);
+
+    // Preprocessed source of the file with the defines, or null if a file is missing
+    std::shared_ptr<const std::string> Process(const char* path, std::span<const Define> defines = {});
+
+    // Key of the variant with these defines. The order of the defines doesn't matter
+    static std::string GetVariantKey(std::span<const Define> defines);
+
+    // Statistics: variants processed, and how many different sources they produced
+    inline unsigned int GetVariantCount() const { return static_cast<unsigned int>(m_variants.size()); }
+    inline unsigned int GetSourceCount() const { return static_cast<unsigned int>(m_sources.size()); }
+
+    // Forget the loaded files and sources, to see the changes in the files
+    void Clear();
+
+private:
+    // Contents of the file, read on first use. Null if the file doesn't exist
+    const std::string* GetFile(const std::filesystem::path& path);
+
+    // Append the file to the output, with its includes resolved
+    bool AppendFile(const std::filesystem::path& path, std::string& output, std::vector<std::filesystem::path>& includedPaths);
+
+    // Find the path of an included file
+    std::filesystem::path FindInclude(const std::filesystem::path& includingPath, const std::string& name);
+
+    // Look for an identical source, to share it
+    std::shared_ptr<const std::string> Deduplicate(std::string source);
+
+private:
+    std::vector<std::filesystem::path> m_includeDirectories;
+
+    // Loaded files, by normalized path
+    std::unordered_map<std::string, std::string> m_files;
+
+    // Preprocessed sources, by path and variant key
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> m_variants;
+
+    // Different sources, by the hash of their contents
+    std::unordered_multimap<std::size_t, std::shared_ptr<const std::string>> m_sources;
+};
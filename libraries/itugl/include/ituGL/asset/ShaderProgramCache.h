@@ -0,0 +1,117 @@
+#pragma once
+
+#include <ituGL/shader/Shader.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderProgram;
+
+// Saves the binaries of the linked programs to disk, so the next runs load them instead of compiling the shaders.
+// Entries are named after a hash of the shader sources and the driver vendor, renderer and version, so changing any
+// of them creates a new entry. If the driver rejects a binary, the program is built from the sources as usual.
+// Programs can also be submitted without waiting, so the driver compiles them in parallel while the application
+// does other work. Their errors are reported, and their binaries saved, when they are completed
+class ShaderProgramCache
+{
+public:
+    // Source code of one of the shaders of the program
+    struct Source
+    {
+        Shader::Type type;
+        std::string code;
+    };
+
+    // Called when a submitted program is completed, after its errors are reported. If it didn't link,
+    // whatever was used until then (like a fallback program) should stay
+    using CompletedFunction = std::function<void(std::shared_ptr<ShaderProgram> shaderProgram, bool linked)>;
+
+public:
+    explicit ShaderProgramCache(const char* directory = "shadercache");
+
+    // Build the program from the shader files, from the cache if possible
+    bool Build(ShaderProgram& shaderProgram, const char* vertexPath, const char* fragmentPath);
+    bool Build(ShaderProgram& shaderProgram, const char* computePath);
+
+    // Build the program from sources that are already loaded. The entry depends on the exact code, so each set of
+    // defines gets its own entry
+    bool Build(ShaderProgram& shaderProgram, std::span<const Source> sources);
+
+    // Shared program built from the sources. Programs with the same sources, like variants whose defines don't
+    // change the code, are built once and shared while they are alive. Programs that don't link are not shared
+    std::shared_ptr<ShaderProgram> LoadShared(std::span<const Source> sources);
+
+    // Same as LoadShared, without waiting for the compilation. The program must be completed before it is used,
+    // by Update, Wait or Finish, which call completedFunction. Programs that don't need to compile, loaded from
+    // the cache or already shared, call it too, the next time the cache is updated
+    std::shared_ptr<ShaderProgram> Submit(std::span<const Source> sources, const CompletedFunction& completedFunction = nullptr);
+
+    // Complete the submitted programs that finished linking, without waiting. Returns how many were completed
+    unsigned int Update();
+
+    // Complete the program if it was submitted, waiting for it. Returns true if it is linked
+    bool Wait(const ShaderProgram& shaderProgram);
+
+    // Complete all the submitted programs
+    void Finish();
+
+    bool IsPending(const ShaderProgram& shaderProgram) const;
+    inline unsigned int GetPendingCount() const { return static_cast<unsigned int>(m_pendingPrograms.size()); }
+
+    inline const std::string& GetDirectory() const { return m_directory; }
+
+    // Statistics of the programs built so far
+    inline unsigned int GetHitCount() const { return m_hitCount; }
+    inline unsigned int GetMissCount() const { return m_missCount; }
+    // Programs from LoadShared that were already built
+    inline unsigned int GetSharedCount() const { return m_sharedCount; }
+    // Time spent building and waiting for programs, in milliseconds
+    inline double GetBuildTime() const { return m_buildTime; }
+
+private:
+    // Program still compiling, with its shaders. Programs that are already linked have no shaders,
+    // they are only waiting to call their completed functions
+    struct PendingProgram
+    {
+        std::shared_ptr<ShaderProgram> shaderProgram;
+        std::vector<Shader> shaders;
+        std::uint64_t key;
+        bool saveEntry;
+        std::vector<CompletedFunction> completedFunctions;
+    };
+
+    // Report the errors of the program, save it if it linked, and call its completed functions. Returns true if it linked
+    bool Complete(PendingProgram& pendingProgram);
+
+    PendingProgram* FindPending(const ShaderProgram& shaderProgram);
+
+    std::uint64_t GetKey(std::span<const Source> sources);
+    std::string GetEntryPath(std::uint64_t key) const;
+
+    bool LoadEntry(ShaderProgram& shaderProgram, const std::string& path, std::uint64_t key) const;
+    void SaveEntry(const ShaderProgram& shaderProgram, const std::string& path, std::uint64_t key) const;
+
+    // Compile the shaders and link them
+    static bool Compile(ShaderProgram& shaderProgram, std::span<const Source> sources);
+
+private:
+    std::string m_directory;
+
+    // Vendor, renderer and version of the driver, read on first use
+    std::string m_driverId;
+
+    // Shared programs, by key
+    std::unordered_map<std::uint64_t, std::weak_ptr<ShaderProgram>> m_sharedPrograms;
+
+    // Submitted programs, in submission order
+    std::vector<PendingProgram> m_pendingPrograms;
+
+    unsigned int m_hitCount;
+    unsigned int m_missCount;
+    unsigned int m_sharedCount;
+    double m_buildTime;
+};
@@ -21,6 +21,14 @@ public:
     inline bool GetFlipVertical() const { return m_flipVertical; }
     inline void SetFlipVertical(bool flipVertical) { m_flipVertical = flipVertical; }
 
+protected:
+    // Also depends on the vertical flip
+    std::string GetKey(const char* path) const override;
+
+private:
+    // Upload all the levels of the image, from the texture cache or a DDS file
+    void LoadCached(const char* path, Texture2DObject& texture2D);
+
 private:
     // If true, the texture will be flipped vertically on load
     // This option exists because some systems define the vertical origin as "up", and others as "down"
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <ituGL/texture/MipmapGenerator.h>
+#include <ituGL/texture/TextureObject.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+class AssetPackWriter;
+class ThreadPool;
+
+// Keeps the images that need processing before the upload as DDS files, so they are only processed the first time:
+// images with their mipmaps built on the CPU, and images encoded in block compressed formats.
+// Entries are named after a hash of the image path, size and modification time, and the settings, so changing
+// the image creates a new entry. DDS files can also be loaded directly.
+// Images found in the default AssetPack are used from the mapping, without reading or copying them.
+// Load can be called from several threads at the same time
+class TextureCache
+{
+public:
+    // How to process the image
+    struct Settings
+    {
+        // Channels of the uncompressed images, same as in the texture loaders. Only 8-bit images are supported
+        TextureObject::Format format = TextureObject::FormatRGBA;
+        // Block compressed formats are encoded, other formats keep the channels of the format
+        TextureObject::InternalFormat internalFormat = TextureObject::InternalFormatRGBA8;
+        // Read in the same cross layout as TextureCubemapLoader
+        bool cubemap = false;
+        bool flipVertical = false;
+        bool generateMipmap = true;
+        MipmapGenerator::Settings mipmap;
+    };
+
+    // Image with all its levels, in a block compressed format or with 8 bits per component
+    struct Image
+    {
+        TextureObject::InternalFormat internalFormat = TextureObject::InternalFormatInvalid;
+        // Channels of the data, if it is not block compressed
+        TextureObject::Format format = TextureObject::FormatInvalid;
+        // Size of the first level
+        int width = 0;
+        int height = 0;
+        int levelCount = 0;
+        // 6 for cubemaps, in the order of the GL_TEXTURE_CUBE_MAP_POSITIVE_X faces
+        int faceCount = 0;
+        // Each face with all its levels, in order, same as in the DDS files
+        std::vector<std::byte> data;
+        // Set instead of the data when the image is in memory that it doesn't own, like a mapped asset pack
+        std::span<const std::byte> externalData;
+
+        inline std::span<const std::byte> GetData() const { return externalData.empty() ? std::span<const std::byte>(data) : externalData; }
+        inline bool IsEmpty() const { return GetData().empty(); }
+        inline bool IsBlockCompressed() const { return TextureObject::IsBlockCompressed(internalFormat); }
+        inline int GetLevelWidth(int level) const { return std::max(width >> level, 1); }
+        inline int GetLevelHeight(int level) const { return std::max(height >> level, 1); }
+        std::size_t GetLevelSize(int level) const;
+        std::span<const std::byte> GetLevelData(int face, int level) const;
+        // Size of all the levels of a face
+        std::size_t GetFaceSize() const;
+    };
+
+public:
+    // The processing is split between the threads of the pool, if there is one
+    explicit TextureCache(const char* directory = "texturecache", ThreadPool* threadPool = nullptr);
+
+    // Get the processed image of the file, from the asset pack or the cache if possible. DDS files are loaded as they are
+    bool Load(const char* path, const Settings& settings, Image& image);
+
+    // Read and write DDS files. Block compressed images use the DX10 header, and uncompressed images the older
+    // RGB masks. Reading also supports the older DXT1, DXT5, ATI1 and ATI2 files
+    static bool ReadDDS(const char* path, Image& image);
+    static bool WriteDDS(const char* path, const Image& image);
+
+    // Same, in memory. The parsed image points into the data, which must outlive it
+    static bool ParseDDS(std::span<const std::byte> data, Image& image);
+    static std::vector<std::byte> SerializeDDS(const Image& image);
+
+    // Name of the processed image in the asset packs
+    static std::string GetPackEntryName(const char* path, const Settings& settings);
+
+    // Add every image that is loaded to the pack, to build a pack with the processed images. Null to stop
+    inline void SetPackWriter(AssetPackWriter* packWriter) { m_packWriter = packWriter; }
+
+    // Check if the path has the .dds extension
+    static bool IsDDS(const char* path);
+
+    // Check if the internal format can be processed by the cache: block compressed, or 8 bits per component
+    static bool IsSupported(TextureObject::InternalFormat internalFormat);
+
+    inline const std::string& GetDirectory() const { return m_directory; }
+
+    // Statistics of the images loaded so far
+    inline unsigned int GetHitCount() const { return m_hitCount; }
+    inline unsigned int GetMissCount() const { return m_missCount; }
+    inline unsigned int GetPackCount() const { return m_packCount; }
+
+    // Shared cache, using the default thread pool. Created on first use
+    static TextureCache& GetDefault();
+
+private:
+    std::uint64_t GetKey(const char* path, const Settings& settings) const;
+    std::string GetEntryPath(std::uint64_t key) const;
+
+    // Decode the file, build its mipmaps and encode it
+    bool Process(const char* path, const Settings& settings, Image& image) const;
+
+    // Add the image to the pack writer, if there is one
+    void AddToPack(const std::string& name, const Image& image) const;
+
+private:
+    std::string m_directory;
+
+    ThreadPool* m_threadPool;
+
+    AssetPackWriter* m_packWriter;
+
+    std::atomic<unsigned int> m_hitCount;
+    std::atomic<unsigned int> m_missCount;
+    std::atomic<unsigned int> m_packCount;
+};
@@ -19,6 +19,9 @@ public:
         bool generateMipmap = true);
 
 private:
+    // Upload all the levels of the image, from the texture cache or a DDS file
+    void LoadCached(const char* path, TextureCubemapObject& textureCubemap);
+
     void LoadFace(TextureCubemapObject& textureCubemap, TextureCubemapObject::Face face, std::span<const std::byte> dataSrc, std::span<std::byte> dataDst, int x, int y, int side, Data::Type dataType);
 };
 
@@ -3,6 +3,7 @@
 #include <ituGL/asset/AssetLoader.h>
 
 #include <ituGL/texture/TextureObject.h>
+#include <ituGL/texture/MipmapGenerator.h>
 #include <ituGL/core/Data.h>
 
 // Base class for all Texture asset loaders
@@ -22,7 +23,13 @@ public:
     inline bool GetGenerateMipmap() const { return m_generateMipmap; }
     inline void SetGenerateMipmap(bool generateMipmap) { m_generateMipmap = generateMipmap; }
 
+    inline const MipmapGenerator::Settings& GetMipmapSettings() const { return m_mipmapSettings; }
+    inline void SetMipmapSettings(const MipmapGenerator::Settings& mipmapSettings) { m_mipmapSettings = mipmapSettings; }
+
 protected:
+    // Path with the formats and the mipmap settings
+    std::string GetKey(const char* path) const override;
+
     std::span<const std::byte> LoadTexture2DData(const char* path, int& width, int& height, Data::Type& dataType, bool flipVertical = false);
     void FreeTexture2DData(std::span<const std::byte> data);
 
@@ -31,10 +38,15 @@ protected:
     TextureObject::Format m_format;
 
     // Internal format of the loaded textures
+    // Block compressed formats are encoded, with their mipmaps, through the default TextureCache
     TextureObject::InternalFormat m_internalFormat;
 
     // If the texture object should generate mipmaps after
+    // 8-bit formats get them from the default TextureCache, built on the CPU. HDR formats still build them on the GPU
     bool m_generateMipmap;
+
+    // How the mipmaps are filtered, when they are built on the CPU
+    MipmapGenerator::Settings m_mipmapSettings;
 };
 
 class TextureLoaderUtils
@@ -42,8 +54,15 @@ class TextureLoaderUtils
 public:
     static std::span<const std::byte> LoadTexture2DData(const char* path, int& width, int& height, Data::Type& dataType, TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical);
     static void FreeTexture2DData(std::span<const std::byte> data);
+
+    // Check if the texture goes through the default TextureCache: DDS files, block compressed formats,
+    // and 8-bit formats with mipmaps
+    static bool IsCached(const char* path, TextureObject::InternalFormat internalFormat, bool generateMipmap);
+
 private:
     static bool IsHDR(TextureObject::InternalFormat internalFormat);
+    // 16-bit normalized formats, loaded without reducing them to 8 bits
+    static bool Is16Bit(TextureObject::InternalFormat internalFormat);
 };
 
 template<typename T>
@@ -58,6 +77,14 @@ TextureLoader<T>::TextureLoader(TextureObject::Format format, TextureObject::Int
 {
 }
 
+template<typename T>
+std::string TextureLoader<T>::GetKey(const char* path) const
+{
+    return std::string(path) + '|' + std::to_string(m_format) + ',' + std::to_string(m_internalFormat)
+        + ',' + std::to_string(m_generateMipmap) + ',' + std::to_string(static_cast<int>(m_mipmapSettings.filter))
+        + ',' + std::to_string(m_mipmapSettings.srgb) + ',' + std::to_string(m_mipmapSettings.normalMap);
+}
+
 template<typename T>
 std::span<const std::byte> TextureLoader<T>::LoadTexture2DData(const char* path, int& width, int& height, Data::Type& dataType, bool flipVertical)
 {
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <ituGL/asset/AsyncTextureLoader.h>
+#include <ituGL/texture/MipmapGenerator.h>
+#include <ituGL/texture/TextureObject.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Textures that are only loaded when they are used, within a memory budget.
+// Textures are added by path, and loaded in the background the first time they are requested. When the resident
+// textures go over the budget, the least recently used ones are evicted, unless something else still holds them,
+// like the uniforms of a material. A texture that is needed again is loaded again.
+// The budget is not a hard limit: textures that are held, or requested since the last update, are never evicted
+class TextureResidencyManager
+{
+public:
+    using Id = unsigned int;
+
+public:
+    TextureResidencyManager(ThreadPool& threadPool, std::size_t memoryBudget);
+
+    TextureResidencyManager(const TextureResidencyManager&) = delete;
+    TextureResidencyManager& operator=(const TextureResidencyManager&) = delete;
+
+    // Add a texture, without loading it. Same settings as AsyncTextureLoader
+    Id Add2D(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap = true, const MipmapGenerator::Settings& mipmapSettings = MipmapGenerator::Settings());
+    Id AddCubemap(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap = true, const MipmapGenerator::Settings& mipmapSettings = MipmapGenerator::Settings());
+
+    // The texture, if it is resident. Otherwise it starts loading, and null is returned until it is uploaded.
+    // Textures that fail to load stay null, and are not loaded again.
+    // Requesting a texture also marks it as used, so request the ones in use every frame
+    std::shared_ptr<TextureObject> Request(Id id);
+
+    // Request the texture and wait for it, with the other pending loads
+    std::shared_ptr<TextureObject> RequestNow(Id id);
+
+    inline bool IsResident(Id id) const { return m_entries[id].state == State::Resident; }
+    inline bool IsLoading(Id id) const { return m_entries[id].state == State::Loading; }
+    inline bool IsFailed(Id id) const { return m_entries[id].state == State::Failed; }
+
+    // Upload the textures that finished loading, and evict textures over the budget. Call it once per frame
+    void Update();
+
+    inline std::size_t GetMemoryBudget() const { return m_memoryBudget; }
+    inline void SetMemoryBudget(std::size_t memoryBudget) { m_memoryBudget = memoryBudget; }
+
+    // Memory taken by the resident textures, in bytes
+    inline std::size_t GetMemoryUsage() const { return m_memoryUsage; }
+
+    // Statistics
+    inline unsigned int GetTextureCount() const { return static_cast<unsigned int>(m_entries.size()); }
+    unsigned int GetResidentCount() const;
+    unsigned int GetFailedCount() const;
+    inline unsigned int GetLoadCount() const { return m_loadCount; }
+    inline unsigned int GetEvictionCount() const { return m_evictionCount; }
+
+private:
+    enum class State
+    {
+        Unloaded,
+        Loading,
+        Resident,
+        Failed,
+    };
+
+    struct Entry
+    {
+        std::string path;
+        TextureObject::Format format;
+        TextureObject::InternalFormat internalFormat;
+        bool generateMipmap;
+        bool cubemap;
+        MipmapGenerator::Settings mipmapSettings;
+
+        State state = State::Unloaded;
+        // Set when the load starts. Empty until the upload
+        std::shared_ptr<TextureObject> texture;
+        std::size_t memorySize = 0;
+        // Update count when it was last requested
+        std::uint64_t lastUse = 0;
+    };
+
+    Id Add(const char* path, TextureObject::Format format, TextureObject::InternalFormat internalFormat,
+        bool generateMipmap, bool cubemap, const MipmapGenerator::Settings& mipmapSettings);
+
+    void StartLoad(Id id);
+
+    // Evict the least recently used textures that nothing else holds, until the usage fits the budget
+    void Evict();
+
+private:
+    std::vector<Entry> m_entries;
+
+    std::size_t m_memoryBudget;
+    std::size_t m_memoryUsage;
+
+    // Number of updates so far, to know which textures were used recently
+    std::uint64_t m_updateCount;
+
+    unsigned int m_loadCount;
+    unsigned int m_evictionCount;
+
+    // Last, so it is destroyed first: it waits for the pending loads, and their callbacks write to the entries
+    AsyncTextureLoader m_loader;
+};
@@ -13,6 +13,18 @@ public:
         ArrayBuffer = GL_ARRAY_BUFFER,
         // Element Buffer Object
         ElementArrayBuffer = GL_ELEMENT_ARRAY_BUFFER,
+        // Parameters of indirect drawcalls
+        DrawIndirectBuffer = GL_DRAW_INDIRECT_BUFFER,
+        // Uniform Buffer Object
+        UniformBuffer = GL_UNIFORM_BUFFER,
+        // Read and written by shaders, usually compute shaders
+        ShaderStorageBuffer = GL_SHADER_STORAGE_BUFFER,
+        // Draw count of indirect drawcalls, read by glMultiDraw*IndirectCount
+        ParameterBuffer = GL_PARAMETER_BUFFER,
+        // Data store of a buffer texture, read by shaders with texelFetch
+        TextureBuffer = GL_TEXTURE_BUFFER,
+        // Source of texture uploads, so they can be copied asynchronously
+        PixelUnpackBuffer = GL_PIXEL_UNPACK_BUFFER,
         // TODO: There are more types, add them when they are supported
     };
 
@@ -58,6 +70,10 @@ public:
     // Modify the contents of the buffer, starting at offset
     void UpdateData(std::span<const std::byte> data, size_t offset = 0);
 
+    // Bind the buffer to an indexed binding point of an indexed target (shader storage or uniform blocks)
+    // Any buffer can be bound this way, for example to let a compute shader write indirect drawcalls
+    void BindBase(Target target, GLuint index) const;
+
 protected:
     // Bind the specific target. Used by the Bind() method in derived classes
     void Bind(Target target) const;
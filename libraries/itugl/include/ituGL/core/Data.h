@@ -20,6 +20,8 @@ public:
         UShort = GL_UNSIGNED_SHORT,
         Int = GL_INT,
         UInt = GL_UNSIGNED_INT,
+        // Packed 24-bit depth and 8-bit stencil
+        UInt24_8 = GL_UNSIGNED_INT_24_8,
         // And more...
     };
 
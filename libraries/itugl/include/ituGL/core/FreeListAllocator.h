@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+// Keeps track of the free ranges inside a block of fixed size, to suballocate it.
+// It only does the bookkeeping: offsets and sizes are in whatever units the owner uses (bytes, vertices, indices...)
+class FreeListAllocator
+{
+public:
+    // Returned by Allocate when there is no free range big enough
+    static constexpr unsigned int InvalidOffset = ~0u;
+
+public:
+    FreeListAllocator(unsigned int size = 0);
+
+    // Free everything and change the size of the block
+    void Reset(unsigned int size);
+
+    // Find the first free range that fits size, and return its offset
+    unsigned int Allocate(unsigned int size);
+
+    // Return a range to the free list, merging it with the neighbouring free ranges
+    void Free(unsigned int offset, unsigned int size);
+
+    inline unsigned int GetSize() const { return m_size; }
+    inline unsigned int GetFreeSize() const { return m_freeSize; }
+
+    // Number of separate free ranges. A high count for the free size means the block is fragmented
+    inline unsigned int GetFreeRangeCount() const { return static_cast<unsigned int>(m_freeRanges.size()); }
+
+private:
+    struct Range
+    {
+        unsigned int offset;
+        unsigned int size;
+    };
+
+    // Free ranges, sorted by offset and never adjacent to each other
+    std::vector<Range> m_freeRanges;
+
+    unsigned int m_size;
+    unsigned int m_freeSize;
+};
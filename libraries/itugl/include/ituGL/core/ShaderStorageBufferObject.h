@@ -0,0 +1,14 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+
+// Buffer read and written by shaders, declared in GLSL as a buffer block: layout(std430, binding = N) buffer Name { ... };
+// Shader storage blocks are only available from OpenGL 4.3
+class ShaderStorageBufferObject : public BufferObjectBase<BufferObject::ShaderStorageBuffer>
+{
+public:
+    ShaderStorageBufferObject();
+
+    // Bind to the binding point N of the block
+    inline void BindBase(GLuint index) const { BufferObject::BindBase(Target::ShaderStorageBuffer, index); }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+#include <array>
+#include <vector>
+#include <span>
+
+// Buffer for data that changes every frame, like per-draw matrices, uniform blocks or geometry simulated on the CPU.
+// The buffer is split in frameCount regions used as a ring: while the CPU writes one region, the GPU can still be
+// reading the previous ones. A fence on each region makes sure it is not written again before the GPU is done with it.
+// With OpenGL 4.4, the storage is immutable and stays mapped (persistent and coherent), so writes go straight
+// to the buffer. On older contexts, writes go to a CPU copy that is uploaded when calling Flush
+class StreamBufferObject : public BufferObject
+{
+public:
+    // Maximum number of regions in the ring
+    static constexpr unsigned int MaxFrameCount = 4;
+
+    // Range of the buffer suballocated for the current frame
+    struct Allocation
+    {
+        // Pointer to write to. Valid until the end of the frame
+        std::byte* data = nullptr;
+        // Offset from the start of the buffer, to use in the attribute pointers or when binding the range
+        size_t offset = 0;
+        size_t size = 0;
+
+        inline bool IsValid() const { return data != nullptr; }
+
+        template<typename T>
+        inline std::span<T> As() const { return std::span<T>(reinterpret_cast<T*>(data), size / sizeof(T)); }
+    };
+
+public:
+    // frameSize is the size in bytes of each region, the buffer size is frameSize * frameCount
+    StreamBufferObject(Target target, size_t frameSize, unsigned int frameCount = 3);
+    ~StreamBufferObject();
+
+    // Moving would leave the mapped pointer and the fences behind
+    StreamBufferObject(StreamBufferObject&&) = delete;
+    StreamBufferObject& operator = (StreamBufferObject&&) = delete;
+
+    Target GetTarget() const override { return m_target; }
+
+    void Bind() const override;
+    void Unbind() const;
+
+    // True if the buffer is persistently mapped, false if using the upload fallback
+    inline bool IsPersistent() const { return m_mappedData != nullptr; }
+
+    inline size_t GetFrameSize() const { return m_frameSize; }
+
+    // Move to the next region, waiting if the GPU is still using it
+    void BeginFrame();
+    // Place a fence after all the commands of this frame, to protect the current region
+    void EndFrame();
+
+    // Suballocate size bytes from the current region. offset is aligned to alignment, that must be a power of two
+    // (uniform blocks need GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT). Returns an invalid allocation if the region is full
+    Allocation Allocate(size_t size, size_t alignment = 16);
+
+    // Make the data written since the last call visible to the GPU. Call it before drawing with the data.
+    // Nothing to do when the buffer is persistent, as the mapping is coherent
+    void Flush();
+
+private:
+    Target m_target;
+
+    size_t m_frameSize;
+    unsigned int m_frameCount;
+
+    // Current region and the next free byte inside it
+    unsigned int m_frameIndex;
+    size_t m_frameOffset;
+
+    // Start of the data not flushed yet (upload fallback only)
+    size_t m_flushOffset;
+
+    // Persistent mapping of the whole buffer, or null if not supported
+    std::byte* m_mappedData;
+
+    // Copy of the buffer used when there is no persistent mapping
+    std::vector<std::byte> m_uploadData;
+
+    // Fence of the last frame that used each region
+    std::array<GLsync, MaxFrameCount> m_fences;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO queue of tasks
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // Function processing the items in [begin, end)
+    using RangeFunction = std::function<void(unsigned int begin, unsigned int end)>;
+
+public:
+    // Zero threads uses one thread less than the hardware concurrency, leaving one for the calling thread
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+    // Queue a task to run in a worker thread
+    void Enqueue(Task task);
+
+    // Queue a function and get a future with its result
+    template<typename TFunction>
+    auto Submit(TFunction&& function) -> std::future<decltype(function())>;
+
+    // Split [0, count) in batches of at least batchSize items and process them in the workers and in the calling thread
+    // Returns when all the batches are done
+    void ParallelFor(unsigned int count, unsigned int batchSize, const RangeFunction& function);
+
+    // Shared pool, created on first use
+    static ThreadPool& GetDefault();
+
+private:
+    void WorkerLoop();
+
+    // Pops and runs one task, if any. Returns false if the queue was empty
+    bool RunPendingTask();
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::deque<Task> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    bool m_stopping;
+};
+
+template<typename TFunction>
+auto ThreadPool::Submit(TFunction&& function) -> std::future<decltype(function())>
+{
+    using Result = decltype(function());
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<TFunction>(function));
+    std::future<Result> future = task->get_future();
+    Enqueue([task]() { (*task)(); });
+    return future;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+#include <ituGL/core/Data.h>
+
+// Buffer with the parameters of indirect drawcalls, so many drawcalls can be issued with a single call
+class DrawIndirectBufferObject : public BufferObjectBase<BufferObject::DrawIndirectBuffer>
+{
+public:
+    // Layout expected by glDrawElementsIndirect and glMultiDrawElementsIndirect
+    struct Command
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+public:
+    DrawIndirectBufferObject();
+
+    // Use the same AllocateData methods from the base class
+    using BufferObject::AllocateData;
+    // Additionally, provide an AllocateData method for a list of commands
+    inline void AllocateData(std::span<const Command> commands, Usage usage = Usage::StreamDraw) { AllocateData(Data::GetBytes(commands), usage); }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ituGL/core/Data.h>
+#include <ituGL/geometry/DrawIndirectBufferObject.h>
 
 // Helper class to store the parameters of a drawcall
 class Drawcall
@@ -26,14 +27,31 @@ public:
 public:
     Drawcall();
     Drawcall(Primitive primitive, GLsizei count, GLint first = 0);
-    Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first = 0);
+    Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first = 0, GLint baseVertex = 0);
 
     // Check if the drawcall is valid
     inline bool IsValid() const { return m_primitive != Primitive::Invalid && m_count > 0; }
 
+    inline Primitive GetPrimitive() const { return m_primitive; }
+    inline GLint GetFirst() const { return m_first; }
+    inline GLsizei GetCount() const { return m_count; }
+    inline Data::Type GetElementType() const { return m_eboType; }
+    inline GLint GetBaseVertex() const { return m_baseVertex; }
+
+    // If it can be drawn in the same multi-draw call as the other drawcall (see GetIndirectCommand)
+    bool IsMultiDrawCompatible(const Drawcall& other) const;
+
+    // Parameters of the drawcall for glMultiDrawElementsIndirect. Only for drawcalls with elements.
+    // baseInstance selects the first element of the per-instance attributes
+    DrawIndirectBufferObject::Command GetIndirectCommand(GLuint instanceCount, GLuint baseInstance) const;
+
     // Execute the drawcall
     void Draw() const;
 
+    // Execute the drawcall several times in a single call. Shaders tell the instances apart with
+    // per-instance vertex attributes (see InstanceBuffer) or gl_InstanceID
+    void DrawInstanced(GLsizei instanceCount) const;
+
 private:
     // Type of primitive to be rendered
     Primitive m_primitive;
@@ -46,4 +64,7 @@ private:
 
     // Data type of the elements in the EBO (int, uint, short, byte, etc.). A value of None means no EBO
     Data::Type m_eboType;
+
+    // Value added to the elements, for meshes that share their buffers with others (see GeometryArena)
+    GLint m_baseVertex;
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/geometry/VertexBufferObject.h>
+#include <ituGL/geometry/ElementBufferObject.h>
+#include <ituGL/geometry/VertexFormat.h>
+#include <ituGL/geometry/Drawcall.h>
+#include <ituGL/core/FreeListAllocator.h>
+#include <span>
+#include <unordered_map>
+#include <cassert>
+
+// Shared storage for static geometry. The vertices and indices of many meshes are suballocated from one VBO
+// and one EBO with the same vertex format, so they all use the same VAO. The drawcalls of the meshes only differ
+// in their index range and base vertex, and the renderer draws the ones with the same material with a single
+// multi-draw call, instead of binding buffers for each mesh (see Mesh::AddSubmesh and ModelLoader::SetGeometryArena)
+class GeometryArena
+{
+public:
+    // Same as Mesh::SemanticMap, attribute semantics mapped to their location on a shader program
+    using SemanticMap = std::unordered_map<VertexAttribute::Semantic, GLint>;
+
+    // Where a mesh is stored inside the arena
+    struct Allocation
+    {
+        unsigned int firstVertex = 0;
+        unsigned int vertexCount = 0;
+        unsigned int firstIndex = 0;
+        unsigned int indexCount = 0;
+
+        inline bool IsValid() const { return vertexCount > 0; }
+    };
+
+public:
+    // Vertices are interleaved. The attributes are assigned consecutive locations, unless they are in locations
+    GeometryArena(const VertexFormat& vertexFormat, unsigned int vertexCapacity, unsigned int indexCapacity,
+        const SemanticMap& locations = SemanticMap());
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // If meshes with this interleaved vertex format and attribute locations can be stored in the arena
+    bool IsCompatible(const VertexFormat& vertexFormat, const SemanticMap& locations) const;
+
+    // Copy the vertices and indices of a mesh into the arena. Indices are relative to the first vertex of the mesh.
+    // Returns an invalid allocation if there is not enough free space
+    template<typename TVertex>
+    Allocation Allocate(std::span<const TVertex> vertices, std::span<const unsigned int> indices);
+    Allocation Allocate(std::span<const std::byte> vertexData, std::span<const unsigned int> indices);
+
+    // Release the space used by a mesh, to be reused by later allocations
+    void Free(const Allocation& allocation);
+
+    inline const VertexFormat& GetVertexFormat() const { return m_vertexFormat; }
+    inline const VertexArrayObject& GetVertexArray() const { return m_vao; }
+
+    inline unsigned int GetFreeVertexCount() const { return m_vertexAllocator.GetFreeSize(); }
+    inline unsigned int GetFreeIndexCount() const { return m_indexAllocator.GetFreeSize(); }
+
+    // Drawcall of the triangles of an allocation, to be drawn with the VAO of the arena
+    static Drawcall GetDrawcall(const Allocation& allocation);
+
+private:
+    VertexFormat m_vertexFormat;
+    SemanticMap m_locations;
+
+    VertexBufferObject m_vbo;
+    ElementBufferObject m_ebo;
+    VertexArrayObject m_vao;
+
+    // In vertices and indices, not bytes
+    FreeListAllocator m_vertexAllocator;
+    FreeListAllocator m_indexAllocator;
+};
+
+template<typename TVertex>
+GeometryArena::Allocation GeometryArena::Allocate(std::span<const TVertex> vertices, std::span<const unsigned int> indices)
+{
+    assert(sizeof(TVertex) == m_vertexFormat.GetSize());
+    return Allocate(Data::GetBytes(vertices), indices);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ituGL/geometry/VertexBufferObject.h>
+#include <glm/mat4x4.hpp>
+#include <span>
+
+class StreamBufferObject;
+
+// Vertex buffer with one world matrix per instance, used to draw many copies of the same mesh in one drawcall.
+// In the vertex shader, the matrix is read from a mat4 attribute instead of the WorldMatrix uniform:
+//     layout (location = 3) in mat4 InstanceWorldMatrix;
+// A mat4 attribute takes 4 consecutive locations, one per column
+class InstanceBuffer
+{
+public:
+    // The matrices are stored in a buffer owned by the instance buffer
+    InstanceBuffer();
+    // The matrices are suballocated from a streaming buffer, for matrices that change every frame.
+    // They are only valid until the stream buffer reuses the frame region
+    InstanceBuffer(StreamBufferObject& streamBuffer);
+
+    // Replace the instance matrices. The previous storage is orphaned, so the GPU can keep reading it
+    void SetWorldMatrices(std::span<const glm::mat4> worldMatrices);
+
+    // Number of matrices currently stored
+    inline unsigned int GetInstanceCount() const { return m_instanceCount; }
+
+    // Point the instance attribute of the currently bound VertexArrayObject to this buffer,
+    // starting at the matrix firstInstance. The VAO remembers this until the attribute is set again
+    void SetAttributes(GLuint location, unsigned int firstInstance = 0) const;
+
+    // Disable the instance attribute of the currently bound VertexArrayObject, and make it advance per vertex again.
+    // Call it after drawing, so later draws of the same VAO without instances don't read the instance buffer
+    static void ResetAttributes(GLuint location);
+
+private:
+    VertexBufferObject m_vbo;
+
+    StreamBufferObject* m_streamBuffer;
+
+    // If the current matrices are in the stream buffer or in the VBO
+    bool m_inStreamBuffer;
+
+    // Offset in bytes of the first matrix
+    size_t m_offset;
+
+    unsigned int m_instanceCount;
+
+    // If the stream buffer was already reported as too small
+    bool m_reportedFallback;
+};
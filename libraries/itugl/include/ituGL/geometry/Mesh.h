@@ -4,8 +4,12 @@
 #include <ituGL/geometry/ElementBufferObject.h>
 #include <ituGL/geometry/VertexArrayObject.h>
 #include <ituGL/geometry/VertexAttribute.h>
+#include <ituGL/geometry/VertexFormat.h>
 #include <ituGL/geometry/Drawcall.h>
+#include <ituGL/geometry/GeometryArena.h>
 #include <ituGL/shader/ShaderProgram.h>
+#include <glm/vec3.hpp>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
@@ -17,8 +21,24 @@ public:
     // Maps vertex attribute semantics with their location on a shader program
     using SemanticMap = std::unordered_map<VertexAttribute::Semantic, ShaderProgram::Location>;
 
+    // CPU copy of the triangles of a submesh, with interleaved vertices and 32-bit indices.
+    // Only kept if the loader is asked to, for example to combine static meshes (see StaticBatchBuilder)
+    struct SubmeshGeometry
+    {
+        VertexFormat vertexFormat;
+        std::vector<GLubyte> vertexData;
+        std::vector<unsigned int> indices;
+        // Attribute locations used by the VAO of the submesh
+        SemanticMap locations;
+    };
+
 public:
     Mesh();
+    // Frees the geometry of the submeshes stored in an arena
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
 
     // Adds a new VBO with uninitialized data
     unsigned int AddVertexData(size_t size);
@@ -100,6 +120,10 @@ public:
         std::span<const TVertex> vertices, std::span<const TElement> elements,
         TIterator it, const TIterator itEnd, const SemanticMap& locations = SemanticMap());
 
+    // Adds a new submesh, with geometry already stored in an arena. The arena VAO is used to draw it, shared with
+    // the other meshes in the arena. The mesh frees the allocation when it is destroyed
+    unsigned int AddSubmesh(std::shared_ptr<GeometryArena> arena, const GeometryArena::Allocation& allocation);
+
     inline unsigned int GetVertexBufferCount() const { return static_cast<unsigned int>(m_vbos.size()); }
     inline const VertexBufferObject& GetVertexBuffer(unsigned int vboIndex) const { return m_vbos[vboIndex]; }
 
@@ -110,12 +134,26 @@ public:
     inline const VertexArrayObject& GetVertexArray(unsigned int vaoIndex) const { return m_vaos[vaoIndex]; }
 
     inline unsigned int GetSubmeshCount() const { return 1; return static_cast<unsigned int>(m_submeshes.size()); }
-    inline const VertexArrayObject& GetSubmeshVertexArray(unsigned int submeshIndex) const { return m_vaos[m_submeshes[submeshIndex].vaoIndex]; }
+    const VertexArrayObject& GetSubmeshVertexArray(unsigned int submeshIndex) const;
     inline const Drawcall& GetSubmeshDrawcall(unsigned int submeshIndex) const { return m_submeshes[submeshIndex].drawcall; }
 
     // Draws a submesh
     void DrawSubmesh(int submeshIndex) const;
 
+    // Local space bounding box of the vertices, filled by the loaders or by the code creating the submeshes
+    inline bool HasBounds() const { return m_boundsMin.x <= m_boundsMax.x; }
+    inline const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+    inline const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
+
+    // Grows the bounding box to contain the given box
+    void ExpandBounds(const glm::vec3& min, const glm::vec3& max);
+
+    // CPU geometry of the submesh, or null if it was not kept
+    const SubmeshGeometry* GetSubmeshGeometry(unsigned int submeshIndex) const;
+    void SetSubmeshGeometry(unsigned int submeshIndex, SubmeshGeometry&& geometry);
+    // Free the CPU geometry of all the submeshes, once it is not needed anymore
+    void ClearSubmeshGeometry();
+
 private:
 
     // Helper structure that contains a drawcall and its VAO to be bound
@@ -123,6 +161,10 @@ private:
     {
         unsigned int vaoIndex;
         Drawcall drawcall;
+
+        // If set, the geometry and the VAO are in the arena instead
+        std::shared_ptr<GeometryArena> arena;
+        GeometryArena::Allocation arenaAllocation;
     };
 
 private:
@@ -151,6 +193,13 @@ private:
 
     // Submeshes contained in this mesh
     std::vector<Submesh> m_submeshes;
+
+    // CPU geometry, indexed like the submeshes. Submeshes without geometry have no vertices
+    std::vector<SubmeshGeometry> m_submeshGeometry;
+
+    // Local space bounding box. Empty (min > max) until some bounds are added
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
 };
 
 template<typename T>
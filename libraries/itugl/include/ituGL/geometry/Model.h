@@ -19,10 +19,12 @@ public:
 
     void SetMesh(std::shared_ptr<Mesh> mesh);
 
-    unsigned int GetMaterialCount();
+    unsigned int GetMaterialCount() const;
 
     Material& GetMaterial(unsigned int index);
     const Material& GetMaterial(unsigned int index) const;
+    // Pointer to the material, to share it with other objects
+    std::shared_ptr<Material> GetSharedMaterial(unsigned int index) const;
 
     void SetMaterial(unsigned int index, std::shared_ptr<Material> material);
 
@@ -3,22 +3,99 @@
 #include <ituGL/renderer/RenderPass.h>
 
 #include <ituGL/shader/ShaderProgram.h>
+#include <ituGL/shader/PipelineState.h>
 #include <ituGL/geometry/Mesh.h>
+#include <ituGL/texture/TextureBufferObject.h>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 #include <memory>
+#include <vector>
 
 class Texture2DObject;
 class Material;
+class Light;
 
+// Lights the GBuffer, adding the contribution of each light to the target framebuffer.
+// The lighting shader must get its texture coordinates from gl_FragCoord, because the lights are not always fullscreen
 class DeferredRenderPass: public RenderPass
 {
+public:
+    enum class Mode
+    {
+        // A fullscreen triangle for each light
+        Fullscreen,
+        // A sphere or cone around each point and spot light. The pixels inside are marked in the stencil buffer, and
+        // only those are lit. Needs the depth of the scene and a stencil buffer in the target framebuffer
+        LightVolumes,
+        // A compute shader lights the screen in tiles with all the lights at once, see SetTiledLighting
+        Tiled,
+    };
+
+    // Group size of the tiled lighting compute shader: layout(local_size_x = 16, local_size_y = 16) in;
+    static constexpr unsigned int TileSize = 16;
+    // Texture unit of the light buffer texture in the tiled lighting
+    static constexpr GLint LightTextureUnit = 13;
+
 public:
     DeferredRenderPass(std::shared_ptr<Material> material, std::shared_ptr<const FramebufferObject> targetFramebuffer = nullptr);
 
+    inline Mode GetMode() const { return m_mode; }
+    void SetMode(Mode mode);
+
+    // Framebuffer with the depth of the scene, usually the GBuffer one, copied to the target before drawing the light volumes.
+    // Not needed if the target already has it
+    void SetDepthSource(std::shared_ptr<const FramebufferObject> depthFramebuffer);
+
+    // Compute material for the Tiled mode, with the GBuffer textures as properties. It writes the lit pixels to the
+    // output texture, bound as image 0 (rgba16f). Each group finds the depth range of its tile, keeps the lights that
+    // touch it in shared memory, and lights its pixels with them. It gets these uniforms:
+    // - samplerBuffer Lights, uint LightCount: the lights, with the layout of LightClusterGrid::AppendLightData
+    // - mat4 ViewMatrix, ProjMatrix, InvViewProjMatrix
+    void SetTiledLighting(std::shared_ptr<Material> computeMaterial, std::shared_ptr<Texture2DObject> outputTexture);
+
+    // The Tiled mode needs compute shaders, from OpenGL 4.3
+    static bool IsTiledSupported();
+
     void Render() override;
 
 private:
     void InitializeMeshes();
+    void InitializeStates();
+
+    void RenderLights();
+    void RenderTiled();
+
+    // Mesh for the light and its world matrix, or nullptr if it is lit fullscreen
+    const Mesh* GetLightVolume(const Light& light, glm::mat4& worldMatrix) const;
+
+    // Mark the pixels inside the light volume: the scene is behind its front faces and in front of its back faces
+    void DrawStencilVolume(const Mesh& mesh);
 
 private:
     std::shared_ptr<Material> m_material;
+
+    Mode m_mode;
+    std::shared_ptr<const FramebufferObject> m_depthFramebuffer;
+
+    // Unit volumes: a sphere of radius 1, and a cone from the origin to a disc of radius 1 at Z = 1.
+    // They are a bit larger than that, so the flat faces never cut the real shapes
+    Mesh m_sphereMesh;
+    Mesh m_coneMesh;
+
+    // Fullscreen lights, the first one replacing and the others adding
+    PipelineState::Id m_firstLightState;
+    PipelineState::Id m_additiveLightState;
+    // Stencil marking, and then the lighting of the marked pixels, clearing them for the next light
+    PipelineState::Id m_stencilVolumeState;
+    PipelineState::Id m_volumeLightState;
+
+    std::shared_ptr<Material> m_tiledMaterial;
+    std::shared_ptr<Texture2DObject> m_tiledOutputTexture;
+    TextureBufferObject m_tiledLightTexture;
+    std::vector<glm::vec4> m_tiledLightData;
+    ShaderProgram::Location m_tiledLightsLocation;
+    ShaderProgram::Location m_tiledLightCountLocation;
+    ShaderProgram::Location m_tiledViewMatrixLocation;
+    ShaderProgram::Location m_tiledProjMatrixLocation;
+    ShaderProgram::Location m_tiledInvViewProjMatrixLocation;
 };
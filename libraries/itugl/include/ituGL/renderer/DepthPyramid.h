@@ -0,0 +1,65 @@
+#pragma once
+
+#include <ituGL/texture/Texture2DObject.h>
+#include <glm/vec2.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+
+class ShaderProgram;
+
+// Hierarchical depth (Hi-Z) texture, built on the GPU from a depth texture with a compute shader.
+// Each texel keeps the furthest depth of the area it covers, so a few texels of the right level are enough
+// to know if some bounds are behind everything that was drawn there.
+// The levels are powers of two, level 0 being the largest one that fits in the depth texture
+//
+// The compute shader is provided by the application. Each dispatch reduces one level into the next one:
+//     layout(local_size_x = 8, local_size_y = 8) in;
+//     uniform sampler2D SourceTexture;      // the depth texture, then the pyramid itself
+//     uniform int SourceLevel;
+//     uniform ivec2 SourceSize;
+//     layout(r32f, binding = 0) uniform writeonly image2D TargetImage;
+class DepthPyramid
+{
+public:
+    // Work group size the compute shader must declare
+    static constexpr int GroupSize = 8;
+
+public:
+    DepthPyramid(std::shared_ptr<ShaderProgram> buildProgram);
+
+    // Build all the levels from the depth texture. The pyramid is resized if the depth size changed.
+    // The view-projection matrix used to draw the depth is kept, to test bounds with the same camera
+    void Build(const Texture2DObject& depthTexture, int depthWidth, int depthHeight, const glm::mat4& viewProjMatrix);
+
+    // False until the first Build
+    inline bool IsValid() const { return m_levelCount > 0; }
+
+    inline const Texture2DObject& GetTexture() const { return m_texture; }
+    inline const glm::ivec2& GetSize() const { return m_size; }
+    inline int GetLevelCount() const { return m_levelCount; }
+    inline const glm::mat4& GetViewProjMatrix() const { return m_viewProjMatrix; }
+
+    // Compute shaders and image load/store need OpenGL 4.3
+    static bool IsSupported();
+
+private:
+    void Resize(int depthWidth, int depthHeight);
+
+    void BuildLevel(const Texture2DObject& sourceTexture, int sourceLevel, const glm::ivec2& sourceSize, int targetLevel);
+
+private:
+    std::shared_ptr<ShaderProgram> m_buildProgram;
+
+    GLint m_sourceTextureLocation;
+    GLint m_sourceLevelLocation;
+    GLint m_sourceSizeLocation;
+
+    Texture2DObject m_texture;
+
+    // Size of level 0, and size of the depth texture it was created for
+    glm::ivec2 m_size;
+    glm::ivec2 m_depthSize;
+    int m_levelCount;
+
+    glm::mat4 m_viewProjMatrix;
+};
@@ -1,15 +1,43 @@
 #pragma once
 
 #include <ituGL/renderer/RenderPass.h>
+#include <glad/glad.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class LightClusterGrid;
+class ShaderProgram;
+class ThreadPool;
 
 class ForwardRenderPass : public RenderPass
 {
+public:
+    // Texture units of the cluster buffer textures, above the ones used by the materials
+    static constexpr GLint ClusterTextureUnit = 13;
+
 public:
     ForwardRenderPass();
     ForwardRenderPass(int drawcallCollectionIndex);
 
+    // Clustered forward shading: the lights are assigned to the clusters of the grid every frame, and each drawcall is
+    // drawn once with all of them. Programs without the cluster uniforms (see LightClusterGrid) still use one pass per light
+    ForwardRenderPass(int drawcallCollectionIndex, std::shared_ptr<LightClusterGrid> lightClusterGrid, ThreadPool* threadPool = nullptr);
+
     void Render() override;
 
+private:
+    void RenderClustered();
+
+    // Draw the prepared drawcall once for each light, adding them together
+    void DrawMultipass(const ShaderProgram& shaderProgram);
+
 private:
     int m_drawcallCollectionIndex;
+
+    std::shared_ptr<LightClusterGrid> m_lightClusterGrid;
+    ThreadPool* m_threadPool;
+
+    // Programs whose cluster uniforms were set this frame, and if they support them
+    std::vector<std::pair<const ShaderProgram*, bool>> m_clusteredPrograms;
 };
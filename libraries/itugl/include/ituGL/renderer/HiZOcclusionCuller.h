@@ -0,0 +1,105 @@
+#pragma once
+
+#include <ituGL/core/ShaderStorageBufferObject.h>
+#include <ituGL/geometry/DrawIndirectBufferObject.h>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <span>
+
+class ShaderProgram;
+class DepthPyramid;
+
+// Culls objects on the GPU. A compute shader tests the bounds of each object against the frustum and a DepthPyramid,
+// and writes the drawcalls of the visible ones, compacted, to an indirect buffer, together with their count.
+// The CPU only dispatches and draws, so its cost doesn't depend on how many objects there are.
+//
+// Culling has two passes, so objects that were hidden in the previous frame appear without a frame of delay:
+// - First: all objects are tested against the pyramid of the previous frame, and the visible ones are drawn
+// - The pyramid is built again from the depth of the first pass
+// - Second: the objects that failed the first pass are tested against the new pyramid, to draw the newly visible ones
+// If the pyramid is already complete when culling (for example, testing against the depth of opaque objects),
+// the first pass alone is enough.
+//
+// The compute shader is provided by the application, with these bindings:
+//     layout(local_size_x = 64) in;
+//     layout(std430, binding = 0) readonly buffer Objects { Object objects[]; };      // see Object
+//     layout(std430, binding = 1) writeonly buffer Commands { DrawCommand commands[]; };
+//     layout(std430, binding = 2) buffer DrawCounts { uint drawCounts[]; };
+//     layout(std430, binding = 3) buffer Visibility { uint visible[]; };
+//     uniform uint ObjectCount, Pass;
+//     uniform vec4 FrustumPlanes[6];
+//     uniform bool OcclusionEnabled;
+//     uniform mat4 PyramidViewProjMatrix;
+//     uniform sampler2D DepthPyramid;
+//     uniform ivec2 PyramidSize;
+//     uniform int PyramidLevelCount;
+// The commands of pass P are written from commands[P * ObjectCount], and counted in drawCounts[P]
+class HiZOcclusionCuller
+{
+public:
+    enum class Pass : unsigned int
+    {
+        First = 0,
+        Second = 1,
+    };
+
+    // Object as stored in the shader storage buffer (std430 layout)
+    struct Object
+    {
+        // World space AABB. W is not used
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+
+        // Drawcall of the object. The instance count is kept, baseInstance can select per-object attributes
+        DrawIndirectBufferObject::Command command;
+        GLuint padding[3];
+    };
+
+    // Work group size the compute shader must declare
+    static constexpr unsigned int GroupSize = 64;
+
+public:
+    HiZOcclusionCuller(std::shared_ptr<ShaderProgram> cullProgram);
+
+    // Replace the objects to cull. Their visibility is reset
+    void SetObjects(std::span<const Object> objects);
+
+    inline unsigned int GetObjectCount() const { return m_objectCount; }
+
+    // Test the objects with the frustum of viewProjMatrix and, if the pyramid is valid, occlusion against it
+    void Cull(Pass pass, const glm::mat4& viewProjMatrix, const DepthPyramid& depthPyramid);
+
+    // Draw the visible objects of the pass, in one call. The VAO of the objects must be bound.
+    // From OpenGL 4.6 the draw count is read from the GPU. Before, all the command slots are drawn, the empty ones have no instances
+    void Draw(Pass pass, GLenum primitive = GL_TRIANGLES, GLenum indexType = GL_UNSIGNED_INT) const;
+
+    // Read back how many objects passed the pass. It waits for the GPU, so only use it for debugging
+    unsigned int ReadDrawCount(Pass pass) const;
+
+    // Compute shaders and shader storage buffers need OpenGL 4.3
+    static bool IsSupported();
+
+private:
+    std::shared_ptr<ShaderProgram> m_cullProgram;
+
+    GLint m_objectCountLocation;
+    GLint m_passLocation;
+    GLint m_frustumPlanesLocation;
+    GLint m_occlusionEnabledLocation;
+    GLint m_pyramidViewProjMatrixLocation;
+    GLint m_depthPyramidLocation;
+    GLint m_pyramidSizeLocation;
+    GLint m_pyramidLevelCountLocation;
+
+    unsigned int m_objectCount;
+
+    ShaderStorageBufferObject m_objectBuffer;
+    ShaderStorageBufferObject m_visibilityBuffer;
+
+    // Commands of both passes, one after the other
+    DrawIndirectBufferObject m_commandBuffer;
+
+    // One count per pass. Also bound as parameter buffer to draw
+    ShaderStorageBufferObject m_drawCountBuffer;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <ituGL/texture/TextureBufferObject.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <span>
+#include <vector>
+
+class Camera;
+class Light;
+class ThreadPool;
+
+// Assigns the lights to the clusters of a grid that splits the view frustum: tiles on screen, and depth slices that
+// grow exponentially with the distance, so far clusters are not much deeper than they are wide.
+// Each fragment only loops over the lights of its cluster, so a drawcall is drawn once with all the lights in view.
+//
+// The shaders read the data from buffer textures, with these uniforms:
+// - samplerBuffer ClusterLights: 4 texels per light, in world space
+//     (position, type), (color * intensity, 0), (direction, 0), (attenuation, as in Light::GetAttenuation)
+//     type is 0 for directional, 1 for point and 2 for spot lights
+// - uint ClusterDirectionalLightCount: directional lights come first, and light every fragment
+// - usamplerBuffer ClusterRanges: offset and count of the lights of each cluster in ClusterLightIndices
+// - usamplerBuffer ClusterLightIndices: indices of the lights in ClusterLights
+// - uvec3 ClusterGridSize, vec2 ClusterTileScale, vec2 ClusterDepthScaleBias, vec4 ClusterDepthPlane
+//     cluster.xy = gl_FragCoord.xy * ClusterTileScale
+//     cluster.z = log(dot(ClusterDepthPlane, vec4(worldPosition, 1))) * ClusterDepthScaleBias.x + ClusterDepthScaleBias.y
+//     index = (cluster.z * ClusterGridSize.y + cluster.y) * ClusterGridSize.x + cluster.x, clamped to the grid
+class LightClusterGrid
+{
+public:
+    LightClusterGrid(const glm::uvec3& gridSize = glm::uvec3(16, 9, 24), unsigned int maxClusterLightCount = 128);
+
+    inline const glm::uvec3& GetGridSize() const { return m_gridSize; }
+    inline unsigned int GetClusterCount() const { return m_gridSize.x * m_gridSize.y * m_gridSize.z; }
+
+    // Lights further than this are ignored, and further fragments use the last slice. 0 uses the camera far plane
+    inline float GetMaxDistance() const { return m_maxDistance; }
+    void SetMaxDistance(float distance);
+
+    // Assign the lights to the clusters of the camera, that must have a perspective projection.
+    // The depth slices are processed in parallel when a thread pool is provided
+    void Build(const Camera& camera, std::span<const Light* const> lights, ThreadPool* threadPool = nullptr);
+
+    // Upload the lights and the clusters of the last Build to the buffer textures
+    void Upload();
+
+    // Bind the buffer textures to 3 consecutive texture units, for all the programs drawn after
+    void BindTextures(GLint firstTextureUnit) const;
+
+    // Set the uniforms of a program that is in use. Returns false if it doesn't support clustered lighting
+    bool SetUniforms(const ShaderProgram& shaderProgram, GLint firstTextureUnit, const glm::vec2& viewportSize) const;
+
+    // Append the 4 texels of the light, with the layout of ClusterLights
+    static void AppendLightData(const Light& light, std::vector<glm::vec4>& lightData);
+
+    // Statistics of the last Build
+    inline unsigned int GetLightCount() const { return static_cast<unsigned int>(m_lightData.size() / 4); }
+    inline unsigned int GetIndexCount() const { return static_cast<unsigned int>(m_lightIndices.size()); }
+    inline unsigned int GetMaxClusterLightCount() const { return m_maxClusterLightCount; }
+    // Lights that didn't fit in a full cluster, and were dropped from it
+    inline unsigned int GetOverflowCount() const { return m_overflowCount; }
+
+private:
+    // Bounding sphere of a point or spot light, in view space, and the clusters it may touch
+    struct LocalLight
+    {
+        glm::vec3 center;
+        float radius;
+        glm::uvec3 clusterMin;
+        glm::uvec3 clusterMax;
+    };
+
+    // Recompute the view space bounds of the clusters, if the projection or the depth range changed
+    void UpdateClusterBounds(const glm::mat4& projMatrix, float nearDistance, float farDistance);
+
+    // Bounding sphere of the light, in world space
+    static glm::vec4 GetBoundingSphere(const Light& light);
+
+    unsigned int GetSlice(float distance) const;
+
+    void AssignSlices(unsigned int sliceBegin, unsigned int sliceEnd);
+
+private:
+    glm::uvec3 m_gridSize;
+    unsigned int m_maxClusterLightCount;
+    float m_maxDistance;
+
+    // Depth range of the last Build, and the values that map a distance to its slice
+    glm::mat4 m_projMatrix;
+    float m_nearDistance;
+    float m_farDistance;
+    glm::vec2 m_depthScaleBias;
+    glm::vec4 m_depthPlane;
+
+    // View space bounds of each cluster, min and max
+    std::vector<glm::vec3> m_clusterBounds;
+
+    unsigned int m_directionalLightCount;
+    std::vector<LocalLight> m_localLights;
+
+    // Fixed capacity lists of each cluster, written by the slices in parallel, then compacted
+    std::vector<unsigned int> m_clusterLights;
+    std::vector<unsigned int> m_clusterLightCounts;
+    std::vector<unsigned int> m_sliceOverflowCounts;
+    unsigned int m_overflowCount;
+
+    // Data uploaded to the buffer textures
+    std::vector<glm::vec4> m_lightData;
+    std::vector<glm::uvec2> m_clusterRanges;
+    std::vector<unsigned int> m_lightIndices;
+
+    TextureBufferObject m_lightTexture;
+    TextureBufferObject m_rangeTexture;
+    TextureBufferObject m_indexTexture;
+};
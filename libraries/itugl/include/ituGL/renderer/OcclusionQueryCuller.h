@@ -0,0 +1,163 @@
+#pragma once
+
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/shader/PipelineState.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+class ShaderProgram;
+
+// Culls objects with hardware occlusion queries, for when compute shaders are not available (see HiZOcclusionCuller).
+// Each object gets a cheap proxy, its bounding box, and a query tells if any sample of the proxy passed the depth test
+// against what was already drawn. The results are never waited for:
+// - The GPU uses them with conditional rendering. Each object is drawn conditioned on the query issued for it
+//   in the previous frame, so it is skipped if its proxy was hidden
+// - The CPU reads them once they are available, usually one frame late, only to decide which queries to issue
+//
+// Temporal coherence: visible objects tend to stay visible, so once an object has been visible for a few queries in
+// a row, it is only queried every few frames and drawn without condition in between. The frames are spread by
+// object index, so objects that became visible together don't query together. Hidden objects are queried
+// every frame, as the query is the only way to know that they appeared again.
+//
+// A frame looks like this:
+//     culler.BeginFrame();                                 // read the results that are available
+//     ... draw the occluders ...
+//     culler.BeginConditionalRender(i);                    // for each object
+//     ... draw object i ...
+//     culler.EndConditionalRender(i);
+//     culler.BeginProxies(viewProjMatrix);
+//     culler.DrawProxy(i, boundsMin, boundsMax);           // for each object, queried only if needed
+//     culler.EndProxies();
+//     culler.EndFrame();
+//
+// The shader program of the proxies is provided by the application. It only needs to output the position:
+//     layout (location = 0) in vec3 VertexPosition;        // unit cube in [0, 1]
+//     uniform vec3 BoundsMin;
+//     uniform vec3 BoundsMax;
+//     uniform mat4 ViewProjMatrix;
+class OcclusionQueryCuller
+{
+public:
+    struct Statistics
+    {
+        // Proxies drawn with a query
+        unsigned int issuedQueries = 0;
+        // Queries skipped, because the object was stable or the camera was inside its proxy
+        unsigned int skippedQueries = 0;
+        // Query results read back, and how many of them found the object hidden
+        unsigned int readResults = 0;
+        unsigned int occludedResults = 0;
+        // Objects drawn with conditional rendering, the others were drawn without condition
+        unsigned int conditionalDraws = 0;
+
+        // Fraction of the results that found the object hidden, so its draw was skipped
+        float GetHitRate() const;
+        // Fraction of the queries that were skipped
+        float GetSkipRate() const;
+
+        Statistics& operator += (const Statistics& other);
+    };
+
+public:
+    OcclusionQueryCuller(std::shared_ptr<ShaderProgram> proxyProgram);
+    ~OcclusionQueryCuller();
+
+    // The query objects are owned by the culler
+    OcclusionQueryCuller(const OcclusionQueryCuller&) = delete;
+    void operator = (const OcclusionQueryCuller&) = delete;
+
+    // Set how many objects are culled. Their visibility is reset
+    void SetObjectCount(unsigned int objectCount);
+    inline unsigned int GetObjectCount() const { return static_cast<unsigned int>(m_objects.size()); }
+
+    // Queries in a row that must find an object visible before it is considered stable. Default: 2
+    inline void SetStableQueryCount(unsigned int queryCount) { m_stableQueryCount = queryCount; }
+    // Stable objects are queried once in this number of frames. 1 queries every frame. Default: 8
+    void SetStableQueryInterval(unsigned int frameCount);
+
+    // Read the results available, without waiting. Then, the queries of the previous frame condition the draws
+    void BeginFrame();
+    // Recycle the query objects whose results were read this frame
+    void EndFrame();
+
+    // Last known visibility of the object, from the CPU side. True until a result says otherwise
+    bool IsVisible(unsigned int object) const;
+
+    // Draw the object only if its proxy was visible in the previous frame. Without a query in the previous frame,
+    // the draws are not conditioned. The GPU doesn't wait for a result not ready yet, and draws
+    void BeginConditionalRender(unsigned int object);
+    void EndConditionalRender(unsigned int object);
+
+    // Set the states to draw proxies: no color or depth writes, no face culling
+    void BeginProxies(const glm::mat4& viewProjMatrix);
+    // Issue a query for the object, drawing its proxy, unless it is not needed this frame. Call it after the
+    // occluders were drawn, and only once per object and frame
+    void DrawProxy(unsigned int object, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    // Restore the states changed by BeginProxies
+    void EndProxies();
+
+    // Statistics of the last complete frame, and accumulated since the last reset
+    inline const Statistics& GetFrameStatistics() const { return m_frameStatistics; }
+    inline const Statistics& GetTotalStatistics() const { return m_totalStatistics; }
+    void ResetStatistics();
+
+private:
+    struct ObjectState
+    {
+        // Query issued in the previous frame, used as condition in this one. 0 if there is none
+        GLuint conditionQuery = 0;
+        // Query issued in this frame
+        GLuint issuedQuery = 0;
+        // Results in a row that found the object visible
+        unsigned int visibleCount = 0;
+        bool visible = true;
+    };
+
+    struct PendingQuery
+    {
+        GLuint query;
+        unsigned int object;
+        // Results of queries issued before the objects were reset are discarded
+        unsigned int generation;
+    };
+
+    bool NeedsQuery(unsigned int object) const;
+
+    GLuint AllocateQuery();
+
+    void InitializeProxyMesh();
+
+private:
+    std::shared_ptr<ShaderProgram> m_proxyProgram;
+
+    GLint m_boundsMinLocation;
+    GLint m_boundsMaxLocation;
+    GLint m_viewProjMatrixLocation;
+
+    Mesh m_proxyMesh;
+
+    // Proxies write nothing and test with less or equal, so they pass on the surface of the object they bound
+    PipelineState::Id m_proxyState;
+    bool m_cullFaceEnabled;
+    glm::mat4 m_viewProjMatrix;
+
+    std::vector<ObjectState> m_objects;
+    unsigned int m_generation;
+
+    // Issued and not read yet, in the order they were issued
+    std::vector<PendingQuery> m_pendingQueries;
+
+    // Query objects ready to be reused, and the ones read this frame that may still condition a draw
+    std::vector<GLuint> m_freeQueries;
+    std::vector<GLuint> m_readQueries;
+
+    unsigned int m_stableQueryCount;
+    unsigned int m_stableQueryInterval;
+    unsigned int m_frameIndex;
+
+    Statistics m_currentStatistics;
+    Statistics m_frameStatistics;
+    Statistics m_totalStatistics;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ituGL/renderer/Renderer.h>
+#include <glm/mat4x4.hpp>
+#include <vector>
+#include <span>
+
+class Model;
+
+// Linear buffer of drawcall commands and the world matrices they reference.
+// A list is not thread-safe, but each thread can record into its own list, and the lists are merged
+// into the renderer with Renderer::SubmitCommandLists once recording is done
+class RenderCommandList
+{
+public:
+    RenderCommandList();
+
+    // Record one drawcall per submesh of the model
+    void AddModel(const Model& model, const glm::mat4& worldMatrix);
+
+    // Record a single drawcall
+    void AddDrawcall(const Material& material, const glm::mat4& worldMatrix, const VertexArrayObject& vao, const Drawcall& drawcall);
+
+    // Append the commands of another list, rebasing its world matrix indices
+    void Append(const RenderCommandList& other);
+
+    std::span<const Renderer::DrawcallInfo> GetDrawcalls() const { return m_drawcalls; }
+    std::span<const glm::mat4> GetWorldMatrices() const { return m_worldMatrices; }
+
+    bool IsEmpty() const { return m_drawcalls.empty(); }
+
+    void Reserve(std::size_t drawcallCount, std::size_t worldMatrixCount);
+    void Clear();
+
+private:
+    std::vector<Renderer::DrawcallInfo> m_drawcalls;
+    std::vector<glm::mat4> m_worldMatrices;
+};
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <ituGL/core/DeviceGL.h>
+#include <ituGL/core/StreamBufferObject.h>
 #include <ituGL/renderer/RenderPass.h>
 #include <ituGL/geometry/Drawcall.h>
 #include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/InstanceBuffer.h>
+#include <ituGL/geometry/DrawIndirectBufferObject.h>
 #include <ituGL/shader/Material.h>
 #include <glm/mat4x4.hpp>
 #include <vector>
@@ -20,25 +23,34 @@ class VertexArrayObject;
 class Drawcall;
 class Model;
 class FramebufferObject;
+class RenderCommandList;
+class ThreadPool;
 
 class Renderer
 {
 public:
+    // Compact, trivially copyable drawcall command. Only raw pointers are stored, so recording, sorting
+    // and merging commands never touches reference counts. The shader program is resolved once on record
     class DrawcallInfo
     {
     public:
         DrawcallInfo(const Material& material, unsigned int worldMatrixIndex, const VertexArrayObject& vao, const Drawcall& drawcall);
 
-        const Material& GetMaterial() const { return m_material; }
+        const Material& GetMaterial() const { return *m_material; }
+        const ShaderProgram& GetShaderProgram() const { return *m_shaderProgram; }
         unsigned int GetWorldMatrixIndex() const { return m_worldMatrixIndex; }
-        const VertexArrayObject& GetVAO() const { return m_vao; }
-        const Drawcall& GetDrawcall() const { return m_drawcall; }
+        const VertexArrayObject& GetVAO() const { return *m_vao; }
+        const Drawcall& GetDrawcall() const { return *m_drawcall; }
 
     private:
-        std::reference_wrapper<const Material> m_material;
+        friend class Renderer;
+        friend class RenderCommandList;
+
+        const Material* m_material;
+        const ShaderProgram* m_shaderProgram;
+        const VertexArrayObject* m_vao;
+        const Drawcall* m_drawcall;
         unsigned int m_worldMatrixIndex;
-        std::reference_wrapper<const VertexArrayObject> m_vao;
-        std::reference_wrapper<const Drawcall> m_drawcall;
     };
 
     using DrawcallSupportedFunction = std::function<bool(const DrawcallInfo& drawcallInfo)>;
@@ -54,6 +66,9 @@ public:
         std::span<const DrawcallInfo> GetDrawcalls() const { return m_drawcallInfos; }
 
         void AddDrawcall(const DrawcallInfo& drawcallInfo);
+        // Append drawcalls already checked with IsSupported
+        void AppendSupportedDrawcalls(std::span<const DrawcallInfo> drawcallInfos);
+        void Reserve(std::size_t count);
         void Clear();
 
     private:
@@ -88,12 +103,25 @@ public:
     std::span<const DrawcallInfo> GetDrawcalls(unsigned int collectionIndex) const;
     void AddModel(const Model& model, const glm::mat4& worldMatrix);
 
+    // Merge command lists recorded independently (for example, one per worker thread) into the drawcall collections
+    // With a thread pool, the lists are filtered in parallel and then concatenated, each task writing to its own ranges.
+    // The supported functions of the collections must then be safe to call from several threads
+    void SubmitCommandLists(std::span<const RenderCommandList> commandLists, ThreadPool* threadPool = nullptr);
+    void SubmitCommandList(const RenderCommandList& commandList);
+
     unsigned int AddDrawcallCollection(const DrawcallSupportedFunction &drawcallSupportedFunction);
     void SetDrawcallCollectionSupportedFunction(unsigned int index, const DrawcallSupportedFunction& drawcallSupportedFunction);
 
     void SortDrawcallCollection(unsigned int index, const DrawcallSortFunction& drawcallSortFunction);
     bool IsBackToFront(const DrawcallInfo& a, const DrawcallInfo& b) const;
     bool IsFrontToBack(const DrawcallInfo& a, const DrawcallInfo& b) const;
+    // Groups drawcalls that can be merged by PrepareInstancedDrawcall, so they end up next to each other.
+    // The groups are ordered by pipeline state, then material
+    bool IsInstancingOrder(const DrawcallInfo& a, const DrawcallInfo& b) const;
+
+    // Sort the collection with IsInstancingOrder, only if none of its materials use blending.
+    // Transparent drawcalls keep their order. Returns if the collection was sorted
+    bool SortOpaqueDrawcallCollection(unsigned int index);
 
     const Mesh& GetFullscreenMesh() const;
 
@@ -101,14 +129,34 @@ public:
         const UpdateTransformsFunction& updateTransformFunction,
         const UpdateLightsFunction& updateLightsFunction);
 
+    void UpdateTransforms(const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, bool cameraChanged = true) const;
+    void UpdateTransforms(const ShaderProgram& shaderProgram, unsigned int worldMatrixIndex, bool cameraChanged = true) const;
     void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged = true) const;
     void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged = true) const;
 
     UpdateLightsFunction GetDefaultUpdateLightsFunction(const ShaderProgram& shaderProgram);
+    bool UpdateLights(const ShaderProgram& shaderProgram, std::span<const Light* const> lights, unsigned int& lightIndex) const;
     bool UpdateLights(std::shared_ptr<const ShaderProgram> shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const;
 
+    // Bind the states required by the drawcall. States already bound by the previous drawcall are skipped
     void PrepareDrawcall(const DrawcallInfo& drawcallInfo, Material::OverrideFlags materialOverride = Material::NoOverride);
 
+    // Prepare the first drawcall in the span. If its shader program reads the world matrix from the
+    // "InstanceWorldMatrix" attribute, the drawcalls that follow with the same material and VAO are merged with it:
+    // as instances if they have the same drawcall, and with a multi-draw call if they only differ in their element
+    // range (like the meshes of a GeometryArena). Returns how many drawcalls were merged
+    unsigned int PrepareInstancedDrawcall(std::span<const DrawcallInfo> drawcallInfos, Material::OverrideFlags materialOverride = Material::NoOverride);
+
+    // Draw the drawcalls merged by the last PrepareInstancedDrawcall. Can be called several times, for multipass lighting
+    void DrawPreparedDrawcall() const;
+
+    // Call after drawing a prepared instanced drawcall. Restores the instance attribute of the VAO, which is shared
+    // with the drawcalls that are not instanced
+    void FinishInstancedDrawcall();
+
+    // Forget the cached drawcall states, so the next drawcall binds everything again
+    void InvalidateDrawcallStates();
+
     void SetLightingRenderStates(bool firstPass);
 
     void Render();
@@ -125,7 +173,12 @@ private:
 
     const Camera *m_currentCamera;
 
-    std::shared_ptr<const Material> m_currentMaterial;
+    // States bound by the last prepared drawcall
+    const Material* m_currentMaterial;
+    Material::OverrideFlags m_currentMaterialOverride;
+    const ShaderProgram* m_currentShaderProgram;
+    const VertexArrayObject* m_currentVAO;
+    unsigned int m_currentWorldMatrixIndex;
 
     std::shared_ptr<const FramebufferObject> m_defaultFramebuffer;
     std::shared_ptr<const FramebufferObject> m_currentFramebuffer;
@@ -136,10 +189,46 @@ private:
 
     std::vector<DrawcallCollection> m_drawcallCollections;
 
-    std::unordered_map<std::shared_ptr<const ShaderProgram>, UpdateTransformsFunction> m_updateTransformsFunctions;
-    std::unordered_map<std::shared_ptr<const ShaderProgram>, UpdateLightsFunction> m_updateLightsFunctions;
+    // Drawcalls of each command list accepted by each collection, used when merging lists in parallel
+    std::vector<std::vector<DrawcallInfo>> m_filteredDrawcalls;
+
+    // Keyed by raw pointer to avoid refcount traffic on lookup. The shared_ptr keeps the program alive
+    struct ShaderProgramFunctions
+    {
+        std::shared_ptr<const ShaderProgram> shaderProgram;
+        UpdateTransformsFunction updateTransforms;
+        UpdateLightsFunction updateLights;
+        // Location of the per-instance world matrix attribute, or -1 if the program does not support instancing
+        ShaderProgram::Location instanceWorldMatrixLocation;
+    };
+    std::unordered_map<const ShaderProgram*, ShaderProgramFunctions> m_shaderProgramFunctions;
 
     Mesh m_fullscreenMesh;
 
+    // Per-frame vertex data, like instance matrices. Declared before its users, so it is constructed first
+    StreamBufferObject m_streamBuffer;
+
+    // World matrices of the instances in the current instanced drawcall, suballocated from m_streamBuffer
+    InstanceBuffer m_instanceBuffer;
+    std::vector<glm::mat4> m_instanceWorldMatrices;
+    // Location where the current VAO reads the instance buffer, or -1 if it doesn't
+    ShaderProgram::Location m_instanceAttributeLocation;
+
+    // Drawcall prepared by PrepareInstancedDrawcall, and how many instances to draw
+    const Drawcall* m_preparedDrawcall;
+    unsigned int m_preparedInstanceCount;
+
+    // Runs of instances with the same drawcall, when the prepared drawcalls need a multi-draw call
+    struct MultiDrawRun
+    {
+        const Drawcall* drawcall;
+        unsigned int firstInstance;
+        unsigned int instanceCount;
+    };
+    std::vector<MultiDrawRun> m_multiDrawRuns;
+    // One command per run, uploaded when glMultiDrawElementsIndirect is available
+    std::vector<DrawIndirectBufferObject::Command> m_multiDrawCommands;
+    DrawIndirectBufferObject m_multiDrawBuffer;
+
     std::vector<std::unique_ptr<RenderPass>> m_passes;
 };
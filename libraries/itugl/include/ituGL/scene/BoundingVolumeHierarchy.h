@@ -0,0 +1,96 @@
+#pragma once
+
+#include <ituGL/scene/Bounds.h>
+#include <vector>
+
+class SceneNode;
+
+// Dynamic AABB tree over scene nodes
+// Leaves store enlarged ("fat") bounds, so small movements only need to check the fat bounds still contain the node.
+// When a node leaves its fat bounds, the leaf is removed and inserted again. The tree is kept balanced with rotations
+class BoundingVolumeHierarchy
+{
+public:
+    static constexpr int NullProxy = -1;
+
+public:
+    BoundingVolumeHierarchy();
+
+    // Adds a node with its current bounds. Returns the proxy id used to move or remove it
+    int AddProxy(const AabbBounds& bounds, SceneNode* node);
+
+    void RemoveProxy(int proxyId);
+
+    // Updates the bounds of the node. Returns true if the leaf had to be reinserted
+    bool MoveProxy(int proxyId, const AabbBounds& bounds);
+
+    inline SceneNode* GetProxyNode(int proxyId) const { return m_nodes[proxyId].node; }
+
+    // Fat bounds stored in the tree
+    AabbBounds GetProxyBounds(int proxyId) const;
+
+    inline unsigned int GetProxyCount() const { return m_proxyCount; }
+
+    // Height of the tree, 0 if empty
+    int GetHeight() const;
+
+    void Clear();
+
+    // Append the nodes whose fat bounds intersect the query volume
+    void Query(const FrustumBounds& frustum, std::vector<SceneNode*>& results) const;
+    void Query(const SphereBounds& sphere, std::vector<SceneNode*>& results) const;
+    void Query(const AabbBounds& aabb, std::vector<SceneNode*>& results) const;
+
+    // Append the nodes whose fat bounds are hit by the ray, up to maxDistance along the (normalized) direction
+    void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<SceneNode*>& results) const;
+
+private:
+    struct TreeNode
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+
+        // Parent in the tree, or next free node when in the free list
+        int parent;
+        int child1;
+        int child2;
+
+        // Leaves have height 0, free nodes -1
+        int height;
+
+        SceneNode* node;
+
+        inline bool IsLeaf() const { return child1 == NullProxy; }
+    };
+
+    int AllocateNode();
+    void FreeNode(int nodeIndex);
+
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+
+    // Rotates the subtree at nodeIndex if it is unbalanced. Returns the new root of the subtree
+    int Balance(int nodeIndex);
+
+    // Recomputes bounds and heights from nodeIndex up to the root
+    void Refit(int nodeIndex);
+
+    void SetFatBounds(TreeNode& treeNode, const AabbBounds& bounds) const;
+
+    // Generic traversal, visiting the children of the nodes accepted by the test
+    template<typename TTest>
+    void Query(const TTest& test, std::vector<SceneNode*>& results) const;
+
+private:
+    std::vector<TreeNode> m_nodes;
+
+    int m_root;
+
+    int m_freeList;
+
+    unsigned int m_proxyCount;
+
+    // Fraction of the size added around the bounds of the leaves, with a minimum absolute margin
+    float m_relativeMargin;
+    float m_minimumMargin;
+};
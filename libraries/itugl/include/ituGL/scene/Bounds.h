@@ -1,7 +1,11 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <array>
+#include <cassert>
 
 class Bounds
 {
@@ -103,21 +107,46 @@ private:
     glm::vec3 m_size;
 };
 
-class FrustumBounds : public RotatedBounds
+class FrustumBounds : public Bounds
 {
 public:
-    FrustumBounds(const glm::vec3& center, const glm::vec3& size);
+    enum class Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far
+    };
+    static const unsigned int PlaneCount = 6;
+
+public:
+    // Extracts the clipping planes from a view-projection matrix, in world space
+    FrustumBounds(const glm::mat4& viewProjectionMatrix);
 
     inline Type GetType() const override { return Type::Frustum; }
 
+    // Plane stored as (normal, distance), with the normal pointing inside the frustum
+    inline const glm::vec4& GetPlane(Plane plane) const { return m_planes[static_cast<unsigned int>(plane)]; }
+    inline const glm::vec4& GetPlane(unsigned int index) const { return m_planes[index]; }
+
+    // Signed distance from the point to the plane, positive inside
+    inline float GetDistance(Plane plane, const glm::vec3& point) const
+    {
+        const glm::vec4& p = GetPlane(plane);
+        return p.x * point.x + p.y * point.y + p.z * point.z + p.w;
+    }
+
 private:
+    std::array<glm::vec4, PlaneCount> m_planes;
 };
 
 
 template<typename T>
 bool Bounds::Intersects(const T& other) const
 {
-    Bounds::Intersects(this, other);
+    return Bounds::Intersects(*this, other);
 }
 
 template<typename TA, typename TB>
@@ -144,6 +173,8 @@ bool Bounds::Intersects(const Bounds& boundsA, const TB& boundsB)
         return Bounds::Intersects(static_cast<const AabbBounds&>(boundsA), boundsB);
     case Type::Box:
         return Bounds::Intersects(static_cast<const BoxBounds&>(boundsA), boundsB);
+    case Type::Frustum:
+        return Bounds::Intersects(static_cast<const FrustumBounds&>(boundsA), boundsB);
     default:
         assert(false);
         return false;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ituGL/scene/Bounds.h>
+#include <vector>
+
+// Set of bounding volumes stored as structure of arrays, to be culled together against a frustum
+// Each entry keeps an AABB and its bounding sphere; an entry is culled if either of them is outside one plane
+// Uses AVX2 when the library is built with it (ITUGL_ENABLE_AVX2), and a scalar loop otherwise
+class CullingBatch
+{
+public:
+    CullingBatch();
+
+    inline unsigned int GetCount() const { return static_cast<unsigned int>(m_centerX.size()); }
+
+    void Reserve(unsigned int count);
+    void Clear();
+
+    // Add bounds to the batch. Returns the index of the new entry
+    unsigned int Add(const AabbBounds& bounds);
+    unsigned int Add(const SphereBounds& bounds);
+    unsigned int Add(const glm::vec3& center, const glm::vec3& extents, float radius);
+
+    // Test all the entries against the frustum, and append the indices of the visible ones
+    void Cull(const FrustumBounds& frustum, std::vector<unsigned int>& visibleIndices) const;
+
+    // Same as Cull, but always using the scalar path
+    void CullScalar(const FrustumBounds& frustum, std::vector<unsigned int>& visibleIndices) const;
+
+    // Returns true if Cull uses the SIMD path
+    static bool IsSimdEnabled();
+
+private:
+    void CullScalar(const FrustumBounds& frustum, unsigned int begin, unsigned int end, std::vector<unsigned int>& visibleIndices) const;
+
+private:
+    // Centers
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+
+    // Half sizes of the AABBs
+    std::vector<float> m_extentX;
+    std::vector<float> m_extentY;
+    std::vector<float> m_extentZ;
+
+    // Radii of the bounding spheres
+    std::vector<float> m_radius;
+};
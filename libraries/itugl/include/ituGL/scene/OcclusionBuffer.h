@@ -0,0 +1,103 @@
+#pragma once
+
+#include <ituGL/scene/Bounds.h>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// Low resolution depth buffer rasterized on the CPU from a few occluder meshes, to skip objects hidden behind them
+// The screen is split in tiles that are rasterized in parallel, writing 8 pixels at a time with a coverage mask
+// when the library is built with AVX2 (ITUGL_ENABLE_AVX2), and one pixel at a time otherwise.
+// A max-depth pyramid is built on top, so bounds are tested against a few texels whatever their size on screen
+//
+// Usage per frame: Begin, AddOccluder for each occluder, Rasterize, then IsVisible for each object
+// Occluders must be inside the objects they stand for (never bigger), or visible objects could be culled
+class OcclusionBuffer
+{
+public:
+    // Size in pixels of the tiles rasterized in parallel. The buffer size is rounded up to whole tiles
+    static constexpr unsigned int TileWidth = 32;
+    static constexpr unsigned int TileHeight = 16;
+
+public:
+    OcclusionBuffer(unsigned int width = 256, unsigned int height = 128);
+
+    void Resize(unsigned int width, unsigned int height);
+
+    inline unsigned int GetWidth() const { return m_width; }
+    inline unsigned int GetHeight() const { return m_height; }
+
+    // Remove the occluders of the previous frame and set the camera to rasterize them with
+    void Begin(const glm::mat4& viewProjMatrix);
+
+    // Add an indexed triangle list, transformed by the world matrix. The data is copied
+    void AddOccluder(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices, const glm::mat4& worldMatrix);
+
+    inline unsigned int GetOccluderTriangleCount() const { return static_cast<unsigned int>(m_indices.size() / 3); }
+
+    // Clear the depth, rasterize the occluders and build the depth pyramid
+    void Rasterize(ThreadPool* threadPool = nullptr);
+
+    // False if the bounds are fully behind the occluders
+    bool IsVisible(const AabbBounds& bounds) const;
+    bool IsVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+    // Depth of the pixel in [0, 1], 1 if no occluder covers it
+    inline float GetDepth(unsigned int x, unsigned int y) const { return m_depthLevels[0][y * m_width + x]; }
+
+    // Returns true if Rasterize uses the SIMD path
+    static bool IsSimdEnabled();
+
+    // Grid mesh with resolution x resolution vertices over [0, 1] in XZ, with the heights of the samples as Y.
+    // Each vertex takes the lowest sample of the cells around it, so the mesh always stays under the heightfield
+    static void CreateHeightfieldOccluder(std::span<const float> heights, unsigned int width, unsigned int height, unsigned int resolution,
+        std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices);
+
+private:
+    // Triangle after projection, with its edge functions and depth plane in pixel coordinates
+    struct Triangle
+    {
+        glm::vec3 edgeX;
+        glm::vec3 edgeY;
+        glm::vec3 edgeC;
+        glm::vec3 depthPlane;
+        glm::ivec2 pixelMin;
+        glm::ivec2 pixelMax;
+    };
+
+    // Clip the triangle against the near plane and add the result (0 to 2 triangles) to the list
+    void SetupTriangle(unsigned int triangleIndex, std::vector<Triangle>& triangles) const;
+    void AddScreenTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, std::vector<Triangle>& triangles) const;
+
+    void BinTriangles();
+
+    void RasterizeTile(unsigned int tileIndex);
+
+    void BuildDepthLevel(unsigned int level, unsigned int rowBegin, unsigned int rowEnd);
+
+private:
+    unsigned int m_width;
+    unsigned int m_height;
+    unsigned int m_tileCountX;
+    unsigned int m_tileCountY;
+
+    glm::mat4 m_viewProjMatrix;
+
+    // Occluder vertices in clip space, and their triangles
+    std::vector<glm::vec4> m_clipVertices;
+    std::vector<unsigned int> m_indices;
+
+    // Projected triangles, set up in batches so each batch writes its own list
+    std::vector<std::vector<Triangle>> m_batchTriangles;
+
+    // Projected triangles overlapping each tile
+    std::vector<std::vector<const Triangle*>> m_tileTriangles;
+
+    // Depth pyramid. Level 0 is the full resolution buffer, each next level keeps the max of 2x2 texels
+    std::vector<std::vector<float>> m_depthLevels;
+    std::vector<glm::uvec2> m_levelSizes;
+};
@@ -1,24 +1,69 @@
 #pragma once
 
 #include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/scene/CullingBatch.h>
+#include <ituGL/renderer/RenderCommandList.h>
+#include <memory>
+#include <vector>
 
 class Renderer;
 class SceneCamera;
 class SceneLight;
 class SceneModel;
 class Transform;
+class ThreadPool;
+class OcclusionBuffer;
+class StaticBatch;
 
 class RendererSceneVisitor : public SceneVisitor
 {
 public:
-    RendererSceneVisitor(Renderer& renderer);
+    // With a thread pool, the models are culled and recorded in parallel chunks when the scene ends
+    RendererSceneVisitor(Renderer& renderer, ThreadPool* threadPool = nullptr);
+
+    // Models hidden behind the occluders of the buffer are not submitted. It must be rasterized before the scene is visited
+    inline void SetOcclusionBuffer(const OcclusionBuffer* occlusionBuffer) { m_occlusionBuffer = occlusionBuffer; }
+
+    // Static batches are not scene nodes. They are kept by the visitor, and their clusters culled and submitted with every scene
+    void AddStaticBatch(std::shared_ptr<StaticBatch> staticBatch);
+    void ClearStaticBatches();
+
+    void BeginScene() override;
+    void EndScene() override;
 
     void VisitCamera(SceneCamera& sceneCamera) override;
 
     void VisitLight(SceneLight& sceneLight) override;
 
+    // Models are collected and frustum culled together when the scene ends
     void VisitModel(SceneModel& sceneModel) override;
 
+private:
+    // Cull the models in the chunk against the frustum and the occlusion buffer, and record the visible ones in its command list
+    void GatherChunk(unsigned int chunkIndex, unsigned int chunkSize, const FrustumBounds* frustum);
+
+    // Cull the clusters of the static batches, and submit the runs of visible ones
+    void GatherStaticBatches(const FrustumBounds* frustum);
+
 private:
     Renderer& m_renderer;
+
+    ThreadPool* m_threadPool;
+
+    const OcclusionBuffer* m_occlusionBuffer;
+
+    std::vector<SceneModel*> m_models;
+
+    // Working data of each chunk. Chunks only write to their own data, so they need no locks
+    struct Chunk
+    {
+        CullingBatch cullingBatch;
+        std::vector<AabbBounds> aabbs;
+        std::vector<unsigned int> visibleIndices;
+    };
+    std::vector<Chunk> m_chunks;
+    std::vector<RenderCommandList> m_commandLists;
+
+    std::vector<std::shared_ptr<StaticBatch>> m_staticBatches;
+    RenderCommandList m_staticCommandList;
 };
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <ituGL/scene/BoundingVolumeHierarchy.h>
+#include <ituGL/scene/TransformHierarchy.h>
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include <memory>
 
 class SceneNode;
 class SceneVisitor;
+class Transform;
 
 class Scene
 {
@@ -20,9 +24,64 @@ public:
     bool RemoveSceneNode(std::shared_ptr<SceneNode> node);
     bool RemoveSceneNode(const std::string& name);
 
+    // Visit all the nodes
     void AcceptVisitor(SceneVisitor& visitor);
     void AcceptVisitor(SceneVisitor& visitor) const;
 
+    // Visit the nodes with bounds that may intersect the volume, and all the nodes without bounds
+    void AcceptVisitor(SceneVisitor& visitor, const FrustumBounds& frustum);
+    void AcceptVisitor(SceneVisitor& visitor, const SphereBounds& sphere);
+
+    // Updates the transform hierarchies, and moves the nodes whose transform changed since the last update in the
+    // spatial index. Only the changed transforms are visited. Call it once per frame, before the spatial queries
+    void UpdateSpatialIndex();
+
+    inline const BoundingVolumeHierarchy& GetSpatialIndex() const { return m_spatialIndex; }
+
+    // Append the nodes with bounds that may intersect the query. Results are conservative, tested against the enlarged bounds in the index
+    void QueryNodes(const FrustumBounds& frustum, std::vector<SceneNode*>& results) const;
+    void QueryNodes(const SphereBounds& sphere, std::vector<SceneNode*>& results) const;
+    void QueryNodes(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<SceneNode*>& results) const;
+
+private:
+    // Nodes call it when their transform is replaced
+    friend class SceneNode;
+
+    void AddToSpatialIndex(SceneNode& node);
+    void RemoveFromSpatialIndex(SceneNode& node);
+
+    void AcceptVisitor(SceneVisitor& visitor, const std::vector<SceneNode*>& nodes);
+
 private:
     std::unordered_map<std::string, std::shared_ptr<SceneNode>> m_nodes;
+
+    // Transforms of one hierarchy that changed since the last update, and the nodes that use them
+    struct TransformChanges
+    {
+        TransformHierarchy* hierarchy;
+        // Filled by the hierarchy, see TransformHierarchy::AddChangeList
+        std::vector<TransformHierarchy::Handle> handles;
+        // Nodes in the spatial index, by handle index of their transform
+        std::unordered_multimap<unsigned int, SceneNode*> nodes;
+    };
+
+    // Entry of a node in the spatial index
+    struct SpatialProxy
+    {
+        int proxyId;
+        TransformChanges* transformChanges;
+        TransformHierarchy::Handle transformHandle;
+    };
+
+    BoundingVolumeHierarchy m_spatialIndex;
+    std::unordered_map<const SceneNode*, SpatialProxy> m_spatialProxies;
+
+    // One per hierarchy used by the nodes. Allocated separately, as the hierarchies keep pointers to the lists
+    std::vector<std::unique_ptr<TransformChanges>> m_transformChanges;
+
+    // Nodes without bounds (cameras, lights...) are not in the index
+    std::vector<SceneNode*> m_unboundedNodes;
+
+    // Results of the last visitor query, reused between frames
+    std::vector<SceneNode*> m_queryResults;
 };
@@ -18,6 +18,8 @@ public:
     //int GetDrawcallCount() const override;
     //const Drawcall& GetDrawcall(int index, const VertexArrayObject*& vao, const Material*& material) const override;
 
+    bool HasBounds() const override;
+
     SphereBounds GetSphereBounds() const override;
     AabbBounds GetAabbBounds() const override;
     BoxBounds GetBoxBounds() const override;
@@ -23,6 +23,9 @@ public:
     std::shared_ptr<const Transform> GetTransform() const;
     void SetTransform(std::shared_ptr<Transform> transform);
 
+    // Nodes with bounds are stored in the spatial index of the scene, the rest are visited always
+    virtual bool HasBounds() const;
+
     virtual SphereBounds GetSphereBounds() const;
     virtual AabbBounds GetAabbBounds() const;
     virtual BoxBounds GetBoxBounds() const;
@@ -8,6 +8,10 @@ class Renderable;
 class SceneVisitor
 {
 public:
+    // Called by the scene before and after visiting all its nodes
+    virtual void BeginScene();
+    virtual void EndScene();
+
     virtual void VisitCamera(SceneCamera& sceneCamera);
     virtual void VisitCamera(const SceneCamera& sceneCamera);
 
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/scene/CullingBatch.h>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+
+class Material;
+class OcclusionBuffer;
+
+// Geometry of many static objects that share a material, already transformed to world space and stored in one VBO
+// and one EBO, so it is drawn with a few drawcalls instead of one per object. Created with StaticBatchBuilder.
+// The triangles are grouped in clusters of nearby objects, each one with its own bounds, so the batch is still culled
+// in small pieces. Clusters are contiguous in the index buffer, and runs of visible clusters are drawn together
+class StaticBatch
+{
+public:
+    struct Cluster
+    {
+        // World space bounds
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+
+        // Range of the cluster in the index buffer
+        unsigned int firstIndex;
+        unsigned int indexCount;
+    };
+
+public:
+    StaticBatch(std::shared_ptr<const Material> material, const VertexFormat& vertexFormat, const Mesh::SemanticMap& locations,
+        std::span<const GLubyte> vertexData, std::span<const unsigned int> indices, std::vector<Cluster>&& clusters);
+
+    inline const Material& GetMaterial() const { return *m_material; }
+    inline const VertexArrayObject& GetVertexArray() const { return m_mesh.GetSubmeshVertexArray(0); }
+
+    inline unsigned int GetClusterCount() const { return static_cast<unsigned int>(m_clusters.size()); }
+    inline const Cluster& GetCluster(unsigned int index) const { return m_clusters[index]; }
+
+    inline unsigned int GetVertexCount() const { return m_vertexCount; }
+    inline unsigned int GetIndexCount() const { return m_indexCount; }
+
+    // Test the clusters against the frustum and the occlusion buffer, if provided, and prepare one drawcall for
+    // each run of consecutive visible clusters. The drawcalls stay valid until the next call
+    void Cull(const FrustumBounds* frustum, const OcclusionBuffer* occlusionBuffer);
+
+    inline std::span<const Drawcall> GetVisibleDrawcalls() const { return m_visibleDrawcalls; }
+
+private:
+    std::shared_ptr<const Material> m_material;
+
+    // A single submesh with all the vertices and indices
+    Mesh m_mesh;
+    unsigned int m_vertexCount;
+    unsigned int m_indexCount;
+
+    std::vector<Cluster> m_clusters;
+    CullingBatch m_cullingBatch;
+
+    std::vector<unsigned int> m_visibleClusters;
+    std::vector<Drawcall> m_visibleDrawcalls;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <ituGL/geometry/Mesh.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+class Material;
+class Model;
+class SceneModel;
+class StaticBatch;
+
+// Combines the submeshes of static models into StaticBatches, one for each material and vertex format.
+// The meshes must keep their CPU geometry (see ModelLoader::SetKeepGeometry), and stay alive until Build.
+// Positions are transformed to world space, and normals, tangents and bitangents rotated, if they are 3 floats.
+// Objects are sorted along a Morton curve before being packed into clusters, so each cluster covers a compact area.
+// Once built, the static models don't need to be in the scene anymore, see RendererSceneVisitor::AddStaticBatch
+class StaticBatchBuilder
+{
+public:
+    StaticBatchBuilder();
+
+    // Triangles a cluster is filled with before starting the next one. Objects are never split, so a cluster can
+    // have more triangles if a single object has them. Default: 1024
+    void SetClusterTriangleCount(unsigned int triangleCount);
+
+    // Add the submeshes of the model, with their world matrix. Returns false if the mesh kept no geometry
+    bool AddModel(const Model& model, const glm::mat4& worldMatrix);
+    bool AddSceneModel(const SceneModel& sceneModel);
+
+    inline unsigned int GetObjectCount() const { return m_objectCount; }
+
+    // Create the batches of all the objects added, and clear the builder
+    std::vector<std::shared_ptr<StaticBatch>> Build();
+
+    void Clear();
+
+private:
+    struct Object
+    {
+        const Mesh::SubmeshGeometry* geometry;
+        glm::mat4 worldMatrix;
+
+        // World space bounds
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+
+        // Position along the Morton curve inside the bounds of its group
+        unsigned int mortonCode;
+    };
+
+    // Objects that can be combined: same material, vertex format and attribute locations
+    struct Group
+    {
+        std::shared_ptr<const Material> material;
+        const Mesh::SubmeshGeometry* referenceGeometry;
+        std::vector<Object> objects;
+    };
+
+    std::shared_ptr<StaticBatch> BuildGroup(Group& group) const;
+
+    // Append the vertices of the object, in world space
+    static void AppendVertices(const Object& object, std::vector<GLubyte>& vertexData);
+
+private:
+    unsigned int m_clusterTriangleCount;
+
+    std::vector<Group> m_groups;
+    unsigned int m_objectCount;
+};
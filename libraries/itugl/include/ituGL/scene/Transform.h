@@ -1,42 +1,52 @@
 #pragma once
 
+#include <ituGL/scene/TransformHierarchy.h>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <memory>
 
+// Node in a TransformHierarchy. The transform data lives in the hierarchy, this object owns its handle
 class Transform
 {
 public:
     Transform();
+    Transform(TransformHierarchy& hierarchy);
+    ~Transform();
 
-    inline glm::vec3 GetTranslation() const { return m_translation; }
-    inline void SetTranslation(const glm::vec3& translation) { m_translation = translation; m_dirty = true; }
+    Transform(const Transform&) = delete;
+    Transform& operator=(const Transform&) = delete;
 
-    inline glm::vec3 GetRotation() const { return m_rotation; }
-    inline void SetRotation(const glm::vec3& rotation) { m_rotation = rotation; m_dirty = true; }
+    inline glm::vec3 GetTranslation() const { return m_hierarchy.GetTranslation(m_handle); }
+    inline void SetTranslation(const glm::vec3& translation) { m_hierarchy.SetTranslation(m_handle, translation); }
 
-    inline glm::vec3 GetScale() const { return m_scale; }
-    inline void SetScale(const glm::vec3& scale) { m_scale = scale; m_dirty = true; }
+    inline glm::vec3 GetRotation() const { return m_hierarchy.GetRotation(m_handle); }
+    inline void SetRotation(const glm::vec3& rotation) { m_hierarchy.SetRotation(m_handle, rotation); }
 
+    inline glm::vec3 GetScale() const { return m_hierarchy.GetScale(m_handle); }
+    inline void SetScale(const glm::vec3& scale) { m_hierarchy.SetScale(m_handle, scale); }
+
+    // The parent must belong to the same hierarchy. The pointer keeps the parent alive while it has children
     inline std::shared_ptr<Transform> GetParent() const { return m_parent; }
-    inline void SetParent(std::shared_ptr<Transform> parent) { m_parent = parent; m_dirty = true; }
+    void SetParent(std::shared_ptr<Transform> parent);
+
+    inline TransformHierarchy& GetHierarchy() const { return m_hierarchy; }
+    inline TransformHierarchy::Handle GetHandle() const { return m_handle; }
 
     glm::mat4 GetTranslationMatrix() const;
     glm::mat4 GetRotationMatrix() const;
     glm::mat4 GetScaleMatrix() const;
 
+    // World matrix, including the parents. Can be read from several threads, see TransformHierarchy
     glm::mat4 GetTransformMatrix() const;
 
     bool IsDirty() const;
 
+    // Increases every time this transform or one of its parents changes
+    unsigned int GetVersion() const;
+
 private:
-    glm::vec3 m_translation;
-    glm::vec3 m_rotation;
-    glm::vec3 m_scale;
+    TransformHierarchy& m_hierarchy;
+    TransformHierarchy::Handle m_handle;
 
     std::shared_ptr<Transform> m_parent;
-
-    // Cached matrix
-    mutable glm::mat4 m_matrix;
-    mutable bool m_dirty;
 };
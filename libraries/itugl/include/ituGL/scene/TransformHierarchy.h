@@ -0,0 +1,149 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <cstdint>
+#include <shared_mutex>
+#include <vector>
+
+// Storage for the local and world transforms of many nodes, as structure of arrays
+// Nodes are kept in breadth-first order: sorted by depth, and the children of a node are contiguous.
+// The world matrices are updated level by level, in parallel, visiting only the dirty nodes and their descendants.
+// World matrices can be read from several threads at once, the lazy update is done by only one of them. Changes to
+// the nodes must not run at the same time as the reads
+class TransformHierarchy
+{
+public:
+    // Stable reference to a node. Stays valid when the storage is reordered
+    struct Handle
+    {
+        Handle() : index(~0u), generation(0) {}
+
+        unsigned int index;
+        unsigned int generation;
+
+        inline bool IsValid() const { return index != ~0u; }
+        inline bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    };
+
+public:
+    TransformHierarchy();
+
+    TransformHierarchy(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+    Handle Create(Handle parent = Handle());
+
+    // Destroys the node. Its children are attached to its parent, keeping their local transforms
+    // The slot is only released the next time the storage is reordered
+    void Destroy(Handle handle);
+
+    bool IsAlive(Handle handle) const;
+
+    inline unsigned int GetCount() const { return static_cast<unsigned int>(m_parents.size()); }
+
+    Handle GetParent(Handle handle) const;
+    void SetParent(Handle handle, Handle parent);
+
+    inline const glm::vec3& GetTranslation(Handle handle) const { return m_translations[GetSlot(handle)]; }
+    void SetTranslation(Handle handle, const glm::vec3& translation);
+
+    // Euler angles, applied in Y, X, Z order
+    inline const glm::vec3& GetRotation(Handle handle) const { return m_rotations[GetSlot(handle)]; }
+    void SetRotation(Handle handle, const glm::vec3& rotation);
+
+    inline const glm::vec3& GetScale(Handle handle) const { return m_scales[GetSlot(handle)]; }
+    void SetScale(Handle handle, const glm::vec3& scale);
+
+    // Returns the world matrix, updating the hierarchy first if there are pending changes.
+    // Calling Update before reading from several threads avoids making them wait for it
+    glm::mat4 GetWorldMatrix(Handle handle);
+
+    // True if the world matrix of the node is pending an update, because of the node or one of its ancestors
+    bool IsDirty(Handle handle) const;
+
+    // Increases every time the node or one of its ancestors changes
+    unsigned int GetVersion(Handle handle) const;
+
+    // Recompute the world matrices of the dirty nodes and their descendants
+    void Update();
+
+    // True if some world matrices need to be updated
+    inline bool HasPendingChanges() const { return m_dirtyCount > 0 || m_structureDirty; }
+
+    // Each Update appends the handles of the nodes whose world matrix changed to the registered lists,
+    // so their owners only visit what changed. The owner clears the list after reading it
+    void AddChangeList(std::vector<Handle>& changes);
+    void RemoveChangeList(std::vector<Handle>& changes);
+
+    // Local matrix from translation, rotation and scale
+    static glm::mat4 ComposeMatrix(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale);
+
+    // Shared hierarchy used by the Transform objects
+    static TransformHierarchy& GetDefault();
+
+private:
+    static constexpr unsigned int InvalidSlot = ~0u;
+
+    unsigned int GetSlot(Handle handle) const;
+
+    // Update, with the lock already held
+    void UpdateLocked();
+
+    inline bool IsSlotAlive(unsigned int slot) const { return m_slotHandles[slot] != InvalidSlot; }
+
+    // First alive ancestor of the slot
+    unsigned int GetParentSlot(unsigned int slot) const;
+
+    void SetDirty(unsigned int slot);
+
+    // Sort the nodes in breadth-first order after nodes were created, destroyed or reparented
+    void Reorder();
+
+    // Rebuild the per-level dirty lists from the dirty flags
+    void RebuildDirtyLists();
+
+    void UpdateLevel(const std::vector<unsigned int>& slots);
+
+private:
+    // Local transform
+    std::vector<glm::vec3> m_translations;
+    std::vector<glm::vec3> m_rotations;
+    std::vector<glm::vec3> m_scales;
+
+    // Hierarchy. Children of a slot are [firstChild, firstChild + childCount) once the storage is ordered
+    std::vector<unsigned int> m_parents;
+    std::vector<unsigned int> m_depths;
+    std::vector<unsigned int> m_firstChildren;
+    std::vector<unsigned int> m_childCounts;
+
+    // Cached world matrices
+    std::vector<glm::mat4> m_worldMatrices;
+
+    // Dirty flags, one byte per node to avoid the bit packing of std::vector<bool>
+    std::vector<std::uint8_t> m_dirty;
+
+    // Version of the last change of the local transform or the parent
+    std::vector<unsigned int> m_versions;
+
+    // Handle index of each slot (InvalidSlot if destroyed), and slot and generation of each handle index
+    std::vector<unsigned int> m_slotHandles;
+    std::vector<unsigned int> m_handleSlots;
+    std::vector<unsigned int> m_handleGenerations;
+    std::vector<unsigned int> m_freeHandles;
+
+    // Dirty slots of each depth, only valid while the storage is ordered
+    std::vector<std::vector<unsigned int>> m_dirtyLevels;
+    unsigned int m_dirtyCount;
+
+    // Nodes were created, destroyed or reparented since the last reorder
+    bool m_structureDirty;
+
+    // Shared by the reads of the world matrices, exclusive for the update
+    std::shared_mutex m_updateMutex;
+
+    // Lists that receive the changed handles on Update
+    std::vector<std::vector<Handle>*> m_changeLists;
+
+    unsigned int m_versionCounter;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ituGL/shader/ShaderUniformCollection.h>
+#include <ituGL/shader/PipelineState.h>
 
 #include <ituGL/core/Color.h>
 #include <functional>
@@ -126,15 +127,13 @@ public:
     // You can skip depth, stencil or blending using the override flags
     void Use(OverrideFlags overrideFlags = OverrideFlags::NoOverride) const;
 
-private:
-    // Set all the properties relative to depth
-    void UseDepthTest() const;
-
-    // Set all the properties relative to stencil
-    void UseStencilTest() const;
+    // Id of the depth, stencil and blend states of the material. Materials with the same states share the Id,
+    // so it can be used to sort drawcalls and reduce state changes
+    inline PipelineState::Id GetPipelineStateId() const { return m_pipelineStateId; }
 
-    // Set all the properties relative to blending
-    void UseBlend() const;
+private:
+    // Bake the depth, stencil and blend properties into a pipeline state. Called by all the setters
+    void UpdatePipelineState();
 
 private:
     // Function pointer to prepare the shader used by the material
@@ -173,6 +172,9 @@ private:
 
     // Blend color to use with ConstantColor or ConstantAlpha parameters. Default: white
     Color m_blendColor;
+
+    // Interned pipeline state with all the properties above
+    PipelineState::Id m_pipelineStateId;
 };
 
 // Different conditions for depth and stencil tests
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+
+// Depth, stencil and blend states used to draw, already resolved to the values passed to OpenGL.
+// States are interned: each different combination gets an immutable Id, so comparing two states is comparing
+// two integers. Apply keeps track of the state last set, and only calls OpenGL for what is different
+class PipelineState
+{
+public:
+    using Id = unsigned int;
+
+    // Groups of states, to apply only some of them
+    enum Group
+    {
+        DepthGroup = 1 << 0,
+        StencilGroup = 1 << 1,
+        BlendGroup = 1 << 2,
+        AllGroups = DepthGroup | StencilGroup | BlendGroup
+    };
+
+    // Default state of OpenGL
+    static const Id DefaultId = 0;
+
+    // Hashing functor, to use states as keys
+    struct Hasher
+    {
+        inline std::size_t operator()(const PipelineState& state) const { return state.GetHash(); }
+    };
+
+public:
+    PipelineState();
+
+    bool operator == (const PipelineState& other) const;
+    inline bool operator != (const PipelineState& other) const { return !(*this == other); }
+
+    // Hash of all the states, used for interning
+    std::size_t GetHash() const;
+
+    // Get the Id of an equivalent state, registering it the first time
+    static Id Intern(const PipelineState& state);
+
+    // Get the state from its Id
+    static const PipelineState& Get(Id id);
+
+    // Number of different states interned so far
+    static unsigned int GetCount();
+
+    // Set the states of the groups in the mask, skipping what is already set
+    static void Apply(Id id, unsigned int groupMask = AllGroups);
+
+    // Forget the state last applied. Call it after changing depth, stencil or blend states directly with OpenGL
+    static void Invalidate();
+
+public:
+    // Depth (test enable is not part of the state)
+    GLenum depthFunction;
+    bool depthWrite;
+
+    // Stencil, front [0] and back [1]
+    std::array<GLenum, 2> stencilFunctions;
+    std::array<GLint, 2> stencilRefValues;
+    std::array<GLuint, 2> stencilMasks;
+    std::array<GLenum, 2> stencilFail;
+    std::array<GLenum, 2> stencilDepthFail;
+    std::array<GLenum, 2> stencilDepthPass;
+
+    // Blend. Equations and params are only relevant when enabled
+    bool blendEnabled;
+    // Color [0] and alpha [1]
+    std::array<GLenum, 2> blendEquations;
+    // Source color, destination color, source alpha and destination alpha
+    std::array<GLenum, 4> blendParams;
+    std::array<float, 4> blendColor;
+
+private:
+    // Set the states of one group, only where different from current
+    static void ApplyDepth(const PipelineState& state, const PipelineState* current);
+    static void ApplyStencil(const PipelineState& state, const PipelineState* current);
+    static void ApplyBlend(const PipelineState& state, const PipelineState* current);
+};
@@ -4,6 +4,11 @@
 
 #include <span>
 
+// From KHR_parallel_shader_compile, not in the loaded OpenGL headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 // Shader is an OpenGL Object that represents a program that runs on the GPU
 // There are different types, with different requirements. See Lecture 2: Shaders for more information
 class Shader : public Object
@@ -47,6 +52,13 @@ public:
     // Compile the shader source code
     bool Compile();
 
+    // Start compiling the shader source code, without waiting for the result. The program links it when it is done
+    void CompileAsync();
+
+    // Shaders and programs compile in driver threads, and can be polled without waiting (KHR_parallel_shader_compile).
+    // Without it, the async methods still work, but IsCompiled and IsLinked wait for the compilation
+    static bool IsParallelCompileSupported();
+
     // Check if the shader has been successfully compiled
     bool IsCompiled() const;
 
@@ -17,6 +17,7 @@
 #include <glm/mat4x4.hpp>
 
 #include <span>
+#include <vector>
 
 class Shader;
 class TextureObject;
@@ -71,9 +72,28 @@ public:
         return Build(vertexShader, fragmentShader, tesselationControlShader, &tesselationEvaluationShader, &geometryShader);
     }
 
+    // Attach the shaders and start linking them, without waiting for the result. See IsLinkCompleted.
+    // The shaders can still be compiling, and must be kept until the link is completed
+    void BuildAsync(std::span<const Shader* const> shaders);
+
     // Check if shaders have been linked to create a valid program
     bool IsLinked() const;
 
+    // Check if the link finished, so IsLinked and the uniform queries don't have to wait
+    bool IsLinkCompleted() const;
+
+    // Program binaries let a linked program be saved and loaded later, skipping the compilation. From OpenGL 4.1
+    static bool IsBinarySupported();
+
+    // Hint that GetBinary will be called. Must be set before linking
+    void SetBinaryRetrievable(bool retrievable);
+
+    // Get the binary of a linked program, in a format that only this driver understands
+    bool GetBinary(GLenum& format, std::vector<std::byte>& binary) const;
+
+    // Link the program from a binary. Returns false if the driver rejects it, and then it can be built from the shaders
+    bool LoadBinary(GLenum format, std::span<const std::byte> binary);
+
     // Get a string with linking error messages
     // The max length of the string returned is determined by the capacity of the span
     void GetLinkingErrors(std::span<char> errors) const;
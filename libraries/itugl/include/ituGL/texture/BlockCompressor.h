@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ituGL/texture/TextureObject.h>
+#include <cstddef>
+#include <span>
+
+class ThreadPool;
+
+// Encodes RGBA8 images in the block compressed formats (BC1, BC3, BC4, BC5 and BC7).
+// Each 4x4 block is fitted to the line through its colors, so the quality is good enough for offline use,
+// but the encoding is not meant to run every frame
+class BlockCompressor
+{
+public:
+    // What the texture is used for, to pick its format
+    enum class Usage
+    {
+        Color,      // RGB: BC1
+        ColorAlpha, // RGBA: BC7, or BC3 if BC7 is not supported
+        Normal,     // XY of a tangent space normal map, with Z reconstructed in the shader: BC5
+        Mask,       // Single channel: BC4
+    };
+
+public:
+    // Best supported block compressed format for the usage, or an uncompressed format with the same channels
+    static TextureObject::InternalFormat SelectInternalFormat(Usage usage, bool srgb = false);
+
+    // Format with the channels of the usage
+    static TextureObject::Format GetFormat(Usage usage);
+
+    // Encode an RGBA8 image. The output must have the size from TextureObject::GetCompressedImageSize.
+    // The rows of blocks are split between the threads of the pool, if there is one
+    static void Compress(TextureObject::InternalFormat internalFormat,
+        std::span<const std::byte> rgba, int width, int height,
+        std::span<std::byte> output, ThreadPool* threadPool = nullptr);
+};
@@ -31,6 +31,10 @@ public:
 
     void SetDrawBuffers(std::span<const Attachment> attachments);
 
+    // Copy the buffers in the mask from the source to the target, leaving the target bound for drawing.
+    // Depth and stencil can only be copied if both framebuffers have the same formats
+    static void Blit(const FramebufferObject& source, const FramebufferObject& target, GLint width, GLint height, GLbitfield mask);
+
     static std::shared_ptr<const FramebufferObject> GetDefault();
 
 private:
@@ -50,6 +54,8 @@ enum class FramebufferObject::Target : GLenum
 enum class FramebufferObject::Attachment : GLenum
 {
     Depth = GL_DEPTH_ATTACHMENT,
+    Stencil = GL_STENCIL_ATTACHMENT,
+    DepthStencil = GL_DEPTH_STENCIL_ATTACHMENT,
     Color0 = GL_COLOR_ATTACHMENT0,
     Color1 = GL_COLOR_ATTACHMENT1,
     Color2 = GL_COLOR_ATTACHMENT2,
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ituGL/core/Data.h>
+#include <glm/vec2.hpp>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// CPU copy of the first channel of a texture, sampled the same way the GPU samples it with GL_LINEAR and
+// GL_CLAMP_TO_EDGE. Made from the same data as the texture, it gives the same heights as the shaders, up to the
+// precision of the filtering weights of the GPU
+class HeightmapSampler
+{
+public:
+    HeightmapSampler();
+
+    // Keep the first component of each pixel, normalized like the GPU normalizes the data type
+    void SetData(std::span<const std::byte> data, int width, int height, int componentCount, Data::Type dataType);
+    void Clear();
+
+    inline bool IsEmpty() const { return m_samples.empty(); }
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+
+    // Normalized values, row by row
+    inline std::span<const float> GetSamples() const { return m_samples; }
+
+    // Lowest and highest samples
+    inline float GetMinValue() const { return m_minValue; }
+    inline float GetMaxValue() const { return m_maxValue; }
+
+    // Value of one texel, clamped to the edge. Same as texelFetch
+    float Fetch(int x, int y) const;
+
+    // Value at the texture coordinates, bilinearly filtered. Same as texture
+    float Sample(const glm::vec2& texCoord) const;
+
+private:
+    std::vector<float> m_samples;
+    int m_width;
+    int m_height;
+
+    float m_minValue;
+    float m_maxValue;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// Builds the mipmap levels of 8-bit images on the CPU, so the result is the same on every driver.
+// The filtering happens in linear space: sRGB colors are decoded first, and normal maps are renormalized after
+class MipmapGenerator
+{
+public:
+    enum class Filter
+    {
+        Box,    // Average of each 2x2 square
+        Kaiser, // Windowed sinc, keeps more detail in the smaller levels
+    };
+
+    struct Settings
+    {
+        Filter filter = Filter::Kaiser;
+        // The RGB channels are sRGB encoded (alpha is always linear)
+        bool srgb = false;
+        // The RGB channels are a normal, encoded in [0, 1]. With 2 channels, Z is reconstructed
+        bool normalMap = false;
+    };
+
+public:
+    // Number of levels down to 1x1
+    static int GetLevelCount(int width, int height);
+
+    // Next level of the image: half the size, and at least 1. The rows are split between the threads of the pool
+    static std::vector<std::byte> Downsample(std::span<const std::byte> image, int width, int height, int componentCount,
+        const Settings& settings, ThreadPool* threadPool = nullptr);
+};
@@ -20,6 +20,12 @@ public:
         GLsizei width, GLsizei height,
         Format format, InternalFormat internalFormat,
         std::span<const T> data, Data::Type type = Data::Type::None);
+
+    // Initialize the texture2D with data in a block compressed format.
+    // With empty data, the image is read from the start of the bound pixel unpack buffer, if any
+    void SetCompressedImage(GLint level,
+        GLsizei width, GLsizei height,
+        InternalFormat internalFormat, std::span<const std::byte> data);
 };
 
 // Set image with data in bytes
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ituGL/texture/TextureObject.h>
+#include <ituGL/core/BufferObject.h>
+#include <ituGL/core/Data.h>
+
+// Texture whose texels are the contents of a buffer object. Declared in GLSL as samplerBuffer (usamplerBuffer for
+// integer formats) and read with texelFetch. Much larger than a uniform block, and cheap to refill every frame
+class TextureBufferObject : public TextureObjectBase<TextureObject::TextureBuffer>
+{
+public:
+    using Buffer = BufferObjectBase<BufferObject::TextureBuffer>;
+
+public:
+    TextureBufferObject();
+
+    // Upload the data to the buffer, growing it if needed, and read it with the internal format
+    void SetData(std::span<const std::byte> data, InternalFormat internalFormat);
+
+    template <typename T>
+    void SetData(std::span<const T> data, InternalFormat internalFormat);
+
+    inline const Buffer& GetBuffer() const { return m_buffer; }
+
+    // Size of the buffer in bytes. It can be larger than the last data uploaded
+    inline size_t GetCapacity() const { return m_capacity; }
+
+private:
+    Buffer m_buffer;
+    size_t m_capacity;
+    InternalFormat m_internalFormat;
+};
+
+template <typename T>
+inline void TextureBufferObject::SetData(std::span<const T> data, InternalFormat internalFormat)
+{
+    SetData(Data::GetBytes(data), internalFormat);
+}
@@ -28,6 +28,11 @@ public:
     void SetImage(GLint level, Face face, GLsizei side,
         Format format, InternalFormat internalFormat,
         std::span<const T> data, Data::Type type = Data::Type::None);
+
+    // Initialize a side of the texture with data in a block compressed format.
+    // With empty data, the image is read from the start of the bound pixel unpack buffer, if any
+    void SetCompressedImage(GLint level, Face face, GLsizei side,
+        InternalFormat internalFormat, std::span<const std::byte> data);
 };
 
 // Set image with data in bytes
@@ -3,6 +3,20 @@
 #include <ituGL/core/Object.h>
 #include <span>
 
+// From EXT_texture_compression_s3tc and EXT_texture_sRGB, not in the loaded OpenGL headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 // Abstract OpenGL object that encapsulates a Texture
 // There are different subtypes depending on the target
 class TextureObject : public Object
@@ -75,6 +89,15 @@ public:
     // Get number of components of the data type of the texture (packed components count as 1)
     static int GetDataComponentCount(InternalFormat internalFormat);
 
+    // Check if the internal format is stored in 4x4 blocks (BCn)
+    static bool IsBlockCompressed(InternalFormat internalFormat);
+    // Size in bytes of each 4x4 block, or 0 if the format is not block compressed
+    static int GetBlockSize(InternalFormat internalFormat);
+    // Size in bytes of an image in a block compressed format. Partial blocks on the edges take a whole block
+    static int GetCompressedImageSize(InternalFormat internalFormat, GLsizei width, GLsizei height);
+    // Check if the driver can sample a block compressed format
+    static bool IsBlockCompressionSupported(InternalFormat internalFormat);
+
     // Set active texture unit
     static void SetActiveTexture(GLint textureUnit);
 
@@ -175,6 +198,9 @@ enum TextureObject::Format : GLenum
     FormatBGR = GL_BGR,
     FormatRGBA = GL_RGBA,
     FormatBGRA = GL_BGRA,
+    FormatRInteger = GL_RED_INTEGER,
+    FormatRGInteger = GL_RG_INTEGER,
+    FormatRGBAInteger = GL_RGBA_INTEGER,
     FormatDepth = GL_DEPTH_COMPONENT,
     FormatDepthStencil = GL_DEPTH_STENCIL
 };
@@ -217,6 +243,10 @@ enum TextureObject::InternalFormat : GLint
     InternalFormatRG32F = GL_RG32F,
     InternalFormatRGB32F = GL_RGB32F,
     InternalFormatRGBA32F = GL_RGBA32F,
+    // 32-bit unsigned integer
+    InternalFormatR32UI = GL_R32UI,
+    InternalFormatRG32UI = GL_RG32UI,
+    InternalFormatRGBA32UI = GL_RGBA32UI,
     // sRGB
     InternalFormatSRGB8 = GL_SRGB8,
     InternalFormatSRGBA8 = GL_SRGB8_ALPHA8,
@@ -227,6 +257,15 @@ enum TextureObject::InternalFormat : GLint
     InternalFormatRGBACompressed = GL_COMPRESSED_RGBA,
     InternalFormatSRGBCompressed = GL_COMPRESSED_SRGB,
     InternalFormatSRGBACompressed = GL_COMPRESSED_SRGB_ALPHA,
+    // Block compressed, in blocks of 4x4 pixels
+    InternalFormatBC1 = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,        // RGB, 8 bytes per block
+    InternalFormatSRGBBC1 = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,
+    InternalFormatBC3 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,       // RGBA, 16 bytes per block
+    InternalFormatSRGBBC3 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
+    InternalFormatBC4 = GL_COMPRESSED_RED_RGTC1,                // R, 8 bytes per block
+    InternalFormatBC5 = GL_COMPRESSED_RG_RGTC2,                 // RG, 16 bytes per block
+    InternalFormatBC7 = GL_COMPRESSED_RGBA_BPTC_UNORM,          // RGBA, 16 bytes per block, higher quality than BC3
+    InternalFormatSRGBBC7 = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
     // Depth Stencil
     InternalFormatDepth = GL_DEPTH_COMPONENT,
     InternalFormatDepth16 = GL_DEPTH_COMPONENT16,
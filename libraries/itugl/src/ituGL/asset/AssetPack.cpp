@@ -0,0 +1,343 @@
+#include <ituGL/asset/AssetPack.h>
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const std::uint32_t s_packMagic = 0x4B415049; // "IPAK"
+static const std::uint32_t s_packVersion = 1;
+
+// Blobs start at multiples of this, so the data can be used in place
+static const std::size_t s_blobAlignment = 64;
+
+struct PackHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t namesSize;
+};
+
+// Entries of the index, sorted by hash and then by name
+struct AssetPack::Entry
+{
+    std::uint64_t hash;
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t nameOffset;
+    std::uint32_t nameSize;
+};
+
+static_assert(sizeof(PackHeader) == 16, "Pack header must be 16 bytes");
+
+// FNV-1a, 64 bits
+static std::uint64_t GetNameHash(std::string_view name)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static std::size_t AlignOffset(std::size_t offset)
+{
+    return (offset + s_blobAlignment - 1) / s_blobAlignment * s_blobAlignment;
+}
+
+AssetPack::AssetPack() : m_data(nullptr), m_size(0), m_entries(nullptr), m_entryCount(0)
+{
+}
+
+AssetPack::~AssetPack()
+{
+    Close();
+}
+
+bool AssetPack::Open(const char* path)
+{
+    Close();
+
+    // The mapping keeps the file open, the handles are not needed after it is created
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(PackHeader)))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        return false;
+    }
+    m_size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(PackHeader)))
+    {
+        close(file);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    m_size = static_cast<std::size_t>(fileStat.st_size);
+#endif
+
+    m_data = static_cast<const std::byte*>(data);
+    if (!Validate())
+    {
+        Close();
+        return false;
+    }
+
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(m_data);
+    m_entries = reinterpret_cast<const Entry*>(m_data + sizeof(PackHeader));
+    m_entryCount = header->entryCount;
+    return true;
+}
+
+void AssetPack::Close()
+{
+    if (m_data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_entries = nullptr;
+    m_entryCount = 0;
+}
+
+std::span<const std::byte> AssetPack::Find(std::string_view name) const
+{
+    if (!m_data)
+    {
+        return std::span<const std::byte>();
+    }
+
+    std::string normalizedName = NormalizeName(name);
+    std::uint64_t hash = GetNameHash(normalizedName);
+
+    // Names with the same hash are next to each other
+    const Entry* entriesEnd = m_entries + m_entryCount;
+    const Entry* entry = std::lower_bound(m_entries, entriesEnd, hash,
+        [](const Entry& entry, std::uint64_t hash) { return entry.hash < hash; });
+    for (; entry != entriesEnd && entry->hash == hash; ++entry)
+    {
+        if (GetEntryName(*entry) == normalizedName)
+        {
+            return std::span<const std::byte>(m_data + entry->offset, static_cast<std::size_t>(entry->size));
+        }
+    }
+    return std::span<const std::byte>();
+}
+
+std::string AssetPack::NormalizeName(std::string_view name)
+{
+    return std::filesystem::path(name).lexically_normal().generic_string();
+}
+
+AssetPack& AssetPack::GetDefault()
+{
+    static AssetPack s_defaultPack;
+    return s_defaultPack;
+}
+
+bool AssetPack::Validate() const
+{
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(m_data);
+    if (header->magic != s_packMagic || header->version != s_packVersion)
+    {
+        return false;
+    }
+
+    std::size_t namesOffset = sizeof(PackHeader) + static_cast<std::size_t>(header->entryCount) * sizeof(Entry);
+    if (namesOffset + header->namesSize > m_size)
+    {
+        return false;
+    }
+
+    const Entry* entries = reinterpret_cast<const Entry*>(m_data + sizeof(PackHeader));
+    for (unsigned int i = 0; i < header->entryCount; ++i)
+    {
+        const Entry& entry = entries[i];
+        if (static_cast<std::size_t>(entry.nameOffset) + entry.nameSize > header->namesSize
+            || entry.offset > m_size || entry.size > m_size - entry.offset
+            || (i > 0 && entries[i - 1].hash > entry.hash))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view AssetPack::GetEntryName(const Entry& entry) const
+{
+    const char* names = reinterpret_cast<const char*>(m_entries + m_entryCount);
+    return std::string_view(names + entry.nameOffset, entry.nameSize);
+}
+
+void AssetPackWriter::Add(std::string_view name, std::vector<std::byte> data)
+{
+    std::string normalizedName = AssetPack::NormalizeName(name);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[std::move(normalizedName)] = std::move(data);
+}
+
+void AssetPackWriter::Add(std::string_view name, std::span<const std::byte> data)
+{
+    Add(name, std::vector<std::byte>(data.begin(), data.end()));
+}
+
+bool AssetPackWriter::AddFile(const char* path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::vector<std::byte> data(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+    {
+        return false;
+    }
+    Add(path, std::move(data));
+    return true;
+}
+
+bool AssetPackWriter::AddDirectory(const char* path)
+{
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator directoryIterator(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    bool added = true;
+    for (const std::filesystem::directory_entry& directoryEntry : directoryIterator)
+    {
+        if (directoryEntry.is_regular_file())
+        {
+            added &= AddFile(directoryEntry.path().generic_string().c_str());
+        }
+    }
+    return added;
+}
+
+unsigned int AssetPackWriter::GetEntryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<unsigned int>(m_entries.size());
+}
+
+bool AssetPackWriter::Write(const char* path) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Index sorted by hash, with the names in the same order
+    struct SortedEntry
+    {
+        std::uint64_t hash;
+        const std::string* name;
+        const std::vector<std::byte>* data;
+    };
+    std::vector<SortedEntry> sortedEntries;
+    sortedEntries.reserve(m_entries.size());
+    for (const auto& [name, data] : m_entries)
+    {
+        sortedEntries.push_back({ GetNameHash(name), &name, &data });
+    }
+    std::sort(sortedEntries.begin(), sortedEntries.end(), [](const SortedEntry& a, const SortedEntry& b)
+        {
+            return a.hash != b.hash ? a.hash < b.hash : *a.name < *b.name;
+        });
+
+    PackHeader header{ s_packMagic, s_packVersion, static_cast<std::uint32_t>(sortedEntries.size()), 0 };
+    std::vector<AssetPack::Entry> entries;
+    entries.reserve(sortedEntries.size());
+    for (const SortedEntry& sortedEntry : sortedEntries)
+    {
+        AssetPack::Entry entry = { sortedEntry.hash, 0, sortedEntry.data->size(), header.namesSize, static_cast<std::uint32_t>(sortedEntry.name->size()) };
+        entries.push_back(entry);
+        header.namesSize += entry.nameSize;
+    }
+
+    std::size_t offset = AlignOffset(sizeof(PackHeader) + entries.size() * sizeof(AssetPack::Entry) + header.namesSize);
+    for (AssetPack::Entry& entry : entries)
+    {
+        entry.offset = offset;
+        offset = AlignOffset(offset + static_cast<std::size_t>(entry.size));
+    }
+
+    std::string temporaryPath = std::string(path) + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPack::Entry));
+        for (const SortedEntry& sortedEntry : sortedEntries)
+        {
+            file.write(sortedEntry.name->data(), sortedEntry.name->size());
+        }
+        for (std::size_t i = 0; i < sortedEntries.size(); ++i)
+        {
+            // Padding up to the start of the blob
+            const char padding[s_blobAlignment] = {};
+            file.write(padding, entries[i].offset - static_cast<std::size_t>(file.tellp()));
+            file.write(reinterpret_cast<const char*>(sortedEntries[i].data->data()), sortedEntries[i].data->size());
+        }
+        if (!file.good())
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
@@ -0,0 +1,336 @@
+#include <ituGL/asset/AsyncTextureLoader.h>
+
+#include <ituGL/asset/TextureLoader.h>
+#include <ituGL/core/ThreadPool.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+AsyncTextureLoader::AsyncTextureLoader(ThreadPool& threadPool)
+    : m_threadPool(threadPool), m_pendingCount(0), m_failedCount(0), m_decodeTime(0.0), m_slowestDecodeTime(0.0)
+{
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+    // The workers write to this object, it can't go away before they are done
+    Finish();
+}
+
+std::shared_ptr<Texture2DObject> AsyncTextureLoader::Load2D(const char* path,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap, bool flipVertical,
+    UploadCallback uploadCallback)
+{
+    Request request;
+    request.path = path;
+    request.format = format;
+    request.internalFormat = internalFormat;
+    request.generateMipmap = generateMipmap;
+    request.flipVertical = flipVertical;
+    request.mipmapSettings = m_mipmapSettings;
+    request.uploadCallback = std::move(uploadCallback);
+    request.texture2D = std::make_shared<Texture2DObject>();
+    std::shared_ptr<Texture2DObject> texture = request.texture2D;
+    Enqueue(std::move(request));
+    return texture;
+}
+
+std::shared_ptr<TextureCubemapObject> AsyncTextureLoader::LoadCubemap(const char* path,
+    TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap,
+    UploadCallback uploadCallback)
+{
+    Request request;
+    request.path = path;
+    request.format = format;
+    request.internalFormat = internalFormat;
+    request.generateMipmap = generateMipmap;
+    request.flipVertical = false;
+    request.mipmapSettings = m_mipmapSettings;
+    request.uploadCallback = std::move(uploadCallback);
+    request.textureCubemap = std::make_shared<TextureCubemapObject>();
+    std::shared_ptr<TextureCubemapObject> texture = request.textureCubemap;
+    Enqueue(std::move(request));
+    return texture;
+}
+
+void AsyncTextureLoader::Enqueue(Request request)
+{
+    ++m_pendingCount;
+    m_threadPool.Enqueue([this, request = std::move(request)]() mutable
+        {
+            auto startTime = std::chrono::steady_clock::now();
+
+            if (TextureLoaderUtils::IsCached(request.path.c_str(), request.internalFormat, request.generateMipmap))
+            {
+                TextureCache::Settings settings;
+                settings.format = request.format;
+                settings.internalFormat = request.internalFormat;
+                settings.cubemap = request.textureCubemap != nullptr;
+                settings.flipVertical = request.flipVertical;
+                settings.generateMipmap = request.generateMipmap;
+                settings.mipmap = request.mipmapSettings;
+                TextureCache::GetDefault().Load(request.path.c_str(), settings, request.cachedImage);
+            }
+            else
+            {
+                request.data = TextureLoaderUtils::LoadTexture2DData(request.path.c_str(), request.width, request.height,
+                    request.dataType, request.format, request.internalFormat, request.flipVertical);
+            }
+
+            request.decodeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decodedRequests.push_back(std::move(request));
+            m_condition.notify_one();
+        });
+}
+
+unsigned int AsyncTextureLoader::Update()
+{
+    unsigned int uploadCount = 0;
+    while (m_pendingCount > 0)
+    {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_decodedRequests.empty())
+            {
+                break;
+            }
+            request = std::move(m_decodedRequests.front());
+            m_decodedRequests.pop_front();
+        }
+        std::size_t memorySize = Upload(request);
+        if (request.uploadCallback)
+        {
+            request.uploadCallback(memorySize);
+        }
+        ++uploadCount;
+    }
+    return uploadCount;
+}
+
+void AsyncTextureLoader::Finish()
+{
+    while (m_pendingCount > 0)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return !m_decodedRequests.empty(); });
+            request = std::move(m_decodedRequests.front());
+            m_decodedRequests.pop_front();
+        }
+        std::size_t memorySize = Upload(request);
+        if (request.uploadCallback)
+        {
+            request.uploadCallback(memorySize);
+        }
+    }
+}
+
+std::size_t AsyncTextureLoader::Upload(Request& request)
+{
+    assert(m_pendingCount > 0);
+    --m_pendingCount;
+
+    m_decodeTime += request.decodeTime;
+    m_slowestDecodeTime = std::max(m_slowestDecodeTime, request.decodeTime);
+
+    // Same as the loaders, missing textures are an error
+    bool cached = !request.cachedImage.IsEmpty();
+    assert(cached || !request.data.empty());
+    if (!cached && request.data.empty())
+    {
+        ++m_failedCount;
+        return 0;
+    }
+
+    // Rows of RGB images, and of the smaller levels, are not aligned to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (cached)
+    {
+        UploadCached(request);
+        PixelBuffer::Unbind();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return request.cachedImage.GetData().size();
+    }
+
+    // Estimated from the data: the cubemaps only use 6 of the 12 squares of the cross, and the mipmaps add a third
+    std::size_t memorySize = request.textureCubemap ? request.data.size() / 2 : request.data.size();
+    if (request.generateMipmap)
+    {
+        memorySize += memorySize / 3;
+    }
+
+    if (request.texture2D)
+    {
+        Upload2D(request);
+    }
+    else
+    {
+        UploadCubemap(request);
+    }
+
+    PixelBuffer::Unbind();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Free loaded data (not needed anymore)
+    TextureLoaderUtils::FreeTexture2DData(request.data);
+    return memorySize;
+}
+
+void AsyncTextureLoader::Upload2D(Request& request)
+{
+    Texture2DObject& texture2D = *request.texture2D;
+    texture2D.Bind();
+
+    StreamPixelData(request.data);
+    texture2D.SetImage<std::byte>(0, request.width, request.height, request.format, request.internalFormat, std::span<const std::byte>(), request.dataType);
+
+    SetSampling(texture2D, request.generateMipmap, std::max(request.width, request.height));
+
+    Texture2DObject::Unbind();
+}
+
+void AsyncTextureLoader::UploadCubemap(Request& request)
+{
+    assert(request.width % 4 == 0);
+    assert(request.height % 3 == 0);
+    assert(request.width / 4 == request.height / 3);
+
+    int side = request.width / 4;
+
+    TextureCubemapObject& textureCubemap = *request.textureCubemap;
+    textureCubemap.Bind();
+
+    // The whole cross goes to the buffer once, and each face reads its square from it
+    StreamPixelData(request.data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, request.width);
+
+    struct FaceOffset { TextureCubemapObject::Face face; int x, y; };
+    const FaceOffset faceOffsets[] =
+    {
+        { TextureCubemapObject::Face::Left,   0, 1 },
+        { TextureCubemapObject::Face::Right,  2, 1 },
+        { TextureCubemapObject::Face::Bottom, 1, 2 },
+        { TextureCubemapObject::Face::Top,    1, 0 },
+        { TextureCubemapObject::Face::Front,  3, 1 },
+        { TextureCubemapObject::Face::Back,   1, 1 },
+    };
+    for (const FaceOffset& faceOffset : faceOffsets)
+    {
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, faceOffset.x * side);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, faceOffset.y * side);
+        textureCubemap.SetImage<std::byte>(0, faceOffset.face, side, request.format, request.internalFormat, std::span<const std::byte>(), request.dataType);
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    SetSampling(textureCubemap, request.generateMipmap, side);
+
+    // Clamp to edge to avoid filtering on the edges
+    textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapR, GL_CLAMP_TO_EDGE);
+    textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+    textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+
+    TextureCubemapObject::Unbind();
+}
+
+void AsyncTextureLoader::UploadCached(Request& request)
+{
+    const TextureCache::Image& image = request.cachedImage;
+
+    // Each level goes through the buffer on its own, the texture calls can only read from its start
+    if (request.texture2D)
+    {
+        assert(image.faceCount == 1);
+        Texture2DObject& texture2D = *request.texture2D;
+        texture2D.Bind();
+        for (int level = 0; level < image.levelCount; ++level)
+        {
+            int width = image.GetLevelWidth(level);
+            int height = image.GetLevelHeight(level);
+            StreamPixelData(image.GetLevelData(0, level));
+            if (image.IsBlockCompressed())
+            {
+                texture2D.SetCompressedImage(level, width, height, image.internalFormat, std::span<const std::byte>());
+            }
+            else
+            {
+                texture2D.SetImage<std::byte>(level, width, height, image.format, image.internalFormat, std::span<const std::byte>(), Data::Type::UByte);
+            }
+        }
+        SetLevelSampling(texture2D, image.levelCount);
+        Texture2DObject::Unbind();
+    }
+    else
+    {
+        assert(image.faceCount == 6);
+        TextureCubemapObject& textureCubemap = *request.textureCubemap;
+        textureCubemap.Bind();
+        for (int face = 0; face < 6; ++face)
+        {
+            // The faces are in the order of the cubemap targets
+            TextureCubemapObject::Face cubemapFace = static_cast<TextureCubemapObject::Face>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
+            for (int level = 0; level < image.levelCount; ++level)
+            {
+                int side = image.GetLevelWidth(level);
+                StreamPixelData(image.GetLevelData(face, level));
+                if (image.IsBlockCompressed())
+                {
+                    textureCubemap.SetCompressedImage(level, cubemapFace, side, image.internalFormat, std::span<const std::byte>());
+                }
+                else
+                {
+                    textureCubemap.SetImage<std::byte>(level, cubemapFace, side, image.format, image.internalFormat, std::span<const std::byte>(), Data::Type::UByte);
+                }
+            }
+        }
+        SetLevelSampling(textureCubemap, image.levelCount);
+
+        // Clamp to edge to avoid filtering on the edges
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapR, GL_CLAMP_TO_EDGE);
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+        TextureCubemapObject::Unbind();
+    }
+}
+
+void AsyncTextureLoader::StreamPixelData(std::span<const std::byte> data)
+{
+    m_pixelBuffer.Bind();
+    // New storage every time, so the copy doesn't wait for the previous upload to be read
+    m_pixelBuffer.AllocateData(data, BufferObject::StreamDraw);
+}
+
+template<typename T>
+void AsyncTextureLoader::SetSampling(T& texture, bool generateMipmap, int size)
+{
+    texture.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
+    texture.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+
+    // Generate mipmap if needed
+    if (generateMipmap)
+    {
+        texture.GenerateMipmap();
+        texture.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR_MIPMAP_LINEAR);
+
+        // Adjust mip levels
+        texture.SetParameter(TextureObject::ParameterFloat::MinLod, 0.0f);
+        float maxLod = 1.0f + std::floor(std::log2(static_cast<float>(size)));
+        texture.SetParameter(TextureObject::ParameterFloat::MaxLod, maxLod);
+    }
+}
+
+template<typename T>
+void AsyncTextureLoader::SetLevelSampling(T& texture, int levelCount)
+{
+    texture.SetParameter(TextureObject::ParameterEnum::MinFilter, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    texture.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    texture.SetParameter(TextureObject::ParameterInt::MaxLevel, levelCount - 1);
+}
@@ -6,12 +6,16 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/common.hpp>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <bit>
 
 ModelLoader::ModelLoader(std::shared_ptr<Material> referenceMaterial)
     : m_referenceMaterial(referenceMaterial)
     , m_createMaterials(false)
+    , m_keepGeometry(false)
 {
     m_textureLoader.SetGenerateMipmap(true);
 }
@@ -39,6 +43,26 @@ void ModelLoader::SetCreateMaterials(bool createMaterials)
     m_createMaterials = createMaterials;
 }
 
+bool ModelLoader::GetKeepGeometry() const
+{
+    return m_keepGeometry;
+}
+
+void ModelLoader::SetKeepGeometry(bool keepGeometry)
+{
+    m_keepGeometry = keepGeometry;
+}
+
+std::shared_ptr<GeometryArena> ModelLoader::GetGeometryArena() const
+{
+    return m_geometryArena;
+}
+
+void ModelLoader::SetGeometryArena(std::shared_ptr<GeometryArena> geometryArena)
+{
+    m_geometryArena = geometryArena;
+}
+
 Texture2DLoader& ModelLoader::GetTexture2DLoader()
 {
     return m_textureLoader;
@@ -73,6 +97,35 @@ bool ModelLoader::SetMaterialProperty(MaterialProperty materialProperty, const c
     return found;
 }
 
+std::string ModelLoader::GetKey(const char* path) const
+{
+    // The maps are sorted, so loaders with the same mappings get the same key whatever order they were added in
+    std::vector<std::pair<unsigned int, ShaderProgram::Location>> attributes;
+    for (const auto& semanticLocation : m_materialAttributeMap)
+    {
+        attributes.emplace_back(static_cast<unsigned int>(semanticLocation.first), semanticLocation.second);
+    }
+    std::vector<std::pair<unsigned int, ShaderProgram::Location>> properties;
+    for (const auto& propertyLocation : m_materialPropertyMap)
+    {
+        properties.emplace_back(static_cast<unsigned int>(propertyLocation.first), propertyLocation.second);
+    }
+    std::sort(attributes.begin(), attributes.end());
+    std::sort(properties.begin(), properties.end());
+
+    std::stringstream stringStream;
+    stringStream << path << '|' << m_referenceMaterial.get() << ',' << m_createMaterials << ',' << m_keepGeometry << ',' << m_geometryArena.get();
+    for (const auto& attribute : attributes)
+    {
+        stringStream << ",a" << attribute.first << ':' << attribute.second;
+    }
+    for (const auto& property : properties)
+    {
+        stringStream << ",p" << property.first << ':' << property.second;
+    }
+    return stringStream.str();
+}
+
 Model ModelLoader::Load(const char* path)
 {
     Model model;
@@ -114,6 +167,30 @@ void ModelLoader::GenerateSubmesh(Mesh& mesh, const aiMesh& meshData)
     VertexFormat vertexFormat;
     bool interleaved = true;
     std::vector<GLubyte> vertexData = CollectVertexData(meshData, vertexFormat, interleaved);
+
+    // Triangle meshes go to the arena when possible, sharing its buffers and VAO with the other static meshes
+    bool onlyTriangles = meshData.mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+    if (m_geometryArena && onlyTriangles && m_geometryArena->IsCompatible(vertexFormat, m_materialAttributeMap))
+    {
+        std::vector<unsigned int> indices = CollectTriangleIndices(meshData);
+        GeometryArena::Allocation allocation = m_geometryArena->Allocate(Data::GetBytes(std::span<const GLubyte>(vertexData)), indices);
+        if (allocation.IsValid())
+        {
+            unsigned int submeshIndex = mesh.AddSubmesh(m_geometryArena, allocation);
+            if (m_keepGeometry)
+            {
+                Mesh::SubmeshGeometry geometry;
+                geometry.vertexFormat = vertexFormat;
+                geometry.vertexData = std::move(vertexData);
+                geometry.indices = std::move(indices);
+                geometry.locations = m_materialAttributeMap;
+                mesh.SetSubmeshGeometry(submeshIndex, std::move(geometry));
+            }
+            ExpandBounds(mesh, meshData);
+            return;
+        }
+    }
+
     int vboIndex = mesh.AddVertexData<GLubyte>(vertexData);
 
     // Collect element data
@@ -130,8 +207,38 @@ void ModelLoader::GenerateSubmesh(Mesh& mesh, const aiMesh& meshData)
     {
         Drawcall::Primitive primitive = primitives[i];
         int end = elementCounts[i];
-        mesh.AddSubmesh(primitive, start, end - start, elementType, eboIndex, vboIndex, vertexFormat.LayoutBegin(static_cast<int>(vertexData.size()), interleaved), vertexFormat.LayoutEnd(), m_materialAttributeMap);
+        unsigned int submeshIndex = mesh.AddSubmesh(primitive, start, end - start, elementType, eboIndex, vboIndex, vertexFormat.LayoutBegin(static_cast<int>(vertexData.size()), interleaved), vertexFormat.LayoutEnd(), m_materialAttributeMap);
         start = end;
+
+        if (m_keepGeometry && primitive == Drawcall::Primitive::Triangles)
+        {
+            Mesh::SubmeshGeometry geometry;
+            geometry.vertexFormat = vertexFormat;
+            geometry.vertexData = vertexData;
+            geometry.locations = m_materialAttributeMap;
+            // Read from the faces, the element data could use smaller types
+            geometry.indices = CollectTriangleIndices(meshData);
+            mesh.SetSubmeshGeometry(submeshIndex, std::move(geometry));
+        }
+    }
+
+    ExpandBounds(mesh, meshData);
+}
+
+void ModelLoader::ExpandBounds(Mesh& mesh, const aiMesh& meshData)
+{
+    // Grow the mesh bounds with the positions of this submesh
+    if (meshData.mNumVertices > 0)
+    {
+        glm::vec3 boundsMin(meshData.mVertices[0].x, meshData.mVertices[0].y, meshData.mVertices[0].z);
+        glm::vec3 boundsMax = boundsMin;
+        for (unsigned int i = 1; i < meshData.mNumVertices; ++i)
+        {
+            glm::vec3 position(meshData.mVertices[i].x, meshData.mVertices[i].y, meshData.mVertices[i].z);
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+        mesh.ExpandBounds(boundsMin, boundsMax);
     }
 }
 
@@ -253,6 +360,21 @@ std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, Vert
     return vertexData;
 }
 
+std::vector<unsigned int> ModelLoader::CollectTriangleIndices(const aiMesh& meshData)
+{
+    std::vector<unsigned int> indices;
+    indices.reserve(meshData.mNumFaces * 3);
+    for (unsigned int faceIndex = 0; faceIndex < meshData.mNumFaces; ++faceIndex)
+    {
+        const aiFace& face = meshData.mFaces[faceIndex];
+        if (face.mNumIndices == 3)
+        {
+            indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+        }
+    }
+    return indices;
+}
+
 std::vector<GLubyte> ModelLoader::CollectElementData(const aiMesh& meshData, Data::Type& elementType,
     std::vector<Drawcall::Primitive>& primitives, std::vector<int>& elementCounts)
 {
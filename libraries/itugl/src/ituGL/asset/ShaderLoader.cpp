@@ -1,5 +1,6 @@
 #include <ituGL/asset/ShaderLoader.h>
 
+#include <ituGL/asset/AssetPack.h>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -23,15 +24,40 @@ bool ShaderLoader::IsValid(std::span<const char*> paths)
 }
 
 Shader ShaderLoader::Load(const char* path)
+{
+    return LoadSource(ReadSource(path).c_str());
+}
+
+Shader ShaderLoader::LoadSource(const char* source)
+{
+    Shader shader(m_type);
+    shader.SetSource(source);
+    shader.Compile();
+    CheckCompilation(shader);
+    return shader;
+}
+
+Shader ShaderLoader::LoadSourceAsync(const char* source)
 {
     Shader shader(m_type);
+    shader.SetSource(source);
+    shader.CompileAsync();
+    return shader;
+}
+
+std::string ShaderLoader::ReadSource(const char* path)
+{
+    std::span<const std::byte> packData = AssetPack::GetDefault().Find(path);
+    if (!packData.empty())
+    {
+        return std::string(reinterpret_cast<const char*>(packData.data()), packData.size());
+    }
+
     std::ifstream file(path);
     assert(file.is_open());
     std::stringstream stringStream;
-    stringStream << file.rdbuf() << '\0';
-    shader.SetSource(stringStream.str().c_str());
-    Compile(shader);
-    return shader;
+    stringStream << file.rdbuf();
+    return stringStream.str();
 }
 
 Shader ShaderLoader::Load(std::span<const char*> paths)
@@ -49,7 +75,8 @@ Shader ShaderLoader::Load(std::span<const char*> paths)
         sourceCode[i] = sourceCodeStrings[i].c_str();
     }
     shader.SetSource(sourceCode);
-    Compile(shader);
+    shader.Compile();
+    CheckCompilation(shader);
     return shader;
 }
 
@@ -73,9 +100,10 @@ bool ShaderLoader::LoadInto(Shader& shader, std::span<const char*> paths)
     return valid;
 }
 
-void ShaderLoader::Compile(Shader& shader)
+bool ShaderLoader::CheckCompilation(const Shader& shader)
 {
-    if (!shader.Compile())
+    bool compiled = shader.IsCompiled();
+    if (!compiled)
     {
         std::array<char, 512> infoLog;
         shader.GetCompilationErrors(infoLog);
@@ -104,6 +132,7 @@ void ShaderLoader::Compile(Shader& shader)
         }
         std::cout << "ERROR::SHADER::" << typeName << "::COMPILATION_FAILED\n" << infoLog.data() << std::endl;
     }
+    return compiled;
 }
 
 Shader ShaderLoader::Load(Shader::Type type, const char* path)
@@ -0,0 +1,212 @@
+#include <ituGL/asset/ShaderPreprocessor.h>
+
+#include <ituGL/asset/AssetPack.h>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Key of a path in the maps, the same for all the ways to write it
+static std::string GetPathKey(const std::filesystem::path& path)
+{
+    return path.lexically_normal().generic_string();
+}
+
+void ShaderPreprocessor::AddIncludeDirectory(const char* directory)
+{
+    m_includeDirectories.emplace_back(directory);
+}
+
+std::shared_ptr<const std::string> ShaderPreprocessor::Process(const char* path, std::span<const Define> defines)
+{
+    std::string variantKey = GetPathKey(path) + '|' + GetVariantKey(defines);
+    auto itVariant = m_variants.find(variantKey);
+    if (itVariant != m_variants.end())
+    {
+        return itVariant->second;
+    }
+
+    std::filesystem::path rootPath = std::filesystem::path(path).lexically_normal();
+    std::string source;
+    std::vector<std::filesystem::path> includedPaths{ rootPath };
+    if (!AppendFile(rootPath, source, includedPaths))
+    {
+        return nullptr;
+    }
+
+    // The defines go right after #version, that must be the first directive. Then the line numbers are restored
+    std::size_t versionBegin = source.rfind("#version", 0) == 0 ? 0 : source.find("\n#version");
+    std::size_t insertPosition = 0;
+    int nextLine = 1;
+    if (versionBegin != std::string::npos)
+    {
+        std::size_t versionEnd = source.find('\n', versionBegin + 1);
+        insertPosition = versionEnd != std::string::npos ? versionEnd + 1 : source.size();
+        nextLine += static_cast<int>(std::count(source.begin(), source.begin() + insertPosition, '\n'));
+    }
+    if (!defines.empty())
+    {
+        // Sorted, so the order of the defines doesn't change the source
+        std::vector<Define> sortedDefines(defines.begin(), defines.end());
+        std::sort(sortedDefines.begin(), sortedDefines.end());
+
+        std::string defineLines;
+        for (const Define& define : sortedDefines)
+        {
+            defineLines += "#define " + define.first + ' ' + define.second + '\n';
+        }
+        defineLines += "#line " + std::to_string(nextLine) + " 0\n";
+        source.insert(insertPosition, defineLines);
+    }
+
+    std::shared_ptr<const std::string> sharedSource = Deduplicate(std::move(source));
+    m_variants.emplace(std::move(variantKey), sharedSource);
+    return sharedSource;
+}
+
+std::string ShaderPreprocessor::GetVariantKey(std::span<const Define> defines)
+{
+    std::vector<Define> sortedDefines(defines.begin(), defines.end());
+    std::sort(sortedDefines.begin(), sortedDefines.end());
+
+    std::string key;
+    for (const Define& define : sortedDefines)
+    {
+        key += define.first;
+        if (!define.second.empty())
+        {
+            key += '=' + define.second;
+        }
+        key += ';';
+    }
+    return key;
+}
+
+void ShaderPreprocessor::Clear()
+{
+    m_files.clear();
+    m_variants.clear();
+    m_sources.clear();
+}
+
+const std::string* ShaderPreprocessor::GetFile(const std::filesystem::path& path)
+{
+    std::string key = GetPathKey(path);
+    auto itFile = m_files.find(key);
+    if (itFile == m_files.end())
+    {
+        // Files in the default asset pack are used instead of the ones on disk
+        std::span<const std::byte> packData = AssetPack::GetDefault().Find(key);
+        if (!packData.empty())
+        {
+            std::string contents(reinterpret_cast<const char*>(packData.data()), packData.size());
+            return &m_files.emplace(std::move(key), std::move(contents)).first->second;
+        }
+
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            return nullptr;
+        }
+        std::stringstream stringStream;
+        stringStream << file.rdbuf();
+        itFile = m_files.emplace(std::move(key), stringStream.str()).first;
+    }
+    return &itFile->second;
+}
+
+bool ShaderPreprocessor::AppendFile(const std::filesystem::path& path, std::string& output, std::vector<std::filesystem::path>& includedPaths)
+{
+    const std::string* file = GetFile(path);
+    if (!file)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_FOUND\n" << path.generic_string() << std::endl;
+        return false;
+    }
+
+    // GLSL has no file names, #line uses the index of the file in the included ones instead
+    std::size_t fileIndex = std::find(includedPaths.begin(), includedPaths.end(), path) - includedPaths.begin();
+
+    std::istringstream lines(*file);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        ++lineNumber;
+
+        std::size_t directiveBegin = line.find_first_not_of(" \t");
+        if (directiveBegin == std::string::npos || line.compare(directiveBegin, 8, "#include") != 0)
+        {
+            output += line;
+            output += '\n';
+            continue;
+        }
+
+        std::size_t nameBegin = line.find('"', directiveBegin);
+        std::size_t nameEnd = nameBegin != std::string::npos ? line.find('"', nameBegin + 1) : std::string::npos;
+        if (nameEnd == std::string::npos)
+        {
+            std::cout << "ERROR::SHADER::INVALID_INCLUDE\n" << path.generic_string() << "(" << lineNumber << "): " << line << std::endl;
+            return false;
+        }
+
+        std::filesystem::path includePath = FindInclude(path, line.substr(nameBegin + 1, nameEnd - nameBegin - 1));
+        if (includePath.empty())
+        {
+            std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND\n" << path.generic_string() << "(" << lineNumber << "): " << line << std::endl;
+            return false;
+        }
+
+        // Files already included are skipped, the empty line keeps the numbering
+        if (std::find(includedPaths.begin(), includedPaths.end(), includePath) == includedPaths.end())
+        {
+            includedPaths.push_back(includePath);
+            output += "#line 1 " + std::to_string(includedPaths.size() - 1) + '\n';
+            if (!AppendFile(includePath, output, includedPaths))
+            {
+                return false;
+            }
+            output += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(fileIndex) + '\n';
+        }
+        else
+        {
+            output += '\n';
+        }
+    }
+    return true;
+}
+
+std::filesystem::path ShaderPreprocessor::FindInclude(const std::filesystem::path& includingPath, const std::string& name)
+{
+    std::filesystem::path includePath = (includingPath.parent_path() / name).lexically_normal();
+    if (GetFile(includePath))
+    {
+        return includePath;
+    }
+    for (const std::filesystem::path& directory : m_includeDirectories)
+    {
+        includePath = (directory / name).lexically_normal();
+        if (GetFile(includePath))
+        {
+            return includePath;
+        }
+    }
+    return std::filesystem::path();
+}
+
+std::shared_ptr<const std::string> ShaderPreprocessor::Deduplicate(std::string source)
+{
+    std::size_t hash = std::hash<std::string>()(source);
+    auto range = m_sources.equal_range(hash);
+    for (auto itSource = range.first; itSource != range.second; ++itSource)
+    {
+        if (*itSource->second == source)
+        {
+            return itSource->second;
+        }
+    }
+    std::shared_ptr<const std::string> sharedSource = std::make_shared<const std::string>(std::move(source));
+    m_sources.emplace(hash, sharedSource);
+    return sharedSource;
+}
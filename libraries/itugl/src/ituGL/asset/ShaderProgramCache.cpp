@@ -0,0 +1,417 @@
+#include <ituGL/asset/ShaderProgramCache.h>
+
+#include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// Header of the entry files, followed by the binary
+struct EntryHeader
+{
+    std::uint32_t magic;
+    GLenum format;
+    std::uint64_t key;
+};
+static const std::uint32_t s_entryMagic = 0x42505449; // "ITPB"
+
+// 64-bit FNV-1a, stable between runs, unlike std::hash
+static void HashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+// Look for the shader of the type, or nullptr if there is none
+static const Shader* FindShader(const std::vector<Shader>& shaders, Shader::Type type)
+{
+    for (const Shader& shader : shaders)
+    {
+        if (shader.IsType(type))
+        {
+            return &shader;
+        }
+    }
+    return nullptr;
+}
+
+ShaderProgramCache::ShaderProgramCache(const char* directory)
+    : m_directory(directory), m_hitCount(0), m_missCount(0), m_sharedCount(0), m_buildTime(0.0)
+{
+}
+
+bool ShaderProgramCache::Build(ShaderProgram& shaderProgram, const char* vertexPath, const char* fragmentPath)
+{
+    Source sources[] =
+    {
+        { Shader::VertexShader, ShaderLoader::ReadSource(vertexPath) },
+        { Shader::FragmentShader, ShaderLoader::ReadSource(fragmentPath) },
+    };
+    return Build(shaderProgram, sources);
+}
+
+bool ShaderProgramCache::Build(ShaderProgram& shaderProgram, const char* computePath)
+{
+    Source sources[] =
+    {
+        { Shader::ComputeShader, ShaderLoader::ReadSource(computePath) },
+    };
+    return Build(shaderProgram, sources);
+}
+
+bool ShaderProgramCache::Build(ShaderProgram& shaderProgram, std::span<const Source> sources)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    bool useCache = ShaderProgram::IsBinarySupported();
+    std::uint64_t key = 0;
+    std::string entryPath;
+    bool linked = false;
+    if (useCache)
+    {
+        key = GetKey(sources);
+        entryPath = GetEntryPath(key);
+        linked = LoadEntry(shaderProgram, entryPath, key);
+    }
+
+    if (linked)
+    {
+        ++m_hitCount;
+    }
+    else
+    {
+        ++m_missCount;
+        if (useCache)
+        {
+            shaderProgram.SetBinaryRetrievable(true);
+        }
+        linked = Compile(shaderProgram, sources);
+        if (linked && useCache)
+        {
+            SaveEntry(shaderProgram, entryPath, key);
+        }
+    }
+
+    m_buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return linked;
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramCache::LoadShared(std::span<const Source> sources)
+{
+    std::shared_ptr<ShaderProgram> shaderProgram = Submit(sources);
+    Wait(*shaderProgram);
+    return shaderProgram;
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramCache::Submit(std::span<const Source> sources, const CompletedFunction& completedFunction)
+{
+    std::uint64_t key = GetKey(sources);
+    std::weak_ptr<ShaderProgram>& sharedProgram = m_sharedPrograms[key];
+    std::shared_ptr<ShaderProgram> shaderProgram = sharedProgram.lock();
+    if (shaderProgram)
+    {
+        ++m_sharedCount;
+        if (completedFunction)
+        {
+            // Still compiling, or only waiting for the next update
+            PendingProgram* pendingProgram = FindPending(*shaderProgram);
+            if (pendingProgram)
+            {
+                pendingProgram->completedFunctions.push_back(completedFunction);
+            }
+            else
+            {
+                m_pendingPrograms.push_back({ shaderProgram, {}, key, false, { completedFunction } });
+            }
+        }
+        return shaderProgram;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    shaderProgram = std::make_shared<ShaderProgram>();
+    sharedProgram = shaderProgram;
+
+    bool useCache = ShaderProgram::IsBinarySupported();
+    if (useCache && LoadEntry(*shaderProgram, GetEntryPath(key), key))
+    {
+        ++m_hitCount;
+        if (completedFunction)
+        {
+            m_pendingPrograms.push_back({ shaderProgram, {}, key, false, { completedFunction } });
+        }
+    }
+    else
+    {
+        ++m_missCount;
+        if (useCache)
+        {
+            shaderProgram->SetBinaryRetrievable(true);
+        }
+
+        PendingProgram pendingProgram{ shaderProgram, {}, key, useCache, {} };
+        if (completedFunction)
+        {
+            pendingProgram.completedFunctions.push_back(completedFunction);
+        }
+        pendingProgram.shaders.reserve(sources.size());
+        std::vector<const Shader*> shaders;
+        for (const Source& source : sources)
+        {
+            ShaderLoader loader(source.type);
+            pendingProgram.shaders.push_back(loader.LoadSourceAsync(source.code.c_str()));
+            shaders.push_back(&pendingProgram.shaders.back());
+        }
+        shaderProgram->BuildAsync(shaders);
+        m_pendingPrograms.push_back(std::move(pendingProgram));
+    }
+
+    m_buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return shaderProgram;
+}
+
+unsigned int ShaderProgramCache::Update()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Take the finished programs out first, so their completed functions can submit other programs
+    std::vector<PendingProgram> completedPrograms;
+    for (auto itPending = m_pendingPrograms.begin(); itPending != m_pendingPrograms.end();)
+    {
+        if (itPending->shaderProgram->IsLinkCompleted())
+        {
+            completedPrograms.push_back(std::move(*itPending));
+            itPending = m_pendingPrograms.erase(itPending);
+        }
+        else
+        {
+            ++itPending;
+        }
+    }
+
+    for (PendingProgram& pendingProgram : completedPrograms)
+    {
+        Complete(pendingProgram);
+    }
+
+    m_buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return static_cast<unsigned int>(completedPrograms.size());
+}
+
+bool ShaderProgramCache::Wait(const ShaderProgram& shaderProgram)
+{
+    auto itPending = std::find_if(m_pendingPrograms.begin(), m_pendingPrograms.end(),
+        [&](const PendingProgram& pendingProgram) { return pendingProgram.shaderProgram.get() == &shaderProgram; });
+    if (itPending == m_pendingPrograms.end())
+    {
+        return shaderProgram.IsLinked();
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    PendingProgram pendingProgram = std::move(*itPending);
+    m_pendingPrograms.erase(itPending);
+    bool linked = Complete(pendingProgram);
+
+    m_buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return linked;
+}
+
+void ShaderProgramCache::Finish()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Until none is left, in case a completed function submits more
+    while (!m_pendingPrograms.empty())
+    {
+        std::vector<PendingProgram> pendingPrograms;
+        pendingPrograms.swap(m_pendingPrograms);
+        for (PendingProgram& pendingProgram : pendingPrograms)
+        {
+            Complete(pendingProgram);
+        }
+    }
+
+    m_buildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+ShaderProgramCache::PendingProgram* ShaderProgramCache::FindPending(const ShaderProgram& shaderProgram)
+{
+    auto itPending = std::find_if(m_pendingPrograms.begin(), m_pendingPrograms.end(),
+        [&](const PendingProgram& pendingProgram) { return pendingProgram.shaderProgram.get() == &shaderProgram; });
+    return itPending != m_pendingPrograms.end() ? &*itPending : nullptr;
+}
+
+bool ShaderProgramCache::IsPending(const ShaderProgram& shaderProgram) const
+{
+    return std::any_of(m_pendingPrograms.begin(), m_pendingPrograms.end(),
+        [&](const PendingProgram& pendingProgram) { return pendingProgram.shaderProgram.get() == &shaderProgram; });
+}
+
+bool ShaderProgramCache::Complete(PendingProgram& pendingProgram)
+{
+    ShaderProgram& shaderProgram = *pendingProgram.shaderProgram;
+
+    bool compiled = true;
+    for (const Shader& shader : pendingProgram.shaders)
+    {
+        compiled &= ShaderLoader::CheckCompilation(shader);
+    }
+
+    bool linked = shaderProgram.IsLinked();
+    if (linked)
+    {
+        if (pendingProgram.saveEntry)
+        {
+            SaveEntry(shaderProgram, GetEntryPath(pendingProgram.key), pendingProgram.key);
+        }
+    }
+    else
+    {
+        // Compilation errors were already reported, the linking ones would only repeat them
+        if (compiled)
+        {
+            std::array<char, 512> errors;
+            shaderProgram.GetLinkingErrors(errors);
+            std::cout << "ERROR::PROGRAM::LINKING_FAILED\n" << errors.data() << std::endl;
+        }
+
+        // Don't share a broken program, so it can be submitted again
+        auto itShared = m_sharedPrograms.find(pendingProgram.key);
+        if (itShared != m_sharedPrograms.end() && itShared->second.lock().get() == &shaderProgram)
+        {
+            m_sharedPrograms.erase(itShared);
+        }
+    }
+
+    for (const CompletedFunction& completedFunction : pendingProgram.completedFunctions)
+    {
+        completedFunction(pendingProgram.shaderProgram, linked);
+    }
+    return linked;
+}
+
+std::uint64_t ShaderProgramCache::GetKey(std::span<const Source> sources)
+{
+    // A driver update can change the binaries, or stop accepting the old ones
+    if (m_driverId.empty())
+    {
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const GLubyte* value = glGetString(name);
+            m_driverId += value ? reinterpret_cast<const char*>(value) : "";
+            m_driverId += '\n';
+        }
+    }
+
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    HashBytes(hash, m_driverId.data(), m_driverId.size());
+    for (const Source& source : sources)
+    {
+        // The size separates the sources, so moving code from one to the next changes the key
+        std::uint64_t size = source.code.size();
+        HashBytes(hash, &source.type, sizeof(source.type));
+        HashBytes(hash, &size, sizeof(size));
+        HashBytes(hash, source.code.data(), source.code.size());
+    }
+    return hash;
+}
+
+std::string ShaderProgramCache::GetEntryPath(std::uint64_t key) const
+{
+    std::stringstream stringStream;
+    stringStream << m_directory << '/' << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return stringStream.str();
+}
+
+bool ShaderProgramCache::LoadEntry(ShaderProgram& shaderProgram, const std::string& path, std::uint64_t key) const
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    EntryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != s_entryMagic || header.key != key)
+    {
+        return false;
+    }
+
+    // The binary is the rest of the file
+    std::streamoff begin = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::vector<std::byte> binary(static_cast<std::size_t>(file.tellg() - begin));
+    file.seekg(begin);
+    if (!file.read(reinterpret_cast<char*>(binary.data()), binary.size()))
+    {
+        return false;
+    }
+    return !binary.empty() && shaderProgram.LoadBinary(header.format, binary);
+}
+
+void ShaderProgramCache::SaveEntry(const ShaderProgram& shaderProgram, const std::string& path, std::uint64_t key) const
+{
+    EntryHeader header{ s_entryMagic, 0, key };
+    std::vector<std::byte> binary;
+    if (!shaderProgram.GetBinary(header.format, binary))
+    {
+        return;
+    }
+
+    // A cache that can't be written only makes the next run slower
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (file.is_open())
+    {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+    }
+}
+
+bool ShaderProgramCache::Compile(ShaderProgram& shaderProgram, std::span<const Source> sources)
+{
+    std::vector<Shader> shaders;
+    shaders.reserve(sources.size());
+    for (const Source& source : sources)
+    {
+        ShaderLoader loader(source.type);
+        shaders.push_back(loader.LoadSource(source.code.c_str()));
+    }
+
+    if (const Shader* computeShader = FindShader(shaders, Shader::ComputeShader))
+    {
+        return shaderProgram.Build(*computeShader);
+    }
+
+    const Shader* vertexShader = FindShader(shaders, Shader::VertexShader);
+    const Shader* fragmentShader = FindShader(shaders, Shader::FragmentShader);
+    const Shader* tesselationControlShader = FindShader(shaders, Shader::TesselationControlShader);
+    const Shader* tesselationEvaluationShader = FindShader(shaders, Shader::TesselationEvaluationShader);
+    const Shader* geometryShader = FindShader(shaders, Shader::GeometryShader);
+    if (!vertexShader || !fragmentShader)
+    {
+        return false;
+    }
+
+    if (tesselationEvaluationShader)
+    {
+        return geometryShader
+            ? shaderProgram.Build(*vertexShader, *fragmentShader, tesselationControlShader, *tesselationEvaluationShader, *geometryShader)
+            : shaderProgram.Build(*vertexShader, *fragmentShader, tesselationControlShader, *tesselationEvaluationShader);
+    }
+    return geometryShader
+        ? shaderProgram.Build(*vertexShader, *fragmentShader, *geometryShader)
+        : shaderProgram.Build(*vertexShader, *fragmentShader);
+}
@@ -1,5 +1,6 @@
 #include <ituGL/asset/Texture2DLoader.h>
 
+#include <ituGL/asset/TextureCache.h>
 #include <cassert>
 
 Texture2DLoader::Texture2DLoader()
@@ -17,6 +18,12 @@ Texture2DObject Texture2DLoader::Load(const char* path)
 {
     Texture2DObject texture2D;
 
+    if (TextureLoaderUtils::IsCached(path, m_internalFormat, m_generateMipmap))
+    {
+        LoadCached(path, texture2D);
+        return texture2D;
+    }
+
     // Load texture data using stbimage library
     int width, height;
     Data::Type dataType;
@@ -27,7 +34,11 @@ Texture2DObject Texture2DLoader::Load(const char* path)
     if (!data.empty())
     {
         texture2D.Bind();
+
+        // Rows of RGB and 16-bit single channel images are not always aligned to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         texture2D.SetImage<std::byte>(0, width, height, m_format, m_internalFormat, data, dataType);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
         texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
         texture2D.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
@@ -60,3 +71,52 @@ std::shared_ptr<Texture2DObject> Texture2DLoader::LoadTextureShared(const char*
     loader.SetFlipVertical(flipVertical);
     return loader.LoadShared(path);
 }
+
+std::string Texture2DLoader::GetKey(const char* path) const
+{
+    return TextureLoader::GetKey(path) + ',' + std::to_string(m_flipVertical);
+}
+
+void Texture2DLoader::LoadCached(const char* path, Texture2DObject& texture2D)
+{
+    TextureCache::Settings settings;
+    settings.format = m_format;
+    settings.internalFormat = m_internalFormat;
+    settings.flipVertical = m_flipVertical;
+    settings.generateMipmap = m_generateMipmap;
+    settings.mipmap = m_mipmapSettings;
+
+    TextureCache::Image image;
+    bool loaded = TextureCache::GetDefault().Load(path, settings, image);
+
+    // Same as the other images, missing textures are an error
+    assert(loaded && image.faceCount == 1);
+    if (loaded && image.faceCount == 1)
+    {
+        texture2D.Bind();
+
+        // The rows of the smaller levels are not aligned to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = 0; level < image.levelCount; ++level)
+        {
+            int width = image.GetLevelWidth(level);
+            int height = image.GetLevelHeight(level);
+            if (image.IsBlockCompressed())
+            {
+                texture2D.SetCompressedImage(level, width, height, image.internalFormat, image.GetLevelData(0, level));
+            }
+            else
+            {
+                texture2D.SetImage<std::byte>(level, width, height, image.format, image.internalFormat, image.GetLevelData(0, level), Data::Type::UByte);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // The mipmaps come with the image, only the ones that are there can be used
+        texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, image.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        texture2D.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+        texture2D.SetParameter(TextureObject::ParameterInt::MaxLevel, image.levelCount - 1);
+
+        texture2D.Unbind();
+    }
+}
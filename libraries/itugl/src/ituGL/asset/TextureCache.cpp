@@ -0,0 +1,614 @@
+#include <ituGL/asset/TextureCache.h>
+
+#include <ituGL/asset/AssetPack.h>
+#include <ituGL/asset/TextureLoader.h>
+#include <ituGL/texture/BlockCompressor.h>
+#include <ituGL/core/ThreadPool.h>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// Change it when the encoded results change, so the old entries are not used
+static const std::uint32_t s_encoderVersion = 2;
+
+// DDS file layout: the magic, the header, the DX10 header, and then the data
+static const std::uint32_t s_ddsMagic = 0x20534444; // "DDS "
+static const std::uint32_t s_fourCCDX10 = 0x30315844; // "DX10"
+static const std::uint32_t s_fourCCDXT1 = 0x31545844; // "DXT1"
+static const std::uint32_t s_fourCCDXT5 = 0x35545844; // "DXT5"
+static const std::uint32_t s_fourCCATI1 = 0x31495441; // "ATI1"
+static const std::uint32_t s_fourCCATI2 = 0x32495441; // "ATI2"
+
+struct DDSPixelFormat
+{
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t fourCC;
+    std::uint32_t rgbBitCount;
+    std::uint32_t masks[4];
+};
+
+struct DDSHeader
+{
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t height;
+    std::uint32_t width;
+    std::uint32_t pitchOrLinearSize;
+    std::uint32_t depth;
+    std::uint32_t mipMapCount;
+    std::uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    std::uint32_t caps;
+    std::uint32_t caps2;
+    std::uint32_t caps3;
+    std::uint32_t caps4;
+    std::uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+    std::uint32_t dxgiFormat;
+    std::uint32_t resourceDimension;
+    std::uint32_t miscFlag;
+    std::uint32_t arraySize;
+    std::uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+// Flags of the headers used here
+static const std::uint32_t s_ddsFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000; // caps, height, width, pixel format, mipmap count
+static const std::uint32_t s_ddsFlagsPitch = 0x8;
+static const std::uint32_t s_ddsFlagsLinearSize = 0x80000;
+static const std::uint32_t s_ddsPixelFormatAlpha = 0x1;
+static const std::uint32_t s_ddsPixelFormatFourCC = 0x4;
+static const std::uint32_t s_ddsPixelFormatRGB = 0x40;
+static const std::uint32_t s_ddsPixelFormatLuminance = 0x20000;
+static const std::uint32_t s_ddsCapsComplex = 0x8;
+static const std::uint32_t s_ddsCapsTexture = 0x1000;
+static const std::uint32_t s_ddsCapsMipmap = 0x400000;
+static const std::uint32_t s_ddsCaps2Cubemap = 0x200 | 0xFC00; // cubemap, with all the faces
+static const std::uint32_t s_dx10ResourceTexture2D = 3;
+static const std::uint32_t s_dx10MiscTextureCube = 0x4;
+
+// 64-bit FNV-1a, stable between runs, unlike std::hash
+static void HashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+static std::uint32_t GetDXGIFormat(TextureObject::InternalFormat internalFormat)
+{
+    switch (internalFormat)
+    {
+    case TextureObject::InternalFormatBC1: return 71;
+    case TextureObject::InternalFormatSRGBBC1: return 72;
+    case TextureObject::InternalFormatBC3: return 77;
+    case TextureObject::InternalFormatSRGBBC3: return 78;
+    case TextureObject::InternalFormatBC4: return 80;
+    case TextureObject::InternalFormatBC5: return 83;
+    case TextureObject::InternalFormatBC7: return 98;
+    case TextureObject::InternalFormatSRGBBC7: return 99;
+    default: return 0;
+    }
+}
+
+static TextureObject::InternalFormat GetInternalFormat(std::uint32_t dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+    case 71: return TextureObject::InternalFormatBC1;
+    case 72: return TextureObject::InternalFormatSRGBBC1;
+    case 77: return TextureObject::InternalFormatBC3;
+    case 78: return TextureObject::InternalFormatSRGBBC3;
+    case 80: return TextureObject::InternalFormatBC4;
+    case 83: return TextureObject::InternalFormatBC5;
+    case 98: return TextureObject::InternalFormatBC7;
+    case 99: return TextureObject::InternalFormatSRGBBC7;
+    default: return TextureObject::InternalFormatInvalid;
+    }
+}
+
+// Uncompressed formats of the images, by number of components
+static TextureObject::Format GetFormat(int componentCount)
+{
+    switch (componentCount)
+    {
+    case 1: return TextureObject::FormatR;
+    case 2: return TextureObject::FormatRG;
+    case 3: return TextureObject::FormatRGB;
+    case 4: return TextureObject::FormatRGBA;
+    default: return TextureObject::FormatInvalid;
+    }
+}
+
+static TextureObject::InternalFormat GetUncompressedInternalFormat(int componentCount)
+{
+    switch (componentCount)
+    {
+    case 1: return TextureObject::InternalFormatR8;
+    case 2: return TextureObject::InternalFormatRG8;
+    case 3: return TextureObject::InternalFormatRGB8;
+    case 4: return TextureObject::InternalFormatRGBA8;
+    default: return TextureObject::InternalFormatInvalid;
+    }
+}
+
+// Everything in the settings that changes the processed image
+static void HashSettings(std::uint64_t& hash, const TextureCache::Settings& settings)
+{
+    std::uint8_t flags[] = { settings.cubemap, settings.flipVertical, settings.generateMipmap,
+        static_cast<std::uint8_t>(settings.mipmap.filter), settings.mipmap.srgb, settings.mipmap.normalMap };
+    HashBytes(hash, &settings.format, sizeof(settings.format));
+    HashBytes(hash, &settings.internalFormat, sizeof(settings.internalFormat));
+    HashBytes(hash, flags, sizeof(flags));
+}
+
+// Check that an image from the cache or the pack is the one the settings produce
+static bool MatchesSettings(const TextureCache::Image& image, const TextureCache::Settings& settings)
+{
+    bool compressed = TextureObject::IsBlockCompressed(settings.internalFormat);
+    return image.faceCount == (settings.cubemap ? 6 : 1)
+        && (compressed ? image.internalFormat == settings.internalFormat : image.format == settings.format);
+}
+
+std::size_t TextureCache::Image::GetLevelSize(int level) const
+{
+    if (IsBlockCompressed())
+    {
+        return TextureObject::GetCompressedImageSize(internalFormat, GetLevelWidth(level), GetLevelHeight(level));
+    }
+    return static_cast<std::size_t>(GetLevelWidth(level)) * GetLevelHeight(level) * TextureObject::GetComponentCount(format);
+}
+
+std::span<const std::byte> TextureCache::Image::GetLevelData(int face, int level) const
+{
+    std::size_t offset = face * GetFaceSize();
+    for (int i = 0; i < level; ++i)
+    {
+        offset += GetLevelSize(i);
+    }
+    std::size_t size = GetLevelSize(level);
+    std::span<const std::byte> imageData = GetData();
+    assert(offset + size <= imageData.size());
+    return imageData.subspan(offset, size);
+}
+
+std::size_t TextureCache::Image::GetFaceSize() const
+{
+    std::size_t size = 0;
+    for (int level = 0; level < levelCount; ++level)
+    {
+        size += GetLevelSize(level);
+    }
+    return size;
+}
+
+TextureCache::TextureCache(const char* directory, ThreadPool* threadPool)
+    : m_directory(directory), m_threadPool(threadPool), m_packWriter(nullptr), m_hitCount(0), m_missCount(0), m_packCount(0)
+{
+}
+
+bool TextureCache::Load(const char* path, const Settings& settings, Image& image)
+{
+    AssetPack& assetPack = AssetPack::GetDefault();
+    if (IsDDS(path))
+    {
+        std::span<const std::byte> packData = assetPack.Find(path);
+        if (packData.empty() ? !ReadDDS(path, image) : !ParseDDS(packData, image))
+        {
+            return false;
+        }
+        AddToPack(path, image);
+        return true;
+    }
+
+    assert(IsSupported(settings.internalFormat));
+    std::string packEntryName = GetPackEntryName(path, settings);
+    Image packImage;
+    if (ParseDDS(assetPack.Find(packEntryName), packImage) && MatchesSettings(packImage, settings))
+    {
+        // The uncompressed DDS files don't keep the internal format
+        packImage.internalFormat = settings.internalFormat;
+        image = std::move(packImage);
+        ++m_packCount;
+        return true;
+    }
+
+    std::string entryPath = GetEntryPath(GetKey(path, settings));
+    Image entryImage;
+    if (ReadDDS(entryPath.c_str(), entryImage) && MatchesSettings(entryImage, settings))
+    {
+        entryImage.internalFormat = settings.internalFormat;
+        image = std::move(entryImage);
+        ++m_hitCount;
+    }
+    else
+    {
+        ++m_missCount;
+        if (!Process(path, settings, image))
+        {
+            return false;
+        }
+
+        // A cache that can't be written only makes the next run slower.
+        // Written with another name first, so other processes never read half of it
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        std::string temporaryPath = entryPath + ".tmp";
+        if (WriteDDS(temporaryPath.c_str(), image))
+        {
+            std::filesystem::rename(temporaryPath, entryPath, error);
+        }
+    }
+
+    AddToPack(packEntryName, image);
+    return true;
+}
+
+bool TextureCache::ReadDDS(const char* path, Image& image)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::vector<std::byte> fileData(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    Image result;
+    if (!file.read(reinterpret_cast<char*>(fileData.data()), fileData.size()) || !ParseDDS(fileData, result))
+    {
+        return false;
+    }
+
+    // The image owns the data, without the headers
+    std::size_t dataOffset = result.externalData.data() - fileData.data();
+    std::size_t dataSize = result.externalData.size();
+    result.externalData = std::span<const std::byte>();
+    fileData.erase(fileData.begin(), fileData.begin() + dataOffset);
+    fileData.resize(dataSize);
+    result.data = std::move(fileData);
+
+    image = std::move(result);
+    return true;
+}
+
+bool TextureCache::WriteDDS(const char* path, const Image& image)
+{
+    std::vector<std::byte> fileData = SerializeDDS(image);
+    if (fileData.empty())
+    {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
+    return file.good();
+}
+
+bool TextureCache::ParseDDS(std::span<const std::byte> data, Image& image)
+{
+    std::uint32_t magic;
+    DDSHeader header;
+    std::size_t offset = sizeof(magic) + sizeof(header);
+    if (data.size() < offset)
+    {
+        return false;
+    }
+    std::memcpy(&magic, data.data(), sizeof(magic));
+    std::memcpy(&header, data.data() + sizeof(magic), sizeof(header));
+    if (magic != s_ddsMagic || header.size != sizeof(header))
+    {
+        return false;
+    }
+
+    TextureObject::InternalFormat internalFormat = TextureObject::InternalFormatInvalid;
+    TextureObject::Format format = TextureObject::FormatInvalid;
+    bool cubemap = (header.caps2 & s_ddsCaps2Cubemap) == s_ddsCaps2Cubemap;
+    if (header.pixelFormat.flags & s_ddsPixelFormatFourCC)
+    {
+        switch (header.pixelFormat.fourCC)
+        {
+        case s_fourCCDX10:
+        {
+            DDSHeaderDX10 headerDX10;
+            if (data.size() < offset + sizeof(headerDX10))
+            {
+                return false;
+            }
+            std::memcpy(&headerDX10, data.data() + offset, sizeof(headerDX10));
+            offset += sizeof(headerDX10);
+            if (headerDX10.resourceDimension != s_dx10ResourceTexture2D || headerDX10.arraySize != 1)
+            {
+                return false;
+            }
+            internalFormat = GetInternalFormat(headerDX10.dxgiFormat);
+            cubemap = (headerDX10.miscFlag & s_dx10MiscTextureCube) != 0;
+            break;
+        }
+        case s_fourCCDXT1:
+            internalFormat = TextureObject::InternalFormatBC1;
+            break;
+        case s_fourCCDXT5:
+            internalFormat = TextureObject::InternalFormatBC3;
+            break;
+        case s_fourCCATI1:
+            internalFormat = TextureObject::InternalFormatBC4;
+            break;
+        case s_fourCCATI2:
+            internalFormat = TextureObject::InternalFormatBC5;
+            break;
+        }
+    }
+    else if (header.pixelFormat.flags & (s_ddsPixelFormatRGB | s_ddsPixelFormatLuminance))
+    {
+        // Only 8 bits per component, in RGBA order
+        int componentCount = header.pixelFormat.rgbBitCount / 8;
+        if (header.pixelFormat.rgbBitCount % 8 == 0 && header.pixelFormat.masks[0] == 0xff)
+        {
+            format = GetFormat(componentCount);
+            internalFormat = GetUncompressedInternalFormat(componentCount);
+        }
+    }
+    if (internalFormat == TextureObject::InternalFormatInvalid || header.width == 0 || header.height == 0)
+    {
+        return false;
+    }
+
+    Image result;
+    result.internalFormat = internalFormat;
+    result.format = format;
+    result.width = static_cast<int>(header.width);
+    result.height = static_cast<int>(header.height);
+    result.levelCount = std::max(static_cast<int>(header.mipMapCount), 1);
+    result.faceCount = cubemap ? 6 : 1;
+    std::size_t size = result.GetFaceSize() * result.faceCount;
+    if (data.size() - offset < size)
+    {
+        return false;
+    }
+    result.externalData = data.subspan(offset, size);
+
+    image = std::move(result);
+    return true;
+}
+
+std::vector<std::byte> TextureCache::SerializeDDS(const Image& image)
+{
+    assert(!image.IsEmpty());
+    bool compressed = image.IsBlockCompressed();
+    std::uint32_t dxgiFormat = GetDXGIFormat(image.internalFormat);
+    int componentCount = TextureObject::GetComponentCount(image.format);
+    if (compressed ? dxgiFormat == 0 : componentCount == 0)
+    {
+        return std::vector<std::byte>();
+    }
+
+    bool cubemap = image.faceCount == 6;
+
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = s_ddsFlags;
+    header.height = image.height;
+    header.width = image.width;
+    header.mipMapCount = image.levelCount;
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    if (compressed)
+    {
+        header.flags |= s_ddsFlagsLinearSize;
+        header.pitchOrLinearSize = static_cast<std::uint32_t>(image.GetLevelSize(0));
+        header.pixelFormat.flags = s_ddsPixelFormatFourCC;
+        header.pixelFormat.fourCC = s_fourCCDX10;
+    }
+    else
+    {
+        // One byte per component, in RGBA order
+        header.flags |= s_ddsFlagsPitch;
+        header.pitchOrLinearSize = image.width * componentCount;
+        header.pixelFormat.flags = componentCount == 1 ? s_ddsPixelFormatLuminance : s_ddsPixelFormatRGB;
+        header.pixelFormat.flags |= componentCount == 4 ? s_ddsPixelFormatAlpha : 0;
+        header.pixelFormat.rgbBitCount = componentCount * 8;
+        for (int c = 0; c < componentCount; ++c)
+        {
+            header.pixelFormat.masks[c] = 0xffu << (8 * c);
+        }
+    }
+    header.caps = s_ddsCapsTexture;
+    if (image.levelCount > 1)
+    {
+        header.caps |= s_ddsCapsComplex | s_ddsCapsMipmap;
+    }
+    if (cubemap)
+    {
+        header.caps |= s_ddsCapsComplex;
+        header.caps2 = s_ddsCaps2Cubemap;
+    }
+
+    std::span<const std::byte> imageData = image.GetData();
+    std::vector<std::byte> data(sizeof(s_ddsMagic) + sizeof(header) + (compressed ? sizeof(DDSHeaderDX10) : 0) + imageData.size());
+    std::byte* output = data.data();
+    std::memcpy(output, &s_ddsMagic, sizeof(s_ddsMagic));
+    output += sizeof(s_ddsMagic);
+    std::memcpy(output, &header, sizeof(header));
+    output += sizeof(header);
+    if (compressed)
+    {
+        DDSHeaderDX10 headerDX10 = {};
+        headerDX10.dxgiFormat = dxgiFormat;
+        headerDX10.resourceDimension = s_dx10ResourceTexture2D;
+        headerDX10.miscFlag = cubemap ? s_dx10MiscTextureCube : 0;
+        headerDX10.arraySize = 1;
+        std::memcpy(output, &headerDX10, sizeof(headerDX10));
+        output += sizeof(headerDX10);
+    }
+    std::memcpy(output, imageData.data(), imageData.size());
+    return data;
+}
+
+std::string TextureCache::GetPackEntryName(const char* path, const Settings& settings)
+{
+    // The pack is built from the files, so only the settings are needed to tell the images apart
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    HashSettings(hash, settings);
+
+    std::stringstream stringStream;
+    stringStream << AssetPack::NormalizeName(path) << '.' << std::hex << std::setw(16) << std::setfill('0') << hash << ".dds";
+    return stringStream.str();
+}
+
+bool TextureCache::IsDDS(const char* path)
+{
+    std::size_t length = std::strlen(path);
+    return length >= 4 && (std::strcmp(path + length - 4, ".dds") == 0 || std::strcmp(path + length - 4, ".DDS") == 0);
+}
+
+bool TextureCache::IsSupported(TextureObject::InternalFormat internalFormat)
+{
+    switch (internalFormat)
+    {
+    case TextureObject::InternalFormatR:
+    case TextureObject::InternalFormatRG:
+    case TextureObject::InternalFormatRGB:
+    case TextureObject::InternalFormatRGBA:
+    case TextureObject::InternalFormatR8:
+    case TextureObject::InternalFormatRG8:
+    case TextureObject::InternalFormatRGB8:
+    case TextureObject::InternalFormatRGBA8:
+    case TextureObject::InternalFormatSRGB8:
+    case TextureObject::InternalFormatSRGBA8:
+        return true;
+    default:
+        return TextureObject::IsBlockCompressed(internalFormat);
+    }
+}
+
+TextureCache& TextureCache::GetDefault()
+{
+    static TextureCache s_defaultCache("texturecache", &ThreadPool::GetDefault());
+    return s_defaultCache;
+}
+
+std::uint64_t TextureCache::GetKey(const char* path, const Settings& settings) const
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    HashBytes(hash, &s_encoderVersion, sizeof(s_encoderVersion));
+    HashBytes(hash, path, std::strlen(path));
+
+    // Size and modification time, so the entry changes with the file
+    std::error_code error;
+    std::uintmax_t fileSize = std::filesystem::file_size(path, error);
+    auto writeTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    HashBytes(hash, &fileSize, sizeof(fileSize));
+    HashBytes(hash, &writeTime, sizeof(writeTime));
+
+    HashSettings(hash, settings);
+    return hash;
+}
+
+std::string TextureCache::GetEntryPath(std::uint64_t key) const
+{
+    std::stringstream stringStream;
+    stringStream << m_directory << '/' << std::hex << std::setw(16) << std::setfill('0') << key << ".dds";
+    return stringStream.str();
+}
+
+bool TextureCache::Process(const char* path, const Settings& settings, Image& image) const
+{
+    // Block compressed images are decoded as RGBA, the encoders take the channels they need
+    bool compressed = TextureObject::IsBlockCompressed(settings.internalFormat);
+    TextureObject::Format format = compressed ? TextureObject::FormatRGBA : settings.format;
+    int componentCount = TextureObject::GetComponentCount(format);
+
+    int width, height;
+    Data::Type dataType;
+    std::span<const std::byte> data = TextureLoaderUtils::LoadTexture2DData(path, width, height, dataType,
+        format, GetUncompressedInternalFormat(componentCount), settings.flipVertical);
+    if (data.empty())
+    {
+        return false;
+    }
+
+    // Split the faces of the cross, in the order of the cubemap targets: +X, -X, +Y, -Y, +Z, -Z
+    std::vector<std::vector<std::byte>> faces;
+    if (settings.cubemap)
+    {
+        assert(width % 4 == 0);
+        assert(height % 3 == 0);
+        assert(width / 4 == height / 3);
+
+        int side = width / 4;
+        std::size_t rowSize = static_cast<std::size_t>(side) * componentCount;
+        const int faceOffsets[6][2] = { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 3, 1 } };
+        for (const int* faceOffset : faceOffsets)
+        {
+            std::vector<std::byte>& face = faces.emplace_back(rowSize * side);
+            for (int y = 0; y < side; ++y)
+            {
+                const std::byte* row = data.data() + ((static_cast<std::size_t>(faceOffset[1]) * side + y) * width + faceOffset[0] * side) * componentCount;
+                std::memcpy(face.data() + y * rowSize, row, rowSize);
+            }
+        }
+        width = height = side;
+    }
+    else
+    {
+        faces.emplace_back(data.begin(), data.end());
+    }
+    TextureLoaderUtils::FreeTexture2DData(data);
+
+    image.internalFormat = settings.internalFormat;
+    image.format = compressed ? TextureObject::FormatInvalid : format;
+    image.width = width;
+    image.height = height;
+    image.levelCount = settings.generateMipmap ? MipmapGenerator::GetLevelCount(width, height) : 1;
+    image.faceCount = static_cast<int>(faces.size());
+    image.data.resize(image.GetFaceSize() * image.faceCount);
+
+    std::size_t offset = 0;
+    for (std::vector<std::byte>& face : faces)
+    {
+        for (int level = 0; level < image.levelCount; ++level)
+        {
+            if (level > 0)
+            {
+                face = MipmapGenerator::Downsample(face, image.GetLevelWidth(level - 1), image.GetLevelHeight(level - 1),
+                    componentCount, settings.mipmap, m_threadPool);
+            }
+
+            std::span<std::byte> levelData(image.data.data() + offset, image.GetLevelSize(level));
+            if (compressed)
+            {
+                BlockCompressor::Compress(settings.internalFormat, face, image.GetLevelWidth(level), image.GetLevelHeight(level), levelData, m_threadPool);
+            }
+            else
+            {
+                std::copy(face.begin(), face.end(), levelData.begin());
+            }
+            offset += levelData.size();
+        }
+    }
+    return true;
+}
+
+void TextureCache::AddToPack(const std::string& name, const Image& image) const
+{
+    if (m_packWriter)
+    {
+        m_packWriter->Add(name, SerializeDDS(image));
+    }
+}
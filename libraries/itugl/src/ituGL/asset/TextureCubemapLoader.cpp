@@ -1,5 +1,6 @@
 #include <ituGL/asset/TextureCubemapLoader.h>
 
+#include <ituGL/asset/TextureCache.h>
 #include <cassert>
 #include <stb_image.h>
 
@@ -16,6 +17,12 @@ TextureCubemapObject TextureCubemapLoader::Load(const char* path)
 {
     TextureCubemapObject textureCubemap;
 
+    if (TextureLoaderUtils::IsCached(path, m_internalFormat, m_generateMipmap))
+    {
+        LoadCached(path, textureCubemap);
+        return textureCubemap;
+    }
+
     int width, height;
     Data::Type dataType;
     std::span<const std::byte> data = LoadTexture2DData(path, width, height, dataType);
@@ -77,6 +84,59 @@ std::shared_ptr<TextureCubemapObject> TextureCubemapLoader::LoadTextureShared(co
     return loader.LoadShared(path);
 }
 
+void TextureCubemapLoader::LoadCached(const char* path, TextureCubemapObject& textureCubemap)
+{
+    TextureCache::Settings settings;
+    settings.format = m_format;
+    settings.internalFormat = m_internalFormat;
+    settings.cubemap = true;
+    settings.generateMipmap = m_generateMipmap;
+    settings.mipmap = m_mipmapSettings;
+
+    TextureCache::Image image;
+    bool loaded = TextureCache::GetDefault().Load(path, settings, image);
+
+    // Same as the other images, missing textures are an error
+    assert(loaded && image.faceCount == 6);
+    if (loaded && image.faceCount == 6)
+    {
+        textureCubemap.Bind();
+
+        // The rows of the smaller levels are not aligned to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int face = 0; face < 6; ++face)
+        {
+            // The faces are in the order of the cubemap targets
+            TextureCubemapObject::Face cubemapFace = static_cast<TextureCubemapObject::Face>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
+            for (int level = 0; level < image.levelCount; ++level)
+            {
+                int side = image.GetLevelWidth(level);
+                if (image.IsBlockCompressed())
+                {
+                    textureCubemap.SetCompressedImage(level, cubemapFace, side, image.internalFormat, image.GetLevelData(face, level));
+                }
+                else
+                {
+                    textureCubemap.SetImage<std::byte>(level, cubemapFace, side, image.format, image.internalFormat, image.GetLevelData(face, level), Data::Type::UByte);
+                }
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // The mipmaps come with the image, only the ones that are there can be used
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::MinFilter, image.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+        textureCubemap.SetParameter(TextureObject::ParameterInt::MaxLevel, image.levelCount - 1);
+
+        // Clamp to edge to avoid filtering on the edges
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapR, GL_CLAMP_TO_EDGE);
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+        textureCubemap.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+
+        textureCubemap.Unbind();
+    }
+}
+
 void TextureCubemapLoader::LoadFace(TextureCubemapObject& textureCubemap, TextureCubemapObject::Face face, std::span<const std::byte> dataSrc, std::span<std::byte> dataDst, int x, int y, int side, Data::Type dataType)
 {
     int pixelSize = TextureObject::GetComponentCount(m_format) * Data::GetTypeSize(dataType);
@@ -1,7 +1,39 @@
 #include <ituGL/asset/TextureLoader.h>
 
+#include <ituGL/asset/AssetPack.h>
+#include <ituGL/asset/TextureCache.h>
+
+// Textures can be decoded in parallel, so the global failure reason of stb_image can't be written
+#define STBI_NO_FAILURE_STRINGS
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#include <cstring>
+#include <vector>
+
+// Swap the rows of the image, in place
+static void FlipRows(std::byte* data, int height, std::size_t rowSize)
+{
+    std::vector<std::byte> row(rowSize);
+    for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom)
+    {
+        std::memcpy(row.data(), data + top * rowSize, rowSize);
+        std::memcpy(data + top * rowSize, data + bottom * rowSize, rowSize);
+        std::memcpy(data + bottom * rowSize, row.data(), rowSize);
+    }
+}
+
+// Keep the first components of each pixel, in place
+template<typename T>
+static void PackComponents(T* data, int pixelCount, int componentCount, int packedComponentCount)
+{
+    for (int i = 0; i < pixelCount; ++i)
+    {
+        for (int c = 0; c < packedComponentCount; ++c)
+        {
+            data[i * packedComponentCount + c] = data[i * componentCount + c];
+        }
+    }
+}
 
 std::span<const std::byte> TextureLoaderUtils::LoadTexture2DData(const char* path, int& width, int& height, Data::Type& dataType, TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool flipVertical)
 {
@@ -10,23 +42,88 @@ std::span<const std::byte> TextureLoaderUtils::LoadTexture2DData(const char* pat
     int componentCount = TextureObject::GetComponentCount(format);
     int originalComponentCount;
 
-    // Set flip vertical on load if needed
-    stbi_set_flip_vertically_on_load(flipVertical ? 1 : 0);
+    // stb_image reads 2 components as grey and alpha, so RG images are read as RGBA and packed after
+    int loadComponentCount = componentCount == 2 ? 4 : componentCount;
+
+    // Files in the default asset pack are decoded from the mapping
+    std::span<const std::byte> packData = AssetPack::GetDefault().Find(path);
+    const stbi_uc* packBuffer = reinterpret_cast<const stbi_uc*>(packData.data());
+    int packSize = static_cast<int>(packData.size());
 
-    if (IsHDR(internalFormat))
+    // stbi_loadf would reduce 16-bit images to 8 bits, and apply a gamma curve to them
+    bool is16BitFile = packData.empty() ? stbi_is_16_bit(path) : stbi_is_16_bit_from_memory(packBuffer, packSize);
+
+    if (IsHDR(internalFormat) && is16BitFile)
+    {
+        // Normalized like the GPU normalizes R16 data, so both formats read the same values
+        stbi_us* data16 = packData.empty()
+            ? stbi_load_16(path, &width, &height, &originalComponentCount, loadComponentCount)
+            : stbi_load_16_from_memory(packBuffer, packSize, &width, &height, &originalComponentCount, loadComponentCount);
+        float* data = nullptr;
+        if (data16)
+        {
+            // Allocated with the allocator of stb_image, so stbi_image_free frees it like the other results
+            std::size_t valueCount = static_cast<std::size_t>(width) * height * componentCount;
+            data = static_cast<float*>(STBI_MALLOC(valueCount * sizeof(float)));
+            for (int i = 0, pixel = 0; data && pixel < width * height; ++pixel)
+            {
+                for (int c = 0; c < componentCount; ++c, ++i)
+                {
+                    data[i] = data16[pixel * loadComponentCount + c] / 65535.0f;
+                }
+            }
+            stbi_image_free(data16);
+        }
+        std::span<const float> dataSpanFloat(data, data ? width * height * componentCount : 0);
+        dataSpan = Data::GetBytes(dataSpanFloat);
+        dataType = Data::Type::Float;
+    }
+    else if (IsHDR(internalFormat))
     {
-        float* data = stbi_loadf(path, &width, &height, &originalComponentCount, componentCount);
+        float* data = packData.empty()
+            ? stbi_loadf(path, &width, &height, &originalComponentCount, loadComponentCount)
+            : stbi_loadf_from_memory(packBuffer, packSize, &width, &height, &originalComponentCount, loadComponentCount);
+        if (data && loadComponentCount != componentCount)
+        {
+            PackComponents(data, width * height, loadComponentCount, componentCount);
+        }
         std::span<const float> dataSpanFloat(data, data ? width * height * componentCount : 0);
         dataSpan = Data::GetBytes(dataSpanFloat);
         dataType = Data::Type::Float;
     }
+    else if (Is16Bit(internalFormat))
+    {
+        // Kept at 16 bits, 8-bit images are expanded by stb_image
+        stbi_us* data = packData.empty()
+            ? stbi_load_16(path, &width, &height, &originalComponentCount, loadComponentCount)
+            : stbi_load_16_from_memory(packBuffer, packSize, &width, &height, &originalComponentCount, loadComponentCount);
+        if (data && loadComponentCount != componentCount)
+        {
+            PackComponents(data, width * height, loadComponentCount, componentCount);
+        }
+        std::span<const stbi_us> dataSpanShort(data, data ? width * height * componentCount : 0);
+        dataSpan = Data::GetBytes(dataSpanShort);
+        dataType = Data::Type::UShort;
+    }
     else
     {
-        unsigned char* data = stbi_load(path, &width, &height, &originalComponentCount, componentCount);
+        unsigned char* data = packData.empty()
+            ? stbi_load(path, &width, &height, &originalComponentCount, loadComponentCount)
+            : stbi_load_from_memory(packBuffer, packSize, &width, &height, &originalComponentCount, loadComponentCount);
+        if (data && loadComponentCount != componentCount)
+        {
+            PackComponents(data, width * height, loadComponentCount, componentCount);
+        }
         std::span<const unsigned char> dataSpanByte(data, data ? width * height * componentCount : 0);
         dataSpan = Data::GetBytes(dataSpanByte);
         dataType = Data::Type::UByte;
     }
+
+    // Flipped here instead of with stbi_set_flip_vertically_on_load, a global that other threads could be using
+    if (flipVertical && !dataSpan.empty())
+    {
+        FlipRows(const_cast<std::byte*>(dataSpan.data()), height, dataSpan.size() / height);
+    }
     return dataSpan;
 }
 
@@ -36,6 +133,26 @@ void TextureLoaderUtils::FreeTexture2DData(std::span<const std::byte> data)
     stbi_image_free(const_cast<void*>(dataPtr));
 }
 
+bool TextureLoaderUtils::IsCached(const char* path, TextureObject::InternalFormat internalFormat, bool generateMipmap)
+{
+    return TextureCache::IsDDS(path) || TextureObject::IsBlockCompressed(internalFormat)
+        || (generateMipmap && TextureCache::IsSupported(internalFormat));
+}
+
+bool TextureLoaderUtils::Is16Bit(TextureObject::InternalFormat internalFormat)
+{
+    switch (internalFormat)
+    {
+    case TextureObject::InternalFormatR16:
+    case TextureObject::InternalFormatRG16:
+    case TextureObject::InternalFormatRGB16:
+    case TextureObject::InternalFormatRGBA16:
+        return true;
+    default:
+        return false;
+    }
+}
+
 bool TextureLoaderUtils::IsHDR(TextureObject::InternalFormat internalFormat)
 {
     switch (internalFormat)
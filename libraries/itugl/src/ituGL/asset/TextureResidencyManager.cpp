@@ -0,0 +1,149 @@
+#include <ituGL/asset/TextureResidencyManager.h>
+
+#include <algorithm>
+#include <cassert>
+
+TextureResidencyManager::TextureResidencyManager(ThreadPool& threadPool, std::size_t memoryBudget)
+    : m_memoryBudget(memoryBudget), m_memoryUsage(0), m_updateCount(0), m_loadCount(0), m_evictionCount(0)
+    , m_loader(threadPool)
+{
+}
+
+TextureResidencyManager::Id TextureResidencyManager::Add2D(const char* path, TextureObject::Format format,
+    TextureObject::InternalFormat internalFormat, bool generateMipmap, const MipmapGenerator::Settings& mipmapSettings)
+{
+    return Add(path, format, internalFormat, generateMipmap, false, mipmapSettings);
+}
+
+TextureResidencyManager::Id TextureResidencyManager::AddCubemap(const char* path, TextureObject::Format format,
+    TextureObject::InternalFormat internalFormat, bool generateMipmap, const MipmapGenerator::Settings& mipmapSettings)
+{
+    return Add(path, format, internalFormat, generateMipmap, true, mipmapSettings);
+}
+
+std::shared_ptr<TextureObject> TextureResidencyManager::Request(Id id)
+{
+    assert(id < m_entries.size());
+    Entry& entry = m_entries[id];
+    entry.lastUse = m_updateCount;
+
+    if (entry.state == State::Unloaded)
+    {
+        StartLoad(id);
+    }
+    return entry.state == State::Resident ? entry.texture : nullptr;
+}
+
+std::shared_ptr<TextureObject> TextureResidencyManager::RequestNow(Id id)
+{
+    std::shared_ptr<TextureObject> texture = Request(id);
+    if (!texture)
+    {
+        m_loader.Finish();
+        texture = Request(id);
+    }
+    return texture;
+}
+
+void TextureResidencyManager::Update()
+{
+    m_loader.Update();
+    Evict();
+    ++m_updateCount;
+}
+
+unsigned int TextureResidencyManager::GetResidentCount() const
+{
+    return static_cast<unsigned int>(std::count_if(m_entries.begin(), m_entries.end(),
+        [](const Entry& entry) { return entry.state == State::Resident; }));
+}
+
+unsigned int TextureResidencyManager::GetFailedCount() const
+{
+    return static_cast<unsigned int>(std::count_if(m_entries.begin(), m_entries.end(),
+        [](const Entry& entry) { return entry.state == State::Failed; }));
+}
+
+TextureResidencyManager::Id TextureResidencyManager::Add(const char* path, TextureObject::Format format,
+    TextureObject::InternalFormat internalFormat, bool generateMipmap, bool cubemap, const MipmapGenerator::Settings& mipmapSettings)
+{
+    Entry& entry = m_entries.emplace_back();
+    entry.path = path;
+    entry.format = format;
+    entry.internalFormat = internalFormat;
+    entry.generateMipmap = generateMipmap;
+    entry.cubemap = cubemap;
+    entry.mipmapSettings = mipmapSettings;
+    return static_cast<Id>(m_entries.size() - 1);
+}
+
+void TextureResidencyManager::StartLoad(Id id)
+{
+    Entry& entry = m_entries[id];
+    assert(entry.state == State::Unloaded);
+
+    // The entry is found by id in the callback, the vector can grow while it loads
+    AsyncTextureLoader::UploadCallback uploadCallback = [this, id](std::size_t memorySize)
+        {
+            Entry& entry = m_entries[id];
+            if (memorySize == 0)
+            {
+                // The image couldn't be loaded, don't keep the empty texture or try again
+                entry.state = State::Failed;
+                entry.texture.reset();
+                return;
+            }
+            entry.state = State::Resident;
+            entry.memorySize = memorySize;
+            m_memoryUsage += memorySize;
+        };
+
+    m_loader.SetMipmapSettings(entry.mipmapSettings);
+    if (entry.cubemap)
+    {
+        entry.texture = m_loader.LoadCubemap(entry.path.c_str(), entry.format, entry.internalFormat, entry.generateMipmap, std::move(uploadCallback));
+    }
+    else
+    {
+        entry.texture = m_loader.Load2D(entry.path.c_str(), entry.format, entry.internalFormat, entry.generateMipmap, false, std::move(uploadCallback));
+    }
+    entry.state = State::Loading;
+    ++m_loadCount;
+}
+
+void TextureResidencyManager::Evict()
+{
+    if (m_memoryUsage <= m_memoryBudget)
+    {
+        return;
+    }
+
+    // Candidates: resident, not requested since the last update, and only held here
+    std::vector<Id> candidates;
+    for (Id id = 0; id < m_entries.size(); ++id)
+    {
+        const Entry& entry = m_entries[id];
+        if (entry.state == State::Resident && entry.lastUse < m_updateCount && entry.texture.use_count() == 1)
+        {
+            candidates.push_back(id);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [this](Id a, Id b) { return m_entries[a].lastUse < m_entries[b].lastUse; });
+
+    for (Id id : candidates)
+    {
+        if (m_memoryUsage <= m_memoryBudget)
+        {
+            break;
+        }
+
+        // Releasing the last reference deletes the texture object
+        Entry& entry = m_entries[id];
+        entry.texture.reset();
+        entry.state = State::Unloaded;
+        m_memoryUsage -= entry.memorySize;
+        entry.memorySize = 0;
+        ++m_evictionCount;
+    }
+}
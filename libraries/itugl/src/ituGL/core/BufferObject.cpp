@@ -63,3 +63,10 @@ void BufferObject::UpdateData(std::span<const std::byte> data, size_t offset)
     Target target = GetTarget();
     glBufferSubData(target, offset, data.size_bytes(), data.data());
 }
+
+// Bind the buffer handle to the indexed binding point
+void BufferObject::BindBase(Target target, GLuint index) const
+{
+    assert(target == Target::ShaderStorageBuffer || target == Target::UniformBuffer);
+    glBindBufferBase(target, index, GetHandle());
+}
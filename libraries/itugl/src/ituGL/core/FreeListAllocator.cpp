@@ -0,0 +1,86 @@
+#include <ituGL/core/FreeListAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+
+FreeListAllocator::FreeListAllocator(unsigned int size) : m_size(0), m_freeSize(0)
+{
+    Reset(size);
+}
+
+void FreeListAllocator::Reset(unsigned int size)
+{
+    m_freeRanges.clear();
+    if (size > 0)
+    {
+        m_freeRanges.push_back(Range{ 0, size });
+    }
+    m_size = size;
+    m_freeSize = size;
+}
+
+unsigned int FreeListAllocator::Allocate(unsigned int size)
+{
+    assert(size > 0);
+
+    // First fit: keeps the allocations packed at the start of the block
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+    {
+        if (it->size >= size)
+        {
+            unsigned int offset = it->offset;
+            it->offset += size;
+            it->size -= size;
+            if (it->size == 0)
+            {
+                m_freeRanges.erase(it);
+            }
+            m_freeSize -= size;
+            return offset;
+        }
+    }
+    return InvalidOffset;
+}
+
+void FreeListAllocator::Free(unsigned int offset, unsigned int size)
+{
+    assert(size > 0);
+    assert(offset + size <= m_size);
+
+    // Find the first free range after the one being freed
+    auto next = std::upper_bound(m_freeRanges.begin(), m_freeRanges.end(), offset,
+        [](unsigned int offset, const Range& range) { return offset < range.offset; });
+
+    // Ranges must not overlap, or the same range has been freed twice
+    assert(next == m_freeRanges.end() || offset + size <= next->offset);
+    assert(next == m_freeRanges.begin() || std::prev(next)->offset + std::prev(next)->size <= offset);
+
+    m_freeSize += size;
+
+    // Merge with the previous range
+    if (next != m_freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->offset + previous->size == offset)
+        {
+            previous->size += size;
+            // The previous range can now be touching the next one as well
+            if (next != m_freeRanges.end() && previous->offset + previous->size == next->offset)
+            {
+                previous->size += next->size;
+                m_freeRanges.erase(next);
+            }
+            return;
+        }
+    }
+
+    // Merge with the next range
+    if (next != m_freeRanges.end() && offset + size == next->offset)
+    {
+        next->offset = offset;
+        next->size += size;
+        return;
+    }
+
+    m_freeRanges.insert(next, Range{ offset, size });
+}
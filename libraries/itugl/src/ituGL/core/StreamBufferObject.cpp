@@ -0,0 +1,130 @@
+#include <ituGL/core/StreamBufferObject.h>
+
+#include <cassert>
+
+StreamBufferObject::StreamBufferObject(Target target, size_t frameSize, unsigned int frameCount)
+    : m_target(target)
+    , m_frameSize(frameSize)
+    , m_frameCount(frameCount)
+    , m_frameIndex(0)
+    , m_frameOffset(0)
+    , m_flushOffset(0)
+    , m_mappedData(nullptr)
+    , m_fences{}
+{
+    assert(frameSize > 0);
+    assert(frameCount > 0 && frameCount <= MaxFrameCount);
+
+    size_t size = m_frameSize * m_frameCount;
+
+    Bind();
+    if (GLAD_GL_VERSION_4_4)
+    {
+        // Immutable storage that can stay mapped while the GPU reads from it
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(m_target, size, nullptr, flags);
+        m_mappedData = static_cast<std::byte*>(glMapBufferRange(m_target, 0, size, flags));
+    }
+
+    if (!m_mappedData)
+    {
+        // Fallback, keep a copy on the CPU and upload the written ranges
+        glBufferData(m_target, size, nullptr, GL_STREAM_DRAW);
+        m_uploadData.resize(size);
+    }
+    Unbind();
+}
+
+StreamBufferObject::~StreamBufferObject()
+{
+    for (GLsync fence : m_fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+
+    if (m_mappedData)
+    {
+        Bind();
+        glUnmapBuffer(m_target);
+        Unbind();
+    }
+}
+
+void StreamBufferObject::Bind() const
+{
+    BufferObject::Bind(m_target);
+}
+
+void StreamBufferObject::Unbind() const
+{
+    BufferObject::Unbind(m_target);
+}
+
+void StreamBufferObject::BeginFrame()
+{
+    m_frameIndex = (m_frameIndex + 1) % m_frameCount;
+    m_frameOffset = 0;
+    m_flushOffset = 0;
+
+    // Wait for the GPU to finish the frame that last used this region. With enough regions, this rarely blocks
+    GLsync& fence = m_fences[m_frameIndex];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED && result != GL_WAIT_FAILED)
+        {
+            // Flush the commands the first time, or the fence might never be reached
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void StreamBufferObject::EndFrame()
+{
+    Flush();
+
+    GLsync& fence = m_fences[m_frameIndex];
+    assert(!fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBufferObject::Allocation StreamBufferObject::Allocate(size_t size, size_t alignment)
+{
+    assert(size > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    size_t frameStart = m_frameIndex * m_frameSize;
+    size_t offset = (frameStart + m_frameOffset + alignment - 1) & ~(alignment - 1);
+    if (offset + size > frameStart + m_frameSize)
+    {
+        return Allocation();
+    }
+    m_frameOffset = offset + size - frameStart;
+
+    Allocation allocation;
+    allocation.data = (m_mappedData ? m_mappedData : m_uploadData.data()) + offset;
+    allocation.offset = offset;
+    allocation.size = size;
+    return allocation;
+}
+
+void StreamBufferObject::Flush()
+{
+    if (m_mappedData || m_flushOffset == m_frameOffset)
+    {
+        return;
+    }
+
+    // Upload everything allocated in this region since the last flush
+    size_t frameStart = m_frameIndex * m_frameSize;
+    Bind();
+    glBufferSubData(m_target, frameStart + m_flushOffset, m_frameOffset - m_flushOffset, m_uploadData.data() + frameStart + m_flushOffset);
+    Unbind();
+
+    m_flushOffset = m_frameOffset;
+}
@@ -0,0 +1,137 @@
+#include <ituGL/core/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+ThreadPool::ThreadPool(unsigned int threadCount) : m_stopping(false)
+{
+    if (threadCount == 0)
+    {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::Enqueue(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(!m_stopping);
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(unsigned int count, unsigned int batchSize, const RangeFunction& function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Not worth splitting: run it here
+    batchSize = std::max(batchSize, 1u);
+    unsigned int batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount <= 1 || GetThreadCount() == 0)
+    {
+        function(0, count);
+        return;
+    }
+
+    // Batches are claimed from a shared counter, so threads that finish early take more work
+    std::atomic<unsigned int> nextBatch(0);
+    auto ProcessBatches = [&]()
+    {
+        unsigned int batch;
+        while ((batch = nextBatch.fetch_add(1)) < batchCount)
+        {
+            unsigned int begin = batch * batchSize;
+            function(begin, std::min(begin + batchSize, count));
+        }
+    };
+
+    // The helper tasks reference this stack frame, so wait for all of them to finish, not only for the batches
+    unsigned int helperCount = std::min(batchCount, GetThreadCount() + 1) - 1;
+    std::atomic<unsigned int> finishedHelpers(0);
+    for (unsigned int i = 0; i < helperCount; ++i)
+    {
+        Enqueue([&]()
+            {
+                ProcessBatches();
+                finishedHelpers.fetch_add(1, std::memory_order_release);
+            });
+    }
+    ProcessBatches();
+
+    // Help with other queued tasks (possibly our own helpers) while waiting
+    while (finishedHelpers.load(std::memory_order_acquire) < helperCount)
+    {
+        if (!RunPendingTask())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+    static ThreadPool s_defaultPool;
+    return s_defaultPool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+            {
+                // Stopping, and nothing left to do
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+    }
+    task();
+    return true;
+}
@@ -0,0 +1,6 @@
+#include <ituGL/geometry/DrawIndirectBufferObject.h>
+
+DrawIndirectBufferObject::DrawIndirectBufferObject()
+{
+    // Nothing to do here, it is done by the base class
+}
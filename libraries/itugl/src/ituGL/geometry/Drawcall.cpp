@@ -5,7 +5,7 @@
 #include <cassert>
 
 Drawcall::Drawcall()
-    : m_primitive(Primitive::Invalid), m_first(0), m_count(0), m_eboType(Data::Type::None)
+    : m_primitive(Primitive::Invalid), m_first(0), m_count(0), m_eboType(Data::Type::None), m_baseVertex(0)
 {
 }
 
@@ -14,12 +14,33 @@ Drawcall::Drawcall(Primitive primitive, GLsizei count, GLint first)
 {
 }
 
-Drawcall::Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first)
-    : m_primitive(primitive), m_first(first), m_count(count), m_eboType(eboType)
+Drawcall::Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first, GLint baseVertex)
+    : m_primitive(primitive), m_first(first), m_count(count), m_eboType(eboType), m_baseVertex(baseVertex)
 {
     assert(primitive != Primitive::Invalid);
     assert(first >= 0);
     assert(count > 0);
+    assert(baseVertex == 0 || eboType != Data::Type::None);
+}
+
+bool Drawcall::IsMultiDrawCompatible(const Drawcall& other) const
+{
+    return m_eboType != Data::Type::None && m_primitive == other.m_primitive && m_eboType == other.m_eboType;
+}
+
+DrawIndirectBufferObject::Command Drawcall::GetIndirectCommand(GLuint instanceCount, GLuint baseInstance) const
+{
+    assert(IsValid());
+    assert(m_eboType != Data::Type::None);
+
+    // The command counts elements, not bytes
+    DrawIndirectBufferObject::Command command;
+    command.count = static_cast<GLuint>(m_count);
+    command.instanceCount = instanceCount;
+    command.firstIndex = static_cast<GLuint>(m_first / Data::GetTypeSize(m_eboType));
+    command.baseVertex = m_baseVertex;
+    command.baseInstance = baseInstance;
+    return command;
 }
 
 // Execute the drawcall
@@ -39,6 +60,42 @@ void Drawcall::Draw() const
         // If there is an EBO, use glDrawElements
         assert(ElementBufferObject::IsSupportedType(m_eboType));
         const char* basePointer = nullptr; // Actual element pointer is in VAO
-        glDrawElements(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first);
+        if (m_baseVertex != 0)
+        {
+            glDrawElementsBaseVertex(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first, m_baseVertex);
+        }
+        else
+        {
+            glDrawElements(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first);
+        }
+    }
+}
+
+// Execute the drawcall for several instances
+void Drawcall::DrawInstanced(GLsizei instanceCount) const
+{
+    assert(IsValid());
+    assert(VertexArrayObject::IsAnyBound());
+    assert(instanceCount > 0);
+
+    GLenum primitive = static_cast<GLenum>(m_primitive);
+    if (m_eboType == Data::Type::None)
+    {
+        // If no EBO is present, use glDrawArraysInstanced
+        glDrawArraysInstanced(primitive, m_first, m_count, instanceCount);
+    }
+    else
+    {
+        // If there is an EBO, use glDrawElementsInstanced
+        assert(ElementBufferObject::IsSupportedType(m_eboType));
+        const char* basePointer = nullptr; // Actual element pointer is in VAO
+        if (m_baseVertex != 0)
+        {
+            glDrawElementsInstancedBaseVertex(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first, instanceCount, m_baseVertex);
+        }
+        else
+        {
+            glDrawElementsInstanced(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first, instanceCount);
+        }
     }
 }
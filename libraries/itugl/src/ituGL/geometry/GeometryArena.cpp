@@ -0,0 +1,119 @@
+#include <ituGL/geometry/GeometryArena.h>
+
+#include <cassert>
+
+GeometryArena::GeometryArena(const VertexFormat& vertexFormat, unsigned int vertexCapacity, unsigned int indexCapacity,
+    const SemanticMap& locations)
+    : m_vertexFormat(vertexFormat)
+    , m_locations(locations)
+    , m_vertexAllocator(vertexCapacity)
+    , m_indexAllocator(indexCapacity)
+{
+    assert(vertexCapacity > 0 && indexCapacity > 0);
+
+    m_vao.Bind();
+
+    // Allocate the whole capacity now, meshes only update their part
+    m_vbo.Bind();
+    m_vbo.AllocateData(vertexCapacity * m_vertexFormat.GetSize());
+
+    m_ebo.Bind();
+    m_ebo.AllocateData<unsigned int>(indexCapacity);
+
+    // Interleaved layout does not depend on the vertex count, the base vertex of each draw selects the mesh.
+    // Locations are assigned like in Mesh, so the same programs can draw meshes in and out of the arena
+    GLuint location = 0;
+    for (auto it = m_vertexFormat.LayoutBegin(vertexCapacity, true); it != m_vertexFormat.LayoutEnd(); it++)
+    {
+        const VertexAttribute& attribute = it->GetAttribute();
+        auto itLocation = m_locations.find(attribute.GetSemantic());
+        if (itLocation != m_locations.end())
+        {
+            location = itLocation->second;
+        }
+        m_vao.SetAttribute(location, attribute, it->GetOffset(), it->GetStride());
+        location += attribute.GetLocationSize();
+    }
+
+    VertexArrayObject::Unbind();
+    VertexBufferObject::Unbind();
+    ElementBufferObject::Unbind();
+}
+
+bool GeometryArena::IsCompatible(const VertexFormat& vertexFormat, const SemanticMap& locations) const
+{
+    if (vertexFormat.GetAttributeCount() != m_vertexFormat.GetAttributeCount() || locations != m_locations)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < vertexFormat.GetAttributeCount(); ++i)
+    {
+        VertexAttribute attribute = vertexFormat.GetAttribute(i);
+        VertexAttribute arenaAttribute = m_vertexFormat.GetAttribute(i);
+        if (attribute.GetType() != arenaAttribute.GetType() || attribute.GetComponents() != arenaAttribute.GetComponents()
+            || attribute.IsNormalized() != arenaAttribute.IsNormalized() || attribute.GetSemantic() != arenaAttribute.GetSemantic())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+GeometryArena::Allocation GeometryArena::Allocate(std::span<const std::byte> vertexData, std::span<const unsigned int> indices)
+{
+    size_t vertexSize = m_vertexFormat.GetSize();
+    assert(vertexData.size() % vertexSize == 0);
+
+    unsigned int vertexCount = static_cast<unsigned int>(vertexData.size() / vertexSize);
+    unsigned int indexCount = static_cast<unsigned int>(indices.size());
+    assert(vertexCount > 0 && indexCount > 0);
+
+    Allocation allocation;
+
+    allocation.firstVertex = m_vertexAllocator.Allocate(vertexCount);
+    if (allocation.firstVertex == FreeListAllocator::InvalidOffset)
+    {
+        return Allocation();
+    }
+
+    allocation.firstIndex = m_indexAllocator.Allocate(indexCount);
+    if (allocation.firstIndex == FreeListAllocator::InvalidOffset)
+    {
+        m_vertexAllocator.Free(allocation.firstVertex, vertexCount);
+        return Allocation();
+    }
+
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+
+    // Copy the data to its place in the buffers
+    m_vbo.Bind();
+    m_vbo.UpdateData(vertexData, allocation.firstVertex * vertexSize);
+    VertexBufferObject::Unbind();
+
+    // Binding the EBO outside of a VAO would change the EBO of the bound VAO
+    VertexArrayObject::Unbind();
+    m_ebo.Bind();
+    m_ebo.UpdateData(indices, allocation.firstIndex * sizeof(unsigned int));
+    ElementBufferObject::Unbind();
+
+    return allocation;
+}
+
+void GeometryArena::Free(const Allocation& allocation)
+{
+    assert(allocation.IsValid());
+    m_vertexAllocator.Free(allocation.firstVertex, allocation.vertexCount);
+    m_indexAllocator.Free(allocation.firstIndex, allocation.indexCount);
+}
+
+Drawcall GeometryArena::GetDrawcall(const Allocation& allocation)
+{
+    assert(allocation.IsValid());
+
+    // The first element is an offset in bytes, like in the other indexed drawcalls
+    GLint firstElement = static_cast<GLint>(allocation.firstIndex * sizeof(unsigned int));
+    return Drawcall(Drawcall::Primitive::Triangles, static_cast<GLsizei>(allocation.indexCount), Data::Type::UInt,
+        firstElement, static_cast<GLint>(allocation.firstVertex));
+}
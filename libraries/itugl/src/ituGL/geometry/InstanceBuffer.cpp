@@ -0,0 +1,87 @@
+#include <ituGL/geometry/InstanceBuffer.h>
+
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/core/StreamBufferObject.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+InstanceBuffer::InstanceBuffer() : m_streamBuffer(nullptr), m_inStreamBuffer(false), m_offset(0), m_instanceCount(0), m_reportedFallback(false)
+{
+}
+
+InstanceBuffer::InstanceBuffer(StreamBufferObject& streamBuffer) : m_streamBuffer(&streamBuffer), m_inStreamBuffer(false), m_offset(0), m_instanceCount(0), m_reportedFallback(false)
+{
+    assert(streamBuffer.GetTarget() == BufferObject::ArrayBuffer);
+}
+
+void InstanceBuffer::SetWorldMatrices(std::span<const glm::mat4> worldMatrices)
+{
+    m_instanceCount = static_cast<unsigned int>(worldMatrices.size());
+
+    if (m_streamBuffer)
+    {
+        // Write directly to the stream buffer, no copies involved if it is persistently mapped
+        StreamBufferObject::Allocation allocation = m_streamBuffer->Allocate(worldMatrices.size_bytes(), sizeof(glm::mat4));
+        if (allocation.IsValid())
+        {
+            std::memcpy(allocation.data, worldMatrices.data(), worldMatrices.size_bytes());
+            m_streamBuffer->Flush();
+            m_inStreamBuffer = true;
+            m_offset = allocation.offset;
+            return;
+        }
+        // The frame region is full, fall back to the own buffer. It still works, only slower, so it is reported once
+        if (!m_reportedFallback)
+        {
+            std::cout << "WARNING::INSTANCEBUFFER::STREAM_BUFFER_FULL\n" << worldMatrices.size_bytes() << " bytes did not fit in the frame region" << std::endl;
+            m_reportedFallback = true;
+        }
+    }
+
+    m_vbo.Bind();
+    // Allocating again instead of updating avoids waiting for draws still using the old data
+    m_vbo.AllocateData(worldMatrices, BufferObject::Usage::StreamDraw);
+    VertexBufferObject::Unbind();
+
+    m_inStreamBuffer = false;
+    m_offset = 0;
+}
+
+void InstanceBuffer::SetAttributes(GLuint location, unsigned int firstInstance) const
+{
+    assert(VertexArrayObject::IsAnyBound());
+    assert(firstInstance < m_instanceCount);
+
+    if (m_inStreamBuffer)
+    {
+        m_streamBuffer->Bind();
+    }
+    else
+    {
+        m_vbo.Bind();
+    }
+
+    // Each column of the matrix is a vec4 attribute that advances once per instance, instead of once per vertex
+    const unsigned char* pointer = nullptr; // Actual base pointer is in VBO
+    pointer += m_offset + firstInstance * sizeof(glm::mat4);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), pointer + column * sizeof(glm::vec4));
+        glVertexAttribDivisor(location + column, 1);
+        glEnableVertexAttribArray(location + column);
+    }
+
+    VertexBufferObject::Unbind();
+}
+
+void InstanceBuffer::ResetAttributes(GLuint location)
+{
+    assert(VertexArrayObject::IsAnyBound());
+
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glDisableVertexAttribArray(location + column);
+        glVertexAttribDivisor(location + column, 0);
+    }
+}
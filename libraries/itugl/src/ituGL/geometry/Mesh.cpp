@@ -1,7 +1,23 @@
 #include <ituGL/geometry/Mesh.h>
 
+#include <glm/common.hpp>
+#include <limits>
+
 Mesh::Mesh()
+    : m_boundsMin(std::numeric_limits<float>::max())
+    , m_boundsMax(std::numeric_limits<float>::lowest())
+{
+}
+
+Mesh::~Mesh()
 {
+    for (const Submesh& submesh : m_submeshes)
+    {
+        if (submesh.arena)
+        {
+            submesh.arena->Free(submesh.arenaAllocation);
+        }
+    }
 }
 
 unsigned int Mesh::AddVertexData(size_t size)
@@ -35,11 +51,30 @@ unsigned int Mesh::AddSubmesh(unsigned int vaoIndex,
     return AddSubmesh(vaoIndex, Drawcall(primitive, count, eboType, first));
 }
 
+unsigned int Mesh::AddSubmesh(std::shared_ptr<GeometryArena> arena, const GeometryArena::Allocation& allocation)
+{
+    assert(arena && allocation.IsValid());
+
+    unsigned int submeshIndex = static_cast<unsigned int>(m_submeshes.size());
+    Submesh& submesh = m_submeshes.emplace_back();
+    submesh.vaoIndex = ~0u;
+    submesh.drawcall = GeometryArena::GetDrawcall(allocation);
+    submesh.arena = std::move(arena);
+    submesh.arenaAllocation = allocation;
+    return submeshIndex;
+}
+
+const VertexArrayObject& Mesh::GetSubmeshVertexArray(unsigned int submeshIndex) const
+{
+    const Submesh& submesh = GetSubmesh(submeshIndex);
+    return submesh.arena ? submesh.arena->GetVertexArray() : GetVertexArray(submesh.vaoIndex);
+}
+
 // Bind the VAO and render the drawcall of the submesh
 void Mesh::DrawSubmesh(int submeshIndex) const
 {
     const Submesh& submesh = GetSubmesh(submeshIndex);
-    const VertexArrayObject& vao = GetVertexArray(submesh.vaoIndex);
+    const VertexArrayObject& vao = GetSubmeshVertexArray(submeshIndex);
     vao.Bind();
     submesh.drawcall.Draw();
     //VertexArrayObject::Unbind(); // No need to unbind
@@ -58,3 +93,35 @@ void Mesh::SetupVertexAttribute(VertexArrayObject& vao, const VertexAttribute::L
     vao.SetAttribute(location, attribute, attributeLayout.GetOffset(), attributeLayout.GetStride());
     location += attribute.GetLocationSize();
 }
+
+void Mesh::ExpandBounds(const glm::vec3& min, const glm::vec3& max)
+{
+    m_boundsMin = glm::min(m_boundsMin, min);
+    m_boundsMax = glm::max(m_boundsMax, max);
+}
+
+const Mesh::SubmeshGeometry* Mesh::GetSubmeshGeometry(unsigned int submeshIndex) const
+{
+    if (submeshIndex >= m_submeshGeometry.size() || m_submeshGeometry[submeshIndex].vertexData.empty())
+    {
+        return nullptr;
+    }
+    return &m_submeshGeometry[submeshIndex];
+}
+
+void Mesh::SetSubmeshGeometry(unsigned int submeshIndex, SubmeshGeometry&& geometry)
+{
+    assert(submeshIndex < m_submeshes.size());
+    assert(geometry.vertexData.size() % geometry.vertexFormat.GetSize() == 0);
+    if (m_submeshGeometry.size() <= submeshIndex)
+    {
+        m_submeshGeometry.resize(submeshIndex + 1);
+    }
+    m_submeshGeometry[submeshIndex] = std::move(geometry);
+}
+
+void Mesh::ClearSubmeshGeometry()
+{
+    m_submeshGeometry.clear();
+    m_submeshGeometry.shrink_to_fit();
+}
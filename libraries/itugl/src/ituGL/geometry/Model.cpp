@@ -24,7 +24,7 @@ void Model::SetMesh(std::shared_ptr<Mesh> mesh)
     m_mesh = mesh;
 }
 
-unsigned int Model::GetMaterialCount()
+unsigned int Model::GetMaterialCount() const
 {
     return static_cast<unsigned int>(m_materials.size());
 }
@@ -39,6 +39,11 @@ const Material& Model::GetMaterial(unsigned int index) const
     return *m_materials[index];
 }
 
+std::shared_ptr<Material> Model::GetSharedMaterial(unsigned int index) const
+{
+    return m_materials[index];
+}
+
 void Model::SetMaterial(unsigned int index, std::shared_ptr<Material> material)
 {
     m_materials[index] = material;
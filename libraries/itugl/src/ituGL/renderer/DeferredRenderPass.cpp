@@ -1,28 +1,95 @@
 #include <ituGL/renderer/DeferredRenderPass.h>
 
 #include <ituGL/renderer/Renderer.h>
+#include <ituGL/renderer/LightClusterGrid.h>
 #include <ituGL/geometry/VertexFormat.h>
 #include <ituGL/lighting/Light.h>
 #include <ituGL/camera/Camera.h>
+#include <ituGL/core/Color.h>
 #include <ituGL/shader/Material.h>
 #include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/FramebufferObject.h>
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cassert>
 
 DeferredRenderPass::DeferredRenderPass(std::shared_ptr<Material> material, std::shared_ptr<const FramebufferObject> framebuffer)
-    : RenderPass(framebuffer), m_material(material)
+    : RenderPass(framebuffer), m_material(material), m_mode(Mode::LightVolumes)
+    , m_firstLightState(PipelineState::DefaultId), m_additiveLightState(PipelineState::DefaultId)
+    , m_stencilVolumeState(PipelineState::DefaultId), m_volumeLightState(PipelineState::DefaultId)
+    , m_tiledLightsLocation(-1), m_tiledLightCountLocation(-1)
+    , m_tiledViewMatrixLocation(-1), m_tiledProjMatrixLocation(-1), m_tiledInvViewProjMatrixLocation(-1)
 {
     InitializeMeshes();
+    InitializeStates();
+}
+
+void DeferredRenderPass::SetMode(Mode mode)
+{
+    assert(mode != Mode::Tiled || m_tiledMaterial);
+    m_mode = mode;
+}
+
+void DeferredRenderPass::SetDepthSource(std::shared_ptr<const FramebufferObject> depthFramebuffer)
+{
+    m_depthFramebuffer = depthFramebuffer;
+}
+
+void DeferredRenderPass::SetTiledLighting(std::shared_ptr<Material> computeMaterial, std::shared_ptr<Texture2DObject> outputTexture)
+{
+    assert(computeMaterial && outputTexture);
+    m_tiledMaterial = computeMaterial;
+    m_tiledOutputTexture = outputTexture;
+
+    std::shared_ptr<const ShaderProgram> shaderProgram = m_tiledMaterial->GetShaderProgram();
+    m_tiledLightsLocation = shaderProgram->GetUniformLocation("Lights");
+    m_tiledLightCountLocation = shaderProgram->GetUniformLocation("LightCount");
+    m_tiledViewMatrixLocation = shaderProgram->GetUniformLocation("ViewMatrix");
+    m_tiledProjMatrixLocation = shaderProgram->GetUniformLocation("ProjMatrix");
+    m_tiledInvViewProjMatrixLocation = shaderProgram->GetUniformLocation("InvViewProjMatrix");
+}
+
+bool DeferredRenderPass::IsTiledSupported()
+{
+    return GLAD_GL_VERSION_4_3;
 }
 
 void DeferredRenderPass::Render()
 {
-    Renderer& renderer = GetRenderer();
+    if (m_mode == Mode::Tiled)
+    {
+        RenderTiled();
+    }
+    else
+    {
+        RenderLights();
+    }
+}
 
-    //TODO: temp hack
-    renderer.GetDevice().DisableFeature(GL_DEPTH_TEST);
+void DeferredRenderPass::RenderLights()
+{
+    Renderer& renderer = GetRenderer();
+    DeviceGL& device = renderer.GetDevice();
 
     const Camera& camera = renderer.GetCurrentCamera();
 
+    bool useVolumes = m_mode == Mode::LightVolumes;
+    if (useVolumes)
+    {
+        if (m_depthFramebuffer)
+        {
+            GLint viewport[4];
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            FramebufferObject::Blit(*m_depthFramebuffer, *renderer.GetCurrentFramebuffer(), viewport[2], viewport[3], GL_DEPTH_BUFFER_BIT);
+        }
+        device.Clear(false, Color(), false, 1.0, true, 0);
+        device.EnableFeature(GL_STENCIL_TEST);
+        // Back faces behind the far plane still have to mark the stencil
+        device.EnableFeature(GL_DEPTH_CLAMP);
+    }
+    bool cullFaceEnabled = device.IsFeatureEnabled(GL_CULL_FACE);
+
     assert(m_material);
     m_material->Use();
     std::shared_ptr<const ShaderProgram> shaderProgram = m_material->GetShaderProgram();
@@ -39,24 +106,206 @@ void DeferredRenderPass::Render()
         const Light* light = lightIndex <= lights.size() ? lights[lightIndex - 1] : nullptr;
         assert(first || light);
 
-        const Mesh* mesh = &renderer.GetFullscreenMesh();
+        // The first pass also adds the indirect light, so it always covers the whole screen
         glm::mat4 worldMatrix = fullscreenMatrix;
+        const Mesh* volumeMesh = useVolumes && !first ? GetLightVolume(*light, worldMatrix) : nullptr;
 
-        // TODO: select different meshes depending on the type
+        renderer.UpdateTransforms(shaderProgram, worldMatrix, first);
+        if (volumeMesh)
+        {
+            DrawStencilVolume(*volumeMesh);
 
-        // Set the render states for the first and additional lights
-        renderer.SetLightingRenderStates(first);
+            // Draw the back faces, that are still there when the camera is inside the volume
+            PipelineState::Apply(m_volumeLightState);
+            device.EnableFeature(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+            volumeMesh->DrawSubmesh(0);
+            glCullFace(GL_BACK);
+        }
+        else
+        {
+            PipelineState::Apply(first ? m_firstLightState : m_additiveLightState);
+            device.SetFeatureEnabled(GL_CULL_FACE, cullFaceEnabled);
+            renderer.GetFullscreenMesh().DrawSubmesh(0);
+        }
 
-        renderer.UpdateTransforms(shaderProgram, fullscreenMatrix, first);
-        mesh->DrawSubmesh(0);
         first = false;
     }
 
-    //TODO: temp hack
-    renderer.GetDevice().EnableFeature(GL_DEPTH_TEST);
+    device.SetFeatureEnabled(GL_CULL_FACE, cullFaceEnabled);
+    if (useVolumes)
+    {
+        device.DisableFeature(GL_STENCIL_TEST);
+        device.DisableFeature(GL_DEPTH_CLAMP);
+    }
+    PipelineState::Apply(PipelineState::DefaultId);
+}
+
+void DeferredRenderPass::DrawStencilVolume(const Mesh& mesh)
+{
+    // The lighting shader runs here too, but nothing is written to color
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    DeviceGL::GetInstance().DisableFeature(GL_CULL_FACE);
+    PipelineState::Apply(m_stencilVolumeState);
+    mesh.DrawSubmesh(0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void DeferredRenderPass::RenderTiled()
+{
+    assert(m_tiledMaterial && m_tiledOutputTexture);
+    assert(IsTiledSupported());
+
+    Renderer& renderer = GetRenderer();
+    const Camera& camera = renderer.GetCurrentCamera();
+
+    // Never empty, so the texture is always complete
+    m_tiledLightData.clear();
+    for (const Light* light : renderer.GetLights())
+    {
+        LightClusterGrid::AppendLightData(*light, m_tiledLightData);
+    }
+    unsigned int lightCount = static_cast<unsigned int>(m_tiledLightData.size() / 4);
+    if (m_tiledLightData.empty())
+    {
+        m_tiledLightData.emplace_back(0.0f);
+    }
+    m_tiledLightTexture.Bind();
+    m_tiledLightTexture.SetData(std::span<const glm::vec4>(m_tiledLightData), TextureObject::InternalFormatRGBA32F);
+
+    m_tiledMaterial->Use();
+    std::shared_ptr<const ShaderProgram> shaderProgram = m_tiledMaterial->GetShaderProgram();
+    shaderProgram->SetTexture(m_tiledLightsLocation, LightTextureUnit, m_tiledLightTexture);
+    shaderProgram->SetUniform(m_tiledLightCountLocation, lightCount);
+    shaderProgram->SetUniform(m_tiledViewMatrixLocation, camera.GetViewMatrix());
+    shaderProgram->SetUniform(m_tiledProjMatrixLocation, camera.GetProjectionMatrix());
+    shaderProgram->SetUniform(m_tiledInvViewProjMatrixLocation, glm::inverse(camera.GetViewProjectionMatrix()));
+
+    const Texture2DObject& outputTexture = *m_tiledOutputTexture;
+    glBindImageTexture(0, outputTexture.GetHandle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glDispatchCompute((viewport[2] + TileSize - 1) / TileSize, (viewport[3] + TileSize - 1) / TileSize, 1);
+
+    // The output is read by the next passes, as a texture or in a framebuffer
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+const Mesh* DeferredRenderPass::GetLightVolume(const Light& light, glm::mat4& worldMatrix) const
+{
+    glm::vec4 attenuation = light.GetAttenuation();
+    float range = std::max(attenuation.x, attenuation.y);
+    glm::vec3 position = light.GetPosition();
+
+    switch (light.GetType())
+    {
+    case Light::Type::Point:
+        worldMatrix = glm::translate(position) * glm::scale(glm::vec3(range));
+        return &m_sphereMesh;
+    case Light::Type::Spot:
+    {
+        // Wide cones are better bounded by the sphere. The falloff is part of the angle
+        float angle = std::min(attenuation.z + attenuation.w, glm::pi<float>());
+        if (angle > glm::pi<float>() / 3.0f)
+        {
+            worldMatrix = glm::translate(position) * glm::scale(glm::vec3(range));
+            return &m_sphereMesh;
+        }
+
+        // Rotate Z to the light direction, keeping the basis right handed so the faces don't flip
+        glm::vec3 direction = light.GetDirection();
+        glm::vec3 helper = std::abs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 right = glm::normalize(glm::cross(helper, direction));
+        glm::vec3 up = glm::cross(direction, right);
+        float radius = range * glm::tan(angle);
+        worldMatrix = glm::translate(position) * glm::mat4(glm::mat3(right * radius, up * radius, direction * range));
+        return &m_coneMesh;
+    }
+    default:
+        // Directional lights cover everything
+        return nullptr;
+    }
 }
 
 void DeferredRenderPass::InitializeMeshes()
 {
-    //TODO: Create meshes for spot and point lights
+    VertexFormat vertexFormat;
+    vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Position);
+
+    // Sphere, with the vertices a bit out so the middle of the faces is still outside of the unit sphere
+    const unsigned int rings = 8, segments = 16;
+    float sphereScale = 1.0f / (glm::cos(glm::pi<float>() / segments) * glm::cos(glm::half_pi<float>() / rings));
+    std::vector<glm::vec3> sphereVertices;
+    for (unsigned int ring = 0; ring <= rings; ++ring)
+    {
+        float theta = glm::pi<float>() * ring / rings;
+        for (unsigned int segment = 0; segment < segments; ++segment)
+        {
+            float phi = glm::two_pi<float>() * segment / segments;
+            sphereVertices.emplace_back(sphereScale * glm::vec3(glm::sin(theta) * glm::cos(phi), glm::cos(theta), glm::sin(theta) * glm::sin(phi)));
+        }
+    }
+    std::vector<unsigned short> sphereIndices;
+    for (unsigned int ring = 0; ring < rings; ++ring)
+    {
+        for (unsigned int segment = 0; segment < segments; ++segment)
+        {
+            unsigned short a = ring * segments + segment;
+            unsigned short b = (ring + 1) * segments + segment;
+            unsigned short c = ring * segments + (segment + 1) % segments;
+            unsigned short d = (ring + 1) * segments + (segment + 1) % segments;
+            // Counter-clockwise from outside
+            sphereIndices.insert(sphereIndices.end(), { a, c, b,  c, d, b });
+        }
+    }
+    m_sphereMesh.AddSubmesh<glm::vec3, unsigned short, VertexFormat::LayoutIterator>(Drawcall::Primitive::Triangles, sphereVertices, sphereIndices,
+        vertexFormat.LayoutBegin(static_cast<int>(sphereVertices.size()), false), vertexFormat.LayoutEnd());
+
+    // Cone, with the apex at the origin and the base at Z = 1. Vertex 0 is the apex, and 1 the center of the base
+    float coneScale = 1.0f / glm::cos(glm::pi<float>() / segments);
+    std::vector<glm::vec3> coneVertices = { glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+    for (unsigned int segment = 0; segment < segments; ++segment)
+    {
+        float phi = glm::two_pi<float>() * segment / segments;
+        coneVertices.emplace_back(coneScale * glm::cos(phi), coneScale * glm::sin(phi), 1.0f);
+    }
+    std::vector<unsigned short> coneIndices;
+    for (unsigned int segment = 0; segment < segments; ++segment)
+    {
+        unsigned short a = 2 + segment;
+        unsigned short b = 2 + (segment + 1) % segments;
+        coneIndices.insert(coneIndices.end(), { 0, b, a,  1, a, b });
+    }
+    m_coneMesh.AddSubmesh<glm::vec3, unsigned short, VertexFormat::LayoutIterator>(Drawcall::Primitive::Triangles, coneVertices, coneIndices,
+        vertexFormat.LayoutBegin(static_cast<int>(coneVertices.size()), false), vertexFormat.LayoutEnd());
+}
+
+void DeferredRenderPass::InitializeStates()
+{
+    // Fullscreen lights ignore the depth, every pixel has to be lit
+    PipelineState firstLightState;
+    firstLightState.depthFunction = GL_ALWAYS;
+    firstLightState.depthWrite = false;
+    m_firstLightState = PipelineState::Intern(firstLightState);
+
+    PipelineState additiveLightState = firstLightState;
+    additiveLightState.blendEnabled = true;
+    additiveLightState.blendEquations = { GL_FUNC_ADD, GL_FUNC_ADD };
+    additiveLightState.blendParams = { GL_ONE, GL_ONE, GL_ONE, GL_ONE };
+    m_additiveLightState = PipelineState::Intern(additiveLightState);
+
+    // Back faces behind the scene add 1, front faces behind the scene remove it.
+    // Only the pixels with the scene between the front and the back faces stay marked
+    PipelineState stencilVolumeState;
+    stencilVolumeState.depthFunction = GL_LESS;
+    stencilVolumeState.depthWrite = false;
+    stencilVolumeState.stencilDepthFail = { GL_DECR_WRAP, GL_INCR_WRAP };
+    m_stencilVolumeState = PipelineState::Intern(stencilVolumeState);
+
+    // Light the marked pixels, resetting them to 0 for the next light
+    PipelineState volumeLightState = additiveLightState;
+    volumeLightState.stencilFunctions = { GL_NOTEQUAL, GL_NOTEQUAL };
+    volumeLightState.stencilDepthPass = { GL_ZERO, GL_ZERO };
+    m_volumeLightState = PipelineState::Intern(volumeLightState);
 }
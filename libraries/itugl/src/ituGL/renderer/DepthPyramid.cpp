@@ -0,0 +1,98 @@
+#include <ituGL/renderer/DepthPyramid.h>
+
+#include <ituGL/shader/ShaderProgram.h>
+#include <algorithm>
+#include <cassert>
+
+// Largest power of two not bigger than value
+static int FloorPowerOfTwo(int value)
+{
+    int power = 1;
+    while (power * 2 <= value)
+    {
+        power *= 2;
+    }
+    return power;
+}
+
+DepthPyramid::DepthPyramid(std::shared_ptr<ShaderProgram> buildProgram)
+    : m_buildProgram(std::move(buildProgram))
+    , m_sourceTextureLocation(-1), m_sourceLevelLocation(-1), m_sourceSizeLocation(-1)
+    , m_size(0), m_depthSize(0), m_levelCount(0)
+    , m_viewProjMatrix(1.0f)
+{
+    assert(m_buildProgram);
+    m_sourceTextureLocation = m_buildProgram->GetUniformLocation("SourceTexture");
+    m_sourceLevelLocation = m_buildProgram->GetUniformLocation("SourceLevel");
+    m_sourceSizeLocation = m_buildProgram->GetUniformLocation("SourceSize");
+}
+
+void DepthPyramid::Build(const Texture2DObject& depthTexture, int depthWidth, int depthHeight, const glm::mat4& viewProjMatrix)
+{
+    assert(IsSupported());
+    assert(depthWidth > 0 && depthHeight > 0);
+
+    if (m_depthSize != glm::ivec2(depthWidth, depthHeight))
+    {
+        Resize(depthWidth, depthHeight);
+    }
+
+    m_buildProgram->Use();
+
+    // Level 0 from the depth texture, then each level from the previous one
+    BuildLevel(depthTexture, 0, m_depthSize, 0);
+    for (int level = 1; level < m_levelCount; ++level)
+    {
+        BuildLevel(m_texture, level - 1, glm::max(m_size >> (level - 1), 1), level);
+    }
+
+    m_viewProjMatrix = viewProjMatrix;
+}
+
+bool DepthPyramid::IsSupported()
+{
+    return GLAD_GL_VERSION_4_3;
+}
+
+void DepthPyramid::Resize(int depthWidth, int depthHeight)
+{
+    m_depthSize = glm::ivec2(depthWidth, depthHeight);
+    m_size = glm::ivec2(FloorPowerOfTwo(depthWidth), FloorPowerOfTwo(depthHeight));
+
+    m_levelCount = 1;
+    while ((m_size.x >> m_levelCount) > 0 || (m_size.y >> m_levelCount) > 0)
+    {
+        ++m_levelCount;
+    }
+
+    m_texture.Bind();
+    for (int level = 0; level < m_levelCount; ++level)
+    {
+        glm::ivec2 levelSize = glm::max(m_size >> level, 1);
+        m_texture.SetImage(level, levelSize.x, levelSize.y, TextureObject::FormatR, TextureObject::InternalFormatR32F);
+    }
+    // Only read with texelFetch, but the texture must still be complete
+    m_texture.SetParameter(TextureObject::ParameterInt::BaseLevel, 0);
+    m_texture.SetParameter(TextureObject::ParameterInt::MaxLevel, m_levelCount - 1);
+    m_texture.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST_MIPMAP_NEAREST);
+    m_texture.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
+    m_texture.SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+    m_texture.SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+    Texture2DObject::Unbind();
+}
+
+void DepthPyramid::BuildLevel(const Texture2DObject& sourceTexture, int sourceLevel, const glm::ivec2& sourceSize, int targetLevel)
+{
+    glm::ivec2 targetSize = glm::max(m_size >> targetLevel, 1);
+
+    m_buildProgram->SetTexture(m_sourceTextureLocation, 0, sourceTexture);
+    m_buildProgram->SetUniform(m_sourceLevelLocation, sourceLevel);
+    m_buildProgram->SetUniform(m_sourceSizeLocation, sourceSize);
+    const Texture2DObject& targetTexture = m_texture;
+    glBindImageTexture(0, targetTexture.GetHandle(), targetLevel, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+    glDispatchCompute((targetSize.x + GroupSize - 1) / GroupSize, (targetSize.y + GroupSize - 1) / GroupSize, 1);
+
+    // The next level reads this one
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
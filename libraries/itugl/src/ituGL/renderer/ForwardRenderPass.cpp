@@ -3,7 +3,9 @@
 #include <ituGL/camera/Camera.h>
 #include <ituGL/shader/Material.h>
 #include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/renderer/LightClusterGrid.h>
 #include <ituGL/renderer/Renderer.h>
+#include <algorithm>
 
 ForwardRenderPass::ForwardRenderPass()
     : ForwardRenderPass(0)
@@ -11,38 +13,115 @@ ForwardRenderPass::ForwardRenderPass()
 }
 
 ForwardRenderPass::ForwardRenderPass(int drawcallCollectionIndex)
+    : ForwardRenderPass(drawcallCollectionIndex, nullptr)
+{
+}
+
+ForwardRenderPass::ForwardRenderPass(int drawcallCollectionIndex, std::shared_ptr<LightClusterGrid> lightClusterGrid, ThreadPool* threadPool)
     : m_drawcallCollectionIndex(drawcallCollectionIndex)
+    , m_lightClusterGrid(std::move(lightClusterGrid))
+    , m_threadPool(threadPool)
 {
 }
 
 void ForwardRenderPass::Render()
+{
+    if (m_lightClusterGrid)
+    {
+        RenderClustered();
+        return;
+    }
+
+    Renderer& renderer = GetRenderer();
+
+    // Group the drawcalls that can be merged. Transparent ones keep their order
+    renderer.SortOpaqueDrawcallCollection(m_drawcallCollectionIndex);
+    const auto& drawcallCollection = renderer.GetDrawcalls(m_drawcallCollectionIndex);
+
+    // for all drawcalls
+    for (unsigned int drawcallIndex = 0; drawcallIndex < drawcallCollection.size(); )
+    {
+        const Renderer::DrawcallInfo& drawcallInfo = drawcallCollection[drawcallIndex];
+
+        // Prepare drawcall states, merging the following drawcalls as instances when possible
+        unsigned int instanceCount = renderer.PrepareInstancedDrawcall(drawcallCollection.subspan(drawcallIndex));
+
+        DrawMultipass(drawcallInfo.GetShaderProgram());
+        renderer.FinishInstancedDrawcall();
+
+        drawcallIndex += instanceCount;
+    }
+}
+
+void ForwardRenderPass::RenderClustered()
 {
     Renderer& renderer = GetRenderer();
 
     const Camera& camera = renderer.GetCurrentCamera();
     const auto& lights = renderer.GetLights();
+
+    // Group the drawcalls that can be merged. Transparent ones keep their order
+    renderer.SortOpaqueDrawcallCollection(m_drawcallCollectionIndex);
     const auto& drawcallCollection = renderer.GetDrawcalls(m_drawcallCollectionIndex);
 
-    // for all drawcalls
-    for (const Renderer::DrawcallInfo& drawcallInfo : drawcallCollection)
+    // Assign the lights once per frame, for all the drawcalls
+    m_lightClusterGrid->Build(camera, lights, m_threadPool);
+    m_lightClusterGrid->Upload();
+    m_lightClusterGrid->BindTextures(ClusterTextureUnit);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glm::vec2 viewportSize(viewport[2], viewport[3]);
+
+    m_clusteredPrograms.clear();
+    for (unsigned int drawcallIndex = 0; drawcallIndex < drawcallCollection.size(); )
     {
-        // Prepare drawcall states
-        renderer.PrepareDrawcall(drawcallInfo);
+        const Renderer::DrawcallInfo& drawcallInfo = drawcallCollection[drawcallIndex];
 
-        std::shared_ptr<const ShaderProgram> shaderProgram = drawcallInfo.GetMaterial().GetShaderProgram();
+        unsigned int instanceCount = renderer.PrepareInstancedDrawcall(drawcallCollection.subspan(drawcallIndex));
 
-        //for all lights
-        bool first = true;
-        unsigned int lightIndex = 0;
-        while (renderer.UpdateLights(shaderProgram, lights, lightIndex))
+        // The uniforms stay in the program, set them the first time it is used in the frame
+        const ShaderProgram& shaderProgram = drawcallInfo.GetShaderProgram();
+        auto itProgram = std::find_if(m_clusteredPrograms.begin(), m_clusteredPrograms.end(), [&](const auto& program) { return program.first == &shaderProgram; });
+        if (itProgram == m_clusteredPrograms.end())
         {
-            // Set the renderstates
-            renderer.SetLightingRenderStates(first);
-
-            // Draw
-            drawcallInfo.GetDrawcall().Draw();
+            bool supported = m_lightClusterGrid->SetUniforms(shaderProgram, ClusterTextureUnit, viewportSize);
+            itProgram = m_clusteredPrograms.insert(m_clusteredPrograms.end(), std::make_pair(&shaderProgram, supported));
+        }
 
-            first = false;
+        if (itProgram->second)
+        {
+            // A single pass: the indirect light from the usual uniforms, and all the direct lights from the clusters
+            unsigned int lightIndex = 0;
+            renderer.UpdateLights(shaderProgram, {}, lightIndex);
+            renderer.DrawPreparedDrawcall();
+        }
+        else
+        {
+            DrawMultipass(shaderProgram);
         }
+        renderer.FinishInstancedDrawcall();
+
+        drawcallIndex += instanceCount;
+    }
+}
+
+void ForwardRenderPass::DrawMultipass(const ShaderProgram& shaderProgram)
+{
+    Renderer& renderer = GetRenderer();
+    const auto& lights = renderer.GetLights();
+
+    //for all lights
+    bool first = true;
+    unsigned int lightIndex = 0;
+    while (renderer.UpdateLights(shaderProgram, lights, lightIndex))
+    {
+        // Set the renderstates
+        renderer.SetLightingRenderStates(first);
+
+        // Draw
+        renderer.DrawPreparedDrawcall();
+
+        first = false;
     }
 }
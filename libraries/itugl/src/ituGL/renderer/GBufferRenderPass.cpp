@@ -20,7 +20,8 @@ void GBufferRenderPass::InitFramebuffer()
 
     targetFramebuffer->Bind();
 
-    targetFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Depth, *m_depthTexture);
+    // Depth and stencil, so the depth can be copied to a framebuffer with the usual 24-bit depth and 8-bit stencil
+    targetFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::DepthStencil, *m_depthTexture);
 
     // Set the albedo texture as color attachment 0
     targetFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color0, *m_albedoTexture);
@@ -49,7 +50,7 @@ void GBufferRenderPass::InitTextures(int width, int height)
     // Depth: Set the min and magfilter as nearest
     m_depthTexture = std::make_shared<Texture2DObject>();
     m_depthTexture->Bind();
-    m_depthTexture->SetImage(0, width, height, TextureObject::FormatDepth, TextureObject::InternalFormatDepth);
+    m_depthTexture->SetImage(0, width, height, TextureObject::FormatDepthStencil, TextureObject::InternalFormatDepth24Stencil8, std::span<const std::byte>(), Data::Type::UInt24_8);
     m_depthTexture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST);
     m_depthTexture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
 
@@ -83,6 +84,9 @@ void GBufferRenderPass::Render()
 
     const Camera& camera = renderer.GetCurrentCamera();
     const auto& lights = renderer.GetLights();
+
+    // Group the drawcalls that can be merged, all of them are opaque
+    renderer.SortOpaqueDrawcallCollection(m_drawcallCollectionIndex);
     const auto& drawcallCollection = renderer.GetDrawcalls(m_drawcallCollectionIndex);
 
     renderer.GetDevice().Clear(true, Color(0.0f, 0.0f, 0.0f, 1.0f), true, 1.0f);
@@ -91,18 +95,23 @@ void GBufferRenderPass::Render()
     renderer.GetDevice().EnableFeature(GL_FRAMEBUFFER_SRGB);
 
     // for all drawcalls
-    for (const Renderer::DrawcallInfo& drawcallInfo : drawcallCollection)
+    for (unsigned int drawcallIndex = 0; drawcallIndex < drawcallCollection.size(); )
     {
+        const Renderer::DrawcallInfo& drawcallInfo = drawcallCollection[drawcallIndex];
+
         const Material& material = drawcallInfo.GetMaterial();
         assert(material.GetBlendEquationColor() == Material::BlendEquation::None);
         assert(material.GetBlendEquationAlpha() == Material::BlendEquation::None);
         assert(material.GetDepthWrite());
 
         // Prepare drawcall (similar to forward)
-        renderer.PrepareDrawcall(drawcallInfo);
+        unsigned int instanceCount = renderer.PrepareInstancedDrawcall(drawcallCollection.subspan(drawcallIndex));
 
         // Render drawcall
-        drawcallInfo.GetDrawcall().Draw();
+        renderer.DrawPreparedDrawcall();
+        renderer.FinishInstancedDrawcall();
+
+        drawcallIndex += instanceCount;
     }
 
     renderer.GetDevice().SetFeatureEnabled(GL_FRAMEBUFFER_SRGB, wasSRGB);
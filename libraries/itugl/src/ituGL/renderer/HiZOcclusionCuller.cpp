@@ -0,0 +1,155 @@
+#include <ituGL/renderer/HiZOcclusionCuller.h>
+
+#include <ituGL/renderer/DepthPyramid.h>
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/scene/Bounds.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <array>
+#include <cassert>
+#include <vector>
+
+static_assert(sizeof(HiZOcclusionCuller::Object) == 64, "Object must match the std430 layout of the shader");
+
+// Shader storage bindings, must match the compute shader
+static const GLuint s_objectsBinding = 0;
+static const GLuint s_commandsBinding = 1;
+static const GLuint s_drawCountsBinding = 2;
+static const GLuint s_visibilityBinding = 3;
+
+static const unsigned int s_passCount = 2;
+
+HiZOcclusionCuller::HiZOcclusionCuller(std::shared_ptr<ShaderProgram> cullProgram)
+    : m_cullProgram(std::move(cullProgram))
+    , m_objectCount(0)
+{
+    assert(m_cullProgram);
+    m_objectCountLocation = m_cullProgram->GetUniformLocation("ObjectCount");
+    m_passLocation = m_cullProgram->GetUniformLocation("Pass");
+    m_frustumPlanesLocation = m_cullProgram->GetUniformLocation("FrustumPlanes");
+    m_occlusionEnabledLocation = m_cullProgram->GetUniformLocation("OcclusionEnabled");
+    m_pyramidViewProjMatrixLocation = m_cullProgram->GetUniformLocation("PyramidViewProjMatrix");
+    m_depthPyramidLocation = m_cullProgram->GetUniformLocation("DepthPyramid");
+    m_pyramidSizeLocation = m_cullProgram->GetUniformLocation("PyramidSize");
+    m_pyramidLevelCountLocation = m_cullProgram->GetUniformLocation("PyramidLevelCount");
+
+    std::array<GLuint, s_passCount> drawCounts = {};
+    m_drawCountBuffer.Bind();
+    m_drawCountBuffer.AllocateData(Data::GetBytes(std::span<const GLuint>(drawCounts)), BufferObject::Usage::DynamicCopy);
+    ShaderStorageBufferObject::Unbind();
+}
+
+void HiZOcclusionCuller::SetObjects(std::span<const Object> objects)
+{
+    m_objectCount = static_cast<unsigned int>(objects.size());
+
+    m_objectBuffer.Bind();
+    m_objectBuffer.AllocateData(Data::GetBytes(objects), BufferObject::Usage::StaticDraw);
+
+    // Nothing was visible before
+    std::vector<GLuint> visibility(m_objectCount, 0);
+    m_visibilityBuffer.Bind();
+    m_visibilityBuffer.AllocateData(Data::GetBytes(std::span<const GLuint>(visibility)), BufferObject::Usage::DynamicCopy);
+    ShaderStorageBufferObject::Unbind();
+
+    // Room for all the objects in each pass. Zero instances, so unwritten slots draw nothing
+    std::vector<DrawIndirectBufferObject::Command> commands(s_passCount * m_objectCount, DrawIndirectBufferObject::Command{});
+    m_commandBuffer.Bind();
+    m_commandBuffer.AllocateData(commands, BufferObject::Usage::DynamicCopy);
+    DrawIndirectBufferObject::Unbind();
+}
+
+void HiZOcclusionCuller::Cull(Pass pass, const glm::mat4& viewProjMatrix, const DepthPyramid& depthPyramid)
+{
+    assert(IsSupported());
+    if (m_objectCount == 0)
+    {
+        return;
+    }
+
+    unsigned int passIndex = static_cast<unsigned int>(pass);
+
+    // Reset the count of the pass. Without the count in the draw, the old commands must be reset too
+    m_drawCountBuffer.Bind();
+    glClearBufferSubData(BufferObject::ShaderStorageBuffer, GL_R32UI, passIndex * sizeof(GLuint), sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    ShaderStorageBufferObject::Unbind();
+    if (!GLAD_GL_VERSION_4_6)
+    {
+        GLsizeiptr passSize = m_objectCount * sizeof(DrawIndirectBufferObject::Command);
+        m_commandBuffer.Bind();
+        glClearBufferSubData(BufferObject::DrawIndirectBuffer, GL_R32UI, passIndex * passSize, passSize, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        DrawIndirectBufferObject::Unbind();
+    }
+
+    m_cullProgram->Use();
+    m_cullProgram->SetUniform(m_objectCountLocation, m_objectCount);
+    m_cullProgram->SetUniform(m_passLocation, passIndex);
+
+    FrustumBounds frustum(viewProjMatrix);
+    std::array<glm::vec4, FrustumBounds::PlaneCount> planes;
+    for (unsigned int i = 0; i < FrustumBounds::PlaneCount; ++i)
+    {
+        planes[i] = frustum.GetPlane(i);
+    }
+    m_cullProgram->SetUniforms(m_frustumPlanesLocation, std::span<const glm::vec4>(planes));
+
+    // Before the first pyramid is built, only the frustum is tested
+    bool occlusionEnabled = depthPyramid.IsValid();
+    m_cullProgram->SetUniform(m_occlusionEnabledLocation, occlusionEnabled ? 1 : 0);
+    if (occlusionEnabled)
+    {
+        m_cullProgram->SetUniform(m_pyramidViewProjMatrixLocation, depthPyramid.GetViewProjMatrix());
+        m_cullProgram->SetTexture(m_depthPyramidLocation, 0, depthPyramid.GetTexture());
+        m_cullProgram->SetUniform(m_pyramidSizeLocation, depthPyramid.GetSize());
+        m_cullProgram->SetUniform(m_pyramidLevelCountLocation, depthPyramid.GetLevelCount());
+    }
+
+    m_objectBuffer.BindBase(s_objectsBinding);
+    m_commandBuffer.BindBase(BufferObject::ShaderStorageBuffer, s_commandsBinding);
+    m_drawCountBuffer.BindBase(s_drawCountsBinding);
+    m_visibilityBuffer.BindBase(s_visibilityBinding);
+
+    glDispatchCompute((m_objectCount + GroupSize - 1) / GroupSize, 1, 1);
+
+    // The commands and counts are read by the draws, the visibility by the next pass
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void HiZOcclusionCuller::Draw(Pass pass, GLenum primitive, GLenum indexType) const
+{
+    assert(VertexArrayObject::IsAnyBound());
+    if (m_objectCount == 0)
+    {
+        return;
+    }
+
+    unsigned int passIndex = static_cast<unsigned int>(pass);
+    const char* commandOffset = nullptr;
+    commandOffset += passIndex * m_objectCount * sizeof(DrawIndirectBufferObject::Command);
+
+    m_commandBuffer.Bind();
+    if (GLAD_GL_VERSION_4_6)
+    {
+        glBindBuffer(BufferObject::ParameterBuffer, m_drawCountBuffer.GetHandle());
+        glMultiDrawElementsIndirectCount(primitive, indexType, commandOffset, passIndex * sizeof(GLuint), m_objectCount, 0);
+        glBindBuffer(BufferObject::ParameterBuffer, 0);
+    }
+    else
+    {
+        glMultiDrawElementsIndirect(primitive, indexType, commandOffset, m_objectCount, 0);
+    }
+    DrawIndirectBufferObject::Unbind();
+}
+
+unsigned int HiZOcclusionCuller::ReadDrawCount(Pass pass) const
+{
+    GLuint drawCount = 0;
+    m_drawCountBuffer.Bind();
+    glGetBufferSubData(BufferObject::ShaderStorageBuffer, static_cast<unsigned int>(pass) * sizeof(GLuint), sizeof(GLuint), &drawCount);
+    ShaderStorageBufferObject::Unbind();
+    return drawCount;
+}
+
+bool HiZOcclusionCuller::IsSupported()
+{
+    return GLAD_GL_VERSION_4_3;
+}
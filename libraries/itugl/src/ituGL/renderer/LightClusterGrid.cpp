@@ -0,0 +1,326 @@
+#include <ituGL/renderer/LightClusterGrid.h>
+
+#include <ituGL/camera/Camera.h>
+#include <ituGL/core/ThreadPool.h>
+#include <ituGL/lighting/Light.h>
+#include <glm/common.hpp>
+#include <glm/exponential.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cassert>
+
+LightClusterGrid::LightClusterGrid(const glm::uvec3& gridSize, unsigned int maxClusterLightCount)
+    : m_gridSize(gridSize)
+    , m_maxClusterLightCount(maxClusterLightCount)
+    , m_maxDistance(0.0f)
+    , m_projMatrix(0.0f)
+    , m_nearDistance(0.0f)
+    , m_farDistance(0.0f)
+    , m_depthScaleBias(0.0f)
+    , m_depthPlane(0.0f)
+    , m_directionalLightCount(0)
+    , m_overflowCount(0)
+{
+    assert(gridSize.x > 0 && gridSize.y > 0 && gridSize.z > 0);
+    assert(maxClusterLightCount > 0);
+
+    unsigned int clusterCount = GetClusterCount();
+    m_clusterBounds.resize(2 * clusterCount);
+    m_clusterLights.resize(clusterCount * maxClusterLightCount);
+    m_clusterLightCounts.resize(clusterCount);
+    m_sliceOverflowCounts.resize(gridSize.z);
+    m_clusterRanges.resize(clusterCount);
+}
+
+void LightClusterGrid::SetMaxDistance(float distance)
+{
+    assert(distance >= 0.0f);
+    m_maxDistance = distance;
+}
+
+void LightClusterGrid::Build(const Camera& camera, std::span<const Light* const> lights, ThreadPool* threadPool)
+{
+    const glm::mat4& projMatrix = camera.GetProjectionMatrix();
+    const glm::mat4& viewMatrix = camera.GetViewMatrix();
+    assert(projMatrix[2][3] == -1.0f);
+
+    // Near and far planes, from the depth terms of the projection
+    float nearDistance = projMatrix[3][2] / (projMatrix[2][2] - 1.0f);
+    float farDistance = projMatrix[3][2] / (projMatrix[2][2] + 1.0f);
+    if (m_maxDistance > 0.0f)
+    {
+        farDistance = std::min(farDistance, m_maxDistance);
+    }
+    UpdateClusterBounds(projMatrix, nearDistance, farDistance);
+
+    // Distance along the view direction, the opposite of the view space Z
+    m_depthPlane = -glm::vec4(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]);
+
+    // Directional lights first, they are not clustered
+    m_lightData.clear();
+    m_localLights.clear();
+    for (const Light* light : lights)
+    {
+        if (light->GetType() == Light::Type::Directional)
+        {
+            AppendLightData(*light, m_lightData);
+        }
+    }
+    m_directionalLightCount = GetLightCount();
+
+    for (const Light* light : lights)
+    {
+        if (light->GetType() == Light::Type::Directional)
+        {
+            continue;
+        }
+
+        glm::vec4 sphere = GetBoundingSphere(*light);
+        LocalLight localLight;
+        localLight.center = viewMatrix * glm::vec4(glm::vec3(sphere), 1.0f);
+        localLight.radius = sphere.w;
+
+        // Skip the lights outside of the depth range
+        float minDistance = -localLight.center.z - localLight.radius;
+        float maxDistance = -localLight.center.z + localLight.radius;
+        if (maxDistance < m_nearDistance || minDistance > m_farDistance || localLight.radius <= 0.0f)
+        {
+            continue;
+        }
+        localLight.clusterMin.z = GetSlice(std::max(minDistance, m_nearDistance));
+        localLight.clusterMax.z = GetSlice(std::min(maxDistance, m_farDistance));
+
+        // Tiles covered by the projection of the bounding box of the sphere. If it crosses the near plane, all of them
+        glm::vec2 screenMin(-1.0f), screenMax(1.0f);
+        if (minDistance > m_nearDistance)
+        {
+            screenMin = glm::vec2(1.0f);
+            screenMax = glm::vec2(-1.0f);
+            for (unsigned int corner = 0; corner < 8; ++corner)
+            {
+                glm::vec3 offset((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+                glm::vec4 clipPosition = projMatrix * glm::vec4(localLight.center + localLight.radius * offset, 1.0f);
+                glm::vec2 screenPosition = glm::vec2(clipPosition) / clipPosition.w;
+                screenMin = glm::min(screenMin, screenPosition);
+                screenMax = glm::max(screenMax, screenPosition);
+            }
+            if (screenMax.x < -1.0f || screenMax.y < -1.0f || screenMin.x > 1.0f || screenMin.y > 1.0f)
+            {
+                continue;
+            }
+        }
+        glm::vec2 tileCount(m_gridSize.x, m_gridSize.y);
+        glm::vec2 tileMin = glm::clamp((screenMin * 0.5f + 0.5f) * tileCount, glm::vec2(0.0f), tileCount - 1.0f);
+        glm::vec2 tileMax = glm::clamp((screenMax * 0.5f + 0.5f) * tileCount, glm::vec2(0.0f), tileCount - 1.0f);
+        localLight.clusterMin.x = static_cast<unsigned int>(tileMin.x);
+        localLight.clusterMin.y = static_cast<unsigned int>(tileMin.y);
+        localLight.clusterMax.x = static_cast<unsigned int>(tileMax.x);
+        localLight.clusterMax.y = static_cast<unsigned int>(tileMax.y);
+
+        m_localLights.push_back(localLight);
+        AppendLightData(*light, m_lightData);
+    }
+
+    // Each slice only writes the lists of its own clusters
+    auto AssignSlices = [this](unsigned int begin, unsigned int end) { this->AssignSlices(begin, end); };
+    if (threadPool)
+    {
+        threadPool->ParallelFor(m_gridSize.z, 1, AssignSlices);
+    }
+    else
+    {
+        AssignSlices(0, m_gridSize.z);
+    }
+
+    // Compact the lists, in cluster order
+    m_lightIndices.clear();
+    m_overflowCount = 0;
+    unsigned int clusterCount = GetClusterCount();
+    for (unsigned int cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        unsigned int count = m_clusterLightCounts[cluster];
+        m_clusterRanges[cluster] = glm::uvec2(m_lightIndices.size(), count);
+        auto itFirst = m_clusterLights.begin() + cluster * m_maxClusterLightCount;
+        m_lightIndices.insert(m_lightIndices.end(), itFirst, itFirst + count);
+    }
+    for (unsigned int overflowCount : m_sliceOverflowCounts)
+    {
+        m_overflowCount += overflowCount;
+    }
+}
+
+void LightClusterGrid::Upload()
+{
+    // Never empty, so the textures are always complete
+    glm::vec4 emptyLight(0.0f);
+    unsigned int emptyIndex = 0;
+
+    m_lightTexture.Bind();
+    m_lightTexture.SetData(m_lightData.empty() ? std::span<const glm::vec4>(&emptyLight, 1) : std::span<const glm::vec4>(m_lightData), TextureObject::InternalFormatRGBA32F);
+    m_rangeTexture.Bind();
+    m_rangeTexture.SetData(std::span<const glm::uvec2>(m_clusterRanges), TextureObject::InternalFormatRG32UI);
+    m_indexTexture.Bind();
+    m_indexTexture.SetData(m_lightIndices.empty() ? std::span<const unsigned int>(&emptyIndex, 1) : std::span<const unsigned int>(m_lightIndices), TextureObject::InternalFormatR32UI);
+    TextureBufferObject::Unbind();
+}
+
+void LightClusterGrid::BindTextures(GLint firstTextureUnit) const
+{
+    TextureObject::SetActiveTexture(firstTextureUnit);
+    m_lightTexture.Bind();
+    TextureObject::SetActiveTexture(firstTextureUnit + 1);
+    m_rangeTexture.Bind();
+    TextureObject::SetActiveTexture(firstTextureUnit + 2);
+    m_indexTexture.Bind();
+}
+
+bool LightClusterGrid::SetUniforms(const ShaderProgram& shaderProgram, GLint firstTextureUnit, const glm::vec2& viewportSize) const
+{
+    ShaderProgram::Location lightsLocation = shaderProgram.GetUniformLocation("ClusterLights");
+    ShaderProgram::Location rangesLocation = shaderProgram.GetUniformLocation("ClusterRanges");
+    ShaderProgram::Location indicesLocation = shaderProgram.GetUniformLocation("ClusterLightIndices");
+    if (lightsLocation < 0 || rangesLocation < 0 || indicesLocation < 0)
+    {
+        return false;
+    }
+
+    shaderProgram.SetUniform(lightsLocation, firstTextureUnit);
+    shaderProgram.SetUniform(rangesLocation, firstTextureUnit + 1);
+    shaderProgram.SetUniform(indicesLocation, firstTextureUnit + 2);
+    shaderProgram.SetUniform(shaderProgram.GetUniformLocation("ClusterDirectionalLightCount"), m_directionalLightCount);
+    shaderProgram.SetUniform(shaderProgram.GetUniformLocation("ClusterGridSize"), m_gridSize);
+    shaderProgram.SetUniform(shaderProgram.GetUniformLocation("ClusterTileScale"), glm::vec2(m_gridSize.x, m_gridSize.y) / viewportSize);
+    shaderProgram.SetUniform(shaderProgram.GetUniformLocation("ClusterDepthScaleBias"), m_depthScaleBias);
+    shaderProgram.SetUniform(shaderProgram.GetUniformLocation("ClusterDepthPlane"), m_depthPlane);
+    return true;
+}
+
+void LightClusterGrid::AppendLightData(const Light& light, std::vector<glm::vec4>& lightData)
+{
+    // The type goes as a float: 0 directional, 1 point, 2 spot
+    lightData.emplace_back(light.GetPosition(), static_cast<float>(light.GetType()));
+    lightData.emplace_back(light.GetColor() * light.GetIntensity(), 0.0f);
+    lightData.emplace_back(light.GetDirection(), 0.0f);
+    lightData.push_back(light.GetAttenuation());
+}
+
+void LightClusterGrid::UpdateClusterBounds(const glm::mat4& projMatrix, float nearDistance, float farDistance)
+{
+    if (projMatrix == m_projMatrix && nearDistance == m_nearDistance && farDistance == m_farDistance)
+    {
+        return;
+    }
+    m_projMatrix = projMatrix;
+    m_nearDistance = nearDistance;
+    m_farDistance = farDistance;
+
+    // slice = log(distance / near) / log(far / near) * sliceCount
+    float logDepthRange = glm::log(farDistance / nearDistance);
+    m_depthScaleBias.x = m_gridSize.z / logDepthRange;
+    m_depthScaleBias.y = -m_gridSize.z * glm::log(nearDistance) / logDepthRange;
+
+    // A point at distance d with normalized device coordinates (u, v) is at ((u + P20) * d / P00, (v + P21) * d / P11, -d)
+    glm::vec2 scale(1.0f / projMatrix[0][0], 1.0f / projMatrix[1][1]);
+    glm::vec2 offset(projMatrix[2][0], projMatrix[2][1]);
+    glm::vec2 tileSize(2.0f / m_gridSize.x, 2.0f / m_gridSize.y);
+    for (unsigned int z = 0; z < m_gridSize.z; ++z)
+    {
+        float sliceNear = nearDistance * glm::pow(farDistance / nearDistance, static_cast<float>(z) / m_gridSize.z);
+        float sliceFar = nearDistance * glm::pow(farDistance / nearDistance, static_cast<float>(z + 1) / m_gridSize.z);
+        for (unsigned int y = 0; y < m_gridSize.y; ++y)
+        {
+            for (unsigned int x = 0; x < m_gridSize.x; ++x)
+            {
+                glm::vec2 screenMin = glm::vec2(x, y) * tileSize - 1.0f;
+                glm::vec2 screenMax = screenMin + tileSize;
+                glm::vec2 nearMin = (screenMin + offset) * scale * sliceNear, nearMax = (screenMax + offset) * scale * sliceNear;
+                glm::vec2 farMin = (screenMin + offset) * scale * sliceFar, farMax = (screenMax + offset) * scale * sliceFar;
+
+                unsigned int cluster = (z * m_gridSize.y + y) * m_gridSize.x + x;
+                m_clusterBounds[2 * cluster] = glm::vec3(glm::min(nearMin, farMin), -sliceFar);
+                m_clusterBounds[2 * cluster + 1] = glm::vec3(glm::max(nearMax, farMax), -sliceNear);
+            }
+        }
+    }
+}
+
+glm::vec4 LightClusterGrid::GetBoundingSphere(const Light& light)
+{
+    glm::vec4 attenuation = light.GetAttenuation();
+    glm::vec3 position = light.GetPosition();
+    float range = std::max(attenuation.x, attenuation.y);
+    if (light.GetType() != Light::Type::Spot)
+    {
+        return glm::vec4(position, range);
+    }
+
+    // Smallest sphere around the cone, with the falloff included in the angle
+    float angle = std::min(attenuation.z + attenuation.w, glm::pi<float>());
+    if (angle >= glm::half_pi<float>())
+    {
+        return glm::vec4(position, range);
+    }
+    glm::vec3 direction = light.GetDirection();
+    if (angle > glm::quarter_pi<float>())
+    {
+        // The sphere through the rim of the base, centered on it
+        return glm::vec4(position + direction * (range * glm::cos(angle)), range * glm::sin(angle));
+    }
+    // The sphere through the apex and the rim of the base
+    float radius = range / (2.0f * glm::cos(angle));
+    return glm::vec4(position + direction * radius, radius);
+}
+
+unsigned int LightClusterGrid::GetSlice(float distance) const
+{
+    float slice = glm::log(distance) * m_depthScaleBias.x + m_depthScaleBias.y;
+    return static_cast<unsigned int>(glm::clamp(slice, 0.0f, m_gridSize.z - 1.0f));
+}
+
+void LightClusterGrid::AssignSlices(unsigned int sliceBegin, unsigned int sliceEnd)
+{
+    for (unsigned int z = sliceBegin; z < sliceEnd; ++z)
+    {
+        unsigned int firstCluster = z * m_gridSize.x * m_gridSize.y;
+        std::fill_n(m_clusterLightCounts.begin() + firstCluster, m_gridSize.x * m_gridSize.y, 0);
+        m_sliceOverflowCounts[z] = 0;
+
+        for (unsigned int lightIndex = 0; lightIndex < m_localLights.size(); ++lightIndex)
+        {
+            const LocalLight& light = m_localLights[lightIndex];
+            if (z < light.clusterMin.z || z > light.clusterMax.z)
+            {
+                continue;
+            }
+
+            float radiusSquared = light.radius * light.radius;
+            for (unsigned int y = light.clusterMin.y; y <= light.clusterMax.y; ++y)
+            {
+                for (unsigned int x = light.clusterMin.x; x <= light.clusterMax.x; ++x)
+                {
+                    // Distance from the center of the sphere to the closest point of the cluster
+                    unsigned int cluster = firstCluster + y * m_gridSize.x + x;
+                    glm::vec3 closest = glm::clamp(light.center, m_clusterBounds[2 * cluster], m_clusterBounds[2 * cluster + 1]);
+                    glm::vec3 difference = closest - light.center;
+                    if (glm::dot(difference, difference) > radiusSquared)
+                    {
+                        continue;
+                    }
+
+                    unsigned int& count = m_clusterLightCounts[cluster];
+                    if (count < m_maxClusterLightCount)
+                    {
+                        m_clusterLights[cluster * m_maxClusterLightCount + count] = m_directionalLightCount + lightIndex;
+                        ++count;
+                    }
+                    else
+                    {
+                        ++m_sliceOverflowCounts[z];
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,281 @@
+#include <ituGL/renderer/OcclusionQueryCuller.h>
+
+#include <ituGL/core/DeviceGL.h>
+#include <ituGL/geometry/VertexFormat.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <glm/vec4.hpp>
+#include <array>
+#include <cassert>
+
+float OcclusionQueryCuller::Statistics::GetHitRate() const
+{
+    return readResults > 0 ? static_cast<float>(occludedResults) / readResults : 0.0f;
+}
+
+float OcclusionQueryCuller::Statistics::GetSkipRate() const
+{
+    unsigned int queryCount = issuedQueries + skippedQueries;
+    return queryCount > 0 ? static_cast<float>(skippedQueries) / queryCount : 0.0f;
+}
+
+OcclusionQueryCuller::Statistics& OcclusionQueryCuller::Statistics::operator += (const Statistics& other)
+{
+    issuedQueries += other.issuedQueries;
+    skippedQueries += other.skippedQueries;
+    readResults += other.readResults;
+    occludedResults += other.occludedResults;
+    conditionalDraws += other.conditionalDraws;
+    return *this;
+}
+
+OcclusionQueryCuller::OcclusionQueryCuller(std::shared_ptr<ShaderProgram> proxyProgram)
+    : m_proxyProgram(std::move(proxyProgram))
+    , m_boundsMinLocation(-1), m_boundsMaxLocation(-1), m_viewProjMatrixLocation(-1)
+    , m_proxyState(PipelineState::DefaultId)
+    , m_cullFaceEnabled(false)
+    , m_viewProjMatrix(1.0f)
+    , m_generation(0)
+    , m_stableQueryCount(2)
+    , m_stableQueryInterval(8)
+    , m_frameIndex(0)
+{
+    assert(m_proxyProgram);
+    m_boundsMinLocation = m_proxyProgram->GetUniformLocation("BoundsMin");
+    m_boundsMaxLocation = m_proxyProgram->GetUniformLocation("BoundsMax");
+    m_viewProjMatrixLocation = m_proxyProgram->GetUniformLocation("ViewProjMatrix");
+
+    PipelineState proxyState;
+    proxyState.depthFunction = GL_LEQUAL;
+    proxyState.depthWrite = false;
+    m_proxyState = PipelineState::Intern(proxyState);
+
+    InitializeProxyMesh();
+}
+
+OcclusionQueryCuller::~OcclusionQueryCuller()
+{
+    // Every query object is either free, pending or read
+    for (const PendingQuery& pendingQuery : m_pendingQueries)
+    {
+        m_freeQueries.push_back(pendingQuery.query);
+    }
+    m_freeQueries.insert(m_freeQueries.end(), m_readQueries.begin(), m_readQueries.end());
+    if (!m_freeQueries.empty())
+    {
+        glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()), m_freeQueries.data());
+    }
+}
+
+void OcclusionQueryCuller::SetObjectCount(unsigned int objectCount)
+{
+    // Pending queries still complete, but their results don't belong to the new objects
+    ++m_generation;
+    m_objects.assign(objectCount, ObjectState());
+}
+
+void OcclusionQueryCuller::SetStableQueryInterval(unsigned int frameCount)
+{
+    assert(frameCount > 0);
+    m_stableQueryInterval = frameCount;
+}
+
+void OcclusionQueryCuller::BeginFrame()
+{
+    ++m_frameIndex;
+
+    // Queries complete in the order they were issued, so stop at the first one that is not available
+    unsigned int readCount = 0;
+    for (const PendingQuery& pendingQuery : m_pendingQueries)
+    {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(pendingQuery.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        if (pendingQuery.generation == m_generation)
+        {
+            GLuint anySamplesPassed = GL_FALSE;
+            glGetQueryObjectuiv(pendingQuery.query, GL_QUERY_RESULT, &anySamplesPassed);
+
+            ObjectState& object = m_objects[pendingQuery.object];
+            object.visible = anySamplesPassed != GL_FALSE;
+            object.visibleCount = object.visible ? object.visibleCount + 1 : 0;
+
+            ++m_currentStatistics.readResults;
+            if (!object.visible)
+            {
+                ++m_currentStatistics.occludedResults;
+            }
+        }
+
+        // Not reused yet, it may be the condition of a draw this frame
+        m_readQueries.push_back(pendingQuery.query);
+        ++readCount;
+    }
+    m_pendingQueries.erase(m_pendingQueries.begin(), m_pendingQueries.begin() + readCount);
+
+    // The queries issued in the last frame become the conditions of this one
+    for (ObjectState& object : m_objects)
+    {
+        object.conditionQuery = object.issuedQuery;
+        object.issuedQuery = 0;
+    }
+}
+
+void OcclusionQueryCuller::EndFrame()
+{
+    m_freeQueries.insert(m_freeQueries.end(), m_readQueries.begin(), m_readQueries.end());
+    m_readQueries.clear();
+
+    m_frameStatistics = m_currentStatistics;
+    m_totalStatistics += m_currentStatistics;
+    m_currentStatistics = Statistics();
+}
+
+bool OcclusionQueryCuller::IsVisible(unsigned int object) const
+{
+    assert(object < m_objects.size());
+    return m_objects[object].visible;
+}
+
+void OcclusionQueryCuller::BeginConditionalRender(unsigned int object)
+{
+    assert(object < m_objects.size());
+    GLuint conditionQuery = m_objects[object].conditionQuery;
+    if (conditionQuery != 0)
+    {
+        glBeginConditionalRender(conditionQuery, GL_QUERY_NO_WAIT);
+        ++m_currentStatistics.conditionalDraws;
+    }
+}
+
+void OcclusionQueryCuller::EndConditionalRender(unsigned int object)
+{
+    assert(object < m_objects.size());
+    if (m_objects[object].conditionQuery != 0)
+    {
+        glEndConditionalRender();
+    }
+}
+
+void OcclusionQueryCuller::BeginProxies(const glm::mat4& viewProjMatrix)
+{
+    m_viewProjMatrix = viewProjMatrix;
+
+    DeviceGL& device = DeviceGL::GetInstance();
+    m_cullFaceEnabled = device.IsFeatureEnabled(GL_CULL_FACE);
+    // Back faces never pass where the front faces fail, drawing both avoids depending on the winding
+    device.DisableFeature(GL_CULL_FACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    PipelineState::Apply(m_proxyState, PipelineState::DepthGroup);
+
+    m_proxyProgram->Use();
+    m_proxyProgram->SetUniform(m_viewProjMatrixLocation, viewProjMatrix);
+}
+
+void OcclusionQueryCuller::DrawProxy(unsigned int object, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    assert(object < m_objects.size());
+    ObjectState& objectState = m_objects[object];
+    assert(objectState.issuedQuery == 0);
+
+    if (!NeedsQuery(object))
+    {
+        ++m_currentStatistics.skippedQueries;
+        return;
+    }
+
+    // If the proxy crosses the near plane, part of it is clipped and the query can miss a visible object.
+    // The camera is inside or very close, so it is visible anyway
+    for (unsigned int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec4 position((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+        glm::vec4 clipPosition = m_viewProjMatrix * position;
+        if (clipPosition.z < -clipPosition.w)
+        {
+            objectState.visible = true;
+            ++m_currentStatistics.skippedQueries;
+            return;
+        }
+    }
+
+    objectState.issuedQuery = AllocateQuery();
+    m_pendingQueries.push_back({ objectState.issuedQuery, object, m_generation });
+    ++m_currentStatistics.issuedQueries;
+
+    m_proxyProgram->SetUniform(m_boundsMinLocation, boundsMin);
+    m_proxyProgram->SetUniform(m_boundsMaxLocation, boundsMax);
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, objectState.issuedQuery);
+    m_proxyMesh.DrawSubmesh(0);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+void OcclusionQueryCuller::EndProxies()
+{
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    PipelineState::Apply(PipelineState::DefaultId, PipelineState::DepthGroup);
+    DeviceGL::GetInstance().SetFeatureEnabled(GL_CULL_FACE, m_cullFaceEnabled);
+}
+
+void OcclusionQueryCuller::ResetStatistics()
+{
+    m_currentStatistics = Statistics();
+    m_frameStatistics = Statistics();
+    m_totalStatistics = Statistics();
+}
+
+bool OcclusionQueryCuller::NeedsQuery(unsigned int object) const
+{
+    const ObjectState& objectState = m_objects[object];
+
+    // Hidden and recently visible objects are queried every frame
+    if (!objectState.visible || objectState.visibleCount < m_stableQueryCount)
+    {
+        return true;
+    }
+
+    // Stable objects once per interval, each one in a different frame
+    return (m_frameIndex + object) % m_stableQueryInterval == 0;
+}
+
+GLuint OcclusionQueryCuller::AllocateQuery()
+{
+    GLuint query = 0;
+    if (!m_freeQueries.empty())
+    {
+        query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+    else
+    {
+        glGenQueries(1, &query);
+    }
+    return query;
+}
+
+void OcclusionQueryCuller::InitializeProxyMesh()
+{
+    VertexFormat vertexFormat;
+    vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Position);
+
+    // Unit cube, scaled to the bounds in the vertex shader
+    std::array<glm::vec3, 8> vertices;
+    for (unsigned int corner = 0; corner < 8; ++corner)
+    {
+        vertices[corner] = glm::vec3((corner & 1) ? 1.0f : 0.0f, (corner & 2) ? 1.0f : 0.0f, (corner & 4) ? 1.0f : 0.0f);
+    }
+    std::array<unsigned short, 36> indices =
+    {
+        0, 2, 1,  1, 2, 3,      // -Z
+        4, 5, 6,  5, 7, 6,      // +Z
+        0, 1, 4,  1, 5, 4,      // -Y
+        2, 6, 3,  3, 6, 7,      // +Y
+        0, 4, 2,  2, 4, 6,      // -X
+        1, 3, 5,  3, 7, 5,      // +X
+    };
+    m_proxyMesh.AddSubmesh<glm::vec3, unsigned short, VertexFormat::LayoutIterator>(Drawcall::Primitive::Triangles,
+        std::span<const glm::vec3>(vertices), std::span<const unsigned short>(indices), vertexFormat.LayoutBegin(8, false), vertexFormat.LayoutEnd());
+}
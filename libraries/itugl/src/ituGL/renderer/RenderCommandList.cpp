@@ -0,0 +1,57 @@
+#include <ituGL/renderer/RenderCommandList.h>
+
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/geometry/Model.h>
+#include <type_traits>
+
+// Commands are copied around in bulk when sorting and merging, they must stay plain data
+static_assert(std::is_trivially_copyable_v<Renderer::DrawcallInfo>);
+
+RenderCommandList::RenderCommandList()
+{
+}
+
+void RenderCommandList::AddModel(const Model& model, const glm::mat4& worldMatrix)
+{
+    unsigned int worldMatrixIndex = static_cast<unsigned int>(m_worldMatrices.size());
+    m_worldMatrices.push_back(worldMatrix);
+
+    const Mesh& mesh = model.GetMesh();
+    for (unsigned int submeshIndex = 0; submeshIndex < mesh.GetSubmeshCount(); ++submeshIndex)
+    {
+        m_drawcalls.emplace_back(model.GetMaterial(submeshIndex), worldMatrixIndex,
+            mesh.GetSubmeshVertexArray(submeshIndex), mesh.GetSubmeshDrawcall(submeshIndex));
+    }
+}
+
+void RenderCommandList::AddDrawcall(const Material& material, const glm::mat4& worldMatrix, const VertexArrayObject& vao, const Drawcall& drawcall)
+{
+    unsigned int worldMatrixIndex = static_cast<unsigned int>(m_worldMatrices.size());
+    m_worldMatrices.push_back(worldMatrix);
+    m_drawcalls.emplace_back(material, worldMatrixIndex, vao, drawcall);
+}
+
+void RenderCommandList::Append(const RenderCommandList& other)
+{
+    unsigned int worldMatrixOffset = static_cast<unsigned int>(m_worldMatrices.size());
+    m_worldMatrices.insert(m_worldMatrices.end(), other.m_worldMatrices.begin(), other.m_worldMatrices.end());
+
+    m_drawcalls.reserve(m_drawcalls.size() + other.m_drawcalls.size());
+    for (Renderer::DrawcallInfo drawcallInfo : other.m_drawcalls)
+    {
+        drawcallInfo.m_worldMatrixIndex += worldMatrixOffset;
+        m_drawcalls.push_back(drawcallInfo);
+    }
+}
+
+void RenderCommandList::Reserve(std::size_t drawcallCount, std::size_t worldMatrixCount)
+{
+    m_drawcalls.reserve(drawcallCount);
+    m_worldMatrices.reserve(worldMatrixCount);
+}
+
+void RenderCommandList::Clear()
+{
+    m_drawcalls.clear();
+    m_worldMatrices.clear();
+}
@@ -9,13 +9,17 @@
 #include <ituGL/camera/Camera.h>
 #include <ituGL/texture/FramebufferObject.h>
 #include <ituGL/renderer/RenderPass.h>
+#include <ituGL/renderer/RenderCommandList.h>
+#include <ituGL/core/ThreadPool.h>
 #include <span>
 #include <algorithm>
 #include <cassert>
 
 Renderer::DrawcallInfo::DrawcallInfo(const Material& material, unsigned int worldMatrixIndex, const VertexArrayObject& vao, const Drawcall& drawcall)
-    : m_material(material), m_worldMatrixIndex(worldMatrixIndex), m_vao(vao), m_drawcall(drawcall)
+    : m_material(&material), m_shaderProgram(material.GetShaderProgramPointer())
+    , m_vao(&vao), m_drawcall(&drawcall), m_worldMatrixIndex(worldMatrixIndex)
 {
+    assert(m_shaderProgram);
 }
 
 Renderer::DrawcallCollection::DrawcallCollection(const DrawcallSupportedFunction& isSupported) : m_isSupported(isSupported)
@@ -40,6 +44,16 @@ void Renderer::DrawcallCollection::AddDrawcall(const DrawcallInfo& drawcallInfo)
     }
 }
 
+void Renderer::DrawcallCollection::AppendSupportedDrawcalls(std::span<const DrawcallInfo> drawcallInfos)
+{
+    m_drawcallInfos.insert(m_drawcallInfos.end(), drawcallInfos.begin(), drawcallInfos.end());
+}
+
+void Renderer::DrawcallCollection::Reserve(std::size_t count)
+{
+    m_drawcallInfos.reserve(count);
+}
+
 void Renderer::DrawcallCollection::Clear()
 {
     m_drawcallInfos.clear();
@@ -49,9 +63,19 @@ void Renderer::DrawcallCollection::Clear()
 Renderer::Renderer(DeviceGL& device)
     : m_device(device)
     , m_currentCamera(nullptr)
+    , m_currentMaterial(nullptr)
+    , m_currentMaterialOverride(Material::NoOverride)
+    , m_currentShaderProgram(nullptr)
+    , m_currentVAO(nullptr)
+    , m_currentWorldMatrixIndex(~0u)
     , m_defaultFramebuffer(FramebufferObject::GetDefault())
     , m_currentFramebuffer(m_defaultFramebuffer)
     , m_drawcallCollections(1)
+    , m_streamBuffer(BufferObject::ArrayBuffer, 4 * 1024 * 1024)
+    , m_instanceBuffer(m_streamBuffer)
+    , m_instanceAttributeLocation(-1)
+    , m_preparedDrawcall(nullptr)
+    , m_preparedInstanceCount(0)
 {
     InitializeFullscreenMesh();
 
@@ -106,12 +130,19 @@ void Renderer::Render()
 {
     assert(m_currentCamera);
 
+    m_streamBuffer.BeginFrame();
+
     for (auto& pass : m_passes)
     {
         SetCurrentFramebuffer(pass->GetTargetFramebuffer());
+
+        // Passes may change states outside of PrepareDrawcall, start each one from scratch
+        InvalidateDrawcallStates();
         pass->Render();
     }
 
+    m_streamBuffer.EndFrame();
+
     Reset();
 }
 
@@ -126,6 +157,8 @@ void Renderer::Reset()
     }
 
     m_currentCamera = nullptr;
+
+    InvalidateDrawcallStates();
 }
 
 int Renderer::AddRenderPass(std::unique_ptr<RenderPass> renderPass)
@@ -143,32 +176,46 @@ void Renderer::RegisterShaderProgram(std::shared_ptr<const ShaderProgram> shader
 {
     assert(shaderProgramPtr);
 
+    ShaderProgramFunctions& functions = m_shaderProgramFunctions[shaderProgramPtr.get()];
+    functions.shaderProgram = shaderProgramPtr;
+    functions.instanceWorldMatrixLocation = shaderProgramPtr->GetAttributeLocation("InstanceWorldMatrix");
+
     if (updateTransformFunction)
     {
-        m_updateTransformsFunctions[shaderProgramPtr] = updateTransformFunction;
+        functions.updateTransforms = updateTransformFunction;
     }
 
     if (updateLightsFunction)
     {
-        m_updateLightsFunctions[shaderProgramPtr] = updateLightsFunction;
+        functions.updateLights = updateLightsFunction;
     }
 }
 
-void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged) const
+void Renderer::UpdateTransforms(const ShaderProgram& shaderProgram, unsigned int worldMatrixIndex, bool cameraChanged) const
 {
     const glm::mat4& worldMatrix = m_worldMatrices[worldMatrixIndex];
-    UpdateTransforms(shaderProgramPtr, worldMatrix);
+    UpdateTransforms(shaderProgram, worldMatrix, cameraChanged);
 }
 
-void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged) const
+void Renderer::UpdateTransforms(const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, bool cameraChanged) const
 {
-    const auto& itFind = m_updateTransformsFunctions.find(shaderProgramPtr);
-    if (itFind != m_updateTransformsFunctions.end())
+    const auto& itFind = m_shaderProgramFunctions.find(&shaderProgram);
+    if (itFind != m_shaderProgramFunctions.end() && itFind->second.updateTransforms)
     {
-        itFind->second(*shaderProgramPtr, worldMatrix, *m_currentCamera, cameraChanged);
+        itFind->second.updateTransforms(shaderProgram, worldMatrix, *m_currentCamera, cameraChanged);
     }
 }
 
+void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged) const
+{
+    UpdateTransforms(*shaderProgramPtr, worldMatrixIndex, cameraChanged);
+}
+
+void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged) const
+{
+    UpdateTransforms(*shaderProgramPtr, worldMatrix, cameraChanged);
+}
+
 Renderer::UpdateLightsFunction Renderer::GetDefaultUpdateLightsFunction(const ShaderProgram& shaderProgram)
 {
     // Get lighting related uniform locations
@@ -205,16 +252,21 @@ Renderer::UpdateLightsFunction Renderer::GetDefaultUpdateLightsFunction(const Sh
     };
 }
 
-bool Renderer::UpdateLights(std::shared_ptr<const ShaderProgram> shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const
+bool Renderer::UpdateLights(const ShaderProgram& shaderProgram, std::span<const Light* const> lights, unsigned int& lightIndex) const
 {
-    const auto& itFind = m_updateLightsFunctions.find(shaderProgramPtr);
-    if (itFind != m_updateLightsFunctions.end())
+    const auto& itFind = m_shaderProgramFunctions.find(&shaderProgram);
+    if (itFind != m_shaderProgramFunctions.end() && itFind->second.updateLights)
     {
-        return itFind->second(*shaderProgramPtr, lights, lightIndex);
+        return itFind->second.updateLights(shaderProgram, lights, lightIndex);
     }
     return false;
 }
 
+bool Renderer::UpdateLights(std::shared_ptr<const ShaderProgram> shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const
+{
+    return UpdateLights(*shaderProgramPtr, lights, lightIndex);
+}
+
 std::span<const Light* const> Renderer::GetLights() const
 {
     return m_lights;
@@ -248,6 +300,107 @@ void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix)
     }
 }
 
+void Renderer::SubmitCommandLists(std::span<const RenderCommandList> commandLists, ThreadPool* threadPool)
+{
+    if (threadPool && commandLists.size() > 1)
+    {
+        // Where the world matrices of each list go
+        unsigned int listCount = static_cast<unsigned int>(commandLists.size());
+        std::vector<unsigned int> worldMatrixOffsets(listCount);
+        std::size_t worldMatrixCount = m_worldMatrices.size();
+        for (unsigned int listIndex = 0; listIndex < listCount; ++listIndex)
+        {
+            worldMatrixOffsets[listIndex] = static_cast<unsigned int>(worldMatrixCount);
+            worldMatrixCount += commandLists[listIndex].GetWorldMatrices().size();
+        }
+        m_worldMatrices.resize(worldMatrixCount);
+
+        // One task per list: copy its matrices and filter its drawcalls for every collection
+        unsigned int collectionCount = static_cast<unsigned int>(m_drawcallCollections.size());
+        m_filteredDrawcalls.resize(static_cast<std::size_t>(collectionCount) * listCount);
+        threadPool->ParallelFor(listCount, 1, [&](unsigned int begin, unsigned int end)
+            {
+                for (unsigned int listIndex = begin; listIndex < end; ++listIndex)
+                {
+                    const RenderCommandList& commandList = commandLists[listIndex];
+                    unsigned int worldMatrixOffset = worldMatrixOffsets[listIndex];
+                    std::span<const glm::mat4> worldMatrices = commandList.GetWorldMatrices();
+                    std::copy(worldMatrices.begin(), worldMatrices.end(), m_worldMatrices.begin() + worldMatrixOffset);
+
+                    for (unsigned int collectionIndex = 0; collectionIndex < collectionCount; ++collectionIndex)
+                    {
+                        const DrawcallCollection& collection = m_drawcallCollections[collectionIndex];
+                        std::vector<DrawcallInfo>& filteredDrawcalls = m_filteredDrawcalls[collectionIndex * listCount + listIndex];
+                        filteredDrawcalls.clear();
+                        for (DrawcallInfo drawcallInfo : commandList.GetDrawcalls())
+                        {
+                            drawcallInfo.m_worldMatrixIndex += worldMatrixOffset;
+                            if (collection.IsSupported(drawcallInfo))
+                            {
+                                filteredDrawcalls.push_back(drawcallInfo);
+                            }
+                        }
+                    }
+                }
+            });
+
+        // One task per collection: concatenate the filtered drawcalls, keeping the order of the lists
+        threadPool->ParallelFor(collectionCount, 1, [&](unsigned int begin, unsigned int end)
+            {
+                for (unsigned int collectionIndex = begin; collectionIndex < end; ++collectionIndex)
+                {
+                    DrawcallCollection& collection = m_drawcallCollections[collectionIndex];
+                    std::size_t drawcallCount = collection.GetDrawcalls().size();
+                    for (unsigned int listIndex = 0; listIndex < listCount; ++listIndex)
+                    {
+                        drawcallCount += m_filteredDrawcalls[collectionIndex * listCount + listIndex].size();
+                    }
+                    collection.Reserve(drawcallCount);
+                    for (unsigned int listIndex = 0; listIndex < listCount; ++listIndex)
+                    {
+                        collection.AppendSupportedDrawcalls(m_filteredDrawcalls[collectionIndex * listCount + listIndex]);
+                    }
+                }
+            });
+        return;
+    }
+
+    // Reserve once for all the lists, so merging does not reallocate
+    std::size_t drawcallCount = 0, worldMatrixCount = m_worldMatrices.size();
+    for (const RenderCommandList& commandList : commandLists)
+    {
+        drawcallCount += commandList.GetDrawcalls().size();
+        worldMatrixCount += commandList.GetWorldMatrices().size();
+    }
+    m_worldMatrices.reserve(worldMatrixCount);
+    for (DrawcallCollection& collection : m_drawcallCollections)
+    {
+        collection.Reserve(collection.GetDrawcalls().size() + drawcallCount);
+    }
+
+    for (const RenderCommandList& commandList : commandLists)
+    {
+        SubmitCommandList(commandList);
+    }
+}
+
+void Renderer::SubmitCommandList(const RenderCommandList& commandList)
+{
+    unsigned int worldMatrixOffset = static_cast<unsigned int>(m_worldMatrices.size());
+    std::span<const glm::mat4> worldMatrices = commandList.GetWorldMatrices();
+    m_worldMatrices.insert(m_worldMatrices.end(), worldMatrices.begin(), worldMatrices.end());
+
+    for (DrawcallInfo drawcallInfo : commandList.GetDrawcalls())
+    {
+        drawcallInfo.m_worldMatrixIndex += worldMatrixOffset;
+
+        for (DrawcallCollection& collection : m_drawcallCollections)
+        {
+            collection.AddDrawcall(drawcallInfo);
+        }
+    }
+}
+
 unsigned int Renderer::AddDrawcallCollection(const DrawcallSupportedFunction& drawcallSupportedFunction)
 {
     unsigned int index = static_cast<unsigned int>(m_drawcallCollections.size());
@@ -283,21 +436,188 @@ bool Renderer::IsFrontToBack(const DrawcallInfo& a, const DrawcallInfo& b) const
     return IsBackToFront(b, a);
 }
 
-void Renderer::PrepareDrawcall(const DrawcallInfo& drawcallInfo, Material::OverrideFlags materialOverride)
+bool Renderer::IsInstancingOrder(const DrawcallInfo& a, const DrawcallInfo& b) const
 {
-    std::shared_ptr<const ShaderProgram> shaderProgram = drawcallInfo.GetMaterial().GetShaderProgram();
+    // Pipeline state first, so materials with the same render states don't change them between each other
+    PipelineState::Id aPipelineStateId = a.m_material->GetPipelineStateId();
+    PipelineState::Id bPipelineStateId = b.m_material->GetPipelineStateId();
+    if (aPipelineStateId != bPipelineStateId)
+        return aPipelineStateId < bPipelineStateId;
+    if (a.m_material != b.m_material)
+        return a.m_material < b.m_material;
+    if (a.m_vao != b.m_vao)
+        return a.m_vao < b.m_vao;
+    return a.m_drawcall < b.m_drawcall;
+}
 
-    // TODO: Room for optimization here, caching current material, current worldMatrixIndex and current VAO
+bool Renderer::SortOpaqueDrawcallCollection(unsigned int index)
+{
+    auto drawcalls = m_drawcallCollections[index].GetDrawcalls();
 
-    // Setup material
-    drawcallInfo.GetMaterial().Use(materialOverride);
+    bool opaque = std::all_of(drawcalls.begin(), drawcalls.end(), [](const DrawcallInfo& drawcallInfo)
+        {
+            const Material& material = drawcallInfo.GetMaterial();
+            return material.GetBlendEquationColor() == Material::BlendEquation::None
+                && material.GetBlendEquationAlpha() == Material::BlendEquation::None;
+        });
+
+    if (opaque)
+    {
+        std::sort(drawcalls.begin(), drawcalls.end(), [this](const DrawcallInfo& a, const DrawcallInfo& b) { return IsInstancingOrder(a, b); });
+    }
+    return opaque;
+}
+
+void Renderer::PrepareDrawcall(const DrawcallInfo& drawcallInfo, Material::OverrideFlags materialOverride)
+{
+    const Material* material = drawcallInfo.m_material;
+    const ShaderProgram* shaderProgram = drawcallInfo.m_shaderProgram;
+
+    // Setup material, only if it changed. Using a material can overwrite the uniforms of its program,
+    // so transforms must be updated again too
+    bool materialChanged = material != m_currentMaterial || materialOverride != m_currentMaterialOverride;
+    if (materialChanged)
+    {
+        material->Use(materialOverride);
+        m_currentMaterial = material;
+        m_currentMaterialOverride = materialOverride;
+    }
 
     // Setup world matrix
-    // Setup camera
-    UpdateTransforms(shaderProgram, drawcallInfo.GetWorldMatrixIndex());
+    // Setup camera, only the first time the program is used in a pass
+    if (materialChanged || drawcallInfo.m_worldMatrixIndex != m_currentWorldMatrixIndex)
+    {
+        bool cameraChanged = materialChanged || shaderProgram != m_currentShaderProgram;
+        UpdateTransforms(*shaderProgram, drawcallInfo.m_worldMatrixIndex, cameraChanged);
+        m_currentShaderProgram = shaderProgram;
+        m_currentWorldMatrixIndex = drawcallInfo.m_worldMatrixIndex;
+    }
 
     // Setup VAO
-    drawcallInfo.GetVAO().Bind();
+    if (drawcallInfo.m_vao != m_currentVAO)
+    {
+        drawcallInfo.m_vao->Bind();
+        m_currentVAO = drawcallInfo.m_vao;
+    }
+}
+
+unsigned int Renderer::PrepareInstancedDrawcall(std::span<const DrawcallInfo> drawcallInfos, Material::OverrideFlags materialOverride)
+{
+    assert(!drawcallInfos.empty());
+    const DrawcallInfo& first = drawcallInfos[0];
+
+    m_preparedDrawcall = first.m_drawcall;
+    m_multiDrawRuns.clear();
+
+    const auto& itFind = m_shaderProgramFunctions.find(first.m_shaderProgram);
+    if (itFind == m_shaderProgramFunctions.end() || itFind->second.instanceWorldMatrixLocation < 0)
+    {
+        // Not supported, draw a single instance
+        PrepareDrawcall(first, materialOverride);
+        m_preparedInstanceCount = 1;
+        return 1;
+    }
+
+    // Merge the drawcalls that only differ in world matrix, or in the part of the VAO buffers they draw.
+    // Consecutive instances of the same drawcall are a run, and each run is a command of the multi-draw call
+    m_instanceWorldMatrices.clear();
+    MultiDrawRun run = { first.m_drawcall, 0, 0 };
+    for (const DrawcallInfo& drawcallInfo : drawcallInfos)
+    {
+        if (drawcallInfo.m_material != first.m_material || drawcallInfo.m_vao != first.m_vao)
+        {
+            break;
+        }
+        if (drawcallInfo.m_drawcall != run.drawcall)
+        {
+            if (!first.m_drawcall->IsMultiDrawCompatible(*drawcallInfo.m_drawcall))
+            {
+                break;
+            }
+            m_multiDrawRuns.push_back(run);
+            run = { drawcallInfo.m_drawcall, static_cast<unsigned int>(m_instanceWorldMatrices.size()), 0 };
+        }
+        m_instanceWorldMatrices.push_back(m_worldMatrices[drawcallInfo.m_worldMatrixIndex]);
+        run.instanceCount++;
+    }
+
+    // With a single run, it is a regular instanced drawcall
+    if (!m_multiDrawRuns.empty())
+    {
+        m_multiDrawRuns.push_back(run);
+
+        if (GLAD_GL_VERSION_4_3)
+        {
+            m_multiDrawCommands.clear();
+            for (const MultiDrawRun& multiDrawRun : m_multiDrawRuns)
+            {
+                m_multiDrawCommands.push_back(multiDrawRun.drawcall->GetIndirectCommand(multiDrawRun.instanceCount, multiDrawRun.firstInstance));
+            }
+            m_multiDrawBuffer.Bind();
+            m_multiDrawBuffer.AllocateData(std::span<const DrawIndirectBufferObject::Command>(m_multiDrawCommands));
+            DrawIndirectBufferObject::Unbind();
+        }
+    }
+
+    // Material, camera and VAO states are the same as a regular drawcall
+    PrepareDrawcall(first, materialOverride);
+
+    // The world matrices come from the instance buffer instead
+    m_instanceBuffer.SetWorldMatrices(m_instanceWorldMatrices);
+    m_instanceBuffer.SetAttributes(itFind->second.instanceWorldMatrixLocation);
+    m_instanceAttributeLocation = itFind->second.instanceWorldMatrixLocation;
+
+    m_preparedInstanceCount = static_cast<unsigned int>(m_instanceWorldMatrices.size());
+    return m_preparedInstanceCount;
+}
+
+void Renderer::DrawPreparedDrawcall() const
+{
+    assert(m_preparedDrawcall);
+
+    if (m_multiDrawRuns.empty())
+    {
+        m_preparedDrawcall->DrawInstanced(m_preparedInstanceCount);
+    }
+    else if (GLAD_GL_VERSION_4_3)
+    {
+        // All the runs in one call. The base instance of each command selects its world matrices
+        GLenum primitive = static_cast<GLenum>(m_preparedDrawcall->GetPrimitive());
+        GLenum elementType = static_cast<GLenum>(m_preparedDrawcall->GetElementType());
+        m_multiDrawBuffer.Bind();
+        glMultiDrawElementsIndirect(primitive, elementType, nullptr, static_cast<GLsizei>(m_multiDrawRuns.size()), 0);
+        DrawIndirectBufferObject::Unbind();
+    }
+    else
+    {
+        // Without base instances in the drawcalls, point the instance attribute to the matrices of each run
+        for (const MultiDrawRun& run : m_multiDrawRuns)
+        {
+            m_instanceBuffer.SetAttributes(m_instanceAttributeLocation, run.firstInstance);
+            run.drawcall->DrawInstanced(run.instanceCount);
+        }
+    }
+}
+
+void Renderer::FinishInstancedDrawcall()
+{
+    // The VAO of the drawcall is still bound
+    if (m_instanceAttributeLocation >= 0)
+    {
+        InstanceBuffer::ResetAttributes(m_instanceAttributeLocation);
+        m_instanceAttributeLocation = -1;
+    }
+}
+
+void Renderer::InvalidateDrawcallStates()
+{
+    m_currentMaterial = nullptr;
+    m_currentMaterialOverride = Material::NoOverride;
+    m_currentShaderProgram = nullptr;
+    m_currentVAO = nullptr;
+    m_currentWorldMatrixIndex = ~0u;
+
+    PipelineState::Invalidate();
 }
 
 void Renderer::SetLightingRenderStates(bool firstPass)
@@ -305,9 +625,15 @@ void Renderer::SetLightingRenderStates(bool firstPass)
     // Set the render states for the first and additional lights
     if (!firstPass)
     {
+        // Additive lights change the material states, the next drawcall must set them again
+        m_currentMaterial = nullptr;
+
         m_device.SetFeatureEnabled(GL_BLEND, true);
         glDepthFunc(firstPass ? GL_LESS : GL_EQUAL);
         glBlendFunc(GL_ONE, GL_ONE);
+
+        // Set behind the back of the pipeline states
+        PipelineState::Invalidate();
     }
 }
 
@@ -4,6 +4,7 @@
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/camera/Camera.h>
 #include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/shader/PipelineState.h>
 #include <ituGL/texture/TextureCubemapObject.h>
 
 SkyboxRenderPass::SkyboxRenderPass(std::shared_ptr<TextureCubemapObject> texture)
@@ -50,6 +51,7 @@ void SkyboxRenderPass::Render()
     const Mesh& fullscreenMesh = renderer.GetFullscreenMesh();
     fullscreenMesh.DrawSubmesh(0);
     
-    // Restore default value
+    // Restore default value, and let the pipeline states know it was changed
     glDepthFunc(GL_LESS);
+    PipelineState::Invalidate();
 }
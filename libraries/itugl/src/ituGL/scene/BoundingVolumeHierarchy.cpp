@@ -0,0 +1,388 @@
+#include <ituGL/scene/BoundingVolumeHierarchy.h>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    float GetSurfaceArea(const glm::vec3& min, const glm::vec3& max)
+    {
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    bool Contains(const glm::vec3& outerMin, const glm::vec3& outerMax, const glm::vec3& innerMin, const glm::vec3& innerMax)
+    {
+        return glm::all(glm::lessThanEqual(outerMin, innerMin)) && glm::all(glm::lessThanEqual(innerMax, outerMax));
+    }
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+    : m_root(NullProxy)
+    , m_freeList(NullProxy)
+    , m_proxyCount(0)
+    , m_relativeMargin(0.1f)
+    , m_minimumMargin(0.05f)
+{
+}
+
+int BoundingVolumeHierarchy::AddProxy(const AabbBounds& bounds, SceneNode* node)
+{
+    int proxyId = AllocateNode();
+    TreeNode& treeNode = m_nodes[proxyId];
+    SetFatBounds(treeNode, bounds);
+    treeNode.node = node;
+    treeNode.height = 0;
+
+    InsertLeaf(proxyId);
+    ++m_proxyCount;
+    return proxyId;
+}
+
+void BoundingVolumeHierarchy::RemoveProxy(int proxyId)
+{
+    assert(proxyId >= 0 && proxyId < static_cast<int>(m_nodes.size()));
+    assert(m_nodes[proxyId].IsLeaf());
+
+    RemoveLeaf(proxyId);
+    FreeNode(proxyId);
+    --m_proxyCount;
+}
+
+bool BoundingVolumeHierarchy::MoveProxy(int proxyId, const AabbBounds& bounds)
+{
+    assert(proxyId >= 0 && proxyId < static_cast<int>(m_nodes.size()));
+    assert(m_nodes[proxyId].IsLeaf());
+
+    // Still inside the fat bounds, nothing to do
+    TreeNode& treeNode = m_nodes[proxyId];
+    if (Contains(treeNode.min, treeNode.max, bounds.GetMin(), bounds.GetMax()))
+    {
+        return false;
+    }
+
+    RemoveLeaf(proxyId);
+    SetFatBounds(m_nodes[proxyId], bounds);
+    InsertLeaf(proxyId);
+    return true;
+}
+
+AabbBounds BoundingVolumeHierarchy::GetProxyBounds(int proxyId) const
+{
+    const TreeNode& treeNode = m_nodes[proxyId];
+    return AabbBounds(0.5f * (treeNode.min + treeNode.max), 0.5f * (treeNode.max - treeNode.min));
+}
+
+int BoundingVolumeHierarchy::GetHeight() const
+{
+    return m_root != NullProxy ? m_nodes[m_root].height + 1 : 0;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_nodes.clear();
+    m_root = NullProxy;
+    m_freeList = NullProxy;
+    m_proxyCount = 0;
+}
+
+void BoundingVolumeHierarchy::Query(const FrustumBounds& frustum, std::vector<SceneNode*>& results) const
+{
+    Query([&](const glm::vec3& min, const glm::vec3& max)
+        {
+            return Bounds::Intersects(frustum, AabbBounds(0.5f * (min + max), 0.5f * (max - min)));
+        }, results);
+}
+
+void BoundingVolumeHierarchy::Query(const SphereBounds& sphere, std::vector<SceneNode*>& results) const
+{
+    Query([&](const glm::vec3& min, const glm::vec3& max)
+        {
+            glm::vec3 closestPoint = glm::clamp(sphere.GetCenter(), min, max);
+            glm::vec3 offset = closestPoint - sphere.GetCenter();
+            return glm::dot(offset, offset) <= sphere.GetRadius() * sphere.GetRadius();
+        }, results);
+}
+
+void BoundingVolumeHierarchy::Query(const AabbBounds& aabb, std::vector<SceneNode*>& results) const
+{
+    glm::vec3 queryMin = aabb.GetMin();
+    glm::vec3 queryMax = aabb.GetMax();
+    Query([&](const glm::vec3& min, const glm::vec3& max)
+        {
+            return glm::all(glm::lessThanEqual(min, queryMax)) && glm::all(glm::lessThanEqual(queryMin, max));
+        }, results);
+}
+
+void BoundingVolumeHierarchy::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<SceneNode*>& results) const
+{
+    // Slab test. Division by zero gives infinities, which the min/max below handle
+    glm::vec3 inverseDirection = 1.0f / direction;
+    Query([&](const glm::vec3& min, const glm::vec3& max)
+        {
+            glm::vec3 t1 = (min - origin) * inverseDirection;
+            glm::vec3 t2 = (max - origin) * inverseDirection;
+            glm::vec3 tNear = glm::min(t1, t2);
+            glm::vec3 tFar = glm::max(t1, t2);
+            float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+            return enter <= exit;
+        }, results);
+}
+
+template<typename TTest>
+void BoundingVolumeHierarchy::Query(const TTest& test, std::vector<SceneNode*>& results) const
+{
+    if (m_root == NullProxy)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+    while (!stack.empty())
+    {
+        const TreeNode& treeNode = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (test(treeNode.min, treeNode.max))
+        {
+            if (treeNode.IsLeaf())
+            {
+                results.push_back(treeNode.node);
+            }
+            else
+            {
+                stack.push_back(treeNode.child1);
+                stack.push_back(treeNode.child2);
+            }
+        }
+    }
+}
+
+int BoundingVolumeHierarchy::AllocateNode()
+{
+    int nodeIndex;
+    if (m_freeList != NullProxy)
+    {
+        nodeIndex = m_freeList;
+        m_freeList = m_nodes[nodeIndex].parent;
+    }
+    else
+    {
+        nodeIndex = static_cast<int>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    TreeNode& treeNode = m_nodes[nodeIndex];
+    treeNode.parent = NullProxy;
+    treeNode.child1 = NullProxy;
+    treeNode.child2 = NullProxy;
+    treeNode.height = 0;
+    treeNode.node = nullptr;
+    return nodeIndex;
+}
+
+void BoundingVolumeHierarchy::FreeNode(int nodeIndex)
+{
+    TreeNode& treeNode = m_nodes[nodeIndex];
+    treeNode.parent = m_freeList;
+    treeNode.height = -1;
+    treeNode.node = nullptr;
+    m_freeList = nodeIndex;
+}
+
+void BoundingVolumeHierarchy::InsertLeaf(int leaf)
+{
+    if (m_root == NullProxy)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NullProxy;
+        return;
+    }
+
+    // Find the best sibling, descending where the increase in surface area is smaller
+    glm::vec3 leafMin = m_nodes[leaf].min;
+    glm::vec3 leafMax = m_nodes[leaf].max;
+    int sibling = m_root;
+    while (!m_nodes[sibling].IsLeaf())
+    {
+        const TreeNode& treeNode = m_nodes[sibling];
+        float area = GetSurfaceArea(treeNode.min, treeNode.max);
+        float combinedArea = GetSurfaceArea(glm::min(treeNode.min, leafMin), glm::max(treeNode.max, leafMax));
+
+        // Cost of making a new parent for this node and the leaf, and the cost pushed down to the children
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCosts[2];
+        int children[2] = { treeNode.child1, treeNode.child2 };
+        for (int i = 0; i < 2; ++i)
+        {
+            const TreeNode& child = m_nodes[children[i]];
+            float childArea = GetSurfaceArea(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+            if (!child.IsLeaf())
+            {
+                childArea -= GetSurfaceArea(child.min, child.max);
+            }
+            childCosts[i] = childArea + inheritanceCost;
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+        {
+            break;
+        }
+        sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+
+    // Create a new parent for the sibling and the leaf
+    int oldParent = m_nodes[sibling].parent;
+    int newParent = AllocateNode();
+    TreeNode& parentNode = m_nodes[newParent];
+    parentNode.parent = oldParent;
+    parentNode.min = glm::min(m_nodes[sibling].min, leafMin);
+    parentNode.max = glm::max(m_nodes[sibling].max, leafMax);
+    parentNode.height = m_nodes[sibling].height + 1;
+    parentNode.child1 = sibling;
+    parentNode.child2 = leaf;
+
+    if (oldParent != NullProxy)
+    {
+        TreeNode& oldParentNode = m_nodes[oldParent];
+        (oldParentNode.child1 == sibling ? oldParentNode.child1 : oldParentNode.child2) = newParent;
+    }
+    else
+    {
+        m_root = newParent;
+    }
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    Refit(m_nodes[leaf].parent);
+}
+
+void BoundingVolumeHierarchy::RemoveLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NullProxy;
+        return;
+    }
+
+    // Replace the parent with the sibling
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != NullProxy)
+    {
+        TreeNode& grandParentNode = m_nodes[grandParent];
+        (grandParentNode.child1 == parent ? grandParentNode.child1 : grandParentNode.child2) = sibling;
+        m_nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+        Refit(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NullProxy;
+        FreeNode(parent);
+    }
+}
+
+void BoundingVolumeHierarchy::Refit(int nodeIndex)
+{
+    while (nodeIndex != NullProxy)
+    {
+        nodeIndex = Balance(nodeIndex);
+
+        TreeNode& treeNode = m_nodes[nodeIndex];
+        const TreeNode& child1 = m_nodes[treeNode.child1];
+        const TreeNode& child2 = m_nodes[treeNode.child2];
+        treeNode.min = glm::min(child1.min, child2.min);
+        treeNode.max = glm::max(child1.max, child2.max);
+        treeNode.height = 1 + std::max(child1.height, child2.height);
+
+        nodeIndex = treeNode.parent;
+    }
+}
+
+int BoundingVolumeHierarchy::Balance(int indexA)
+{
+    // Rotate the taller grandchild of A up when the children of A differ in height by more than one
+    TreeNode& a = m_nodes[indexA];
+    if (a.IsLeaf() || a.height < 2)
+    {
+        return indexA;
+    }
+
+    int indexB = a.child1;
+    int indexC = a.child2;
+    int balance = m_nodes[indexC].height - m_nodes[indexB].height;
+    if (balance >= -1 && balance <= 1)
+    {
+        return indexA;
+    }
+
+    // Promote the taller child (C) to replace A
+    if (balance < 0)
+    {
+        std::swap(indexB, indexC);
+    }
+    TreeNode& b = m_nodes[indexB];
+    TreeNode& c = m_nodes[indexC];
+    int indexF = c.child1;
+    int indexG = c.child2;
+    TreeNode& f = m_nodes[indexF];
+    TreeNode& g = m_nodes[indexG];
+
+    c.child1 = indexA;
+    c.parent = a.parent;
+    a.parent = indexC;
+    if (c.parent != NullProxy)
+    {
+        TreeNode& parentNode = m_nodes[c.parent];
+        (parentNode.child1 == indexA ? parentNode.child1 : parentNode.child2) = indexC;
+    }
+    else
+    {
+        m_root = indexC;
+    }
+
+    // Keep the taller grandchild (F) under C, and give the other one to A
+    int indexKept = f.height >= g.height ? indexF : indexG;
+    int indexMoved = f.height >= g.height ? indexG : indexF;
+    TreeNode& kept = m_nodes[indexKept];
+    TreeNode& moved = m_nodes[indexMoved];
+
+    c.child2 = indexKept;
+    if (a.child1 == indexC)
+    {
+        a.child1 = indexMoved;
+    }
+    else
+    {
+        a.child2 = indexMoved;
+    }
+    moved.parent = indexA;
+
+    a.min = glm::min(b.min, moved.min);
+    a.max = glm::max(b.max, moved.max);
+    a.height = 1 + std::max(b.height, moved.height);
+
+    c.min = glm::min(a.min, kept.min);
+    c.max = glm::max(a.max, kept.max);
+    c.height = 1 + std::max(a.height, kept.height);
+
+    return indexC;
+}
+
+void BoundingVolumeHierarchy::SetFatBounds(TreeNode& treeNode, const AabbBounds& bounds) const
+{
+    glm::vec3 margin = glm::max(m_relativeMargin * bounds.GetSize(), glm::vec3(m_minimumMargin));
+    treeNode.min = bounds.GetMin() - margin;
+    treeNode.max = bounds.GetMax() + margin;
+}
@@ -1,5 +1,9 @@
 #include <ituGL/scene/Bounds.h>
 
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <cmath>
+
 SphereBounds::SphereBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m_radius(0.0f)
 {
     switch (bounds.GetType())
@@ -8,10 +12,10 @@ SphereBounds::SphereBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m
         m_radius = static_cast<const SphereBounds&>(bounds).GetRadius();
         break;
     case Type::AABB:
-        m_radius = static_cast<const AabbBounds&>(bounds).GetSize().length();
+        m_radius = glm::length(static_cast<const AabbBounds&>(bounds).GetSize());
         break;
     case Type::Box:
-        m_radius = static_cast<const BoxBounds&>(bounds).GetSize().length();
+        m_radius = glm::length(static_cast<const BoxBounds&>(bounds).GetSize());
         break;
     default:
         assert(false);
@@ -31,9 +35,8 @@ AabbBounds::AabbBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m_siz
     case Type::Box:
         {
             glm::mat3 scaledMatrix = static_cast<const BoxBounds&>(bounds).GetScaledMatrix();
-            m_size = glm::abs(scaledMatrix[0]);
-            m_size = glm::max(m_size, glm::abs(scaledMatrix[1]));
-            m_size = glm::max(m_size, glm::abs(scaledMatrix[2]));
+            // The extent on each world axis is the sum of the projected box axes
+            m_size = glm::abs(scaledMatrix[0]) + glm::abs(scaledMatrix[1]) + glm::abs(scaledMatrix[2]);
         }
         break;
     default:
@@ -100,6 +103,7 @@ bool Bounds::Intersects(const BoxBounds& boundsA, const AabbBounds& boundsB)
     return Bounds::Intersects(boundsA, BoxBounds(boundsB.GetCenter(), glm::mat3(1.0f), boundsB.GetSize()));
 }
 
+// Returns true if the projections of both boxes on the axis overlap
 bool TestSeparationAxis(const glm::vec3& axis, const glm::vec3& distance, const glm::mat3& mA, const glm::mat3& mB)
 {
     float projDistance = std::abs(glm::dot(distance, axis));
@@ -109,7 +113,7 @@ bool TestSeparationAxis(const glm::vec3& axis, const glm::vec3& distance, const
         projSize += std::abs(glm::dot(mA[i], axis));
         projSize += std::abs(glm::dot(mB[i], axis));
     }
-    return projSize <= projDistance;
+    return projDistance <= projSize;
 }
 
 template<>
@@ -117,7 +121,7 @@ bool Bounds::Intersects(const BoxBounds& boundsA, const BoxBounds& boundsB)
 {
     glm::vec3 distance = boundsB.GetCenter() - boundsA.GetCenter();
     glm::mat3 mA = boundsA.GetScaledMatrix();
-    glm::mat3 mB = boundsA.GetScaledMatrix();
+    glm::mat3 mB = boundsB.GetScaledMatrix();
     return TestSeparationAxis(boundsA.GetXVector(), distance, mA, mB)
         && TestSeparationAxis(boundsA.GetYVector(), distance, mA, mB)
         && TestSeparationAxis(boundsA.GetZVector(), distance, mA, mB)
@@ -138,18 +142,49 @@ bool Bounds::Intersects(const BoxBounds& boundsA, const BoxBounds& boundsB)
 template<>
 bool Bounds::Intersects(const FrustumBounds& boundsA, const SphereBounds& boundsB)
 {
+    for (unsigned int i = 0; i < FrustumBounds::PlaneCount; ++i)
+    {
+        const glm::vec4& plane = boundsA.GetPlane(i);
+        if (glm::dot(glm::vec3(plane), boundsB.GetCenter()) + plane.w < -boundsB.GetRadius())
+        {
+            return false;
+        }
+    }
     return true;
 }
 
 template<>
 bool Bounds::Intersects(const FrustumBounds& boundsA, const AabbBounds& boundsB)
 {
+    for (unsigned int i = 0; i < FrustumBounds::PlaneCount; ++i)
+    {
+        // Distance of the corner furthest along the plane normal
+        const glm::vec4& plane = boundsA.GetPlane(i);
+        glm::vec3 normal(plane);
+        if (glm::dot(normal, boundsB.GetCenter()) + glm::dot(glm::abs(normal), boundsB.GetSize()) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
     return true;
 }
 
 template<>
 bool Bounds::Intersects(const FrustumBounds& boundsA, const BoxBounds& boundsB)
 {
+    glm::mat3 scaledMatrix = boundsB.GetScaledMatrix();
+    for (unsigned int i = 0; i < FrustumBounds::PlaneCount; ++i)
+    {
+        const glm::vec4& plane = boundsA.GetPlane(i);
+        glm::vec3 normal(plane);
+        float radius = std::abs(glm::dot(normal, scaledMatrix[0]))
+            + std::abs(glm::dot(normal, scaledMatrix[1]))
+            + std::abs(glm::dot(normal, scaledMatrix[2]));
+        if (glm::dot(normal, boundsB.GetCenter()) + radius + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -163,6 +198,8 @@ bool Bounds::Intersects(const Bounds& boundsA, const Bounds& boundsB)
         return Bounds::Intersects(static_cast<const AabbBounds&>(boundsA), boundsB);
     case Type::Box:
         return Bounds::Intersects(static_cast<const BoxBounds&>(boundsA), boundsB);
+    case Type::Frustum:
+        return Bounds::Intersects(static_cast<const FrustumBounds&>(boundsA), boundsB);
     default:
         assert(false);
         return false;
@@ -178,3 +215,24 @@ glm::mat3 BoxBounds::GetScaledMatrix() const
         m_rotationMatrix[2] * m_size[2]
     );
 }
+
+FrustumBounds::FrustumBounds(const glm::mat4& viewProjectionMatrix) : Bounds(glm::vec3(0.0f))
+{
+    // Gribb-Hartmann: each plane is the 4th row of the matrix plus or minus one of the other rows
+    glm::mat4 m = glm::transpose(viewProjectionMatrix);
+    m_planes[static_cast<unsigned int>(Plane::Left)] = m[3] + m[0];
+    m_planes[static_cast<unsigned int>(Plane::Right)] = m[3] - m[0];
+    m_planes[static_cast<unsigned int>(Plane::Bottom)] = m[3] + m[1];
+    m_planes[static_cast<unsigned int>(Plane::Top)] = m[3] - m[1];
+    m_planes[static_cast<unsigned int>(Plane::Near)] = m[3] + m[2];
+    m_planes[static_cast<unsigned int>(Plane::Far)] = m[3] - m[2];
+
+    for (glm::vec4& plane : m_planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    // Use the center of the clip volume as the center of the bounds
+    glm::vec4 center = glm::inverse(viewProjectionMatrix) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    m_center = glm::vec3(center) / center.w;
+}
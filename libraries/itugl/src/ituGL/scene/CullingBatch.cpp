@@ -0,0 +1,150 @@
+#include <ituGL/scene/CullingBatch.h>
+
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ITUGL_CULLING_AVX2
+#endif
+
+CullingBatch::CullingBatch()
+{
+}
+
+void CullingBatch::Reserve(unsigned int count)
+{
+    m_centerX.reserve(count);
+    m_centerY.reserve(count);
+    m_centerZ.reserve(count);
+    m_extentX.reserve(count);
+    m_extentY.reserve(count);
+    m_extentZ.reserve(count);
+    m_radius.reserve(count);
+}
+
+void CullingBatch::Clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+    m_radius.clear();
+}
+
+unsigned int CullingBatch::Add(const AabbBounds& bounds)
+{
+    return Add(bounds.GetCenter(), bounds.GetSize(), glm::length(bounds.GetSize()));
+}
+
+unsigned int CullingBatch::Add(const SphereBounds& bounds)
+{
+    return Add(bounds.GetCenter(), glm::vec3(bounds.GetRadius()), bounds.GetRadius());
+}
+
+unsigned int CullingBatch::Add(const glm::vec3& center, const glm::vec3& extents, float radius)
+{
+    unsigned int index = GetCount();
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_extentX.push_back(extents.x);
+    m_extentY.push_back(extents.y);
+    m_extentZ.push_back(extents.z);
+    m_radius.push_back(radius);
+    return index;
+}
+
+void CullingBatch::Cull(const FrustumBounds& frustum, std::vector<unsigned int>& visibleIndices) const
+{
+    unsigned int count = GetCount();
+    unsigned int begin = 0;
+
+#ifdef ITUGL_CULLING_AVX2
+    // Broadcast the plane components once
+    __m256 planeX[FrustumBounds::PlaneCount], planeY[FrustumBounds::PlaneCount], planeZ[FrustumBounds::PlaneCount], planeW[FrustumBounds::PlaneCount];
+    __m256 absX[FrustumBounds::PlaneCount], absY[FrustumBounds::PlaneCount], absZ[FrustumBounds::PlaneCount];
+    for (unsigned int p = 0; p < FrustumBounds::PlaneCount; ++p)
+    {
+        const glm::vec4& plane = frustum.GetPlane(p);
+        planeX[p] = _mm256_set1_ps(plane.x);
+        planeY[p] = _mm256_set1_ps(plane.y);
+        planeZ[p] = _mm256_set1_ps(plane.z);
+        planeW[p] = _mm256_set1_ps(plane.w);
+        absX[p] = _mm256_set1_ps(std::abs(plane.x));
+        absY[p] = _mm256_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    for (; begin + 8 <= count; begin += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&m_centerX[begin]);
+        __m256 cy = _mm256_loadu_ps(&m_centerY[begin]);
+        __m256 cz = _mm256_loadu_ps(&m_centerZ[begin]);
+        __m256 ex = _mm256_loadu_ps(&m_extentX[begin]);
+        __m256 ey = _mm256_loadu_ps(&m_extentY[begin]);
+        __m256 ez = _mm256_loadu_ps(&m_extentZ[begin]);
+        __m256 r = _mm256_loadu_ps(&m_radius[begin]);
+
+        // Lanes stay set while the entry is inside all the planes tested so far
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (unsigned int p = 0; p < FrustumBounds::PlaneCount; ++p)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+                _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+            __m256 projectedExtent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+            __m256 reach = _mm256_add_ps(distance, _mm256_min_ps(projectedExtent, r));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(reach, zero, _CMP_GE_OQ));
+        }
+
+        // Append the indices of the set lanes
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(inside));
+        while (mask)
+        {
+            visibleIndices.push_back(begin + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // Remaining entries (or all of them without SIMD)
+    CullScalar(frustum, begin, count, visibleIndices);
+}
+
+void CullingBatch::CullScalar(const FrustumBounds& frustum, std::vector<unsigned int>& visibleIndices) const
+{
+    CullScalar(frustum, 0, GetCount(), visibleIndices);
+}
+
+void CullingBatch::CullScalar(const FrustumBounds& frustum, unsigned int begin, unsigned int end, std::vector<unsigned int>& visibleIndices) const
+{
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        bool inside = true;
+        for (unsigned int p = 0; inside && p < FrustumBounds::PlaneCount; ++p)
+        {
+            const glm::vec4& plane = frustum.GetPlane(p);
+            float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] + plane.z * m_centerZ[i] + plane.w;
+            float projectedExtent = std::abs(plane.x) * m_extentX[i] + std::abs(plane.y) * m_extentY[i] + std::abs(plane.z) * m_extentZ[i];
+            inside = distance + std::min(projectedExtent, m_radius[i]) >= 0.0f;
+        }
+        if (inside)
+        {
+            visibleIndices.push_back(i);
+        }
+    }
+}
+
+bool CullingBatch::IsSimdEnabled()
+{
+#ifdef ITUGL_CULLING_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
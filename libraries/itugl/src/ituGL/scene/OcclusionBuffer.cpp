@@ -0,0 +1,467 @@
+#include <ituGL/scene/OcclusionBuffer.h>
+
+#include <ituGL/core/ThreadPool.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ITUGL_OCCLUSION_AVX2
+#endif
+
+// Triangles set up together by one task
+static const unsigned int s_setupBatchSize = 256;
+
+// Triangles reaching further than this, in viewports, are dropped instead of rasterized with poor precision
+static const float s_guardBand = 16.0f;
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+    : m_width(0), m_height(0), m_tileCountX(0), m_tileCountY(0), m_viewProjMatrix(1.0f)
+{
+    Resize(width, height);
+}
+
+void OcclusionBuffer::Resize(unsigned int width, unsigned int height)
+{
+    assert(width > 0 && height > 0);
+
+    m_tileCountX = (width + TileWidth - 1) / TileWidth;
+    m_tileCountY = (height + TileHeight - 1) / TileHeight;
+    m_width = m_tileCountX * TileWidth;
+    m_height = m_tileCountY * TileHeight;
+    m_tileTriangles.resize(m_tileCountX * m_tileCountY);
+
+    // Halve the size down to a single texel
+    m_levelSizes.clear();
+    glm::uvec2 levelSize(m_width, m_height);
+    m_levelSizes.push_back(levelSize);
+    while (levelSize.x > 1 || levelSize.y > 1)
+    {
+        levelSize = glm::max((levelSize + 1u) / 2u, glm::uvec2(1));
+        m_levelSizes.push_back(levelSize);
+    }
+
+    m_depthLevels.resize(m_levelSizes.size());
+    for (unsigned int level = 0; level < m_levelSizes.size(); ++level)
+    {
+        m_depthLevels[level].assign(m_levelSizes[level].x * m_levelSizes[level].y, 1.0f);
+    }
+}
+
+void OcclusionBuffer::Begin(const glm::mat4& viewProjMatrix)
+{
+    m_viewProjMatrix = viewProjMatrix;
+    m_clipVertices.clear();
+    m_indices.clear();
+}
+
+void OcclusionBuffer::AddOccluder(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices, const glm::mat4& worldMatrix)
+{
+    assert(indices.size() % 3 == 0);
+
+    unsigned int firstVertex = static_cast<unsigned int>(m_clipVertices.size());
+    glm::mat4 worldViewProjMatrix = m_viewProjMatrix * worldMatrix;
+    for (const glm::vec3& vertex : vertices)
+    {
+        m_clipVertices.push_back(worldViewProjMatrix * glm::vec4(vertex, 1.0f));
+    }
+    for (unsigned int index : indices)
+    {
+        assert(index < vertices.size());
+        m_indices.push_back(firstVertex + index);
+    }
+}
+
+void OcclusionBuffer::Rasterize(ThreadPool* threadPool)
+{
+    // Project the triangles. Each batch writes its own list, so there is no contention
+    unsigned int triangleCount = GetOccluderTriangleCount();
+    unsigned int batchCount = (triangleCount + s_setupBatchSize - 1) / s_setupBatchSize;
+    m_batchTriangles.resize(batchCount);
+    auto SetupBatches = [&](unsigned int begin, unsigned int end)
+    {
+        for (unsigned int batch = begin; batch < end; ++batch)
+        {
+            std::vector<Triangle>& triangles = m_batchTriangles[batch];
+            triangles.clear();
+            unsigned int batchEnd = std::min((batch + 1) * s_setupBatchSize, triangleCount);
+            for (unsigned int triangleIndex = batch * s_setupBatchSize; triangleIndex < batchEnd; ++triangleIndex)
+            {
+                SetupTriangle(triangleIndex, triangles);
+            }
+        }
+    };
+
+    // Each tile only writes its own pixels
+    unsigned int tileCount = m_tileCountX * m_tileCountY;
+    auto RasterizeTiles = [&](unsigned int begin, unsigned int end)
+    {
+        for (unsigned int tileIndex = begin; tileIndex < end; ++tileIndex)
+        {
+            RasterizeTile(tileIndex);
+        }
+    };
+
+    if (threadPool)
+    {
+        threadPool->ParallelFor(batchCount, 1, SetupBatches);
+        BinTriangles();
+        threadPool->ParallelFor(tileCount, 1, RasterizeTiles);
+    }
+    else
+    {
+        SetupBatches(0, batchCount);
+        BinTriangles();
+        RasterizeTiles(0, tileCount);
+    }
+
+    // Each level depends on the previous one, but its rows are independent
+    for (unsigned int level = 1; level < m_levelSizes.size(); ++level)
+    {
+        unsigned int rowCount = m_levelSizes[level].y;
+        if (threadPool)
+        {
+            threadPool->ParallelFor(rowCount, 16, [&](unsigned int begin, unsigned int end) { BuildDepthLevel(level, begin, end); });
+        }
+        else
+        {
+            BuildDepthLevel(level, 0, rowCount);
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const AabbBounds& bounds) const
+{
+    return IsVisible(bounds.GetMin(), bounds.GetMax());
+}
+
+bool OcclusionBuffer::IsVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+{
+    // Screen rectangle and nearest depth of the corners
+    glm::vec2 screenMin(std::numeric_limits<float>::max());
+    glm::vec2 screenMax(std::numeric_limits<float>::lowest());
+    float nearestDepth = 1.0f;
+    for (unsigned int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec3 position((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clipPosition = m_viewProjMatrix * glm::vec4(position, 1.0f);
+
+        // Crossing the near plane: it may cover the whole screen
+        if (clipPosition.z < -clipPosition.w)
+        {
+            return true;
+        }
+
+        glm::vec3 ndcPosition = glm::vec3(clipPosition) / clipPosition.w;
+        glm::vec2 screenPosition = (glm::vec2(ndcPosition) * 0.5f + 0.5f) * glm::vec2(m_width, m_height);
+        screenMin = glm::min(screenMin, screenPosition);
+        screenMax = glm::max(screenMax, screenPosition);
+        nearestDepth = std::min(nearestDepth, ndcPosition.z * 0.5f + 0.5f);
+    }
+
+    // Outside of the screen is for the frustum culling to decide
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= m_width || screenMin.y >= m_height)
+    {
+        return true;
+    }
+
+    // Pixels touched by the rectangle
+    glm::uvec2 pixelMin(glm::max(glm::floor(screenMin), glm::vec2(0.0f)));
+    glm::uvec2 pixelMax(glm::min(glm::floor(screenMax), glm::vec2(m_width - 1, m_height - 1)));
+
+    // Go up the pyramid until the rectangle covers a few texels
+    unsigned int level = 0;
+    while (level + 1 < m_levelSizes.size() && ((pixelMax.x >> level) - (pixelMin.x >> level) > 3 || (pixelMax.y >> level) - (pixelMin.y >> level) > 3))
+    {
+        ++level;
+    }
+
+    const std::vector<float>& depth = m_depthLevels[level];
+    unsigned int levelWidth = m_levelSizes[level].x;
+    for (unsigned int y = pixelMin.y >> level; y <= (pixelMax.y >> level); ++y)
+    {
+        for (unsigned int x = pixelMin.x >> level; x <= (pixelMax.x >> level); ++x)
+        {
+            // Something in this texel is further than the bounds
+            if (nearestDepth <= depth[y * levelWidth + x])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionBuffer::IsSimdEnabled()
+{
+#ifdef ITUGL_OCCLUSION_AVX2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void OcclusionBuffer::CreateHeightfieldOccluder(std::span<const float> heights, unsigned int width, unsigned int height, unsigned int resolution,
+    std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices)
+{
+    assert(heights.size() >= width * height);
+    assert(width > 0 && height > 0 && resolution >= 2);
+
+    vertices.clear();
+    indices.clear();
+
+    float cellCount = static_cast<float>(resolution - 1);
+    for (unsigned int j = 0; j < resolution; ++j)
+    {
+        // Samples under the cells around the vertex
+        unsigned int sampleY0 = static_cast<unsigned int>(std::floor(std::max(j - 1.0f, 0.0f) / cellCount * (height - 1)));
+        unsigned int sampleY1 = static_cast<unsigned int>(std::ceil(std::min(j + 1.0f, cellCount) / cellCount * (height - 1)));
+
+        for (unsigned int i = 0; i < resolution; ++i)
+        {
+            unsigned int sampleX0 = static_cast<unsigned int>(std::floor(std::max(i - 1.0f, 0.0f) / cellCount * (width - 1)));
+            unsigned int sampleX1 = static_cast<unsigned int>(std::ceil(std::min(i + 1.0f, cellCount) / cellCount * (width - 1)));
+
+            float minHeight = std::numeric_limits<float>::max();
+            for (unsigned int y = sampleY0; y <= sampleY1; ++y)
+            {
+                for (unsigned int x = sampleX0; x <= sampleX1; ++x)
+                {
+                    minHeight = std::min(minHeight, heights[y * width + x]);
+                }
+            }
+            vertices.emplace_back(i / cellCount, minHeight, j / cellCount);
+
+            if (i > 0 && j > 0)
+            {
+                unsigned int topRight = j * resolution + i;
+                unsigned int topLeft = topRight - 1;
+                unsigned int bottomRight = topRight - resolution;
+                unsigned int bottomLeft = bottomRight - 1;
+
+                indices.insert(indices.end(), { bottomLeft, topLeft, bottomRight });
+                indices.insert(indices.end(), { bottomRight, topLeft, topRight });
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::SetupTriangle(unsigned int triangleIndex, std::vector<Triangle>& triangles) const
+{
+    const glm::vec4* clipVertices[3] =
+    {
+        &m_clipVertices[m_indices[triangleIndex * 3 + 0]],
+        &m_clipVertices[m_indices[triangleIndex * 3 + 1]],
+        &m_clipVertices[m_indices[triangleIndex * 3 + 2]],
+    };
+
+    // Clip against the near plane (z = -w). A triangle becomes a polygon of up to 4 vertices
+    glm::vec4 polygon[4];
+    unsigned int polygonCount = 0;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        const glm::vec4& current = *clipVertices[i];
+        const glm::vec4& next = *clipVertices[(i + 1) % 3];
+        float currentDistance = current.z + current.w;
+        float nextDistance = next.z + next.w;
+
+        if (currentDistance >= 0.0f)
+        {
+            polygon[polygonCount++] = current;
+        }
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+        {
+            float t = currentDistance / (currentDistance - nextDistance);
+            polygon[polygonCount++] = current + t * (next - current);
+        }
+    }
+    if (polygonCount < 3)
+    {
+        return;
+    }
+
+    // Project to pixel coordinates, with depth in [0, 1]
+    glm::vec3 screenVertices[4];
+    glm::vec2 viewportSize(m_width, m_height);
+    for (unsigned int i = 0; i < polygonCount; ++i)
+    {
+        glm::vec3 ndcPosition = glm::vec3(polygon[i]) / polygon[i].w;
+        if (std::abs(ndcPosition.x) > s_guardBand || std::abs(ndcPosition.y) > s_guardBand)
+        {
+            return;
+        }
+        screenVertices[i] = glm::vec3((glm::vec2(ndcPosition) * 0.5f + 0.5f) * viewportSize, ndcPosition.z * 0.5f + 0.5f);
+    }
+
+    AddScreenTriangle(screenVertices[0], screenVertices[1], screenVertices[2], triangles);
+    if (polygonCount == 4)
+    {
+        AddScreenTriangle(screenVertices[0], screenVertices[2], screenVertices[3], triangles);
+    }
+}
+
+void OcclusionBuffer::AddScreenTriangle(const glm::vec3& v0, const glm::vec3& v1In, const glm::vec3& v2In, std::vector<Triangle>& triangles) const
+{
+    // No backface culling: both sides of an occluder hide what is behind. Make it counter-clockwise instead
+    glm::vec3 v1 = v1In, v2 = v2In;
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+    if (area < 1e-6f)
+    {
+        return;
+    }
+
+    Triangle triangle;
+    triangle.pixelMin = glm::ivec2(glm::max(glm::floor(glm::min(glm::min(glm::vec2(v0), glm::vec2(v1)), glm::vec2(v2))), glm::vec2(0.0f)));
+    triangle.pixelMax = glm::ivec2(glm::min(glm::floor(glm::max(glm::max(glm::vec2(v0), glm::vec2(v1)), glm::vec2(v2))), glm::vec2(m_width - 1, m_height - 1)));
+    if (triangle.pixelMin.x > triangle.pixelMax.x || triangle.pixelMin.y > triangle.pixelMax.y)
+    {
+        return;
+    }
+
+    // Edge functions, positive inside: E(p) = edgeX * p.x + edgeY * p.y + edgeC
+    triangle.edgeX = glm::vec3(v0.y - v1.y, v1.y - v2.y, v2.y - v0.y);
+    triangle.edgeY = glm::vec3(v1.x - v0.x, v2.x - v1.x, v0.x - v2.x);
+    triangle.edgeC = glm::vec3(v0.x * v1.y - v0.y * v1.x, v1.x * v2.y - v1.y * v2.x, v2.x * v0.y - v2.y * v0.x);
+
+    // Depth plane: z(p) = depthPlane.x * p.x + depthPlane.y * p.y + depthPlane.z
+    // Moved to the furthest corner of the pixel, so the depth is never closer than the occluder inside the pixel
+    glm::vec3 d1 = v1 - v0;
+    glm::vec3 d2 = v2 - v0;
+    float depthX = (d1.z * d2.y - d2.z * d1.y) / area;
+    float depthY = (d2.z * d1.x - d1.z * d2.x) / area;
+    float depthC = v0.z - depthX * v0.x - depthY * v0.y + 0.5f * (std::abs(depthX) + std::abs(depthY));
+    triangle.depthPlane = glm::vec3(depthX, depthY, depthC);
+
+    triangles.push_back(triangle);
+}
+
+void OcclusionBuffer::BinTriangles()
+{
+    for (std::vector<const Triangle*>& tileTriangles : m_tileTriangles)
+    {
+        tileTriangles.clear();
+    }
+
+    for (const std::vector<Triangle>& triangles : m_batchTriangles)
+    {
+        for (const Triangle& triangle : triangles)
+        {
+            unsigned int tileX0 = triangle.pixelMin.x / TileWidth;
+            unsigned int tileX1 = triangle.pixelMax.x / TileWidth;
+            unsigned int tileY0 = triangle.pixelMin.y / TileHeight;
+            unsigned int tileY1 = triangle.pixelMax.y / TileHeight;
+            for (unsigned int tileY = tileY0; tileY <= tileY1; ++tileY)
+            {
+                for (unsigned int tileX = tileX0; tileX <= tileX1; ++tileX)
+                {
+                    m_tileTriangles[tileY * m_tileCountX + tileX].push_back(&triangle);
+                }
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::RasterizeTile(unsigned int tileIndex)
+{
+    int tileX0 = (tileIndex % m_tileCountX) * TileWidth;
+    int tileY0 = (tileIndex / m_tileCountX) * TileHeight;
+    int tileX1 = tileX0 + TileWidth - 1;
+    int tileY1 = tileY0 + TileHeight - 1;
+
+    float* depth = m_depthLevels[0].data();
+    for (int y = tileY0; y <= tileY1; ++y)
+    {
+        std::fill_n(depth + y * m_width + tileX0, TileWidth, 1.0f);
+    }
+
+    for (const Triangle* triangle : m_tileTriangles[tileIndex])
+    {
+        int x0 = std::max(triangle->pixelMin.x, tileX0);
+        int x1 = std::min(triangle->pixelMax.x, tileX1);
+        int y0 = std::max(triangle->pixelMin.y, tileY0);
+        int y1 = std::min(triangle->pixelMax.y, tileY1);
+
+#ifdef ITUGL_OCCLUSION_AVX2
+        // 8 pixels at a time, starting aligned to 8. Pixels outside of the triangle are masked out by the edge functions
+        x0 &= ~7;
+        __m256 edgeX0 = _mm256_set1_ps(triangle->edgeX.x), edgeX1 = _mm256_set1_ps(triangle->edgeX.y), edgeX2 = _mm256_set1_ps(triangle->edgeX.z);
+        __m256 depthX = _mm256_set1_ps(triangle->depthPlane.x);
+        __m256 zero = _mm256_setzero_ps();
+        __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        for (int y = y0; y <= y1; ++y)
+        {
+            float pixelY = y + 0.5f;
+            __m256 rowEdge0 = _mm256_set1_ps(triangle->edgeY.x * pixelY + triangle->edgeC.x);
+            __m256 rowEdge1 = _mm256_set1_ps(triangle->edgeY.y * pixelY + triangle->edgeC.y);
+            __m256 rowEdge2 = _mm256_set1_ps(triangle->edgeY.z * pixelY + triangle->edgeC.z);
+            __m256 rowDepth = _mm256_set1_ps(triangle->depthPlane.y * pixelY + triangle->depthPlane.z);
+            float* row = depth + y * m_width;
+            for (int x = x0; x <= x1; x += 8)
+            {
+                __m256 pixelX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+                __m256 edge0 = _mm256_add_ps(_mm256_mul_ps(edgeX0, pixelX), rowEdge0);
+                __m256 edge1 = _mm256_add_ps(_mm256_mul_ps(edgeX1, pixelX), rowEdge1);
+                __m256 edge2 = _mm256_add_ps(_mm256_mul_ps(edgeX2, pixelX), rowEdge2);
+                __m256 mask = _mm256_and_ps(_mm256_cmp_ps(edge0, zero, _CMP_GE_OQ),
+                    _mm256_and_ps(_mm256_cmp_ps(edge1, zero, _CMP_GE_OQ), _mm256_cmp_ps(edge2, zero, _CMP_GE_OQ)));
+                if (_mm256_movemask_ps(mask) == 0)
+                {
+                    continue;
+                }
+
+                __m256 pixelDepth = _mm256_add_ps(_mm256_mul_ps(depthX, pixelX), rowDepth);
+                __m256 currentDepth = _mm256_loadu_ps(row + x);
+                __m256 newDepth = _mm256_blendv_ps(currentDepth, _mm256_min_ps(currentDepth, pixelDepth), mask);
+                _mm256_storeu_ps(row + x, newDepth);
+            }
+        }
+#else
+        for (int y = y0; y <= y1; ++y)
+        {
+            float pixelY = y + 0.5f;
+            glm::vec3 rowEdge = triangle->edgeY * pixelY + triangle->edgeC;
+            float rowDepth = triangle->depthPlane.y * pixelY + triangle->depthPlane.z;
+            float* row = depth + y * m_width;
+            for (int x = x0; x <= x1; ++x)
+            {
+                float pixelX = x + 0.5f;
+                glm::vec3 edge = triangle->edgeX * pixelX + rowEdge;
+                if (edge.x >= 0.0f && edge.y >= 0.0f && edge.z >= 0.0f)
+                {
+                    row[x] = std::min(row[x], triangle->depthPlane.x * pixelX + rowDepth);
+                }
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionBuffer::BuildDepthLevel(unsigned int level, unsigned int rowBegin, unsigned int rowEnd)
+{
+    const std::vector<float>& source = m_depthLevels[level - 1];
+    std::vector<float>& target = m_depthLevels[level];
+    glm::uvec2 sourceSize = m_levelSizes[level - 1];
+    glm::uvec2 targetSize = m_levelSizes[level];
+
+    for (unsigned int y = rowBegin; y < rowEnd; ++y)
+    {
+        // Odd sizes: the last texel also covers the extra row or column
+        unsigned int sourceY0 = y * 2;
+        unsigned int sourceY1 = std::min(sourceY0 + 1, sourceSize.y - 1);
+        for (unsigned int x = 0; x < targetSize.x; ++x)
+        {
+            unsigned int sourceX0 = x * 2;
+            unsigned int sourceX1 = std::min(sourceX0 + 1, sourceSize.x - 1);
+            target[y * targetSize.x + x] = std::max(
+                std::max(source[sourceY0 * sourceSize.x + sourceX0], source[sourceY0 * sourceSize.x + sourceX1]),
+                std::max(source[sourceY1 * sourceSize.x + sourceX0], source[sourceY1 * sourceSize.x + sourceX1]));
+        }
+    }
+}
@@ -4,10 +4,159 @@
 #include <ituGL/scene/SceneCamera.h>
 #include <ituGL/scene/SceneLight.h>
 #include <ituGL/scene/SceneModel.h>
+#include <ituGL/scene/OcclusionBuffer.h>
+#include <ituGL/scene/StaticBatch.h>
 #include <ituGL/scene/Transform.h>
+#include <ituGL/camera/Camera.h>
+#include <ituGL/core/ThreadPool.h>
+#include <glm/geometric.hpp>
+#include <algorithm>
 
-RendererSceneVisitor::RendererSceneVisitor(Renderer& renderer) : m_renderer(renderer)
+// Fewer models than this per chunk are not worth another thread
+static const unsigned int s_minChunkSize = 256;
+
+RendererSceneVisitor::RendererSceneVisitor(Renderer& renderer, ThreadPool* threadPool) : m_renderer(renderer), m_threadPool(threadPool), m_occlusionBuffer(nullptr)
+{
+}
+
+void RendererSceneVisitor::BeginScene()
+{
+    m_models.clear();
+}
+
+void RendererSceneVisitor::AddStaticBatch(std::shared_ptr<StaticBatch> staticBatch)
+{
+    assert(staticBatch);
+    m_staticBatches.push_back(std::move(staticBatch));
+}
+
+void RendererSceneVisitor::ClearStaticBatches()
+{
+    m_staticBatches.clear();
+}
+
+void RendererSceneVisitor::EndScene()
+{
+    // Without a camera there is no frustum, submit everything
+    const FrustumBounds* frustum = nullptr;
+    FrustumBounds cameraFrustum(m_renderer.HasCamera() ? m_renderer.GetCurrentCamera().GetViewProjectionMatrix() : glm::mat4(1.0f));
+    if (m_renderer.HasCamera())
+    {
+        frustum = &cameraFrustum;
+    }
+
+    GatherStaticBatches(frustum);
+
+    unsigned int modelCount = static_cast<unsigned int>(m_models.size());
+    if (modelCount == 0)
+    {
+        return;
+    }
+
+    // Bring the world matrices up to date here, so the chunks only read them
+    for (SceneModel* sceneModel : m_models)
+    {
+        TransformHierarchy& hierarchy = sceneModel->GetTransform()->GetHierarchy();
+        if (hierarchy.HasPendingChanges())
+        {
+            hierarchy.Update();
+        }
+    }
+
+    unsigned int chunkCount = 1;
+    if (m_threadPool)
+    {
+        chunkCount = std::min(m_threadPool->GetThreadCount() + 1, (modelCount + s_minChunkSize - 1) / s_minChunkSize);
+        chunkCount = std::max(chunkCount, 1u);
+    }
+    unsigned int chunkSize = (modelCount + chunkCount - 1) / chunkCount;
+    m_chunks.resize(chunkCount);
+    m_commandLists.resize(chunkCount);
+
+    if (chunkCount > 1)
+    {
+        m_threadPool->ParallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end)
+            {
+                for (unsigned int chunkIndex = begin; chunkIndex < end; ++chunkIndex)
+                {
+                    GatherChunk(chunkIndex, chunkSize, frustum);
+                }
+            });
+        m_renderer.SubmitCommandLists(std::span<const RenderCommandList>(m_commandLists.data(), chunkCount), m_threadPool);
+    }
+    else
+    {
+        GatherChunk(0, chunkSize, frustum);
+        m_renderer.SubmitCommandList(m_commandLists[0]);
+    }
+
+    m_models.clear();
+}
+
+void RendererSceneVisitor::GatherChunk(unsigned int chunkIndex, unsigned int chunkSize, const FrustumBounds* frustum)
 {
+    unsigned int begin = chunkIndex * chunkSize;
+    unsigned int end = std::min(begin + chunkSize, static_cast<unsigned int>(m_models.size()));
+
+    Chunk& chunk = m_chunks[chunkIndex];
+    chunk.cullingBatch.Clear();
+    chunk.aabbs.clear();
+    chunk.visibleIndices.clear();
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        // The sphere comes from the oriented box, tighter than the one around its AABB
+        BoxBounds boxBounds = m_models[i]->GetBoxBounds();
+        AabbBounds aabbBounds(boxBounds);
+        chunk.cullingBatch.Add(boxBounds.GetCenter(), aabbBounds.GetSize(), glm::length(boxBounds.GetSize()));
+        chunk.aabbs.push_back(aabbBounds);
+    }
+
+    if (frustum)
+    {
+        chunk.cullingBatch.Cull(*frustum, chunk.visibleIndices);
+    }
+    else
+    {
+        chunk.visibleIndices.resize(end - begin);
+        for (unsigned int i = 0; i < chunk.visibleIndices.size(); ++i)
+        {
+            chunk.visibleIndices[i] = i;
+        }
+    }
+
+    // Then the ones left, against the occluders. Only reads the buffer, so the chunks can share it
+    if (m_occlusionBuffer)
+    {
+        std::erase_if(chunk.visibleIndices, [&](unsigned int index) { return !m_occlusionBuffer->IsVisible(chunk.aabbs[index]); });
+    }
+
+    RenderCommandList& commandList = m_commandLists[chunkIndex];
+    commandList.Clear();
+    for (unsigned int index : chunk.visibleIndices)
+    {
+        SceneModel& sceneModel = *m_models[begin + index];
+        commandList.AddModel(*sceneModel.GetModel(), sceneModel.GetTransform()->GetTransformMatrix());
+    }
+}
+
+void RendererSceneVisitor::GatherStaticBatches(const FrustumBounds* frustum)
+{
+    if (m_staticBatches.empty())
+    {
+        return;
+    }
+
+    // The vertices are already in world space
+    m_staticCommandList.Clear();
+    for (const std::shared_ptr<StaticBatch>& staticBatch : m_staticBatches)
+    {
+        staticBatch->Cull(frustum, m_occlusionBuffer);
+        for (const Drawcall& drawcall : staticBatch->GetVisibleDrawcalls())
+        {
+            m_staticCommandList.AddDrawcall(staticBatch->GetMaterial(), glm::mat4(1.0f), staticBatch->GetVertexArray(), drawcall);
+        }
+    }
+    m_renderer.SubmitCommandList(m_staticCommandList);
 }
 
 void RendererSceneVisitor::VisitCamera(SceneCamera& sceneCamera)
@@ -24,5 +173,5 @@ void RendererSceneVisitor::VisitLight(SceneLight& sceneLight)
 void RendererSceneVisitor::VisitModel(SceneModel& sceneModel)
 {
     assert(sceneModel.GetTransform());
-    m_renderer.AddModel(*sceneModel.GetModel(), sceneModel.GetTransform()->GetTransformMatrix());
+    m_models.push_back(&sceneModel);
 }
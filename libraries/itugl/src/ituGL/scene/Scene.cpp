@@ -2,6 +2,8 @@
 
 #include <ituGL/scene/SceneNode.h>
 #include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/scene/Transform.h>
+#include <algorithm>
 #include <cassert>
 
 Scene::Scene()
@@ -14,6 +16,10 @@ Scene::~Scene()
     {
         pair.second->SetOwnerScene(nullptr);
     }
+    for (auto& transformChanges : m_transformChanges)
+    {
+        transformChanges->hierarchy->RemoveChangeList(transformChanges->handles);
+    }
 }
 
 std::shared_ptr<SceneNode> Scene::GetSceneNode(const std::string& name) const
@@ -32,6 +38,7 @@ bool Scene::AddSceneNode(std::shared_ptr<SceneNode> node)
     assert(m_nodes.find(node->GetName()) == m_nodes.end());
     m_nodes[node->GetName()] = node;
     node->SetOwnerScene(this);
+    AddToSpatialIndex(*node);
     return true;
 }
 
@@ -48,6 +55,7 @@ bool Scene::RemoveSceneNode(const std::string& name)
     {
         assert(it->second);
         assert(it->second->GetOwnerScene() == this);
+        RemoveFromSpatialIndex(*it->second);
         it->second->SetOwnerScene(nullptr);
         m_nodes.erase(it);
         return true;
@@ -57,16 +65,140 @@ bool Scene::RemoveSceneNode(const std::string& name)
 
 void Scene::AcceptVisitor(SceneVisitor& visitor)
 {
+    visitor.BeginScene();
     for (auto& pair : m_nodes)
     {
         pair.second->AcceptVisitor(visitor);
     }
+    visitor.EndScene();
 }
 
 void Scene::AcceptVisitor(SceneVisitor& visitor) const
 {
+    visitor.BeginScene();
     for (auto& pair : m_nodes)
     {
         pair.second->AcceptVisitor(visitor);
     }
+    visitor.EndScene();
+}
+
+void Scene::AcceptVisitor(SceneVisitor& visitor, const FrustumBounds& frustum)
+{
+    m_queryResults.clear();
+    m_spatialIndex.Query(frustum, m_queryResults);
+    AcceptVisitor(visitor, m_queryResults);
+}
+
+void Scene::AcceptVisitor(SceneVisitor& visitor, const SphereBounds& sphere)
+{
+    m_queryResults.clear();
+    m_spatialIndex.Query(sphere, m_queryResults);
+    AcceptVisitor(visitor, m_queryResults);
+}
+
+void Scene::AcceptVisitor(SceneVisitor& visitor, const std::vector<SceneNode*>& nodes)
+{
+    visitor.BeginScene();
+    for (SceneNode* node : m_unboundedNodes)
+    {
+        node->AcceptVisitor(visitor);
+    }
+    for (SceneNode* node : nodes)
+    {
+        node->AcceptVisitor(visitor);
+    }
+    visitor.EndScene();
+}
+
+void Scene::UpdateSpatialIndex()
+{
+    for (auto& transformChanges : m_transformChanges)
+    {
+        // Fills the list with the transforms that changed
+        transformChanges->hierarchy->Update();
+
+        for (const TransformHierarchy::Handle& handle : transformChanges->handles)
+        {
+            // The list also has the transforms of other scenes, and of nodes that were removed
+            auto range = transformChanges->nodes.equal_range(handle.index);
+            for (auto itNode = range.first; itNode != range.second; ++itNode)
+            {
+                const SpatialProxy& proxy = m_spatialProxies.find(itNode->second)->second;
+                if (proxy.transformHandle == handle)
+                {
+                    m_spatialIndex.MoveProxy(proxy.proxyId, itNode->second->GetAabbBounds());
+                }
+            }
+        }
+        transformChanges->handles.clear();
+    }
+}
+
+void Scene::QueryNodes(const FrustumBounds& frustum, std::vector<SceneNode*>& results) const
+{
+    m_spatialIndex.Query(frustum, results);
+}
+
+void Scene::QueryNodes(const SphereBounds& sphere, std::vector<SceneNode*>& results) const
+{
+    m_spatialIndex.Query(sphere, results);
+}
+
+void Scene::QueryNodes(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<SceneNode*>& results) const
+{
+    m_spatialIndex.QueryRay(origin, direction, maxDistance, results);
+}
+
+void Scene::AddToSpatialIndex(SceneNode& node)
+{
+    if (node.HasBounds())
+    {
+        assert(node.GetTransform());
+        const Transform& transform = *node.GetTransform();
+
+        // Listen to the changes of the hierarchy the first time one of its transforms is used
+        TransformHierarchy* hierarchy = &transform.GetHierarchy();
+        auto itChanges = std::find_if(m_transformChanges.begin(), m_transformChanges.end(),
+            [hierarchy](const auto& transformChanges) { return transformChanges->hierarchy == hierarchy; });
+        if (itChanges == m_transformChanges.end())
+        {
+            itChanges = m_transformChanges.insert(m_transformChanges.end(), std::make_unique<TransformChanges>());
+            (*itChanges)->hierarchy = hierarchy;
+            hierarchy->AddChangeList((*itChanges)->handles);
+        }
+
+        SpatialProxy& proxy = m_spatialProxies[&node];
+        proxy.proxyId = m_spatialIndex.AddProxy(node.GetAabbBounds(), &node);
+        proxy.transformChanges = itChanges->get();
+        proxy.transformHandle = transform.GetHandle();
+        proxy.transformChanges->nodes.emplace(proxy.transformHandle.index, &node);
+    }
+    else
+    {
+        m_unboundedNodes.push_back(&node);
+    }
+}
+
+void Scene::RemoveFromSpatialIndex(SceneNode& node)
+{
+    auto it = m_spatialProxies.find(&node);
+    if (it != m_spatialProxies.end())
+    {
+        const SpatialProxy& proxy = it->second;
+        m_spatialIndex.RemoveProxy(proxy.proxyId);
+
+        auto range = proxy.transformChanges->nodes.equal_range(proxy.transformHandle.index);
+        auto itNode = std::find_if(range.first, range.second, [&node](const auto& indexNode) { return indexNode.second == &node; });
+        assert(itNode != range.second);
+        proxy.transformChanges->nodes.erase(itNode);
+
+        m_spatialProxies.erase(it);
+    }
+    else
+    {
+        auto itUnbounded = std::find(m_unboundedNodes.begin(), m_unboundedNodes.end(), &node);
+        assert(itUnbounded != m_unboundedNodes.end());
+        m_unboundedNodes.erase(itUnbounded);
+    }
 }
@@ -4,6 +4,7 @@
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/scene/Transform.h>
 #include <ituGL/scene/SceneVisitor.h>
+#include <glm/geometric.hpp>
 #include <cassert>
 
 SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model) : SceneNode(name), m_model(model)
@@ -43,6 +44,11 @@ const Drawcall& SceneModel::GetDrawcall(int index, const VertexArrayObject*& vao
     return mesh.GetSubmeshDrawcall(index);
 }*/
 
+bool SceneModel::HasBounds() const
+{
+    return m_model != nullptr;
+}
+
 SphereBounds SceneModel::GetSphereBounds() const
 {
     return SphereBounds(GetBoxBounds());
@@ -57,7 +63,25 @@ BoxBounds SceneModel::GetBoxBounds() const
 {
     assert(m_transform);
     assert(m_model);
-    return BoxBounds(m_transform->GetTranslation(), m_transform->GetRotationMatrix(), m_transform->GetScale() /* * m_model->GetSize()*/);
+
+    // Local bounds of the mesh, or a unit box if the mesh has none
+    glm::vec3 localCenter(0.0f);
+    glm::vec3 localSize(1.0f);
+    const Mesh& mesh = m_model->GetMesh();
+    if (mesh.HasBounds())
+    {
+        localCenter = 0.5f * (mesh.GetBoundsMin() + mesh.GetBoundsMax());
+        localSize = 0.5f * (mesh.GetBoundsMax() - mesh.GetBoundsMin());
+    }
+
+    // Take the world matrix apart so the bounds include the parent transforms
+    glm::mat4 worldMatrix = m_transform->GetTransformMatrix();
+    glm::vec3 center(worldMatrix * glm::vec4(localCenter, 1.0f));
+    glm::mat3 axes(worldMatrix);
+    glm::vec3 scale(glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]));
+    glm::mat3 rotationMatrix(axes[0] / scale.x, axes[1] / scale.y, axes[2] / scale.z);
+
+    return BoxBounds(center, rotationMatrix, scale * localSize);
 }
 
 void SceneModel::AcceptVisitor(SceneVisitor& visitor)
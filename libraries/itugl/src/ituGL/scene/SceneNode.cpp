@@ -48,7 +48,16 @@ std::shared_ptr<const Transform> SceneNode::GetTransform() const
 
 void SceneNode::SetTransform(std::shared_ptr<Transform> transform)
 {
+    // The entry in the spatial index follows the transform, so it is added again
+    if (m_scene)
+    {
+        m_scene->RemoveFromSpatialIndex(*this);
+    }
     m_transform = transform;
+    if (m_scene)
+    {
+        m_scene->AddToSpatialIndex(*this);
+    }
 }
 
 Scene* SceneNode::GetOwnerScene() const
@@ -61,6 +70,11 @@ void SceneNode::SetOwnerScene(Scene* scene)
     m_scene = scene;
 }
 
+bool SceneNode::HasBounds() const
+{
+    return false;
+}
+
 SphereBounds SceneNode::GetSphereBounds() const
 {
     return SphereBounds(glm::vec3(m_transform->GetTranslation()), 0.0f); // use world translation?
@@ -1,5 +1,13 @@
 #include <ituGL/scene/SceneVisitor.h>
 
+void SceneVisitor::BeginScene()
+{
+}
+
+void SceneVisitor::EndScene()
+{
+}
+
 void SceneVisitor::VisitCamera(SceneCamera& sceneCamera)
 {
     VisitCamera(const_cast<const SceneCamera&>(sceneCamera));
@@ -0,0 +1,77 @@
+#include <ituGL/scene/StaticBatch.h>
+
+#include <ituGL/scene/OcclusionBuffer.h>
+#include <ituGL/shader/Material.h>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <cassert>
+
+StaticBatch::StaticBatch(std::shared_ptr<const Material> material, const VertexFormat& vertexFormat, const Mesh::SemanticMap& locations,
+    std::span<const GLubyte> vertexData, std::span<const unsigned int> indices, std::vector<Cluster>&& clusters)
+    : m_material(std::move(material))
+    , m_vertexCount(static_cast<unsigned int>(vertexData.size() / vertexFormat.GetSize()))
+    , m_indexCount(static_cast<unsigned int>(indices.size()))
+    , m_clusters(std::move(clusters))
+{
+    assert(m_material);
+    assert(vertexData.size() % vertexFormat.GetSize() == 0);
+
+    VertexFormat format = vertexFormat;
+    m_mesh.AddSubmesh<GLubyte, unsigned int, VertexFormat::LayoutIterator>(Drawcall::Primitive::Triangles, vertexData, indices,
+        format.LayoutBegin(static_cast<int>(m_vertexCount), true), format.LayoutEnd(), locations);
+
+    m_cullingBatch.Reserve(GetClusterCount());
+    for (const Cluster& cluster : m_clusters)
+    {
+        assert(cluster.firstIndex + cluster.indexCount <= m_indexCount);
+        glm::vec3 extents = 0.5f * (cluster.boundsMax - cluster.boundsMin);
+        m_cullingBatch.Add(cluster.boundsMin + extents, extents, glm::length(extents));
+        m_mesh.ExpandBounds(cluster.boundsMin, cluster.boundsMax);
+    }
+}
+
+void StaticBatch::Cull(const FrustumBounds* frustum, const OcclusionBuffer* occlusionBuffer)
+{
+    m_visibleClusters.clear();
+    if (frustum)
+    {
+        m_cullingBatch.Cull(*frustum, m_visibleClusters);
+    }
+    else
+    {
+        m_visibleClusters.resize(GetClusterCount());
+        for (unsigned int i = 0; i < m_visibleClusters.size(); ++i)
+        {
+            m_visibleClusters[i] = i;
+        }
+    }
+
+    if (occlusionBuffer)
+    {
+        std::erase_if(m_visibleClusters, [&](unsigned int index) { return !occlusionBuffer->IsVisible(m_clusters[index].boundsMin, m_clusters[index].boundsMax); });
+    }
+
+    // The indices come in order, so clusters that follow each other in the index buffer can share a drawcall
+    m_visibleDrawcalls.clear();
+    unsigned int runFirst = 0, runCount = 0;
+    for (unsigned int index : m_visibleClusters)
+    {
+        const Cluster& cluster = m_clusters[index];
+        if (runCount > 0 && runFirst + runCount == cluster.firstIndex)
+        {
+            runCount += cluster.indexCount;
+            continue;
+        }
+        if (runCount > 0)
+        {
+            // The first element of indexed drawcalls is an offset in bytes
+            m_visibleDrawcalls.emplace_back(Drawcall::Primitive::Triangles, runCount, Data::Type::UInt, runFirst * static_cast<GLint>(sizeof(unsigned int)));
+        }
+        runFirst = cluster.firstIndex;
+        runCount = cluster.indexCount;
+    }
+    if (runCount > 0)
+    {
+        m_visibleDrawcalls.emplace_back(Drawcall::Primitive::Triangles, runCount, Data::Type::UInt, runFirst * static_cast<GLint>(sizeof(unsigned int)));
+    }
+}
@@ -0,0 +1,255 @@
+#include <ituGL/scene/StaticBatchBuilder.h>
+
+#include <ituGL/scene/StaticBatch.h>
+#include <ituGL/scene/SceneModel.h>
+#include <ituGL/scene/Transform.h>
+#include <ituGL/geometry/Model.h>
+#include <ituGL/shader/Material.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+// Vertex formats are only compatible if all their attributes match, in the same order
+static bool IsSameVertexFormat(const VertexFormat& a, const VertexFormat& b)
+{
+    if (a.GetAttributeCount() != b.GetAttributeCount() || a.GetSize() != b.GetSize())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.GetAttributeCount(); ++i)
+    {
+        VertexAttribute attributeA = a.GetAttribute(i);
+        VertexAttribute attributeB = b.GetAttribute(i);
+        if (attributeA.GetType() != attributeB.GetType() || attributeA.GetComponents() != attributeB.GetComponents()
+            || attributeA.IsNormalized() != attributeB.IsNormalized() || attributeA.GetSemantic() != attributeB.GetSemantic())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Spread the lower 10 bits of the value, leaving two zero bits between each of them
+static unsigned int SpreadBits(unsigned int value)
+{
+    value &= 0x3FF;
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8)) & 0x0300F00F;
+    value = (value | (value << 4)) & 0x030C30C3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+// 30 bit Morton code of a position normalized to [0, 1]
+static unsigned int GetMortonCode(const glm::vec3& position)
+{
+    glm::uvec3 cell(glm::clamp(position, 0.0f, 1.0f) * 1023.0f);
+    return (SpreadBits(cell.x) << 2) | (SpreadBits(cell.y) << 1) | SpreadBits(cell.z);
+}
+
+StaticBatchBuilder::StaticBatchBuilder() : m_clusterTriangleCount(1024), m_objectCount(0)
+{
+}
+
+void StaticBatchBuilder::SetClusterTriangleCount(unsigned int triangleCount)
+{
+    assert(triangleCount > 0);
+    m_clusterTriangleCount = triangleCount;
+}
+
+bool StaticBatchBuilder::AddModel(const Model& model, const glm::mat4& worldMatrix)
+{
+    const Mesh& mesh = model.GetMesh();
+    bool added = false;
+    for (unsigned int submeshIndex = 0; submeshIndex < model.GetMaterialCount(); ++submeshIndex)
+    {
+        const Mesh::SubmeshGeometry* geometry = mesh.GetSubmeshGeometry(submeshIndex);
+        if (!geometry || geometry->indices.empty())
+        {
+            continue;
+        }
+
+        // The loaders always put the position first, as 3 floats
+        VertexAttribute positionAttribute = geometry->vertexFormat.GetAttribute(0);
+        if (positionAttribute.GetSemantic() != VertexAttribute::Semantic::Position
+            || positionAttribute.GetType() != Data::Type::Float || positionAttribute.GetComponents() != 3)
+        {
+            continue;
+        }
+
+        Object object;
+        object.geometry = geometry;
+        object.worldMatrix = worldMatrix;
+        object.mortonCode = 0;
+
+        // Bounds of the transformed positions, tighter than transforming the local bounds
+        object.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        object.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        std::size_t vertexSize = geometry->vertexFormat.GetSize();
+        for (std::size_t offset = 0; offset < geometry->vertexData.size(); offset += vertexSize)
+        {
+            glm::vec3 position;
+            std::memcpy(&position, &geometry->vertexData[offset], sizeof(position));
+            glm::vec3 worldPosition = worldMatrix * glm::vec4(position, 1.0f);
+            object.boundsMin = glm::min(object.boundsMin, worldPosition);
+            object.boundsMax = glm::max(object.boundsMax, worldPosition);
+        }
+
+        // Find a group with the same material and format, or start a new one
+        std::shared_ptr<const Material> material = model.GetSharedMaterial(submeshIndex);
+        auto itGroup = std::find_if(m_groups.begin(), m_groups.end(), [&](const Group& group)
+            {
+                return group.material == material
+                    && group.referenceGeometry->locations == geometry->locations
+                    && IsSameVertexFormat(group.referenceGeometry->vertexFormat, geometry->vertexFormat);
+            });
+        if (itGroup == m_groups.end())
+        {
+            itGroup = m_groups.insert(m_groups.end(), Group{ material, geometry, {} });
+        }
+        itGroup->objects.push_back(object);
+
+        ++m_objectCount;
+        added = true;
+    }
+    return added;
+}
+
+bool StaticBatchBuilder::AddSceneModel(const SceneModel& sceneModel)
+{
+    assert(sceneModel.GetModel() && sceneModel.GetTransform());
+    return AddModel(*sceneModel.GetModel(), sceneModel.GetTransform()->GetTransformMatrix());
+}
+
+std::vector<std::shared_ptr<StaticBatch>> StaticBatchBuilder::Build()
+{
+    std::vector<std::shared_ptr<StaticBatch>> staticBatches;
+    staticBatches.reserve(m_groups.size());
+    for (Group& group : m_groups)
+    {
+        staticBatches.push_back(BuildGroup(group));
+    }
+    Clear();
+    return staticBatches;
+}
+
+void StaticBatchBuilder::Clear()
+{
+    m_groups.clear();
+    m_objectCount = 0;
+}
+
+std::shared_ptr<StaticBatch> StaticBatchBuilder::BuildGroup(Group& group) const
+{
+    // Sort the objects along a Morton curve, so consecutive objects are close to each other
+    glm::vec3 groupMin(std::numeric_limits<float>::max());
+    glm::vec3 groupMax(std::numeric_limits<float>::lowest());
+    std::size_t vertexCount = 0, indexCount = 0;
+    for (const Object& object : group.objects)
+    {
+        groupMin = glm::min(groupMin, object.boundsMin);
+        groupMax = glm::max(groupMax, object.boundsMax);
+        vertexCount += object.geometry->vertexData.size() / object.geometry->vertexFormat.GetSize();
+        indexCount += object.geometry->indices.size();
+    }
+    glm::vec3 groupSize = glm::max(groupMax - groupMin, glm::vec3(std::numeric_limits<float>::epsilon()));
+    for (Object& object : group.objects)
+    {
+        glm::vec3 center = 0.5f * (object.boundsMin + object.boundsMax);
+        object.mortonCode = GetMortonCode((center - groupMin) / groupSize);
+    }
+    std::stable_sort(group.objects.begin(), group.objects.end(), [](const Object& a, const Object& b) { return a.mortonCode < b.mortonCode; });
+
+    // 32-bit indices, so vertices of all the objects can be addressed
+    assert(vertexCount <= std::numeric_limits<unsigned int>::max());
+    const VertexFormat& vertexFormat = group.referenceGeometry->vertexFormat;
+    std::vector<GLubyte> vertexData;
+    vertexData.reserve(vertexCount * vertexFormat.GetSize());
+    std::vector<unsigned int> indices;
+    indices.reserve(indexCount);
+    std::vector<StaticBatch::Cluster> clusters;
+
+    unsigned int clusterIndexCount = 3 * m_clusterTriangleCount;
+    for (const Object& object : group.objects)
+    {
+        // Start a new cluster when the current one is full
+        if (clusters.empty() || clusters.back().indexCount >= clusterIndexCount)
+        {
+            unsigned int firstIndex = static_cast<unsigned int>(indices.size());
+            clusters.push_back({ object.boundsMin, object.boundsMax, firstIndex, 0 });
+        }
+        StaticBatch::Cluster& cluster = clusters.back();
+        cluster.boundsMin = glm::min(cluster.boundsMin, object.boundsMin);
+        cluster.boundsMax = glm::max(cluster.boundsMax, object.boundsMax);
+
+        unsigned int baseVertex = static_cast<unsigned int>(vertexData.size() / vertexFormat.GetSize());
+        AppendVertices(object, vertexData);
+
+        // A mirroring transform flips the triangles, swap two vertices to keep them front facing
+        bool flipWinding = glm::determinant(glm::mat3(object.worldMatrix)) < 0.0f;
+        const std::vector<unsigned int>& objectIndices = object.geometry->indices;
+        for (std::size_t i = 0; i + 2 < objectIndices.size(); i += 3)
+        {
+            indices.push_back(baseVertex + objectIndices[i]);
+            indices.push_back(baseVertex + objectIndices[flipWinding ? i + 2 : i + 1]);
+            indices.push_back(baseVertex + objectIndices[flipWinding ? i + 1 : i + 2]);
+        }
+        cluster.indexCount = static_cast<unsigned int>(indices.size()) - cluster.firstIndex;
+    }
+
+    return std::make_shared<StaticBatch>(group.material, vertexFormat, group.referenceGeometry->locations, vertexData, indices, std::move(clusters));
+}
+
+void StaticBatchBuilder::AppendVertices(const Object& object, std::vector<GLubyte>& vertexData)
+{
+    const Mesh::SubmeshGeometry& geometry = *object.geometry;
+    std::size_t firstByte = vertexData.size();
+    vertexData.insert(vertexData.end(), geometry.vertexData.begin(), geometry.vertexData.end());
+
+    glm::mat3 rotationMatrix(object.worldMatrix);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(rotationMatrix));
+
+    // Transform the attributes in place, the rest are kept as they are
+    VertexFormat vertexFormat = geometry.vertexFormat;
+    std::size_t vertexSize = vertexFormat.GetSize();
+    std::size_t vertexCount = geometry.vertexData.size() / vertexSize;
+    for (auto it = vertexFormat.LayoutBegin(static_cast<int>(vertexCount), true), itEnd = vertexFormat.LayoutEnd(); it != itEnd; it++)
+    {
+        const VertexAttribute& attribute = it->GetAttribute();
+        if (attribute.GetType() != Data::Type::Float || attribute.GetComponents() != 3)
+        {
+            continue;
+        }
+
+        VertexAttribute::Semantic semantic = attribute.GetSemantic();
+        bool isPosition = semantic == VertexAttribute::Semantic::Position;
+        bool isNormal = semantic == VertexAttribute::Semantic::Normal;
+        bool isTangent = semantic == VertexAttribute::Semantic::Tangent || semantic == VertexAttribute::Semantic::Bitangent;
+        if (!isPosition && !isNormal && !isTangent)
+        {
+            continue;
+        }
+
+        GLubyte* data = &vertexData[firstByte + it->GetOffset()];
+        for (std::size_t i = 0; i < vertexCount; ++i, data += vertexSize)
+        {
+            glm::vec3 value;
+            std::memcpy(&value, data, sizeof(value));
+            if (isPosition)
+            {
+                value = object.worldMatrix * glm::vec4(value, 1.0f);
+            }
+            else
+            {
+                value = (isNormal ? normalMatrix : rotationMatrix) * value;
+                float length = glm::length(value);
+                value = length > 0.0f ? value / length : value;
+            }
+            std::memcpy(data, &value, sizeof(value));
+        }
+    }
+}
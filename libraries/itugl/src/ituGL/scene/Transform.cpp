@@ -1,45 +1,54 @@
 #include <ituGL/scene/Transform.h>
 
 #include <glm/ext/matrix_transform.hpp>
+#include <cassert>
 
-Transform::Transform() : m_translation(0, 0, 0), m_rotation(0, 0, 0), m_scale(1, 1, 1), m_matrix(1.0f), m_dirty(false)
+Transform::Transform() : Transform(TransformHierarchy::GetDefault())
 {
 }
 
+Transform::Transform(TransformHierarchy& hierarchy) : m_hierarchy(hierarchy), m_handle(hierarchy.Create())
+{
+}
+
+Transform::~Transform()
+{
+    m_hierarchy.Destroy(m_handle);
+}
+
+void Transform::SetParent(std::shared_ptr<Transform> parent)
+{
+    assert(!parent || &parent->m_hierarchy == &m_hierarchy);
+    m_hierarchy.SetParent(m_handle, parent ? parent->m_handle : TransformHierarchy::Handle());
+    m_parent = parent;
+}
+
 glm::mat4 Transform::GetTranslationMatrix() const
 {
-    return glm::translate(glm::identity<glm::mat4>(), m_translation);
+    return glm::translate(glm::identity<glm::mat4>(), GetTranslation());
 }
 
 glm::mat4 Transform::GetRotationMatrix() const
 {
-    glm::mat4 matrix = glm::identity<glm::mat4>();
-    matrix = glm::rotate(matrix, m_rotation.y, glm::vec3(0, 1, 0));
-    matrix = glm::rotate(matrix, m_rotation.x, glm::vec3(1, 0, 0));
-    matrix = glm::rotate(matrix, m_rotation.z, glm::vec3(0, 0, 1));
-    return matrix;
+    return TransformHierarchy::ComposeMatrix(glm::vec3(0.0f), GetRotation(), glm::vec3(1.0f));
 }
 
 glm::mat4 Transform::GetScaleMatrix() const
 {
-    return glm::scale(glm::identity<glm::mat4>(), m_scale);
+    return glm::scale(glm::identity<glm::mat4>(), GetScale());
 }
 
 glm::mat4 Transform::GetTransformMatrix() const
 {
-    if (IsDirty())
-    {
-        m_matrix = GetTranslationMatrix() * GetRotationMatrix() * GetScaleMatrix();
-        if (m_parent)
-        {
-            m_matrix = m_parent->GetTransformMatrix() * m_matrix;
-        }
-        m_dirty = false;
-    }
-    return m_matrix;
+    return m_hierarchy.GetWorldMatrix(m_handle);
 }
 
 bool Transform::IsDirty() const
 {
-    return m_dirty || (m_parent && m_parent->IsDirty());
+    return m_hierarchy.IsDirty(m_handle);
+}
+
+unsigned int Transform::GetVersion() const
+{
+    return m_hierarchy.GetVersion(m_handle);
 }
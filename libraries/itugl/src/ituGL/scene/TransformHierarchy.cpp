@@ -0,0 +1,449 @@
+#include <ituGL/scene/TransformHierarchy.h>
+
+#include <ituGL/core/ThreadPool.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Levels with fewer dirty nodes than this are updated in the calling thread
+static const unsigned int s_parallelThreshold = 4096;
+static const unsigned int s_parallelBatchSize = 1024;
+
+TransformHierarchy::TransformHierarchy() : m_dirtyCount(0), m_structureDirty(false), m_versionCounter(0)
+{
+}
+
+TransformHierarchy::Handle TransformHierarchy::Create(Handle parent)
+{
+    unsigned int parentSlot = parent.IsValid() ? GetSlot(parent) : InvalidSlot;
+    unsigned int slot = GetCount();
+
+    m_translations.emplace_back(0.0f);
+    m_rotations.emplace_back(0.0f);
+    m_scales.emplace_back(1.0f);
+    m_parents.push_back(parentSlot);
+    m_depths.push_back(parentSlot != InvalidSlot ? m_depths[parentSlot] + 1 : 0);
+    m_firstChildren.push_back(0);
+    m_childCounts.push_back(0);
+    m_worldMatrices.emplace_back(1.0f);
+    m_dirty.push_back(1);
+    m_versions.push_back(++m_versionCounter);
+
+    // Reuse a free handle index, with a new generation
+    Handle handle;
+    if (!m_freeHandles.empty())
+    {
+        handle.index = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        handle.index = static_cast<unsigned int>(m_handleSlots.size());
+        m_handleSlots.push_back(InvalidSlot);
+        m_handleGenerations.push_back(0);
+    }
+    handle.generation = m_handleGenerations[handle.index];
+    m_handleSlots[handle.index] = slot;
+    m_slotHandles.push_back(handle.index);
+
+    ++m_dirtyCount;
+    m_structureDirty = true;
+    return handle;
+}
+
+void TransformHierarchy::Destroy(Handle handle)
+{
+    unsigned int slot = GetSlot(handle);
+
+    // Children find their new parent walking up through the destroyed slot
+    m_versions[slot] = ++m_versionCounter;
+    m_slotHandles[slot] = InvalidSlot;
+    m_handleSlots[handle.index] = InvalidSlot;
+    ++m_handleGenerations[handle.index];
+    m_freeHandles.push_back(handle.index);
+    m_structureDirty = true;
+}
+
+bool TransformHierarchy::IsAlive(Handle handle) const
+{
+    return handle.index < m_handleSlots.size()
+        && m_handleGenerations[handle.index] == handle.generation
+        && m_handleSlots[handle.index] != InvalidSlot;
+}
+
+TransformHierarchy::Handle TransformHierarchy::GetParent(Handle handle) const
+{
+    Handle parent;
+    unsigned int parentSlot = GetParentSlot(GetSlot(handle));
+    if (parentSlot != InvalidSlot)
+    {
+        parent.index = m_slotHandles[parentSlot];
+        parent.generation = m_handleGenerations[parent.index];
+    }
+    return parent;
+}
+
+void TransformHierarchy::SetParent(Handle handle, Handle parent)
+{
+    unsigned int slot = GetSlot(handle);
+    unsigned int parentSlot = parent.IsValid() ? GetSlot(parent) : InvalidSlot;
+
+#ifndef NDEBUG
+    // The node can't be its own ancestor
+    for (unsigned int ancestor = parentSlot; ancestor != InvalidSlot; ancestor = m_parents[ancestor])
+    {
+        assert(ancestor != slot);
+    }
+#endif
+
+    m_parents[slot] = parentSlot;
+    m_structureDirty = true;
+    SetDirty(slot);
+}
+
+void TransformHierarchy::SetTranslation(Handle handle, const glm::vec3& translation)
+{
+    unsigned int slot = GetSlot(handle);
+    m_translations[slot] = translation;
+    SetDirty(slot);
+}
+
+void TransformHierarchy::SetRotation(Handle handle, const glm::vec3& rotation)
+{
+    unsigned int slot = GetSlot(handle);
+    m_rotations[slot] = rotation;
+    SetDirty(slot);
+}
+
+void TransformHierarchy::SetScale(Handle handle, const glm::vec3& scale)
+{
+    unsigned int slot = GetSlot(handle);
+    m_scales[slot] = scale;
+    SetDirty(slot);
+}
+
+glm::mat4 TransformHierarchy::GetWorldMatrix(Handle handle)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(m_updateMutex);
+        if (!HasPendingChanges())
+        {
+            return m_worldMatrices[GetSlot(handle)];
+        }
+    }
+
+    // Checked again, another thread could have updated it meanwhile
+    std::unique_lock<std::shared_mutex> lock(m_updateMutex);
+    if (HasPendingChanges())
+    {
+        UpdateLocked();
+    }
+    return m_worldMatrices[GetSlot(handle)];
+}
+
+bool TransformHierarchy::IsDirty(Handle handle) const
+{
+    for (unsigned int slot = GetSlot(handle); slot != InvalidSlot; slot = m_parents[slot])
+    {
+        // A destroyed ancestor means a new parent
+        if (m_dirty[slot] || !IsSlotAlive(slot))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int TransformHierarchy::GetVersion(Handle handle) const
+{
+    unsigned int version = 0;
+    for (unsigned int slot = GetSlot(handle); slot != InvalidSlot; slot = m_parents[slot])
+    {
+        version = std::max(version, m_versions[slot]);
+    }
+    return version;
+}
+
+void TransformHierarchy::Update()
+{
+    std::unique_lock<std::shared_mutex> lock(m_updateMutex);
+    UpdateLocked();
+}
+
+void TransformHierarchy::UpdateLocked()
+{
+    if (m_structureDirty)
+    {
+        Reorder();
+    }
+
+    // Parents are always finished before their children, because the levels are processed in order
+    for (unsigned int depth = 0; depth < m_dirtyLevels.size(); ++depth)
+    {
+        if (m_dirtyLevels[depth].empty())
+        {
+            continue;
+        }
+
+        // Make room for the next level before taking references
+        if (depth + 1 >= m_dirtyLevels.size())
+        {
+            m_dirtyLevels.resize(depth + 2);
+        }
+        std::vector<unsigned int>& slots = m_dirtyLevels[depth];
+        std::vector<unsigned int>& nextSlots = m_dirtyLevels[depth + 1];
+
+        UpdateLevel(slots);
+
+        for (std::vector<Handle>* changes : m_changeLists)
+        {
+            for (unsigned int slot : slots)
+            {
+                Handle handle;
+                handle.index = m_slotHandles[slot];
+                handle.generation = m_handleGenerations[handle.index];
+                changes->push_back(handle);
+            }
+        }
+
+        // The children of updated nodes need an update too
+        for (unsigned int slot : slots)
+        {
+            unsigned int childEnd = m_firstChildren[slot] + m_childCounts[slot];
+            for (unsigned int child = m_firstChildren[slot]; child < childEnd; ++child)
+            {
+                if (!m_dirty[child])
+                {
+                    m_dirty[child] = 1;
+                    nextSlots.push_back(child);
+                }
+            }
+            m_dirty[slot] = 0;
+        }
+        slots.clear();
+    }
+    m_dirtyCount = 0;
+}
+
+void TransformHierarchy::UpdateLevel(const std::vector<unsigned int>& slots)
+{
+    auto UpdateRange = [&](unsigned int begin, unsigned int end)
+    {
+        for (unsigned int i = begin; i < end; ++i)
+        {
+            unsigned int slot = slots[i];
+            glm::mat4 localMatrix = ComposeMatrix(m_translations[slot], m_rotations[slot], m_scales[slot]);
+            unsigned int parentSlot = m_parents[slot];
+            m_worldMatrices[slot] = parentSlot != InvalidSlot ? m_worldMatrices[parentSlot] * localMatrix : localMatrix;
+        }
+    };
+
+    unsigned int count = static_cast<unsigned int>(slots.size());
+    if (count < s_parallelThreshold)
+    {
+        UpdateRange(0, count);
+    }
+    else
+    {
+        ThreadPool::GetDefault().ParallelFor(count, s_parallelBatchSize, UpdateRange);
+    }
+}
+
+void TransformHierarchy::AddChangeList(std::vector<Handle>& changes)
+{
+    assert(std::find(m_changeLists.begin(), m_changeLists.end(), &changes) == m_changeLists.end());
+    m_changeLists.push_back(&changes);
+}
+
+void TransformHierarchy::RemoveChangeList(std::vector<Handle>& changes)
+{
+    auto itChanges = std::find(m_changeLists.begin(), m_changeLists.end(), &changes);
+    assert(itChanges != m_changeLists.end());
+    m_changeLists.erase(itChanges);
+}
+
+glm::mat4 TransformHierarchy::ComposeMatrix(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    // Same as translate * rotate(Y) * rotate(X) * rotate(Z) * scale, written out to avoid the intermediate matrices
+    float cy = std::cos(rotation.y), sy = std::sin(rotation.y);
+    float cx = std::cos(rotation.x), sx = std::sin(rotation.x);
+    float cz = std::cos(rotation.z), sz = std::sin(rotation.z);
+
+    glm::mat4 matrix;
+    matrix[0] = glm::vec4(cy * cz + sy * sx * sz, sz * cx, -sy * cz + cy * sx * sz, 0.0f) * scale.x;
+    matrix[1] = glm::vec4(-cy * sz + sy * sx * cz, cz * cx, sz * sy + cy * sx * cz, 0.0f) * scale.y;
+    matrix[2] = glm::vec4(sy * cx, -sx, cy * cx, 0.0f) * scale.z;
+    matrix[3] = glm::vec4(translation, 1.0f);
+    return matrix;
+}
+
+TransformHierarchy& TransformHierarchy::GetDefault()
+{
+    static TransformHierarchy s_defaultHierarchy;
+    return s_defaultHierarchy;
+}
+
+unsigned int TransformHierarchy::GetSlot(Handle handle) const
+{
+    assert(IsAlive(handle));
+    return m_handleSlots[handle.index];
+}
+
+unsigned int TransformHierarchy::GetParentSlot(unsigned int slot) const
+{
+    unsigned int parentSlot = m_parents[slot];
+    while (parentSlot != InvalidSlot && !IsSlotAlive(parentSlot))
+    {
+        parentSlot = m_parents[parentSlot];
+    }
+    return parentSlot;
+}
+
+void TransformHierarchy::SetDirty(unsigned int slot)
+{
+    m_versions[slot] = ++m_versionCounter;
+    if (!m_dirty[slot])
+    {
+        m_dirty[slot] = 1;
+        ++m_dirtyCount;
+
+        // While the storage is out of order the lists are rebuilt from the flags instead
+        if (!m_structureDirty)
+        {
+            unsigned int depth = m_depths[slot];
+            if (depth >= m_dirtyLevels.size())
+            {
+                m_dirtyLevels.resize(depth + 1);
+            }
+            m_dirtyLevels[depth].push_back(slot);
+        }
+    }
+}
+
+void TransformHierarchy::Reorder()
+{
+    unsigned int oldCount = GetCount();
+
+    // Skip destroyed parents, and count the children of each slot
+    std::vector<unsigned int> childOffsets(oldCount + 1, 0);
+    std::vector<unsigned int> roots;
+    for (unsigned int slot = 0; slot < oldCount; ++slot)
+    {
+        if (!IsSlotAlive(slot))
+        {
+            continue;
+        }
+
+        unsigned int parentSlot = GetParentSlot(slot);
+        if (parentSlot != m_parents[slot])
+        {
+            m_parents[slot] = parentSlot;
+            m_versions[slot] = ++m_versionCounter;
+            m_dirty[slot] = 1;
+        }
+
+        if (parentSlot != InvalidSlot)
+        {
+            ++childOffsets[parentSlot + 1];
+        }
+        else
+        {
+            roots.push_back(slot);
+        }
+    }
+
+    // Children of each slot, in slot order
+    for (unsigned int slot = 0; slot < oldCount; ++slot)
+    {
+        childOffsets[slot + 1] += childOffsets[slot];
+    }
+    std::vector<unsigned int> children(childOffsets[oldCount]);
+    std::vector<unsigned int> childCursor(childOffsets.begin(), childOffsets.end() - 1);
+    for (unsigned int slot = 0; slot < oldCount; ++slot)
+    {
+        if (IsSlotAlive(slot) && m_parents[slot] != InvalidSlot)
+        {
+            children[childCursor[m_parents[slot]]++] = slot;
+        }
+    }
+
+    // Breadth-first order. Each node appends its children, so they end up contiguous
+    std::vector<unsigned int> order = std::move(roots);
+    order.reserve(oldCount);
+    std::vector<unsigned int> newSlots(oldCount, InvalidSlot);
+    std::vector<unsigned int> firstChildren, childCounts, depths;
+    firstChildren.reserve(oldCount);
+    childCounts.reserve(oldCount);
+    depths.reserve(oldCount);
+    depths.resize(order.size(), 0);
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        unsigned int oldSlot = order[i];
+        newSlots[oldSlot] = i;
+        firstChildren.push_back(static_cast<unsigned int>(order.size()));
+        childCounts.push_back(childOffsets[oldSlot + 1] - childOffsets[oldSlot]);
+        for (unsigned int c = childOffsets[oldSlot]; c < childOffsets[oldSlot + 1]; ++c)
+        {
+            order.push_back(children[c]);
+            depths.push_back(depths[i] + 1);
+        }
+    }
+
+    // Move all the arrays to the new order
+    unsigned int newCount = static_cast<unsigned int>(order.size());
+    auto Permute = [&](auto& values)
+    {
+        std::remove_reference_t<decltype(values)> newValues(newCount);
+        for (unsigned int i = 0; i < newCount; ++i)
+        {
+            newValues[i] = values[order[i]];
+        }
+        values = std::move(newValues);
+    };
+    Permute(m_translations);
+    Permute(m_rotations);
+    Permute(m_scales);
+    Permute(m_parents);
+    Permute(m_worldMatrices);
+    Permute(m_dirty);
+    Permute(m_versions);
+    Permute(m_slotHandles);
+
+    for (unsigned int i = 0; i < newCount; ++i)
+    {
+        if (m_parents[i] != InvalidSlot)
+        {
+            m_parents[i] = newSlots[m_parents[i]];
+        }
+        m_handleSlots[m_slotHandles[i]] = i;
+    }
+    m_firstChildren = std::move(firstChildren);
+    m_childCounts = std::move(childCounts);
+    m_depths = std::move(depths);
+
+    m_structureDirty = false;
+    RebuildDirtyLists();
+}
+
+void TransformHierarchy::RebuildDirtyLists()
+{
+    for (std::vector<unsigned int>& level : m_dirtyLevels)
+    {
+        level.clear();
+    }
+
+    m_dirtyCount = 0;
+    unsigned int count = GetCount();
+    for (unsigned int slot = 0; slot < count; ++slot)
+    {
+        if (m_dirty[slot])
+        {
+            if (m_depths[slot] >= m_dirtyLevels.size())
+            {
+                m_dirtyLevels.resize(m_depths[slot] + 1);
+            }
+            m_dirtyLevels[m_depths[slot]].push_back(slot);
+            ++m_dirtyCount;
+        }
+    }
+}
@@ -18,7 +18,9 @@ Material::Material(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet&
     , m_stencilDepthPass{ StencilOperation::Keep, StencilOperation::Keep }
     , m_blendEquations{ BlendEquation::None }
     , m_blendParams{ BlendParam::One, BlendParam::Zero, BlendParam::One, BlendParam::Zero }
+    , m_pipelineStateId(PipelineState::DefaultId)
 {
+    UpdatePipelineState();
 }
 
 void Material::SetShaderSetupFunction(ShaderSetupFunction shaderSetupFunction)
@@ -34,6 +36,8 @@ Material::TestFunction Material::GetDepthTestFunction() const
 void Material::SetDepthTestFunction(TestFunction function)
 {
     m_depthTestFunction = function;
+
+    UpdatePipelineState();
 }
 
 bool Material::GetDepthWrite() const
@@ -44,6 +48,8 @@ bool Material::GetDepthWrite() const
 void Material::SetDepthWrite(bool depthWrite)
 {
     m_depthWrite = depthWrite;
+
+    UpdatePipelineState();
 }
 
 void Material::SetStencilTestFunction(TestFunction function, int refValue, unsigned int mask)
@@ -64,6 +70,8 @@ void Material::SetStencilFrontTestFunction(TestFunction function, int refValue,
     m_stencilTestFunctions[0] = function;
     m_stencilRefValues[0] = refValue;
     m_stencilMasks[0] = mask;
+
+    UpdatePipelineState();
 }
 
 Material::TestFunction Material::GetStencilBackTestFunction(int& refValue, unsigned int& mask) const
@@ -78,6 +86,8 @@ void Material::SetStencilBackTestFunction(TestFunction function, int refValue, u
     m_stencilTestFunctions[1] = function;
     m_stencilRefValues[1] = refValue;
     m_stencilMasks[1] = mask;
+
+    UpdatePipelineState();
 }
 
 void Material::SetStencilOperations(StencilOperation stencilFail, StencilOperation depthFail, StencilOperation depthPass)
@@ -98,6 +108,8 @@ void Material::SetStencilFrontOperations(StencilOperation stencilFail, StencilOp
     m_stencilFail[0] = stencilFail;
     m_stencilDepthFail[0] = depthFail;
     m_stencilDepthPass[0] = depthPass;
+
+    UpdatePipelineState();
 }
 
 void Material::GetStencilBackOperations(StencilOperation& stencilFail, StencilOperation& depthFail, StencilOperation& depthPass) const
@@ -112,6 +124,8 @@ void Material::SetStencilBackOperations(StencilOperation stencilFail, StencilOpe
     m_stencilFail[1] = stencilFail;
     m_stencilDepthFail[1] = depthFail;
     m_stencilDepthPass[1] = depthPass;
+
+    UpdatePipelineState();
 }
 
 bool Material::HasBlend() const
@@ -138,6 +152,8 @@ void Material::SetBlendEquation(BlendEquation blendEquationColor, BlendEquation
 {
     m_blendEquations[0] = blendEquationColor;
     m_blendEquations[1] = blendEquationAlpha;
+
+    UpdatePipelineState();
 }
 
 Material::BlendParam Material::GetBlendParamSourceColor() const
@@ -176,6 +192,8 @@ void Material::SetBlendParams(BlendParam sourceColor, BlendParam destColor, Blen
     m_blendParams[1] = destColor;
     m_blendParams[2] = sourceAlpha;
     m_blendParams[3] = destAlpha;
+
+    UpdatePipelineState();
 }
 
 void Material::SetBlendParams(BlendParam sourceColor, BlendParam destColor, BlendParam sourceAlpha, BlendParam destAlpha, Color blendColor)
@@ -193,6 +211,8 @@ void Material::SetBlendColor(Color blendColor)
         || m_blendParams[3] == BlendParam::ConstantColor || m_blendParams[3] == BlendParam::ConstantAlpha);
 
     m_blendColor = blendColor;
+
+    UpdatePipelineState();
 }
 
 void Material::Use(OverrideFlags overrideFlags) const
@@ -211,122 +231,78 @@ void Material::Use(OverrideFlags overrideFlags) const
         m_shaderSetupFunction(*m_shaderProgram);
     }
 
-    // If not skipped, set the depth settings
-    if ((overrideFlags & OverrideFlags::OverrideDepthTest) == 0)
+    // Set depth, stencil and blend states that are not skipped. Only what changed from the last material is set
+    unsigned int groupMask = PipelineState::AllGroups;
+    if ((overrideFlags & OverrideFlags::OverrideDepthTest) != 0)
     {
-        UseDepthTest();
+        groupMask &= ~PipelineState::DepthGroup;
     }
-
-    // If not skipped, set the stencil settings
-    if ((overrideFlags & OverrideFlags::OverrideStencilTest) == 0)
+    if ((overrideFlags & OverrideFlags::OverrideStencilTest) != 0)
     {
-        UseStencilTest();
+        groupMask &= ~PipelineState::StencilGroup;
     }
-
-    // If not skipped, set the blend settings
-    if ((overrideFlags & OverrideFlags::OverrideBlend) == 0)
+    if ((overrideFlags & OverrideFlags::OverrideBlend) != 0)
     {
-        UseBlend();
+        groupMask &= ~PipelineState::BlendGroup;
     }
+    PipelineState::Apply(m_pipelineStateId, groupMask);
 }
 
-void Material::UseDepthTest() const
+void Material::UpdatePipelineState()
 {
-    // Depth function
-    glDepthFunc(static_cast<GLenum>(m_depthTestFunction));
+    PipelineState state;
 
-    // Depth write
-    glDepthMask(m_depthWrite ? GL_TRUE : GL_FALSE);
-}
+    // Depth
+    state.depthFunction = static_cast<GLenum>(m_depthTestFunction);
+    state.depthWrite = m_depthWrite;
 
-void Material::UseStencilTest() const
-{
-    // Stencil operations
-    if (m_stencilFail[0] == m_stencilFail[1] && m_stencilDepthFail[0] == m_stencilDepthFail[1] && m_stencilDepthPass[0] == m_stencilDepthPass[1])
+    // Stencil
+    for (int i = 0; i < 2; ++i)
     {
-        // Same for front and back
-        glStencilOp(static_cast<GLenum>(m_stencilFail[0]), static_cast<GLenum>(m_stencilDepthFail[0]), static_cast<GLenum>(m_stencilDepthPass[0]));
+        state.stencilFunctions[i] = static_cast<GLenum>(m_stencilTestFunctions[i]);
+        state.stencilRefValues[i] = m_stencilRefValues[i];
+        state.stencilMasks[i] = m_stencilMasks[i];
+        state.stencilFail[i] = static_cast<GLenum>(m_stencilFail[i]);
+        state.stencilDepthFail[i] = static_cast<GLenum>(m_stencilDepthFail[i]);
+        state.stencilDepthPass[i] = static_cast<GLenum>(m_stencilDepthPass[i]);
     }
-    else
-    {
-        // Separate functions for front and back
-        glStencilOpSeparate(GL_FRONT, static_cast<GLenum>(m_stencilFail[0]), static_cast<GLenum>(m_stencilDepthFail[0]), static_cast<GLenum>(m_stencilDepthPass[0]));
-        glStencilOpSeparate(GL_BACK, static_cast<GLenum>(m_stencilFail[1]), static_cast<GLenum>(m_stencilDepthFail[1]), static_cast<GLenum>(m_stencilDepthPass[1]));
-    }
-
-    // Stencil functions
-    if (m_stencilTestFunctions[0] == m_stencilTestFunctions[1] && m_stencilRefValues[0] == m_stencilRefValues[1] && m_stencilMasks[0] == m_stencilMasks[1])
-    {
-        // Same for front and back
-        glStencilFunc(static_cast<GLenum>(m_stencilTestFunctions[0]), m_stencilRefValues[0], m_stencilMasks[0]);
-    }
-    else
-    {
-        // Separate functions for front and back
-        glStencilFuncSeparate(GL_FRONT, static_cast<GLenum>(m_stencilTestFunctions[0]), m_stencilRefValues[0], m_stencilMasks[0]);
-        glStencilFuncSeparate(GL_BACK, static_cast<GLenum>(m_stencilTestFunctions[1]), m_stencilRefValues[1], m_stencilMasks[1]);
-    }
-}
 
-void Material::UseBlend() const
-{
-    // If the blend equation is None for color and alpha, do nothing
-    bool blending = HasBlend();
-    DeviceGL::GetInstance().SetFeatureEnabled(GL_BLEND, blending);
-    if (blending)
+    // Blend. If the blend equation is None for color and alpha, the rest is left with default values
+    state.blendEnabled = HasBlend();
+    if (state.blendEnabled)
     {
         std::array<BlendParam, 4> blendParams = m_blendParams;
+        std::array<BlendEquation, 2> blendEquations = m_blendEquations;
 
-        // Set blend equation
-        if (m_blendEquations[0] == m_blendEquations[1])
+        // Because there is no "None" equation, we replace it with (Source * 1 + Dest * 0)
+        if (blendEquations[0] == BlendEquation::None)
         {
-            // Set the same blend equation for color and alpha
-            glBlendEquation(static_cast<GLenum>(m_blendEquations[0]));
+            blendEquations[0] = BlendEquation::Add;
+            blendParams[0] = BlendParam::One;
+            blendParams[1] = BlendParam::Zero;
         }
-        else
+        if (blendEquations[1] == BlendEquation::None)
         {
-            GLenum blendEquationColor = static_cast<GLenum>(m_blendEquations[0]);
-            GLenum blendEquationAlpha = static_cast<GLenum>(m_blendEquations[1]);
-
-            // Because there is no "None" equation, we replace it with (Source * 1 + Dest * 0)
-            if (m_blendEquations[0] == BlendEquation::None)
-            {
-                blendEquationColor = GL_FUNC_ADD;
-                blendParams[0] = BlendParam::One;
-                blendParams[1] = BlendParam::Zero;
-            }
-            if (m_blendEquations[1] == BlendEquation::None)
-            {
-                blendEquationAlpha = GL_FUNC_ADD;
-                blendParams[2] = BlendParam::One;
-                blendParams[3] = BlendParam::Zero;
-            }
-
-            // Set separate blend equation for color and alpha
-            glBlendEquationSeparate(blendEquationColor, blendEquationAlpha);
+            blendEquations[1] = BlendEquation::Add;
+            blendParams[2] = BlendParam::One;
+            blendParams[3] = BlendParam::Zero;
         }
 
-        // Set blend params
-        if (blendParams[0] == blendParams[2] && blendParams[1] == blendParams[3])
+        bool usesBlendColor = false;
+        for (int i = 0; i < 4; ++i)
         {
-            // Set the same blend params for color and alpha
-            glBlendFunc(static_cast<GLenum>(blendParams[0]), static_cast<GLenum>(blendParams[1]));
-        }
-        else
-        {
-            // Set separate blend params for color and alpha
-            glBlendFuncSeparate(
-                static_cast<GLenum>(blendParams[0]), static_cast<GLenum>(blendParams[1]),
-                static_cast<GLenum>(blendParams[2]), static_cast<GLenum>(blendParams[3]));
+            state.blendParams[i] = static_cast<GLenum>(blendParams[i]);
+            usesBlendColor |= blendParams[i] == BlendParam::ConstantColor || blendParams[i] == BlendParam::ConstantAlpha;
         }
+        state.blendEquations[0] = static_cast<GLenum>(blendEquations[0]);
+        state.blendEquations[1] = static_cast<GLenum>(blendEquations[1]);
 
-        // Set blend color only if one param is using constant color or constant alpha
-        if (blendParams[0] == BlendParam::ConstantColor || blendParams[0] == BlendParam::ConstantAlpha ||
-            blendParams[1] == BlendParam::ConstantColor || blendParams[1] == BlendParam::ConstantAlpha ||
-            blendParams[2] == BlendParam::ConstantColor || blendParams[2] == BlendParam::ConstantAlpha ||
-            blendParams[3] == BlendParam::ConstantColor || blendParams[3] == BlendParam::ConstantAlpha)
+        // Blend color only matters if one param is using constant color or constant alpha
+        if (usesBlendColor)
         {
-            glBlendColor(m_blendColor.GetRed(), m_blendColor.GetGreen(), m_blendColor.GetBlue(), m_blendColor.GetAlpha());
+            state.blendColor = { m_blendColor.GetRed(), m_blendColor.GetGreen(), m_blendColor.GetBlue(), m_blendColor.GetAlpha() };
         }
     }
+
+    m_pipelineStateId = PipelineState::Intern(state);
 }
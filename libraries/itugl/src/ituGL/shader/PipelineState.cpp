@@ -0,0 +1,237 @@
+#include <ituGL/shader/PipelineState.h>
+
+#include <ituGL/core/DeviceGL.h>
+#include <unordered_map>
+#include <vector>
+#include <cassert>
+
+namespace
+{
+    // Interned states. Index 0 is always the default state
+    std::vector<PipelineState> s_states(1);
+    std::unordered_map<PipelineState, PipelineState::Id, PipelineState::Hasher> s_stateIds{ { PipelineState(), PipelineState::DefaultId } };
+
+    // Id of the state last applied for each group, or InvalidId if unknown
+    const PipelineState::Id InvalidId = ~0u;
+    PipelineState::Id s_currentDepthId = InvalidId;
+    PipelineState::Id s_currentStencilId = InvalidId;
+    PipelineState::Id s_currentBlendId = InvalidId;
+
+    // Get the current state of a group, or null if unknown
+    const PipelineState* GetCurrent(PipelineState::Id currentId)
+    {
+        return currentId != InvalidId ? &PipelineState::Get(currentId) : nullptr;
+    }
+
+    // Combine a value into the hash
+    template<typename T>
+    void HashCombine(std::size_t& hash, const T& value)
+    {
+        hash ^= std::hash<T>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+}
+
+PipelineState::PipelineState()
+    : depthFunction(GL_LESS)
+    , depthWrite(true)
+    , stencilFunctions{ GL_ALWAYS, GL_ALWAYS }
+    , stencilRefValues{ 0, 0 }
+    , stencilMasks{ ~0u, ~0u }
+    , stencilFail{ GL_KEEP, GL_KEEP }
+    , stencilDepthFail{ GL_KEEP, GL_KEEP }
+    , stencilDepthPass{ GL_KEEP, GL_KEEP }
+    , blendEnabled(false)
+    , blendEquations{ GL_FUNC_ADD, GL_FUNC_ADD }
+    , blendParams{ GL_ONE, GL_ZERO, GL_ONE, GL_ZERO }
+    , blendColor{ 0.0f, 0.0f, 0.0f, 0.0f }
+{
+}
+
+bool PipelineState::operator == (const PipelineState& other) const
+{
+    return depthFunction == other.depthFunction && depthWrite == other.depthWrite
+        && stencilFunctions == other.stencilFunctions && stencilRefValues == other.stencilRefValues && stencilMasks == other.stencilMasks
+        && stencilFail == other.stencilFail && stencilDepthFail == other.stencilDepthFail && stencilDepthPass == other.stencilDepthPass
+        && blendEnabled == other.blendEnabled && blendEquations == other.blendEquations
+        && blendParams == other.blendParams && blendColor == other.blendColor;
+}
+
+std::size_t PipelineState::GetHash() const
+{
+    std::size_t hash = 0;
+    HashCombine(hash, depthFunction);
+    HashCombine(hash, depthWrite);
+    for (int i = 0; i < 2; ++i)
+    {
+        HashCombine(hash, stencilFunctions[i]);
+        HashCombine(hash, stencilRefValues[i]);
+        HashCombine(hash, stencilMasks[i]);
+        HashCombine(hash, stencilFail[i]);
+        HashCombine(hash, stencilDepthFail[i]);
+        HashCombine(hash, stencilDepthPass[i]);
+        HashCombine(hash, blendEquations[i]);
+    }
+    HashCombine(hash, blendEnabled);
+    for (int i = 0; i < 4; ++i)
+    {
+        HashCombine(hash, blendParams[i]);
+        HashCombine(hash, blendColor[i]);
+    }
+    return hash;
+}
+
+PipelineState::Id PipelineState::Intern(const PipelineState& state)
+{
+    auto itFind = s_stateIds.find(state);
+    if (itFind != s_stateIds.end())
+    {
+        return itFind->second;
+    }
+
+    Id id = static_cast<Id>(s_states.size());
+    s_states.push_back(state);
+    s_stateIds.emplace(state, id);
+
+    return id;
+}
+
+const PipelineState& PipelineState::Get(Id id)
+{
+    assert(id < s_states.size());
+    return s_states[id];
+}
+
+unsigned int PipelineState::GetCount()
+{
+    return static_cast<unsigned int>(s_states.size());
+}
+
+void PipelineState::Apply(Id id, unsigned int groupMask)
+{
+    const PipelineState& state = Get(id);
+
+    if ((groupMask & DepthGroup) != 0 && id != s_currentDepthId)
+    {
+        ApplyDepth(state, GetCurrent(s_currentDepthId));
+        s_currentDepthId = id;
+    }
+
+    if ((groupMask & StencilGroup) != 0 && id != s_currentStencilId)
+    {
+        ApplyStencil(state, GetCurrent(s_currentStencilId));
+        s_currentStencilId = id;
+    }
+
+    if ((groupMask & BlendGroup) != 0 && id != s_currentBlendId)
+    {
+        ApplyBlend(state, GetCurrent(s_currentBlendId));
+        s_currentBlendId = id;
+    }
+}
+
+void PipelineState::Invalidate()
+{
+    s_currentDepthId = InvalidId;
+    s_currentStencilId = InvalidId;
+    s_currentBlendId = InvalidId;
+}
+
+void PipelineState::ApplyDepth(const PipelineState& state, const PipelineState* current)
+{
+    if (!current || state.depthFunction != current->depthFunction)
+    {
+        glDepthFunc(state.depthFunction);
+    }
+
+    if (!current || state.depthWrite != current->depthWrite)
+    {
+        glDepthMask(state.depthWrite ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void PipelineState::ApplyStencil(const PipelineState& state, const PipelineState* current)
+{
+    // Stencil operations
+    if (!current || state.stencilFail != current->stencilFail || state.stencilDepthFail != current->stencilDepthFail || state.stencilDepthPass != current->stencilDepthPass)
+    {
+        if (state.stencilFail[0] == state.stencilFail[1] && state.stencilDepthFail[0] == state.stencilDepthFail[1] && state.stencilDepthPass[0] == state.stencilDepthPass[1])
+        {
+            // Same for front and back
+            glStencilOp(state.stencilFail[0], state.stencilDepthFail[0], state.stencilDepthPass[0]);
+        }
+        else
+        {
+            // Separate functions for front and back
+            glStencilOpSeparate(GL_FRONT, state.stencilFail[0], state.stencilDepthFail[0], state.stencilDepthPass[0]);
+            glStencilOpSeparate(GL_BACK, state.stencilFail[1], state.stencilDepthFail[1], state.stencilDepthPass[1]);
+        }
+    }
+
+    // Stencil functions
+    if (!current || state.stencilFunctions != current->stencilFunctions || state.stencilRefValues != current->stencilRefValues || state.stencilMasks != current->stencilMasks)
+    {
+        if (state.stencilFunctions[0] == state.stencilFunctions[1] && state.stencilRefValues[0] == state.stencilRefValues[1] && state.stencilMasks[0] == state.stencilMasks[1])
+        {
+            // Same for front and back
+            glStencilFunc(state.stencilFunctions[0], state.stencilRefValues[0], state.stencilMasks[0]);
+        }
+        else
+        {
+            // Separate functions for front and back
+            glStencilFuncSeparate(GL_FRONT, state.stencilFunctions[0], state.stencilRefValues[0], state.stencilMasks[0]);
+            glStencilFuncSeparate(GL_BACK, state.stencilFunctions[1], state.stencilRefValues[1], state.stencilMasks[1]);
+        }
+    }
+}
+
+void PipelineState::ApplyBlend(const PipelineState& state, const PipelineState* current)
+{
+    if (!current || state.blendEnabled != current->blendEnabled)
+    {
+        DeviceGL::GetInstance().SetFeatureEnabled(GL_BLEND, state.blendEnabled);
+    }
+
+    if (!state.blendEnabled)
+    {
+        // The rest of the states are ignored, leave them as they are
+        return;
+    }
+
+    // Compare against the current values only if they were set, blend states are skipped while disabled
+    if (current && !current->blendEnabled)
+    {
+        current = nullptr;
+    }
+
+    // Set blend equation
+    if (!current || state.blendEquations != current->blendEquations)
+    {
+        if (state.blendEquations[0] == state.blendEquations[1])
+        {
+            glBlendEquation(state.blendEquations[0]);
+        }
+        else
+        {
+            glBlendEquationSeparate(state.blendEquations[0], state.blendEquations[1]);
+        }
+    }
+
+    // Set blend params
+    if (!current || state.blendParams != current->blendParams)
+    {
+        if (state.blendParams[0] == state.blendParams[2] && state.blendParams[1] == state.blendParams[3])
+        {
+            glBlendFunc(state.blendParams[0], state.blendParams[1]);
+        }
+        else
+        {
+            glBlendFuncSeparate(state.blendParams[0], state.blendParams[1], state.blendParams[2], state.blendParams[3]);
+        }
+    }
+
+    // Set blend color
+    if (!current || state.blendColor != current->blendColor)
+    {
+        glBlendColor(state.blendColor[0], state.blendColor[1], state.blendColor[2], state.blendColor[3]);
+    }
+}
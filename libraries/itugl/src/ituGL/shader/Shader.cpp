@@ -1,6 +1,7 @@
 #include <ituGL/shader/Shader.h>
 
 #include <cassert>
+#include <cstring>
 
 Shader::Shader(Type type) : Object(NullHandle)
 {
@@ -62,6 +63,37 @@ bool Shader::Compile()
     return IsCompiled();
 }
 
+// Start compiling the shader source code, without waiting for the result
+void Shader::CompileAsync()
+{
+    assert(IsValid());
+
+    glCompileShader(GetHandle());
+}
+
+bool Shader::IsParallelCompileSupported()
+{
+    // The extension list doesn't change, look for it once
+    static int s_supported = -1;
+    if (s_supported < 0)
+    {
+        s_supported = 0;
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; ++i)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension && (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0
+                || std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0))
+            {
+                s_supported = 1;
+                break;
+            }
+        }
+    }
+    return s_supported != 0;
+}
+
 // Check if the shader has been successfully compiled
 bool Shader::IsCompiled() const
 {
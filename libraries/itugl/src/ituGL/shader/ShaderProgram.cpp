@@ -82,6 +82,19 @@ bool ShaderProgram::Build(const Shader& vertexShader, const Shader& fragmentShad
     return Link();
 }
 
+// Attach the shaders and start linking them, without waiting for the result
+void ShaderProgram::BuildAsync(std::span<const Shader* const> shaders)
+{
+    assert(IsValid());
+    for (const Shader* shader : shaders)
+    {
+        // Not checking IsCompiled, it would wait for the compilation
+        assert(shader && shader->IsValid());
+        glAttachShader(GetHandle(), shader->GetHandle());
+    }
+    glLinkProgram(GetHandle());
+}
+
 // Attach a shader to be linked
 void ShaderProgram::AttachShader(const Shader& shader)
 {
@@ -110,6 +123,63 @@ bool ShaderProgram::IsLinked() const
     return success;
 }
 
+bool ShaderProgram::IsBinarySupported()
+{
+    if (!GLAD_GL_VERSION_4_1)
+    {
+        return false;
+    }
+
+    // Drivers can support the functions without any binary format
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+void ShaderProgram::SetBinaryRetrievable(bool retrievable)
+{
+    assert(IsValid());
+    glProgramParameteri(GetHandle(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, retrievable ? GL_TRUE : GL_FALSE);
+}
+
+bool ShaderProgram::GetBinary(GLenum& format, std::vector<std::byte>& binary) const
+{
+    assert(IsValid());
+    assert(IsLinked());
+
+    GLint length = 0;
+    glGetProgramiv(GetHandle(), GL_PROGRAM_BINARY_LENGTH, &length);
+    binary.resize(length);
+    if (length > 0)
+    {
+        glGetProgramBinary(GetHandle(), length, &length, &format, binary.data());
+        binary.resize(length);
+    }
+    return !binary.empty();
+}
+
+bool ShaderProgram::LoadBinary(GLenum format, std::span<const std::byte> binary)
+{
+    assert(IsValid());
+    glProgramBinary(GetHandle(), format, binary.data(), static_cast<GLsizei>(binary.size()));
+    return IsLinked();
+}
+
+// Check if the link finished
+bool ShaderProgram::IsLinkCompleted() const
+{
+    assert(IsValid());
+
+    if (!Shader::IsParallelCompileSupported())
+    {
+        return true;
+    }
+
+    GLint completed;
+    glGetProgramiv(GetHandle(), GL_COMPLETION_STATUS_KHR, &completed);
+    return completed;
+}
+
 // Get a string with linking error messages
 // The max length of the string returned is determined by the capacity of the span
 void ShaderProgram::GetLinkingErrors(std::span<char> errors) const
@@ -0,0 +1,479 @@
+#include <ituGL/texture/BlockCompressor.h>
+
+#include <ituGL/core/ThreadPool.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// Pixels of a 4x4 block, one array per channel. The encoders loop over the 16 pixels with fixed counts
+// and no branches inside, so the compiler can vectorize them
+struct Block
+{
+    float channels[4][16];
+};
+
+// Weights of the 16 palette entries of BC7 with 4-bit indices, out of 64
+static const int s_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Writes blocks bit by bit, starting from the lowest bit
+struct BitWriter
+{
+    std::uint64_t words[2] = { 0, 0 };
+    int position = 0;
+
+    void Write(std::uint32_t value, int bitCount)
+    {
+        for (int bit = 0; bit < bitCount; ++bit, ++position)
+        {
+            words[position >> 6] |= static_cast<std::uint64_t>((value >> bit) & 1) << (position & 63);
+        }
+    }
+};
+
+static void WriteLittleEndian(std::byte* output, std::uint64_t value, int byteCount)
+{
+    for (int i = 0; i < byteCount; ++i)
+    {
+        output[i] = static_cast<std::byte>((value >> (8 * i)) & 0xff);
+    }
+}
+
+// Copy the block at (blockX, blockY). Pixels outside the image repeat the last row or column
+static void LoadBlock(const std::byte* rgba, int width, int height, int blockX, int blockY, Block& block)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        int x = std::min(blockX * 4 + (i & 3), width - 1);
+        int y = std::min(blockY * 4 + (i >> 2), height - 1);
+        const std::byte* pixel = rgba + (static_cast<std::size_t>(y) * width + x) * 4;
+        for (int c = 0; c < 4; ++c)
+        {
+            block.channels[c][i] = static_cast<float>(pixel[c]);
+        }
+    }
+}
+
+// Endpoints of the segment that fits the first N channels of the block: the extremes of the projection of the pixels
+// on their principal axis, moved inwards by a fraction of the length, since the extremes are rarely the best choice
+template<int N>
+static void FitEndpoints(const Block& block, float inset, float endpoint0[N], float endpoint1[N])
+{
+    float mean[N];
+    float minValue[N];
+    float maxValue[N];
+    for (int c = 0; c < N; ++c)
+    {
+        float sum = 0.0f;
+        minValue[c] = maxValue[c] = block.channels[c][0];
+        for (int i = 0; i < 16; ++i)
+        {
+            sum += block.channels[c][i];
+            minValue[c] = std::min(minValue[c], block.channels[c][i]);
+            maxValue[c] = std::max(maxValue[c], block.channels[c][i]);
+        }
+        mean[c] = sum / 16.0f;
+    }
+
+    float covariance[N][N];
+    for (int a = 0; a < N; ++a)
+    {
+        for (int b = a; b < N; ++b)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                sum += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+            }
+            covariance[a][b] = covariance[b][a] = sum;
+        }
+    }
+
+    // Power iteration, starting from the diagonal of the bounding box
+    float axis[N];
+    for (int c = 0; c < N; ++c)
+    {
+        axis[c] = maxValue[c] - minValue[c];
+    }
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[N];
+        float length = 0.0f;
+        for (int a = 0; a < N; ++a)
+        {
+            next[a] = 0.0f;
+            for (int b = 0; b < N; ++b)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length == 0.0f)
+        {
+            break;
+        }
+        for (int c = 0; c < N; ++c)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float axisLength2 = 0.0f;
+    for (int c = 0; c < N; ++c)
+    {
+        axisLength2 += axis[c] * axis[c];
+    }
+
+    // Flat block: a single color
+    if (axisLength2 == 0.0f)
+    {
+        for (int c = 0; c < N; ++c)
+        {
+            endpoint0[c] = endpoint1[c] = mean[c];
+        }
+        return;
+    }
+
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < N; ++c)
+        {
+            t += (block.channels[c][i] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float offset = (maxT - minT) * inset;
+    minT = (minT + offset) / axisLength2;
+    maxT = (maxT - offset) / axisLength2;
+
+    for (int c = 0; c < N; ++c)
+    {
+        endpoint0[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+        endpoint1[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+    }
+}
+
+static std::uint16_t PackRGB565(const float color[3])
+{
+    int r = static_cast<int>(std::lround(color[0] * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(color[1] * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(std::uint16_t packed, float color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+// Color part of BC1 and BC3: two RGB565 endpoints and 2-bit indices, always in 4 color mode
+static void EncodeColorBlock(const Block& block, std::byte* output)
+{
+    float endpoint0[3], endpoint1[3];
+    FitEndpoints<3>(block, 1.0f / 16.0f, endpoint0, endpoint1);
+
+    // The first endpoint must be the greater for the 4 color mode
+    std::uint16_t color0 = PackRGB565(endpoint1);
+    std::uint16_t color1 = PackRGB565(endpoint0);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    std::uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        float palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestIndex = 0;
+            float bestDistance = 0.0f;
+            for (int index = 0; index < 4; ++index)
+            {
+                float distance = 0.0f;
+                for (int c = 0; c < 3; ++c)
+                {
+                    float difference = block.channels[c][i] - palette[index][c];
+                    distance += difference * difference;
+                }
+                if (index == 0 || distance < bestDistance)
+                {
+                    bestIndex = index;
+                    bestDistance = distance;
+                }
+            }
+            indices |= static_cast<std::uint32_t>(bestIndex) << (2 * i);
+        }
+    }
+
+    WriteLittleEndian(output, color0, 2);
+    WriteLittleEndian(output + 2, color1, 2);
+    WriteLittleEndian(output + 4, indices, 4);
+}
+
+// Single channel part of BC3, BC4 and BC5: two 8-bit endpoints and 3-bit indices, always in 8 value mode
+static void EncodeChannelBlock(const float values[16], std::byte* output)
+{
+    float minValue = values[0];
+    float maxValue = values[0];
+    for (int i = 0; i < 16; ++i)
+    {
+        minValue = std::min(minValue, values[i]);
+        maxValue = std::max(maxValue, values[i]);
+    }
+
+    int value0 = static_cast<int>(std::lround(maxValue));
+    int value1 = static_cast<int>(std::lround(minValue));
+    std::uint64_t bits = static_cast<std::uint64_t>(value0) | (static_cast<std::uint64_t>(value1) << 8);
+    if (value0 > value1)
+    {
+        // Indices 0 and 1 are the endpoints, 2 to 7 go from the first one to the second one
+        float scale = 7.0f / static_cast<float>(value0 - value1);
+        for (int i = 0; i < 16; ++i)
+        {
+            int step = std::clamp(static_cast<int>(std::lround((value0 - values[i]) * scale)), 0, 7);
+            int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+            bits |= static_cast<std::uint64_t>(index) << (16 + 3 * i);
+        }
+    }
+    WriteLittleEndian(output, bits, 8);
+}
+
+static void EncodeBC1(const Block& block, std::byte* output)
+{
+    EncodeColorBlock(block, output);
+}
+
+static void EncodeBC3(const Block& block, std::byte* output)
+{
+    EncodeChannelBlock(block.channels[3], output);
+    EncodeColorBlock(block, output + 8);
+}
+
+static void EncodeBC4(const Block& block, std::byte* output)
+{
+    EncodeChannelBlock(block.channels[0], output);
+}
+
+static void EncodeBC5(const Block& block, std::byte* output)
+{
+    EncodeChannelBlock(block.channels[0], output);
+    EncodeChannelBlock(block.channels[1], output + 8);
+}
+
+// BC7 in mode 6 only: a single RGBA segment with 7-bit endpoints, a shared low bit per endpoint, and 4-bit indices.
+// The other modes are better for blocks with several colors, but the search is far more expensive
+static void EncodeBC7(const Block& block, std::byte* output)
+{
+    float endpoints[2][4];
+    FitEndpoints<4>(block, 1.0f / 32.0f, endpoints[0], endpoints[1]);
+
+    // Pick the low bit that gets each endpoint closer
+    int quantized[2][4];
+    int lowBits[2];
+    for (int e = 0; e < 2; ++e)
+    {
+        float bestError = 0.0f;
+        for (int lowBit = 0; lowBit < 2; ++lowBit)
+        {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                candidate[c] = std::clamp(static_cast<int>(std::lround((endpoints[e][c] - lowBit) * 0.5f)), 0, 127);
+                float difference = static_cast<float>(candidate[c] * 2 + lowBit) - endpoints[e][c];
+                error += difference * difference;
+            }
+            if (lowBit == 0 || error < bestError)
+            {
+                bestError = error;
+                lowBits[e] = lowBit;
+                std::copy_n(candidate, 4, quantized[e]);
+            }
+        }
+    }
+
+    float palette[16][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        int value0 = quantized[0][c] * 2 + lowBits[0];
+        int value1 = quantized[1][c] * 2 + lowBits[1];
+        for (int index = 0; index < 16; ++index)
+        {
+            palette[index][c] = static_cast<float>(((64 - s_bc7Weights[index]) * value0 + s_bc7Weights[index] * value1 + 32) >> 6);
+        }
+    }
+
+    int indices[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        indices[i] = 0;
+        float bestDistance = 0.0f;
+        for (int index = 0; index < 16; ++index)
+        {
+            float distance = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                float difference = block.channels[c][i] - palette[index][c];
+                distance += difference * difference;
+            }
+            if (index == 0 || distance < bestDistance)
+            {
+                indices[i] = index;
+                bestDistance = distance;
+            }
+        }
+    }
+
+    // The highest bit of the first index is not stored, it must be 0. The weights are symmetric,
+    // so swapping the endpoints and mirroring the indices gives the same colors
+    if (indices[0] >= 8)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            std::swap(quantized[0][c], quantized[1][c]);
+        }
+        std::swap(lowBits[0], lowBits[1]);
+        for (int i = 0; i < 16; ++i)
+        {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    BitWriter writer;
+    writer.Write(1 << 6, 7); // Mode 6
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.Write(quantized[0][c], 7);
+        writer.Write(quantized[1][c], 7);
+    }
+    writer.Write(lowBits[0], 1);
+    writer.Write(lowBits[1], 1);
+    writer.Write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+    {
+        writer.Write(indices[i], 4);
+    }
+    assert(writer.position == 128);
+
+    WriteLittleEndian(output, writer.words[0], 8);
+    WriteLittleEndian(output + 8, writer.words[1], 8);
+}
+
+TextureObject::InternalFormat BlockCompressor::SelectInternalFormat(Usage usage, bool srgb)
+{
+    switch (usage)
+    {
+    case Usage::Color:
+        if (TextureObject::IsBlockCompressionSupported(TextureObject::InternalFormatBC1))
+            return srgb ? TextureObject::InternalFormatSRGBBC1 : TextureObject::InternalFormatBC1;
+        return srgb ? TextureObject::InternalFormatSRGB8 : TextureObject::InternalFormatRGB8;
+    case Usage::ColorAlpha:
+        if (TextureObject::IsBlockCompressionSupported(TextureObject::InternalFormatBC7))
+            return srgb ? TextureObject::InternalFormatSRGBBC7 : TextureObject::InternalFormatBC7;
+        if (TextureObject::IsBlockCompressionSupported(TextureObject::InternalFormatBC3))
+            return srgb ? TextureObject::InternalFormatSRGBBC3 : TextureObject::InternalFormatBC3;
+        return srgb ? TextureObject::InternalFormatSRGBA8 : TextureObject::InternalFormatRGBA8;
+    case Usage::Normal:
+        return TextureObject::InternalFormatBC5;
+    case Usage::Mask:
+        return TextureObject::InternalFormatBC4;
+    default:
+        return TextureObject::InternalFormatInvalid;
+    }
+}
+
+TextureObject::Format BlockCompressor::GetFormat(Usage usage)
+{
+    switch (usage)
+    {
+    case Usage::Color:
+        return TextureObject::FormatRGB;
+    case Usage::ColorAlpha:
+        return TextureObject::FormatRGBA;
+    case Usage::Normal:
+        return TextureObject::FormatRG;
+    case Usage::Mask:
+        return TextureObject::FormatR;
+    default:
+        return TextureObject::FormatInvalid;
+    }
+}
+
+void BlockCompressor::Compress(TextureObject::InternalFormat internalFormat,
+    std::span<const std::byte> rgba, int width, int height,
+    std::span<std::byte> output, ThreadPool* threadPool)
+{
+    assert(rgba.size() == static_cast<std::size_t>(width) * height * 4);
+    assert(output.size() == static_cast<std::size_t>(TextureObject::GetCompressedImageSize(internalFormat, width, height)));
+
+    void (*encodeBlock)(const Block&, std::byte*) = nullptr;
+    switch (internalFormat)
+    {
+    case TextureObject::InternalFormatBC1:
+    case TextureObject::InternalFormatSRGBBC1:
+        encodeBlock = EncodeBC1;
+        break;
+    case TextureObject::InternalFormatBC3:
+    case TextureObject::InternalFormatSRGBBC3:
+        encodeBlock = EncodeBC3;
+        break;
+    case TextureObject::InternalFormatBC4:
+        encodeBlock = EncodeBC4;
+        break;
+    case TextureObject::InternalFormatBC5:
+        encodeBlock = EncodeBC5;
+        break;
+    case TextureObject::InternalFormatBC7:
+    case TextureObject::InternalFormatSRGBBC7:
+        encodeBlock = EncodeBC7;
+        break;
+    default:
+        assert(false);
+        return;
+    }
+
+    int blockSize = TextureObject::GetBlockSize(internalFormat);
+    int blockCountX = (width + 3) / 4;
+    int blockCountY = (height + 3) / 4;
+    auto EncodeRows = [&](unsigned int begin, unsigned int end)
+    {
+        Block block;
+        for (unsigned int blockY = begin; blockY < end; ++blockY)
+        {
+            std::byte* rowOutput = output.data() + static_cast<std::size_t>(blockY) * blockCountX * blockSize;
+            for (int blockX = 0; blockX < blockCountX; ++blockX)
+            {
+                LoadBlock(rgba.data(), width, height, blockX, blockY, block);
+                encodeBlock(block, rowOutput + blockX * blockSize);
+            }
+        }
+    };
+
+    if (threadPool)
+    {
+        threadPool->ParallelFor(blockCountY, 4, EncodeRows);
+    }
+    else
+    {
+        EncodeRows(0, blockCountY);
+    }
+}
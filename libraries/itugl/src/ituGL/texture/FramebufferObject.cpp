@@ -58,6 +58,14 @@ void FramebufferObject::SetTexture(Target target, Attachment attachment, const T
     glFramebufferTexture2D(static_cast<GLenum>(target), static_cast<GLenum>(attachment), texture.GetTarget(), texture.GetHandle(), level);
 }
 
+void FramebufferObject::Blit(const FramebufferObject& source, const FramebufferObject& target, GLint width, GLint height, GLbitfield mask)
+{
+    source.Bind(Target::Read);
+    target.Bind(Target::Draw);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, mask, GL_NEAREST);
+    Unbind(Target::Read);
+}
+
 void FramebufferObject::SetDrawBuffers(std::span<const Attachment> attachments)
 {
     glDrawBuffers(static_cast<GLint>(attachments.size()), reinterpret_cast<const GLenum*>(attachments.data()));
@@ -0,0 +1,82 @@
+#include <ituGL/texture/HeightmapSampler.h>
+
+#include <glm/common.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+HeightmapSampler::HeightmapSampler() : m_width(0), m_height(0), m_minValue(0.0f), m_maxValue(0.0f)
+{
+}
+
+void HeightmapSampler::SetData(std::span<const std::byte> data, int width, int height, int componentCount, Data::Type dataType)
+{
+    std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+    std::size_t pixelSize = static_cast<std::size_t>(componentCount) * Data::GetTypeSize(dataType);
+    assert(data.size() >= pixelCount * pixelSize);
+
+    m_samples.resize(pixelCount);
+    m_width = width;
+    m_height = height;
+    for (std::size_t i = 0; i < pixelCount; ++i)
+    {
+        // Copied out, the data is not aligned to the type in every case
+        const std::byte* pixel = data.data() + i * pixelSize;
+        switch (dataType)
+        {
+        case Data::Type::UByte:
+            m_samples[i] = static_cast<std::uint8_t>(*pixel) / 255.0f;
+            break;
+        case Data::Type::UShort:
+        {
+            std::uint16_t value;
+            std::memcpy(&value, pixel, sizeof(value));
+            m_samples[i] = value / 65535.0f;
+            break;
+        }
+        case Data::Type::Float:
+            std::memcpy(&m_samples[i], pixel, sizeof(float));
+            break;
+        default:
+            assert(false);
+            m_samples[i] = 0.0f;
+            break;
+        }
+    }
+
+    auto minMax = std::minmax_element(m_samples.begin(), m_samples.end());
+    m_minValue = minMax.first != m_samples.end() ? *minMax.first : 0.0f;
+    m_maxValue = minMax.second != m_samples.end() ? *minMax.second : 0.0f;
+}
+
+void HeightmapSampler::Clear()
+{
+    m_samples.clear();
+    m_width = 0;
+    m_height = 0;
+    m_minValue = 0.0f;
+    m_maxValue = 0.0f;
+}
+
+float HeightmapSampler::Fetch(int x, int y) const
+{
+    assert(!IsEmpty());
+    x = std::clamp(x, 0, m_width - 1);
+    y = std::clamp(y, 0, m_height - 1);
+    return m_samples[static_cast<std::size_t>(y) * m_width + x];
+}
+
+float HeightmapSampler::Sample(const glm::vec2& texCoord) const
+{
+    // Texel centers are at half texels, the 4 texels around the coordinates are blended
+    glm::vec2 texelCoord = texCoord * glm::vec2(m_width, m_height) - 0.5f;
+    glm::vec2 texel = glm::floor(texelCoord);
+    glm::vec2 weight = texelCoord - texel;
+    int x = static_cast<int>(texel.x);
+    int y = static_cast<int>(texel.y);
+
+    float bottom = Fetch(x, y) + (Fetch(x + 1, y) - Fetch(x, y)) * weight.x;
+    float top = Fetch(x, y + 1) + (Fetch(x + 1, y + 1) - Fetch(x, y + 1)) * weight.x;
+    return bottom + (top - bottom) * weight.y;
+}
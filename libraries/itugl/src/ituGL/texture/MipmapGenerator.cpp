@@ -0,0 +1,232 @@
+#include <ituGL/texture/MipmapGenerator.h>
+
+#include <ituGL/core/ThreadPool.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+// Each destination pixel reads the 6 source pixels around it, from 2x-2 to 2x+3, in each direction
+static const int s_tapCount = 6;
+using Weights = std::array<float, s_tapCount>;
+
+// Rows per batch when splitting the passes between threads
+static const unsigned int s_rowBatchSize = 16;
+
+// Modified Bessel function of the first kind, order 0, used by the Kaiser window
+static float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; ++k)
+    {
+        float factor = x / (2.0f * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+static Weights ComputeKaiserWeights()
+{
+    const float pi = 3.14159265f;
+    const float width = 1.5f; // In destination pixels
+    const float alpha = 4.0f;
+
+    Weights weights;
+    float sum = 0.0f;
+    for (int k = 0; k < s_tapCount; ++k)
+    {
+        // Distance from the center of the destination pixel, in destination pixels
+        float t = (k - 2.5f) * 0.5f;
+        float sinc = std::sin(pi * t) / (pi * t);
+        float r = t / width;
+        float window = BesselI0(alpha * std::sqrt(std::max(1.0f - r * r, 0.0f))) / BesselI0(alpha);
+        weights[k] = sinc * window;
+        sum += weights[k];
+    }
+    for (float& weight : weights)
+    {
+        weight /= sum;
+    }
+    return weights;
+}
+
+static const Weights& GetWeights(MipmapGenerator::Filter filter)
+{
+    static const Weights s_boxWeights = { 0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f };
+    static const Weights s_kaiserWeights = ComputeKaiserWeights();
+    return filter == MipmapGenerator::Filter::Kaiser ? s_kaiserWeights : s_boxWeights;
+}
+
+static float SRGBToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Run the function for the rows in [0, count), in the threads of the pool if there is one
+static void ForEachRow(ThreadPool* threadPool, int count, const ThreadPool::RangeFunction& function)
+{
+    if (threadPool)
+    {
+        threadPool->ParallelFor(count, s_rowBatchSize, function);
+    }
+    else
+    {
+        function(0, count);
+    }
+}
+
+// Filter and halve one direction. Lines are the rows or the columns, and the pixels are spaced by the stride
+static void FilterLines(const float* source, float* destination, int lineCount, int sourceLength,
+    int sourceLineStride, int sourcePixelStride, int destinationLineStride, int destinationPixelStride,
+    int channelCount, const Weights& weights, ThreadPool* threadPool)
+{
+    int destinationLength = std::max(sourceLength / 2, 1);
+    ForEachRow(threadPool, lineCount, [&](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int line = begin; line < end; ++line)
+            {
+                const float* sourceLine = source + line * sourceLineStride;
+                float* destinationLine = destination + line * destinationLineStride;
+                for (int i = 0; i < destinationLength; ++i)
+                {
+                    float* pixel = destinationLine + i * destinationPixelStride;
+                    std::fill_n(pixel, channelCount, 0.0f);
+
+                    // A line of 1 pixel is only copied
+                    if (sourceLength == 1)
+                    {
+                        std::copy_n(sourceLine, channelCount, pixel);
+                        continue;
+                    }
+
+                    // Pixels outside the image repeat the edge
+                    for (int k = 0; k < s_tapCount; ++k)
+                    {
+                        int sourceIndex = std::clamp(2 * i - 2 + k, 0, sourceLength - 1);
+                        const float* sourcePixel = sourceLine + sourceIndex * sourcePixelStride;
+                        for (int c = 0; c < channelCount; ++c)
+                        {
+                            pixel[c] += weights[k] * sourcePixel[c];
+                        }
+                    }
+                }
+            }
+        });
+}
+
+int MipmapGenerator::GetLevelCount(int width, int height)
+{
+    return 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(std::max(width, height), 1)))));
+}
+
+std::vector<std::byte> MipmapGenerator::Downsample(std::span<const std::byte> image, int width, int height, int componentCount,
+    const Settings& settings, ThreadPool* threadPool)
+{
+    assert(componentCount >= 1 && componentCount <= 4);
+    assert(image.size() == static_cast<std::size_t>(width) * height * componentCount);
+
+    // Decoding table for sRGB, built once
+    static const std::array<float, 256> s_srgbToLinear = []()
+        {
+            std::array<float, 256> table;
+            for (int i = 0; i < 256; ++i)
+            {
+                table[i] = SRGBToLinear(i / 255.0f);
+            }
+            return table;
+        }();
+
+    // Normal maps with only XY get their Z while filtering, so they can be renormalized
+    bool normalMap = settings.normalMap && componentCount >= 2;
+    // Only RGB and RGBA images have sRGB colors
+    bool srgb = settings.srgb && !normalMap && componentCount >= 3;
+    int channelCount = normalMap ? std::max(componentCount, 3) : componentCount;
+
+    // Decode to linear values
+    std::vector<float> source(static_cast<std::size_t>(width) * height * channelCount);
+    ForEachRow(threadPool, height, [&](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    std::size_t pixelIndex = static_cast<std::size_t>(y) * width + x;
+                    const std::byte* input = image.data() + pixelIndex * componentCount;
+                    float* output = source.data() + pixelIndex * channelCount;
+                    for (int c = 0; c < componentCount; ++c)
+                    {
+                        std::uint8_t value = static_cast<std::uint8_t>(input[c]);
+                        if (normalMap && c < 3)
+                            output[c] = value / 255.0f * 2.0f - 1.0f;
+                        else if (srgb && c < 3)
+                            output[c] = s_srgbToLinear[value];
+                        else
+                            output[c] = value / 255.0f;
+                    }
+                    if (normalMap && componentCount == 2)
+                    {
+                        output[2] = std::sqrt(std::max(1.0f - output[0] * output[0] - output[1] * output[1], 0.0f));
+                    }
+                }
+            }
+        });
+
+    // Separable filter: rows first, then columns
+    const Weights& weights = GetWeights(settings.filter);
+    int halfWidth = std::max(width / 2, 1);
+    int halfHeight = std::max(height / 2, 1);
+
+    std::vector<float> rows(static_cast<std::size_t>(halfWidth) * height * channelCount);
+    FilterLines(source.data(), rows.data(), height, width,
+        width * channelCount, channelCount, halfWidth * channelCount, channelCount,
+        channelCount, weights, threadPool);
+
+    std::vector<float> columns(static_cast<std::size_t>(halfWidth) * halfHeight * channelCount);
+    FilterLines(rows.data(), columns.data(), halfWidth, height,
+        channelCount, halfWidth * channelCount, channelCount, halfWidth * channelCount,
+        channelCount, weights, threadPool);
+
+    // Encode back to 8 bits
+    std::vector<std::byte> result(static_cast<std::size_t>(halfWidth) * halfHeight * componentCount);
+    ForEachRow(threadPool, halfHeight, [&](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int y = begin; y < end; ++y)
+            {
+                for (int x = 0; x < halfWidth; ++x)
+                {
+                    std::size_t pixelIndex = static_cast<std::size_t>(y) * halfWidth + x;
+                    float* input = columns.data() + pixelIndex * channelCount;
+                    std::byte* output = result.data() + pixelIndex * componentCount;
+
+                    if (normalMap)
+                    {
+                        float length = std::sqrt(input[0] * input[0] + input[1] * input[1] + input[2] * input[2]);
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            input[c] = length > 0.0f ? (input[c] / length) * 0.5f + 0.5f : (c == 2 ? 1.0f : 0.5f);
+                        }
+                    }
+
+                    for (int c = 0; c < componentCount; ++c)
+                    {
+                        // The sinc lobes can go slightly out of range
+                        float value = std::clamp(input[c], 0.0f, 1.0f);
+                        if (srgb && c < 3)
+                        {
+                            value = LinearToSRGB(value);
+                        }
+                        output[c] = static_cast<std::byte>(std::lround(value * 255.0f));
+                    }
+                }
+            }
+        });
+    return result;
+}
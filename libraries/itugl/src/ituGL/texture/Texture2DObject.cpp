@@ -20,3 +20,12 @@ void Texture2DObject::SetImage(GLint level, GLsizei width, GLsizei height, Forma
 {
     SetImage<float>(level, width, height, format, internalFormat, std::span<float>());
 }
+
+void Texture2DObject::SetCompressedImage(GLint level, GLsizei width, GLsizei height, InternalFormat internalFormat, std::span<const std::byte> data)
+{
+    assert(IsBound());
+    assert(IsBlockCompressed(internalFormat));
+    GLsizei imageSize = GetCompressedImageSize(internalFormat, width, height);
+    assert(data.empty() || data.size_bytes() == static_cast<std::size_t>(imageSize));
+    glCompressedTexImage2D(GetTarget(), level, internalFormat, width, height, 0, imageSize, data.data());
+}
@@ -0,0 +1,35 @@
+#include <ituGL/texture/TextureBufferObject.h>
+
+#include <algorithm>
+#include <cassert>
+
+TextureBufferObject::TextureBufferObject() : m_capacity(0), m_internalFormat(InternalFormatInvalid)
+{
+}
+
+void TextureBufferObject::SetData(std::span<const std::byte> data, InternalFormat internalFormat)
+{
+    assert(IsBound());
+
+    m_buffer.Bind();
+    if (data.size_bytes() > m_capacity || m_capacity == 0)
+    {
+        // Grow geometrically, so a slowly increasing size doesn't reallocate every frame.
+        // Never empty, a buffer texture without storage is incomplete
+        m_capacity = std::max({ data.size_bytes(), 2 * m_capacity, size_t(64) });
+        m_buffer.AllocateData(m_capacity, BufferObject::StreamDraw);
+    }
+    if (!data.empty())
+    {
+        m_buffer.UpdateData(data);
+    }
+    Buffer::Unbind();
+
+    // The attachment keeps pointing to the buffer after reallocating its storage, only the format can change it
+    if (internalFormat != m_internalFormat)
+    {
+        const Buffer& buffer = m_buffer;
+        glTexBuffer(GetTarget(), internalFormat, buffer.GetHandle());
+        m_internalFormat = internalFormat;
+    }
+}
@@ -26,3 +26,12 @@ void TextureCubemapObject::SetImage(GLint level, GLsizei side, Format format, In
     SetImage<std::byte>(level, Face::Front, side, format, internalFormat, empty, Data::Type::None);
     SetImage<std::byte>(level, Face::Back, side, format, internalFormat, empty, Data::Type::None);
 }
+
+void TextureCubemapObject::SetCompressedImage(GLint level, Face face, GLsizei side, InternalFormat internalFormat, std::span<const std::byte> data)
+{
+    assert(IsBound());
+    assert(IsBlockCompressed(internalFormat));
+    GLsizei imageSize = GetCompressedImageSize(internalFormat, side, side);
+    assert(data.empty() || data.size_bytes() == static_cast<std::size_t>(imageSize));
+    glCompressedTexImage2D(static_cast<GLenum>(face), level, internalFormat, side, side, 0, imageSize, data.data());
+}
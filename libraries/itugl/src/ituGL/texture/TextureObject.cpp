@@ -1,6 +1,7 @@
 #include <ituGL/texture/TextureObject.h>
 
 #include <cassert>
+#include <cstring>
 
 TextureObject::TextureObject() : Object(NullHandle)
 {
@@ -119,6 +120,7 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatR16F:
     case InternalFormatR32F:
     case InternalFormatRCompressed:
+    case InternalFormatBC4:
         return format == FormatR;
     case InternalFormatRG:
     case InternalFormatRG8:
@@ -128,6 +130,7 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRG16F:
     case InternalFormatRG32F:
     case InternalFormatRGCompressed:
+    case InternalFormatBC5:
         return format == FormatRG;
     case InternalFormatRGB:
     case InternalFormatRGB8:
@@ -140,6 +143,8 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRGBCompressed:
     case InternalFormatSRGBCompressed:
     case InternalFormatR11G11B10:
+    case InternalFormatBC1:
+    case InternalFormatSRGBBC1:
         return format == FormatRGB || format == FormatBGR;
     case InternalFormatRGBA:
     case InternalFormatRGBA8:
@@ -152,6 +157,10 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRGBACompressed:
     case InternalFormatSRGBACompressed:
     case InternalFormatRGB10A2:
+    case InternalFormatBC3:
+    case InternalFormatSRGBBC3:
+    case InternalFormatBC7:
+    case InternalFormatSRGBBC7:
         return format == FormatRGBA || format == FormatBGRA;
     case InternalFormatDepth:
     case InternalFormatDepth16:
@@ -163,6 +172,12 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatDepth24Stencil8:
     case InternalFormatDepth32FStencil8:
         return format == FormatDepthStencil;
+    case InternalFormatR32UI:
+        return format == FormatRInteger;
+    case InternalFormatRG32UI:
+        return format == FormatRGInteger;
+    case InternalFormatRGBA32UI:
+        return format == FormatRGBAInteger;
     default:
         //Unknown format
         return false;
@@ -175,9 +190,11 @@ int TextureObject::GetComponentCount(Format format)
     switch (format)
     {
     case FormatR:
+    case FormatRInteger:
     case FormatDepth:
         return 1;
     case FormatRG:
+    case FormatRGInteger:
     case FormatDepthStencil:
         return 2;
     case FormatRGB:
@@ -185,6 +202,7 @@ int TextureObject::GetComponentCount(Format format)
         return 3;
     case FormatRGBA:
     case FormatBGRA:
+    case FormatRGBAInteger:
         return 4;
     default:
         //Unknown format
@@ -203,7 +221,9 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatR16SNorm:
     case InternalFormatR16F:
     case InternalFormatR32F:
+    case InternalFormatR32UI:
     case InternalFormatRCompressed:
+    case InternalFormatBC4:
     case InternalFormatR11G11B10:
     case InternalFormatRGB10A2:
     case InternalFormatDepth:
@@ -221,7 +241,9 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatRG16SNorm:
     case InternalFormatRG16F:
     case InternalFormatRG32F:
+    case InternalFormatRG32UI:
     case InternalFormatRGCompressed:
+    case InternalFormatBC5:
         return 2;
     case InternalFormatRGB:
     case InternalFormatRGB8:
@@ -233,6 +255,8 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatSRGB8:
     case InternalFormatRGBCompressed:
     case InternalFormatSRGBCompressed:
+    case InternalFormatBC1:
+    case InternalFormatSRGBBC1:
         return 3;
     case InternalFormatRGBA:
     case InternalFormatRGBA8:
@@ -241,12 +265,98 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatRGBA16SNorm:
     case InternalFormatRGBA16F:
     case InternalFormatRGBA32F:
+    case InternalFormatRGBA32UI:
     case InternalFormatSRGBA8:
     case InternalFormatRGBACompressed:
     case InternalFormatSRGBACompressed:
+    case InternalFormatBC3:
+    case InternalFormatSRGBBC3:
+    case InternalFormatBC7:
+    case InternalFormatSRGBBC7:
         return 4;
     default:
         //Unknown format
         return 0;
     }
 }
+
+bool TextureObject::IsBlockCompressed(InternalFormat internalFormat)
+{
+    return GetBlockSize(internalFormat) != 0;
+}
+
+int TextureObject::GetBlockSize(InternalFormat internalFormat)
+{
+    switch (internalFormat)
+    {
+    case InternalFormatBC1:
+    case InternalFormatSRGBBC1:
+    case InternalFormatBC4:
+        return 8;
+    case InternalFormatBC3:
+    case InternalFormatSRGBBC3:
+    case InternalFormatBC5:
+    case InternalFormatBC7:
+    case InternalFormatSRGBBC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+int TextureObject::GetCompressedImageSize(InternalFormat internalFormat, GLsizei width, GLsizei height)
+{
+    assert(IsBlockCompressed(internalFormat));
+    return ((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(internalFormat);
+}
+
+// Check if the driver exposes the extension
+static bool HasExtension(const char* name)
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TextureObject::IsBlockCompressionSupported(InternalFormat internalFormat)
+{
+    // The extension list doesn't change, look for them once
+    static int s_s3tcSupported = -1;
+    static int s_bptcSupported = -1;
+
+    switch (internalFormat)
+    {
+    case InternalFormatBC1:
+    case InternalFormatSRGBBC1:
+    case InternalFormatBC3:
+    case InternalFormatSRGBBC3:
+        // Not core, but every desktop driver has it
+        if (s_s3tcSupported < 0)
+        {
+            s_s3tcSupported = HasExtension("GL_EXT_texture_compression_s3tc");
+        }
+        return s_s3tcSupported != 0;
+    case InternalFormatBC4:
+    case InternalFormatBC5:
+        // Core since OpenGL 3.0
+        return true;
+    case InternalFormatBC7:
+    case InternalFormatSRGBBC7:
+        // Core since OpenGL 4.2
+        if (s_bptcSupported < 0)
+        {
+            s_bptcSupported = GLAD_GL_VERSION_4_2 || HasExtension("GL_ARB_texture_compression_bptc");
+        }
+        return s_bptcSupported != 0;
+    default:
+        return false;
+    }
+}